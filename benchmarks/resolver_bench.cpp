@@ -0,0 +1,213 @@
+/**
+ * @file resolver_bench.cpp
+ * @brief Benchmark for the dependency resolver on a synthetic catalog
+ *
+ * Builds a catalog of 100,000 package versions (50,000 names with two
+ * versions each) and about 1,000,000 dependency edges, then resolves
+ * packages from the top of the graph and checks the timings against
+ * the targets below. Part of the newer versions pin older releases of
+ * their dependencies (^1); those conflicts are settled by trying the
+ * next version of the package that pins. bench-backjump hides a conflict
+ * behind the closure of the largest root, so the resolver has to jump
+ * back over that whole closure, and the run fails unless it does.
+ *
+ * Every plan is checked against the catalog: one version per name, each
+ * dependency present, in range and placed before its dependent.
+ *
+ * Usage: openspm_resolver_bench [versions] [edges-per-version]
+ * Exits non-zero if a target is missed, a resolution fails or a plan
+ * breaks a constraint.
+ */
+#include <catalog.hpp>
+#include <resolver.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace openspm;
+
+namespace
+{
+    /// Indexing the whole catalog (version parsing included)
+    constexpr double CatalogTargetMs = 1000.0;
+    /// Any single resolution, including ones that backtrack
+    constexpr double ResolveTargetMs = 1000.0;
+    constexpr int Roots = 20;
+    constexpr const char *Tags = "bin;linux-x86_64";
+
+    double elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::string nameOf(size_t i)
+    {
+        return "pkg-" + std::to_string(i);
+    }
+
+    /// Names depend on lower-numbered names only, mostly nearby ones, so closures stay realistic
+    std::vector<PackageInfo> buildCatalog(size_t versions, size_t edges)
+    {
+        std::mt19937_64 random(42);
+        size_t names = std::max<size_t>(1, versions / 2);
+        std::vector<PackageInfo> packages;
+        packages.reserve(names * 2 + 9);
+        for (size_t i = 0; i < names; ++i)
+        {
+            for (int major = 1; major <= 2; ++major)
+            {
+                PackageInfo pkg;
+                pkg.name = nameOf(i);
+                pkg.version = std::to_string(major) + ".0.0";
+                pkg.tags = Tags;
+                pkg.url = "https://example.invalid/" + pkg.name + "-" + pkg.version + ".tar.gz";
+                for (size_t e = 0; e < edges && i > 0; ++e)
+                {
+                    size_t span = std::min<size_t>(i, 2000);
+                    size_t dep = i - 1 - static_cast<size_t>(random() % span);
+                    bool pinsOld = major == 2 && random() % 20 == 0;
+                    pkg.dependencies.push_back(nameOf(dep) + (pinsOld ? " ^1" : " >=1"));
+                }
+                packages.push_back(std::move(pkg));
+            }
+        }
+
+        // No version of bench-conflict can coexist with bench-base ^1
+        auto extra = [&packages](const std::string &name, const std::string &version, std::vector<std::string> deps)
+        {
+            PackageInfo pkg;
+            pkg.name = name;
+            pkg.version = version;
+            pkg.tags = Tags;
+            pkg.dependencies = std::move(deps);
+            packages.push_back(std::move(pkg));
+        };
+        extra("bench-base", "1.0.0", {});
+        extra("bench-base", "2.0.0", {});
+        extra("bench-conflict", "1.0.0", {"bench-base ^2"});
+        extra("bench-conflict", "2.0.0", {"bench-base ^2"});
+        extra("bench-unsatisfiable", "1.0.0", {"bench-base ^1", "bench-conflict"});
+        // bench-mid 2 only fails at bench-tail, after the top-level closure has been decided
+        extra("bench-tail", "1.0.0", {"bench-base ^1"});
+        extra("bench-mid", "1.0.0", {"bench-base ^1"});
+        extra("bench-mid", "2.0.0", {"bench-base ^2", "bench-tail"});
+        extra("bench-backjump", "1.0.0", {"bench-mid", nameOf(names - 1)});
+        std::sort(packages.begin(), packages.end(), [](const PackageInfo &a, const PackageInfo &b)
+                  { return a.name < b.name; });
+        return packages;
+    }
+
+    /// Empty if the plan holds, otherwise the first broken constraint
+    std::string checkPlan(const std::vector<PackageInfo> &plan)
+    {
+        std::map<std::string, VersionKey> placed;
+        for (const auto &pkg : plan)
+        {
+            for (const auto &spec : pkg.dependencies)
+            {
+                Dependency dep;
+                std::string parseError;
+                if (parseDependency(spec, dep, parseError) != 0)
+                {
+                    return pkg.name + " " + pkg.version + ": " + parseError;
+                }
+                auto it = placed.find(dep.name);
+                if (it == placed.end() || !dep.range.contains(it->second))
+                {
+                    return pkg.name + " " + pkg.version + " requires " + spec + ", which the plan does not provide before it";
+                }
+            }
+            if (!placed.emplace(pkg.name, parseVersion(pkg.version)).second)
+            {
+                return pkg.name + " is selected twice";
+            }
+        }
+        return "";
+    }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t versions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    size_t edges = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+    bool ok = true;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<PackageInfo> packages = buildCatalog(versions, edges);
+    size_t edgeCount = 0;
+    for (const auto &pkg : packages)
+    {
+        edgeCount += pkg.dependencies.size();
+    }
+    std::cout << "generated " << packages.size() << " versions, " << edgeCount << " edges in " << elapsedMs(start) << " ms\n";
+
+    start = std::chrono::steady_clock::now();
+    Catalog catalog;
+    catalog.setPackages(std::move(packages));
+    double catalogMs = elapsedMs(start);
+    std::cout << "catalog indexed in " << catalogMs << " ms (target " << CatalogTargetMs << " ms)\n";
+    ok = ok && catalogMs <= CatalogTargetMs;
+
+    size_t names = std::max<size_t>(1, versions / 2);
+    std::vector<double> times;
+    std::mt19937_64 random(7);
+    for (int r = 0; r < Roots; ++r)
+    {
+        size_t root = r == 0 ? names - 1 : names / 2 + static_cast<size_t>(random() % (names - names / 2));
+        ResolveResult result;
+        start = std::chrono::steady_clock::now();
+        int status = resolveDependencies(catalog, {Dependency{nameOf(root), VersionRange()}}, Tags, result);
+        double ms = elapsedMs(start);
+        times.push_back(ms);
+        std::cout << nameOf(root) << ": " << (status == 0 ? "resolved " + std::to_string(result.plan.size()) + " packages" : "FAILED")
+                  << ", " << result.decisions << " decisions, " << result.backjumps << " backjumps, " << ms << " ms\n";
+        if (status != 0)
+        {
+            for (const auto &line : result.explanation)
+                std::cout << "  " << line << "\n";
+            ok = false;
+            continue;
+        }
+        std::string problem = checkPlan(result.plan);
+        if (!problem.empty())
+        {
+            std::cout << "  INVALID PLAN: " << problem << "\n";
+            ok = false;
+        }
+    }
+    std::sort(times.begin(), times.end());
+    std::cout << "resolve median " << times[times.size() / 2] << " ms, max " << times.back() << " ms (target " << ResolveTargetMs << " ms)\n";
+    ok = ok && times.back() <= ResolveTargetMs;
+
+    ResolveResult jumped;
+    start = std::chrono::steady_clock::now();
+    int jumpStatus = resolveDependencies(catalog, {Dependency{"bench-backjump", VersionRange()}}, Tags, jumped);
+    double jumpMs = elapsedMs(start);
+    std::cout << "bench-backjump: " << (jumpStatus == 0 ? "resolved " + std::to_string(jumped.plan.size()) + " packages" : "FAILED")
+              << ", " << jumped.decisions << " decisions, " << jumped.backjumps << " backjumps, " << jumpMs << " ms\n";
+    std::string jumpProblem = jumpStatus == 0 ? checkPlan(jumped.plan) : "";
+    if (!jumpProblem.empty())
+    {
+        std::cout << "  INVALID PLAN: " << jumpProblem << "\n";
+    }
+    ok = ok && jumpStatus == 0 && jumpProblem.empty() && jumped.backjumps > 0 && jumpMs <= ResolveTargetMs;
+
+    ResolveResult conflict;
+    start = std::chrono::steady_clock::now();
+    int status = resolveDependencies(catalog, {Dependency{"bench-unsatisfiable", VersionRange()}}, Tags, conflict);
+    double conflictMs = elapsedMs(start);
+    std::cout << "unsatisfiable request: " << (status != 0 ? "rejected" : "RESOLVED") << " in " << conflictMs << " ms\n";
+    for (const auto &line : conflict.explanation)
+    {
+        std::cout << "  " << line << "\n";
+    }
+    ok = ok && status != 0 && conflictMs <= ResolveTargetMs;
+
+    std::cout << (ok ? "all targets met" : "TARGETS MISSED") << "\n";
+    return ok ? 0 : 1;
+}
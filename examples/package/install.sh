@@ -14,5 +14,4 @@ echo "  PKG_MAINTAINER=$PKG_MAINTAINER" >> "$PKG_INSTALL_DIR/$PKG_NAME-installed
 echo "  PKG_DESCRIPTION=$PKG_DESCRIPTION" >> "$PKG_INSTALL_DIR/$PKG_NAME-installed.txt"
 echo "  PKG_TAGS=$PKG_TAGS" >> "$PKG_INSTALL_DIR/$PKG_NAME-installed.txt"
 echo "  PKG_INSTALL_DIR=$PKG_INSTALL_DIR" >> "$PKG_INSTALL_DIR/$PKG_NAME-installed.txt"
-echo "  PKG_SOURCE_DIR=$PKG_SOURCE_DIR" >> "$PKG_INSTALL_DIR/$PKG_NAME-installed.txt"
-sleep 10
\ No newline at end of file
+echo "  PKG_SOURCE_DIR=$PKG_SOURCE_DIR" >> "$PKG_INSTALL_DIR/$PKG_NAME-installed.txt"
\ No newline at end of file
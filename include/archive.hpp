@@ -6,6 +6,7 @@
  * a compressed tar.gz archive used to store OpenSPM metadata.
  */
 #pragma once
+#include <map>
 #include <string>
 #include <vector>
 namespace openspm
@@ -33,6 +34,15 @@ namespace openspm
          * @return 0 on success, non-zero on error
          */
         int writeFile(const std::string &filePath, std::string &data);
+
+        /**
+         * @brief Write, update and remove several files with a single archive rewrite
+         * @param updates Map of file path within the archive to content
+         * @param removals Files to drop from the archive (missing ones are ignored)
+         * @return 0 on success, non-zero on error
+         */
+        int writeFiles(const std::map<std::string, std::string> &updates,
+                       const std::vector<std::string> &removals = {});
         
         /**
          * @brief Read a file from the archive
@@ -41,6 +51,14 @@ namespace openspm
          * @return 0 on success, non-zero if file not found or error
          */
         int readFile(const std::string &filePath, std::string &outData);
+
+        /**
+         * @brief Read several files in one pass over the archive
+         * @param filePaths Paths/names of the files within the archive
+         * @param outFiles Receives path to content for every file found
+         * @return 0 on success (even if some files are missing), non-zero if the archive can't be read
+         */
+        int readFiles(const std::vector<std::string> &filePaths, std::map<std::string, std::string> &outFiles);
         
         /**
          * @brief Delete a file from the archive
@@ -63,6 +81,9 @@ namespace openspm
         int createArchive();
 
     private:
+        /// Read every entry (all == true) or only those in @p wanted, in one pass
+        int readEntries(const std::vector<std::string> &wanted, bool all, std::map<std::string, std::string> &outFiles);
+
         std::string archivePath;  ///< Path to the archive file
     };
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+/**
+ * @file bloom_filter.hpp
+ * @brief Bloom filters over package names
+ *
+ * `update` stores one filter per repository shard in the data archive, so
+ * lookups can rule out a package, or a shard, without parsing any index
+ * data. With the default 10 bits per name, about 1% of absent names are
+ * reported as possibly present; present names are never missed.
+ *
+ * Layout of a filter set (integers little-endian):
+ * - magic "OSPMBLM1"
+ * - u32 filter count
+ * - per filter: u32 key length, key bytes, u32 hash count, u32 byte count, bit bytes
+ */
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+namespace openspm
+{
+    /**
+     * @brief Fixed-size Bloom filter using double hashing
+     */
+    class BloomFilter
+    {
+    public:
+        /**
+         * @brief Build a filter sized for a set of names
+         * @param names Names to insert
+         * @param bitsPerName Filter bits per name; 10 gives about 1% false positives
+         * @return Filter containing every name
+         */
+        static BloomFilter build(const std::vector<std::string_view> &names, unsigned bitsPerName = 10);
+
+        /**
+         * @brief Test a name
+         * @param name Name to look up
+         * @return false if the name is definitely absent, true if it may be present
+         */
+        bool mayContain(std::string_view name) const;
+
+        /**
+         * @brief Append the filter in the layout above (without key)
+         * @param out Buffer to append to
+         */
+        void serialize(std::string &out) const;
+
+        /**
+         * @brief Read a filter written by serialize()
+         * @param data Start of the filter
+         * @param size Bytes available
+         * @param out Receives the filter
+         * @return Bytes consumed, or 0 if the data is truncated or invalid
+         */
+        static size_t parse(const char *data, size_t size, BloomFilter &out);
+
+    private:
+        std::uint32_t hashCount = 0;
+        std::vector<std::uint8_t> bits;
+    };
+
+    /// Filters keyed by repository URL
+    using BloomFilterSet = std::map<std::string, BloomFilter>;
+
+    /**
+     * @brief Serialize a filter set
+     * @param filters Filters to write
+     * @return Binary filter set
+     */
+    std::string serializeBloomFilters(const BloomFilterSet &filters);
+
+    /**
+     * @brief Parse a filter set
+     * @param data Binary filter set
+     * @param outFilters Receives the filters
+     * @return 0 on success, non-zero if the data is not a valid filter set
+     */
+    int parseBloomFilters(const std::string &data, BloomFilterSet &outFilters);
+} // namespace openspm
@@ -0,0 +1,169 @@
+/**
+ * @file catalog.hpp
+ * @brief Session-scoped in-memory package catalog
+ *
+ * Loads the package index and repository list from the data archive once
+ * per command and indexes them by name, so the install and update paths
+ * don't decompress and re-parse the archive for every lookup.
+ *
+ * Every version of a package is kept. Versions are parsed once into
+ * VersionKey when the package set is replaced; each name maps to its
+ * versions in ascending order, so the newest version satisfying a range is
+ * one hash lookup and one binary search.
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <closure_index.hpp>
+#include <package_manager.hpp>
+#include <repository_manager.hpp>
+#include <version.hpp>
+namespace openspm
+{
+    /**
+     * @brief Package and repository metadata indexed for fast lookup
+     */
+    class Catalog
+    {
+    public:
+        /**
+         * @brief Load both the package index and the repository list
+         * @return 0 on success, non-zero if the package index is missing or invalid
+         */
+        int load();
+
+        /**
+         * @brief Load the merged package index from the data archive
+         * @return 0 on success, non-zero if missing or invalid
+         */
+        int loadPackages();
+
+        /**
+         * @brief Load only what is needed to resolve one package
+         *
+         * Uses the shard filters to skip shards that can't contain the
+         * package or its dependencies. An unknown package loads nothing.
+         *
+         * @param packageName Package that will be resolved
+         * @return 0 on success, non-zero if the index is missing or invalid
+         */
+        int loadPackagesFor(const std::string &packageName);
+
+        /**
+         * @brief Load repositories.yaml from the data archive
+         *
+         * A missing file is not an error; the catalog simply has no repositories.
+         *
+         * @return 0 on success, non-zero on parse error
+         */
+        int loadRepositories();
+
+        /**
+         * @brief Replace the package set (e.g. after an index update)
+         * @param packages New package list
+         */
+        void setPackages(std::vector<PackageInfo> packages);
+
+        /**
+         * @brief Attach precomputed dependency closures for the current package set
+         *
+         * Cleared by setPackages(), since closures only hold for the index
+         * they were built from.
+         *
+         * @param index Loaded closure index
+         */
+        void setClosureIndex(ClosureIndex index) { closureIndex = std::move(index); }
+
+        /**
+         * @brief Precomputed dependency closures, if the index had any
+         * @return Closure index (check ClosureIndex::loaded())
+         */
+        const ClosureIndex &closures() const { return closureIndex; }
+
+        /**
+         * @brief Add or replace a repository entry
+         * @param repoInfo Repository information
+         */
+        void setRepository(const RepositoryInfo &repoInfo);
+
+        /**
+         * @brief Find the newest version of a package
+         * @param name Package name
+         * @return Pointer to the package, or nullptr if not present
+         */
+        const PackageInfo *findPackage(const std::string &name) const;
+
+        /**
+         * @brief Find the newest version of a package within a range
+         * @param name Package name
+         * @param range Acceptable versions
+         * @return Pointer to the package, or nullptr if no version satisfies @p range
+         */
+        const PackageInfo *findPackage(const std::string &name, const VersionRange &range) const;
+
+        /**
+         * @brief All versions of a package
+         * @param name Package name
+         * @return Packages, oldest version first; empty if unknown
+         */
+        std::vector<const PackageInfo *> findVersions(const std::string &name) const;
+
+        /**
+         * @brief Parsed version of a package held by this catalog
+         * @param pkg Package returned by findPackage() or packages()
+         * @return Version key
+         */
+        VersionKey versionOf(const PackageInfo &pkg) const { return versionKeys[static_cast<size_t>(&pkg - packageList.data())]; }
+
+        /**
+         * @brief Find a repository by URL
+         * @param url Repository URL
+         * @return Pointer to the repository, or nullptr if not present
+         */
+        const RepositoryInfo *findRepository(const std::string &url) const;
+
+        /**
+         * @brief All packages, in index order (by name, then version, for the merged index)
+         * @return Package list
+         */
+        const std::vector<PackageInfo> &packages() const { return packageList; }
+
+        /**
+         * @brief All repository URLs, in configuration order
+         * @return Repository URL list
+         */
+        const std::vector<std::string> &repositoryUrls() const { return repositoryOrder; }
+
+        /**
+         * @brief Whether the package index has been loaded or set
+         * @return true if packages are available
+         */
+        bool packagesLoaded() const { return havePackages; }
+
+    private:
+        /// Range of versionOrder holding one name's versions
+        struct VersionSpan
+        {
+            size_t begin;
+            size_t end;
+        };
+
+        std::vector<PackageInfo> packageList;
+        std::vector<VersionKey> versionKeys;  ///< Parsed version of each packageList entry
+        std::vector<size_t> versionOrder;     ///< packageList positions grouped by name, oldest first
+        std::unordered_map<std::string, VersionSpan> packageIndex;
+        std::unordered_map<std::string, RepositoryInfo> repositories;
+        std::vector<std::string> repositoryOrder;
+        ClosureIndex closureIndex;
+        bool havePackages = false;
+    };
+
+    /**
+     * @brief Parse a packages.yaml document
+     * @param content YAML content
+     * @param outPackages Vector to append packages to
+     * @return 0 on success, non-zero on invalid format
+     */
+    int parsePackageIndex(const std::string &content, std::vector<PackageInfo> &outPackages);
+} // namespace openspm
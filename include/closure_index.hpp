@@ -0,0 +1,91 @@
+/**
+ * @file closure_index.hpp
+ * @brief Precomputed dependency closures for every package
+ *
+ * Built from the merged package view during `update` and stored in the
+ * data archive as closures.idx, so resolving an install plan is one
+ * binary search instead of a recursive walk.
+ *
+ * The dependency graph is condensed into strongly connected components
+ * (Tarjan), so cycles resolve instead of recursing forever. Components are
+ * processed level by level, in parallel, with a package's closure built
+ * from the closures of its dependencies. The install order is the one
+ * the recursive walk produces: dependencies depth-first in declaration
+ * order, each package after everything it needs. Members of a cycle come
+ * together, with the requested package last.
+ *
+ * Closures follow the newest version of each package and ignore version
+ * constraints; a resolver checks the constraints along the plan and falls
+ * back to a full resolution when they don't hold.
+ *
+ * Closures are stored reversed (package first), so a package whose
+ * closure is the beginning of another's shares that list's tail.
+ *
+ * Layout (integers little-endian):
+ * - magic "OSPMCLO1"
+ * - u32 package count, u32 pool length
+ * - entries: u32 pool offset, u32 length (high bit set if a dependency is missing)
+ * - u32 name offsets, package count + 1
+ * - pool: u32 package numbers
+ * - name bytes, sorted by name
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <package_manager.hpp>
+#include <utils.hpp>
+namespace openspm
+{
+    /// Name of the closure index inside the data archive
+    constexpr const char *ClosureIndexFile = "closures.idx";
+
+    /**
+     * @brief Serialize the closure index for a package list
+     * @param packages Merged package view, sorted by name, then version
+     * @return Binary index
+     */
+    std::string buildClosureIndex(const std::vector<PackageInfo> &packages);
+
+    /**
+     * @brief A loaded closure index
+     */
+    class ClosureIndex
+    {
+    public:
+        /**
+         * @brief Outcome of a lookup
+         */
+        enum class Result
+        {
+            Found,     ///< Install order returned
+            Unknown,   ///< No such package in the index
+            Incomplete ///< A package in the closure depends on a package that doesn't exist
+        };
+
+        /**
+         * @brief Take ownership of closures.idx content
+         * @param content Index bytes
+         * @return 0 on success, non-zero if the data is not a closure index
+         */
+        int load(std::string content);
+
+        /**
+         * @brief Whether an index is loaded
+         * @return true if load() succeeded
+         */
+        bool loaded() const { return table.size() > 0; }
+
+        /**
+         * @brief Install order for a package
+         * @param name Package name
+         * @param outOrder Receives the closure, dependencies first and @p name last
+         * @return Lookup outcome; @p outOrder is only filled for Result::Found
+         */
+        Result lookup(std::string_view name, std::vector<std::string_view> &outOrder) const;
+
+    private:
+        NamePool table;
+    };
+} // namespace openspm
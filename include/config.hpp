@@ -40,6 +40,11 @@ namespace openspm
         std::string logsFile = "/var/log/openspm/openspm.log";  ///< Log file path
 #endif
         std::string unsupported_msg = "";            ///< Message if platform unsupported
+        std::string durability = "none";             ///< Install durability mode: none, batch or strict
+        unsigned scriptTimeout = 600;                ///< Post-install script timeout in seconds (0 = none)
+        unsigned scriptJobs = 0;                     ///< Concurrent post-install scripts (0 = CPU count)
+        std::string metricsFile = "";                ///< Prometheus textfile written after each run (empty = off)
+        bool useDaemon = true;                       ///< Answer queries through openspmd when it is running
     };
     
     /**
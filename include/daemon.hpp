@@ -0,0 +1,54 @@
+/**
+ * @file daemon.hpp
+ * @brief Resident query daemon (openspmd) and its client
+ *
+ * openspmd keeps the package catalog parsed in memory and answers
+ * read-only queries from the CLI over a Unix domain socket at
+ * `<dataDir>/openspmd.sock`. The CLI falls back to loading the catalog
+ * itself when no daemon is listening.
+ *
+ * Protocol: one request per connection, a single line of tab-separated
+ * fields (`command`, `tags`, then arguments). The response is a series of
+ * lines: `P` package records, then a final `S <status>` line. Fields are
+ * escaped so they never contain tabs or newlines.
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <package_manager.hpp>
+namespace openspm
+{
+    /**
+     * @brief Path of the daemon socket for the configured data directory
+     * @return Socket path
+     */
+    std::string daemonSocketPath();
+
+    /**
+     * @brief Serve queries until SIGINT or SIGTERM
+     *
+     * The data archive must already be initialized. The catalog is reloaded
+     * whenever data.bin changes on disk, so `openspm update` run without the
+     * daemon is picked up automatically.
+     *
+     * @return 0 on clean shutdown, non-zero if the socket could not be set up
+     */
+    int runDaemon();
+
+    /**
+     * @brief Send a query to a running daemon
+     *
+     * Supported commands:
+     * - `list-packages`: packages compatible with @p tags
+     * - `resolve <package>`: the package and its dependencies in install order
+     *
+     * @param command Query command
+     * @param argument Command argument (empty if none)
+     * @param tags Supported tags of the caller
+     * @param outPackages Receives the returned packages
+     * @param outStatus Receives the daemon's status for the query
+     * @return true if a daemon answered, false if none is running (fall back to standalone mode)
+     */
+    bool queryDaemon(const std::string &command, const std::string &argument, const std::string &tags,
+                     std::vector<PackageInfo> &outPackages, int &outStatus);
+} // namespace openspm
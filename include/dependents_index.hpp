@@ -0,0 +1,70 @@
+/**
+ * @file dependents_index.hpp
+ * @brief Reverse dependencies for every package
+ *
+ * Built from the merged package view during `update` and stored in the
+ * data archive as dependents.idx, so "what depends on X" is one binary
+ * search instead of a scan over every package's dependencies.
+ *
+ * A package counts as a dependent if any of its versions lists the
+ * dependency, whatever the version constraint. Dependencies on packages
+ * that don't exist are left out.
+ *
+ * Layout (integers little-endian):
+ * - magic "OSPMRDP1"
+ * - u32 package count, u32 pool length
+ * - entries: u32 pool offset, u32 length
+ * - u32 name offsets, package count + 1
+ * - pool: u32 package numbers, each entry's dependents sorted by name
+ * - name bytes, sorted by name
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <package_manager.hpp>
+#include <utils.hpp>
+namespace openspm
+{
+    /// Name of the reverse-dependency index inside the data archive
+    constexpr const char *DependentsIndexFile = "dependents.idx";
+
+    /**
+     * @brief Serialize the reverse-dependency index for a package list
+     * @param packages Merged package view, sorted by name, then version
+     * @return Binary index
+     */
+    std::string buildDependentsIndex(const std::vector<PackageInfo> &packages);
+
+    /**
+     * @brief A loaded reverse-dependency index
+     */
+    class DependentsIndex
+    {
+    public:
+        /**
+         * @brief Take ownership of dependents.idx content
+         * @param content Index bytes
+         * @return 0 on success, non-zero if the data is not a reverse-dependency index
+         */
+        int load(std::string content);
+
+        /**
+         * @brief Whether an index is loaded
+         * @return true if load() succeeded
+         */
+        bool loaded() const { return table.size() > 0; }
+
+        /**
+         * @brief Packages that depend directly on a package
+         * @param name Package name
+         * @param outDependents Receives the dependents, sorted by name; views into the index
+         * @return true if the package is in the index
+         */
+        bool lookup(std::string_view name, std::vector<std::string_view> &outDependents) const;
+
+    private:
+        NamePool table;
+    };
+} // namespace openspm
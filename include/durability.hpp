@@ -0,0 +1,84 @@
+/**
+ * @file durability.hpp
+ * @brief Durability policy for files written by the installer
+ *
+ * Controls when installed files are forced to stable storage:
+ * - none: leave it to the kernel (fastest, not crash safe)
+ * - batch: write everything, then sync once per transaction
+ * - strict: fdatasync every file and its directory as it is written
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_set>
+namespace openspm
+{
+    /**
+     * @brief How aggressively installed files are synced to disk
+     */
+    enum class DurabilityMode
+    {
+        None,   ///< No explicit syncing
+        Batch,  ///< One syncfs (or grouped fdatasync) per transaction
+        Strict  ///< fdatasync each file and its parent directory immediately
+    };
+
+    /**
+     * @brief Parse a durability mode name ("none", "batch", "strict")
+     * @param value Mode name
+     * @param outMode Parsed mode
+     * @return true if the name is valid
+     */
+    bool parseDurabilityMode(const std::string &value, DurabilityMode &outMode);
+
+    /**
+     * @brief Get the name of a durability mode
+     * @param mode Durability mode
+     * @return Mode name as accepted by parseDurabilityMode
+     */
+    std::string durabilityModeName(DurabilityMode mode);
+
+    /**
+     * @brief Tracks files written during one install transaction
+     *
+     * Call fileWritten() after each file is in place and commit() once all
+     * of them are written; packages must only be recorded as installed
+     * after commit() succeeds.
+     */
+    class SyncBatch
+    {
+    public:
+        /**
+         * @brief Create a batch for the given policy
+         * @param mode Durability mode to apply
+         */
+        explicit SyncBatch(DurabilityMode mode);
+
+        /**
+         * @brief Record a file that has been fully written
+         * @param path Path of the written file
+         * @return 0 on success, non-zero if a strict sync failed
+         */
+        int fileWritten(const std::string &path);
+
+        /**
+         * @brief Make every recorded file durable
+         * @return 0 on success, non-zero on error
+         */
+        int commit();
+
+        /**
+         * @brief Number of files recorded so far
+         * @return File count
+         */
+        size_t fileCount() const { return files; }
+
+    private:
+        DurabilityMode mode;
+        size_t files = 0;
+        std::vector<std::string> pendingFiles;      ///< Files to sync when syncfs is unavailable
+        std::unordered_set<std::string> seenDirs;   ///< Parent directories already inspected
+        std::vector<std::string> filesystemRoots;   ///< One directory per distinct filesystem
+        std::unordered_set<unsigned long long> seenDevices;
+    };
+} // namespace openspm
@@ -0,0 +1,32 @@
+/**
+ * @file extractor.hpp
+ * @brief Package archive extraction
+ *
+ * Unpacks downloaded package archives into a staging directory. On Linux
+ * builds with io_uring support, small regular files are created, written
+ * and closed in batches through a single submission ring; everything else
+ * (and every platform without io_uring) goes through libarchive's
+ * archive_write_disk.
+ */
+#pragma once
+#include <string>
+namespace openspm
+{
+    /**
+     * @brief Extract a package archive into a directory
+     *
+     * Uses the batched io_uring sink when it was compiled in and the kernel
+     * accepts it, otherwise falls back to libarchive's disk writer.
+     *
+     * @param archivePath Path to the downloaded package archive
+     * @param extractPath Directory to extract into (must already exist)
+     * @return 0 on success, non-zero on error
+     */
+    int extractPackageArchive(const std::string &archivePath, const std::string &extractPath);
+
+    /**
+     * @brief Check whether the io_uring extraction sink is usable
+     * @return true if compiled in and supported by the running kernel
+     */
+    bool ioUringExtractionAvailable();
+} // namespace openspm
@@ -0,0 +1,220 @@
+/**
+ * @file index_shards.hpp
+ * @brief Per-repository package index shards
+ *
+ * Every fetched package list is stored in the data archive as its own
+ * shard, `shards/<hash>.json`, sorted by package name. `shards.yaml`
+ * records where each shard came from, the HTTP validators used to refresh
+ * it conditionally and the `depend` lists it referenced, so refreshing one
+ * repository only rewrites that repository's shard.
+ *
+ * The merged view used for lookups is built from the shards with a k-way
+ * merge. The shard texts are read from the archive whole, and the result
+ * is a complete list. What the merge bounds is the decoding: each shard
+ * is parsed one package at a time, so only one decoded package per shard
+ * plus the versions of the name being merged are held besides the result.
+ * Which repository a package comes from is decided per name, so the result
+ * depends only on repositories.yaml and the shards, never on fetch order:
+ *
+ * 1. If repositories pin the name, only their versions inside the pin
+ *    ranges are considered.
+ * 2. Of the remaining repositories offering the name, only those with the
+ *    highest priority contribute versions.
+ * 3. For the same name and version, repositories later in the
+ *    configuration win, and a repository wins over the repositories it
+ *    depends on.
+ *
+ * `filters.bin` holds a Bloom filter over each shard's package names, so
+ * resolving one package parses only the shards that may contain it and
+ * its dependencies, and an unknown name is rejected without parsing any.
+ */
+#pragma once
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <package_manager.hpp>
+#include <repository_manager.hpp>
+#include <version.hpp>
+namespace openspm
+{
+    class ClosureIndex;
+
+    /// Name of the shard manifest inside the data archive
+    constexpr const char *ShardManifestFile = "shards.yaml";
+
+    /// Name of the per-shard Bloom filters inside the data archive
+    constexpr const char *ShardFilterFile = "filters.bin";
+
+    /**
+     * @brief Provenance of one shard
+     */
+    struct ShardInfo
+    {
+        std::string url;                 ///< Repository URL the list was fetched from
+        std::string file;                ///< Shard path inside the data archive
+        std::string source;              ///< Format served by the repository ("json" or "yaml")
+        std::string etag;                ///< ETag of the last full response
+        std::string lastModified;        ///< Last-Modified of the last full response
+        long long updated = 0;           ///< Unix time the shard was last downloaded
+        size_t packages = 0;             ///< Number of packages in the shard
+        std::vector<std::string> depend; ///< Repositories this list depends on
+    };
+
+    /// Shard provenance by repository URL
+    using ShardManifest = std::map<std::string, ShardInfo>;
+
+    /**
+     * @brief Archive path of the shard for a repository
+     * @param url Repository URL
+     * @return Path such as `shards/3f2a...json`
+     */
+    std::string shardFileName(const std::string &url);
+
+    /**
+     * @brief Parse shards.yaml
+     * @param content Manifest text
+     * @param outManifest Receives the entries
+     * @return 0 on success, non-zero on invalid format
+     */
+    int parseShardManifest(const std::string &content, ShardManifest &outManifest);
+
+    /**
+     * @brief Serialize shards.yaml
+     * @param manifest Entries to write
+     * @return Manifest text
+     */
+    std::string serializeShardManifest(const ShardManifest &manifest);
+
+    /**
+     * @brief Order in which shards are merged
+     *
+     * Each repository is preceded by the repositories it depends on. A
+     * shard reachable several times keeps only its last position, and
+     * dependency cycles are cut.
+     *
+     * @param repositoryUrls Configured repositories, in configuration order
+     * @param manifest Shard manifest
+     * @return Repository URLs with a shard, lowest priority first
+     */
+    std::vector<std::string> shardMergeOrder(const std::vector<std::string> &repositoryUrls, const ShardManifest &manifest);
+
+    /**
+     * @brief Merge settings of one shard
+     */
+    struct ShardPolicy
+    {
+        int priority = 0;                         ///< Only the highest-priority shards offering a name contribute to it
+        std::map<std::string, VersionRange> pins; ///< Names taken only from pinning shards, restricted to these versions
+    };
+
+    /**
+     * @brief Priorities and pins of the shards in a merge order
+     *
+     * A configured repository uses its own settings. A repository only
+     * reachable as a dependency takes the highest priority of the configured
+     * repositories that depend on it and pins nothing. Pins with an invalid
+     * range are reported and ignored.
+     *
+     * @param order Merge order from shardMergeOrder()
+     * @param repositories Configured repositories
+     * @param manifest Shard manifest
+     * @return One policy per entry of @p order
+     */
+    std::vector<ShardPolicy> shardPolicies(const std::vector<std::string> &order,
+                                           const std::vector<RepositoryInfo> &repositories, const ShardManifest &manifest);
+
+    /**
+     * @brief One input of the merge, read one package at a time
+     */
+    struct MergeSource
+    {
+        std::string url;                         ///< Repository URL, recorded in PackageInfo::repository
+        std::function<bool(PackageInfo &)> next; ///< Stores the next package, in name order; false after the last
+        ShardPolicy policy;                      ///< Priority and pins of the shard
+    };
+
+    /**
+     * @brief Merge source over packages already in memory
+     * @param packages Packages in any order; stably sorted by name first if needed
+     * @param policy Priority and pins of the shard
+     * @return Source yielding @p packages
+     */
+    MergeSource packageSource(std::vector<PackageInfo> packages, ShardPolicy policy = ShardPolicy());
+
+    /**
+     * @brief Streaming k-way merge into one list sorted by name, then version
+     *
+     * Each name is resolved with the rules above as soon as all of its
+     * versions have been read, so besides the result and whatever the
+     * sources themselves keep (such as a shard's text), only one package
+     * per source is held. A source that goes out of name order is reported
+     * and not read further.
+     *
+     * @param sources Package sources, lowest priority first
+     * @return Merged packages, unique by name and version
+     */
+    std::vector<PackageInfo> mergeShards(std::vector<MergeSource> sources);
+
+    /**
+     * @brief Merge packages of several repositories again, with the rules above
+     *
+     * For packages that meet outside of `update`, such as the local index
+     * and packages fetched from sparse repositories at install time. Each
+     * package belongs to the repository in PackageInfo::repository;
+     * packages of unknown repositories merge with the default policy,
+     * below all configured ones.
+     *
+     * @param packages Packages of any repositories, in any order
+     * @param repositories Configured repositories, in configuration order
+     * @param manifest Shard manifest, for repositories only reachable as dependencies
+     * @return Merged packages, sorted by name, then version
+     */
+    std::vector<PackageInfo> mergeRepositoryPackages(std::vector<PackageInfo> packages,
+                                                     const std::vector<RepositoryInfo> &repositories, ShardManifest manifest);
+
+    /**
+     * @brief K-way merge of in-memory package lists without priorities or pins
+     * @param shards Package lists, lowest priority first
+     * @return Merged packages, unique by name and version
+     */
+    std::vector<PackageInfo> mergeShards(std::vector<std::vector<PackageInfo>> shards);
+
+    /**
+     * @brief Load the merged package view from the data archive
+     *
+     * Falls back to the single packages.yaml written by older versions
+     * when no shard manifest exists yet.
+     *
+     * @param outPackages Receives the merged packages, sorted by name
+     * @param outClosures If set, receives the closure index when the archive has one
+     * @return 0 on success, non-zero if no index exists or it is invalid
+     */
+    int loadMergedPackages(std::vector<PackageInfo> &outPackages, ClosureIndex *outClosures = nullptr);
+
+    /**
+     * @brief Load the packages needed to resolve one package
+     *
+     * Consults the shard filters first: if no shard may contain
+     * @p packageName, nothing else is read. Otherwise only the shards whose
+     * filters match a name in the dependency closure are parsed. Every
+     * package in the closure, with all of its versions, resolves exactly
+     * as in the full merged view. When the closure index knows the
+     * package, its precomputed closure seeds the walk, and a name it
+     * doesn't know loads nothing. Without filters (index written by an
+     * older version), the full view is loaded.
+     *
+     * @param packageName Package to resolve
+     * @param outPackages Receives the merged packages of the parsed shards, sorted by name
+     * @param outClosures If set, receives the closure index when the archive has one
+     * @return 0 on success (an unknown package gives an empty list), non-zero if no index exists or it is invalid
+     */
+    int loadPackageClosure(const std::string &packageName, std::vector<PackageInfo> &outPackages,
+                           ClosureIndex *outClosures = nullptr);
+
+    /**
+     * @brief Whether the data archive holds a package index
+     * @return true if shards or a legacy packages.yaml exist
+     */
+    bool hasPackageIndex();
+} // namespace openspm
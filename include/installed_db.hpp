@@ -0,0 +1,237 @@
+/**
+ * @file installed_db.hpp
+ * @brief Database of installed packages and the files they own
+ *
+ * Kept in `<dataDir>/installed`, outside the data archive, so checking
+ * whether a package is installed reads one small file instead of
+ * decompressing data.bin:
+ *
+ * - `packages.idx`: one record per installed package, sorted by name, so
+ *   lookups are a binary search over the file. Layout (integers
+ *   little-endian):
+ *   - magic "OSPMINS1"
+ *   - u32 package count
+ *   - u32 record offsets: count + 1 entries, relative to the record pool
+ *   - records: name, version and repository (each u32 length + bytes),
+ *     u64 install time, u32 file count, u64 total bytes, then (absent in
+ *     records written by older versions) u8 flags (1 = automatic), the
+ *     dependency names and the names of the installed packages requiring
+ *     this one (each list a u32 count + strings)
+ * - `manifests/<hash>.files`: the files and directories of one package,
+ *   sorted by path and read only when needed (removal, reinstall):
+ *   - magic "OSPMMAN1", package name (u32 length + bytes), u32 entry count
+ *   - per entry: u8 type ('f' file, 'd' directory), u32 mode, u64 size,
+ *     u64 FNV-1a hash of the contents, path (u32 length + bytes)
+ * - `paths.idx`: which packages own each path, so ownership and conflict
+ *   checks never read every manifest. Entries are sorted by path hash and
+ *   looked up by binary search. A hit is confirmed against the owner's
+ *   manifest, so hash collisions can't produce false owners:
+ *   - magic "OSPMPTH1", u64 FNV-1a hash of the `packages.idx` it belongs to,
+ *     u32 entry count
+ *   - per entry: u64 FNV-1a hash of the path, u32 owner (position of the
+ *     package in `packages.idx`, top bit set for a directory)
+ *
+ * All files are replaced atomically. A transaction writes the manifests
+ * first, then the path index, and the package index last, so the index never
+ * points at a manifest that isn't on disk. A path index whose stamp doesn't
+ * match the package index is rebuilt from the manifests.
+ */
+#pragma once
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+namespace openspm
+{
+    /// Directory of the installed-package database, below the data directory
+    constexpr const char *InstalledDir = "installed";
+
+    /**
+     * @brief One file or directory installed by a package
+     */
+    struct InstalledFile
+    {
+        std::string path;         ///< Relative to the target directory, '/'-separated
+        bool directory = false;   ///< Directory created for the package
+        std::uint32_t mode = 0;   ///< Permission bits
+        std::uint64_t size = 0;   ///< File size in bytes, 0 for directories
+        std::uint64_t hash = 0;   ///< fnv1a64 of the contents, 0 for directories
+    };
+
+    /**
+     * @brief Index record of an installed package
+     */
+    struct InstalledPackage
+    {
+        std::string name;             ///< Package name
+        std::string version;          ///< Installed version
+        std::string repository;       ///< Repository it was installed from, empty if unknown
+        long long installedAt = 0;    ///< Unix time of the install
+        std::uint32_t fileCount = 0;  ///< Files in the manifest, directories excluded
+        std::uint64_t totalBytes = 0; ///< Sum of the file sizes
+        bool automatic = false;       ///< Installed only as a dependency; autoremove may take it
+        std::vector<std::string> dependencies; ///< Names of the packages it depends on
+        std::vector<std::string> requiredBy;   ///< Installed packages depending on it, kept up to date by save()
+    };
+
+    /**
+     * @brief An installed package that lists a path
+     */
+    struct PathOwner
+    {
+        std::string package;    ///< Package name
+        bool directory = false; ///< Listed as a directory rather than a file
+    };
+
+    /**
+     * @brief Path of the installed-package database for the configured data directory
+     * @return Database directory
+     */
+    std::string installedDatabasePath();
+
+    /**
+     * @brief Hash a file's contents the way manifests record them
+     * @param path File to read
+     * @param outSize Receives the number of bytes read
+     * @param outHash Receives the fnv1a64 hash
+     * @return 0 on success, non-zero if the file can't be read
+     */
+    int hashFile(const std::string &path, std::uint64_t &outSize, std::uint64_t &outHash);
+
+    /**
+     * @brief The installed-package database, with changes staged until save()
+     */
+    class InstalledDatabase
+    {
+    public:
+        /**
+         * @brief Load the index
+         * @param dir Database directory, normally installedDatabasePath()
+         * @return 0 on success (a missing index is an empty database), non-zero if the index is invalid
+         */
+        int open(const std::string &dir);
+
+        /**
+         * @brief Whether a package is installed
+         * @param name Package name
+         * @return true if installed, counting staged changes
+         */
+        bool isInstalled(std::string_view name) const;
+
+        /**
+         * @brief Look up an installed package
+         * @param name Package name
+         * @param outPackage Receives the record
+         * @return true if installed, counting staged changes
+         */
+        bool find(std::string_view name, InstalledPackage &outPackage) const;
+
+        /**
+         * @brief All installed packages
+         * @return Records sorted by name, counting staged changes
+         */
+        std::vector<InstalledPackage> list() const;
+
+        /**
+         * @brief Read the manifest of an installed package
+         * @param name Package name
+         * @param outFiles Receives the entries, sorted by path
+         * @return 0 on success, non-zero if the package isn't installed or its manifest is unreadable
+         */
+        int readManifest(const std::string &name, std::vector<InstalledFile> &outFiles) const;
+
+        /**
+         * @brief Installed packages that list a path
+         *
+         * Answered from the path index. Several packages may list the same
+         * directory; a file normally has one owner.
+         *
+         * @param path Relative to the target directory, '/'-separated
+         * @param exact Confirm index hits against the manifests; without it,
+         *        a package whose path merely shares the hash may be returned
+         * @return Owners sorted by package name, counting staged changes
+         */
+        std::vector<PathOwner> owners(const std::string &path, bool exact = true) const;
+
+        /**
+         * @brief Installed packages that depend directly on a package
+         *
+         * Read from the package's record, not computed by scanning the others.
+         *
+         * @param name Package name
+         * @return Dependents sorted by name, counting staged changes
+         */
+        std::vector<std::string> dependents(std::string_view name) const;
+
+        /**
+         * @brief Automatic packages that no explicitly installed package needs any more
+         * @return Orphans sorted by name, counting staged changes
+         */
+        std::vector<std::string> orphans() const;
+
+        /**
+         * @brief Whether a package about to be installed is recorded as automatic
+         *
+         * It is unless it was asked for by name or an earlier install of it
+         * was explicit. Without requested names nothing is automatic.
+         *
+         * @param name Package name
+         * @param requestedNames Packages the user asked for
+         * @return true if the new record should carry the automatic flag
+         */
+        bool installsAutomatically(std::string_view name, const std::vector<std::string> &requestedNames) const;
+
+        /**
+         * @brief Stage a package as installed, replacing any previous record
+         *
+         * The manifest is written immediately; the index follows on save().
+         * File count and total bytes are taken from @p files.
+         *
+         * @param package Record to store
+         * @param files Installed files and directories, in any order
+         * @return 0 on success, non-zero if the manifest couldn't be written
+         */
+        int record(InstalledPackage package, std::vector<InstalledFile> files);
+
+        /**
+         * @brief Stage a package as removed; its manifest is deleted on save()
+         * @param name Package name
+         */
+        void forget(const std::string &name);
+
+        /**
+         * @brief Write the index with all staged changes
+         * @return 0 on success, non-zero on error
+         */
+        int save();
+
+    private:
+        /// Path index entry: path hash and owner position, top bit marking a directory
+        struct PathEntry
+        {
+            std::uint64_t hash;
+            std::uint32_t owner;
+        };
+
+        std::string_view recordAt(std::uint32_t i) const;
+        bool findStored(std::string_view name, InstalledPackage &outPackage) const;
+        std::string manifestPath(const std::string &name) const;
+        void loadPaths() const;
+        bool listsPath(const std::string &name, const std::string &path, bool &outDirectory) const;
+
+        std::string directory;
+        std::string index;           ///< Contents of packages.idx
+        std::uint32_t count = 0;
+        const char *offsets = nullptr;
+        const char *pool = nullptr;
+        size_t poolSize = 0;
+        std::uint64_t indexStamp = 0;  ///< fnv1a64 of the index, matched by the path index
+        std::map<std::string, std::optional<InstalledPackage>, std::less<>> staged; ///< nullopt marks a removal
+        std::map<std::string, std::vector<InstalledFile>, std::less<>> stagedFiles; ///< Manifests of staged installs, sorted by path
+        mutable bool pathsLoaded = false;
+        mutable std::vector<PathEntry> paths;  ///< Stored path index, sorted by hash; loaded on first use
+        mutable std::map<std::string, std::vector<InstalledFile>, std::less<>> manifestCache; ///< Manifests read to confirm index hits
+    };
+} // namespace openspm
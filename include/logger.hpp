@@ -27,6 +27,33 @@
 #define CL_PURPLE "\033[0;35m"
 /// ANSI escape sequence to clear current line
 #define CLEAR_LINE "\033[2K\r"
+
+/**
+ * @brief Log a debug message, building it only when debug output is enabled
+ *
+ * The argument is not evaluated unless debug mode is on, so string
+ * concatenation and std::to_string calls cost nothing otherwise. Building
+ * with OPENSPM_STRIP_DEBUG_LOG removes the calls entirely.
+ */
+#ifdef OPENSPM_STRIP_DEBUG_LOG
+#define OPENSPM_DEBUG(message)                       \
+    do                                               \
+    {                                                \
+        if (false)                                   \
+        {                                            \
+            ::openspm::logger::debug(message);       \
+        }                                            \
+    } while (0)
+#else
+#define OPENSPM_DEBUG(message)                       \
+    do                                               \
+    {                                                \
+        if (::openspm::logger::debugEnabled())       \
+        {                                            \
+            ::openspm::logger::debug(message);       \
+        }                                            \
+    } while (0)
+#endif
 namespace openspm::logger
 {
     /**
@@ -37,6 +64,15 @@ namespace openspm::logger
      */
     void initFileLogging();
     
+    /**
+     * @brief Wait until every message logged so far has been written
+     *
+     * Messages are written by a background thread. Call this before
+     * writing to the console directly (prompts, progress bars) so the
+     * output doesn't interleave.
+     */
+    void flush();
+
     /**
      * @brief Log an informational message
      * @param m Message to log
@@ -55,12 +91,27 @@ namespace openspm::logger
      */
     void error(const std::string &m);
     
+    /**
+     * @brief Whether debug messages are currently shown
+     * @return true if debug mode is enabled
+     */
+    bool debugEnabled();
+
     /**
      * @brief Log a debug message (only shown when debug mode is enabled)
+     *
+     * Prefer OPENSPM_DEBUG, which skips building the message when it
+     * would be discarded.
      * @param m Debug message to log
      */
     void debug(const std::string &m);
 
+    /**
+     * @brief Write a message to the log file only, without console output
+     * @param m Message to record
+     */
+    void record(const std::string &m);
+
     /**
      * @brief Log an HTTP request with status code
      * @param method HTTP method (GET, POST, etc.)
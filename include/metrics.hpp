@@ -0,0 +1,78 @@
+/**
+ * @file metrics.hpp
+ * @brief Run metrics exported in Prometheus text format
+ *
+ * Counters and gauges collected during one openspm run (phase durations,
+ * HTTP requests, bytes transferred, cache hits, package counts) and
+ * written to a node_exporter textfile collector file when the run ends.
+ * Enabled by setting `metricsFile` in the config or `--metrics-file`.
+ */
+#pragma once
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+namespace openspm::metrics
+{
+    /// Label name/value pairs attached to a sample
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    /// Set while metrics are being collected; use enabled() to read it
+    extern std::atomic<bool> active;
+
+    /**
+     * @brief Whether metrics are being collected
+     * @return true if a metrics file is configured for this run
+     */
+    inline bool enabled() { return active.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Start collecting metrics for this run
+     */
+    void enable();
+
+    /**
+     * @brief Add to a counter
+     * @param name Metric name, including the openspm_ prefix
+     * @param value Amount to add
+     * @param labels Sample labels
+     */
+    void add(const std::string &name, double value, const Labels &labels = {});
+
+    /**
+     * @brief Set a gauge
+     * @param name Metric name, including the openspm_ prefix
+     * @param value New value
+     * @param labels Sample labels
+     */
+    void set(const std::string &name, double value, const Labels &labels = {});
+
+    /**
+     * @brief Count an HTTP request by host and status
+     * @param url Request URL
+     * @param status HTTP status (0 if the request failed without a response)
+     */
+    void observeHttpRequest(const std::string &url, int status);
+
+    /**
+     * @brief Record one completed phase (called for every trace::Span)
+     * @param phase Span name
+     * @param category Span category
+     * @param seconds Duration
+     * @param bytes Bytes attached to the span
+     */
+    void observePhase(const char *phase, const char *category, double seconds, unsigned long long bytes);
+
+    /**
+     * @brief Write all collected metrics to a textfile collector file
+     *
+     * The file is written under a temporary name and renamed into place so
+     * node_exporter never reads a partial file.
+     *
+     * @param path Output file, normally ending in .prom
+     * @param command Command that was run
+     * @param exitStatus Exit status of the run
+     * @return 0 on success, non-zero on write failure
+     */
+    int writeTextfile(const std::string &path, const std::string &command, int exitStatus);
+} // namespace openspm::metrics
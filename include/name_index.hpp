@@ -0,0 +1,98 @@
+/**
+ * @file name_index.hpp
+ * @brief Sorted name list for shell completion
+ *
+ * Written next to data.bin as names.idx so `openspm complete` can answer
+ * prefix queries by memory-mapping one small file, without decompressing
+ * the data archive or parsing the package index.
+ *
+ * Layout (integers little-endian):
+ * - magic "OSPMNAM1"
+ * - u32 package count, u32 repository count
+ * - u32 string offsets: package count + 1 entries, then repository count + 1
+ * - string pool; names are sorted bytewise within each section
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+namespace openspm
+{
+    /// Name of the completion index inside the data directory
+    constexpr const char *NameIndexFile = "names.idx";
+
+    /**
+     * @brief Path of the completion index for the configured data directory
+     * @return Index path
+     */
+    std::string nameIndexPath();
+
+    /**
+     * @brief Write the completion index, replacing any previous one atomically
+     * @param packageNames Package names (any order, duplicates allowed)
+     * @param repositoryUrls Repository URLs (any order, duplicates allowed)
+     * @return 0 on success, non-zero on error
+     */
+    int writeNameIndex(std::vector<std::string> packageNames, std::vector<std::string> repositoryUrls);
+
+    /**
+     * @brief Rewrite the repository section after repositories were added or removed
+     *
+     * Package names are kept from the existing index until the next update.
+     *
+     * @return 0 on success, non-zero on error
+     */
+    int refreshNameIndexRepositories();
+
+    /**
+     * @brief A memory-mapped completion index
+     */
+    class NameIndex
+    {
+    public:
+        /**
+         * @brief Which list to complete from
+         */
+        enum class Section
+        {
+            Packages,
+            Repositories
+        };
+
+        NameIndex() = default;
+        NameIndex(const NameIndex &) = delete;
+        NameIndex &operator=(const NameIndex &) = delete;
+        ~NameIndex();
+
+        /**
+         * @brief Map an index file
+         * @param path Path to names.idx
+         * @return 0 on success, non-zero if the file is missing or invalid
+         */
+        int open(const std::string &path);
+
+        /**
+         * @brief Find all names starting with a prefix
+         * @param section List to search
+         * @param prefix Prefix to match (empty matches everything)
+         * @return Matching names in sorted order; views into the mapped file
+         */
+        std::vector<std::string_view> complete(Section section, std::string_view prefix) const;
+
+    private:
+        std::string_view at(Section section, std::uint32_t i) const;
+        std::uint32_t count(Section section) const;
+        void close();
+
+        const char *data = nullptr;
+        size_t size = 0;
+        bool mapped = false;
+        std::string buffer; ///< File contents where mmap is unavailable
+        std::uint32_t packageCount = 0;
+        std::uint32_t repositoryCount = 0;
+        const char *offsets = nullptr;
+        const char *pool = nullptr;
+        size_t poolSize = 0;
+    };
+} // namespace openspm
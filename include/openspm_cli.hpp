@@ -42,9 +42,14 @@ namespace openspm
         
         /**
          * @brief Update both repositories and package indices
+         *
+         * With @p onlyRepos, only those repositories' package lists are
+         * refreshed and the repository metadata sync is skipped.
+         *
+         * @param onlyRepos Repository URLs to refresh; empty refreshes all
          * @return 0 on success, non-zero on error
          */
-        int updateAll();
+        int updateAll(const std::vector<std::string> &onlyRepos = {});
         
         /**
          * @brief Update repository metadata
@@ -63,6 +68,58 @@ namespace openspm
          * @return 0 on success, non-zero on error
          */
         int listPackages();
+
+        /**
+         * @brief List installed packages from the installed-package database
+         * @param names Only report whether these packages are installed; empty lists all
+         * @return 0 on success, non-zero if a named package isn't installed or the database is invalid
+         */
+        int listInstalled(const std::vector<std::string> &names);
+
+        /**
+         * @brief Ask for confirmation, then remove installed packages and their files
+         * @param packageNames Packages to remove
+         * @return 0 on success, non-zero if cancelled or on error
+         */
+        int removePackages(const std::vector<std::string> &packageNames);
+
+        /**
+         * @brief Ask for confirmation, then remove every orphaned automatic package in one transaction
+         * @return 0 on success or if there is nothing to remove, non-zero if cancelled or on error
+         */
+        int autoremove();
+
+        /**
+         * @brief Print the installed and the available packages that depend on a package
+         * @param packageName Package name
+         * @return 0 on success, non-zero if the package is unknown or on error
+         */
+        int dependents(const std::string &packageName);
+
+        /**
+         * @brief Print the installed packages that own each path
+         * @param paths Absolute paths below the target directory, or paths relative to it
+         * @return 0 on success, non-zero if a path isn't owned by any package
+         */
+        int owns(const std::vector<std::string> &paths);
+
+        /**
+         * @brief Search compatible packages by name, description and maintainer
+         * @param query Whitespace-separated search terms
+         * @return 0 on success (even with no matches), non-zero on error
+         */
+        int searchPackages(const std::string &query);
+
+        /**
+         * @brief Print names starting with a prefix, one per line, for shell completion
+         *
+         * Reads only the completion index, so it needs neither the data
+         * archive nor root privileges.
+         *
+         * @param args `[packages|repos] <prefix>`; completes package names if the kind is omitted
+         * @return 0 on success (even with no matches), non-zero on a usage error
+         */
+        int complete(const std::vector<std::string> &args);
         
         /**
          * @brief Create default configuration without user interaction
@@ -0,0 +1,171 @@
+/**
+ * @file package_list_parser.hpp
+ * @brief Streaming parser and writer for package list documents
+ *
+ * Parses pkg-list.yaml and packages.yaml with yaml-cpp's event API instead
+ * of building a node tree, handing each package to a callback as soon as
+ * its mapping is complete. Memory use is bounded by the largest single
+ * record rather than the whole document.
+ *
+ * Recognized schema:
+ * @code
+ * depend:            # optional, repository URLs
+ *   - https://...
+ * packages:
+ *   - name: ...
+ *     version: ...
+ *     description: ...
+ *     maintainer: ...
+ *     dependencies: [ ... ]
+ *     tags: ...
+ *     url: ...
+ * @endcode
+ * Unknown keys are skipped. pkg-list.json uses the same structure and is
+ * parsed with simdjson's on-demand API.
+ */
+#pragma once
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <package_manager.hpp>
+namespace openspm
+{
+    /// Receives each parsed package
+    using PackageCallback = std::function<void(PackageInfo &&)>;
+
+    /**
+     * @brief Parse a package list from a stream
+     * @param input Stream positioned at the start of the document
+     * @param onPackage Called once per package, in document order
+     * @param outDepends Receives the `depend` repository URLs
+     * @param outError Receives a description of the problem on failure
+     * @return 0 on success, non-zero if the document is not a valid package list
+     */
+    int parsePackageList(std::istream &input, const PackageCallback &onPackage,
+                         std::vector<std::string> &outDepends, std::string &outError);
+
+    /**
+     * @brief Parse a JSON package list
+     *
+     * Non-string scalars (e.g. an unquoted version number) are taken
+     * verbatim, as YAML would.
+     *
+     * @param json Document text; its capacity may grow to add the padding simdjson reads past the end
+     * @param onPackage Called once per package, in document order
+     * @param outDepends Receives the `depend` repository URLs
+     * @param outError Receives a description of the problem on failure
+     * @return 0 on success, non-zero if the document is not a valid package list
+     */
+    int parsePackageListJson(std::string &json, const PackageCallback &onPackage,
+                             std::vector<std::string> &outDepends, std::string &outError);
+
+    /**
+     * @brief Serialize packages as a JSON package list
+     *
+     * The output is accepted by parsePackageListJson(). @p repository is
+     * recorded as a top-level `repository` key, which parsers ignore.
+     *
+     * @param packages Packages to write, in the order given
+     * @param repository URL the packages were fetched from
+     * @return JSON document, one package per line
+     */
+    std::string serializePackageListJson(const std::vector<PackageInfo> &packages, const std::string &repository);
+
+    /**
+     * @brief Pull parser for package lists, one package per call
+     *
+     * Documents in the layout serializePackageListJson() writes are read
+     * one line at a time, so only the current package is ever parsed and
+     * many lists can be consumed side by side in bounded memory. Any other
+     * JSON layout is parsed whole on the first call instead.
+     */
+    class PackageListReader
+    {
+    public:
+        /**
+         * @brief Start reading a document
+         * @param json Document text, owned by the reader
+         */
+        explicit PackageListReader(std::string json);
+        PackageListReader(const PackageListReader &) = delete;
+        PackageListReader &operator=(const PackageListReader &) = delete;
+        ~PackageListReader();
+
+        /**
+         * @brief Read the next package
+         * @param outPackage Receives the package
+         * @return true if a package was read, false at the end or on error
+         */
+        bool next(PackageInfo &outPackage);
+
+        /**
+         * @brief Why reading stopped early
+         * @return Description of the problem, empty if the document was valid so far
+         */
+        const std::string &error() const { return errorMessage; }
+
+    private:
+        class LineParser;
+
+        std::string text;
+        size_t pos = 0;
+        bool started = false;
+        bool done = false;
+        std::unique_ptr<LineParser> lines;
+        std::vector<PackageInfo> whole; ///< Packages of a document not in the line layout, in reverse
+        std::string errorMessage;
+    };
+
+    /**
+     * @brief Incremental package list parser fed with chunks of a download
+     *
+     * Parsing runs on a worker thread that consumes the chunks as they are
+     * fed, so records are produced while the download is still in progress.
+     * @p onPackage is called on the worker thread; it must not touch state
+     * the feeding thread uses until finish() returns.
+     */
+    class PackageListStream
+    {
+    public:
+        /**
+         * @brief Start the parser
+         * @param onPackage Called once per package, in document order
+         */
+        explicit PackageListStream(PackageCallback onPackage);
+        PackageListStream(const PackageListStream &) = delete;
+        PackageListStream &operator=(const PackageListStream &) = delete;
+        ~PackageListStream();
+
+        /**
+         * @brief Pass the next chunk of the document
+         *
+         * Blocks while the parser is more than a few hundred KiB behind.
+         *
+         * @param data Chunk bytes
+         * @param size Chunk length
+         * @return false once parsing has failed, so the download can be cancelled
+         */
+        bool feed(const char *data, size_t size);
+
+        /**
+         * @brief Signal the end of the document and wait for the parser
+         * @param outDepends Receives the `depend` repository URLs
+         * @param outError Receives a description of the problem on failure
+         * @return 0 on success, non-zero if the document is not a valid package list
+         */
+        int finish(std::vector<std::string> &outDepends, std::string &outError);
+
+    private:
+        class ChunkBuffer;
+
+        std::unique_ptr<ChunkBuffer> buffer;
+        PackageCallback onPackage;
+        std::vector<std::string> depends;
+        std::string errorMessage;
+        int status = 0;
+        std::thread worker;
+    };
+} // namespace openspm
@@ -10,6 +10,9 @@
 #include <vector>
 namespace openspm
 {
+    class Catalog;
+    struct ShardInfo;
+
     /**
      * @brief Information about a package
      */
@@ -22,21 +25,58 @@ namespace openspm
         std::vector<std::string> dependencies; ///< List of dependency package names
         std::string tags;                      ///< Semicolon-separated tags (e.g., "bin;linux-x86_64")
         std::string url;                       ///< Download URL for the package archive
+        std::string repository;                ///< Repository the package was merged from, empty if unknown
     };
 
     /**
-     * @brief Update local package index from all configured repositories
+     * @brief Update local package index from the configured repositories
+     * @param onlyRepos Refresh only these repositories; empty refreshes all
      * @return 0 on success, non-zero on error
      */
-    int updatePackages();
+    int updatePackages(const std::vector<std::string> &onlyRepos = {});
 
     /**
-     * @brief Fetch package list from a specific repository
+     * @brief Update local package index using an already loaded catalog
+     *
+     * Repository metadata is taken from the catalog instead of re-reading
+     * repositories.yaml per repository, and the catalog's package set is
+     * replaced with the freshly built index. Each repository's list is
+     * stored as its own shard; a repository that fails to refresh keeps its
+     * previous shard, and one the server reports unchanged is not rewritten.
+     *
+     * @param catalog Session catalog (repositories must be loaded)
+     * @param onlyRepos Refresh only these repositories (and the ones they depend on); empty refreshes all
+     * @return 0 on success, non-zero on error
+     */
+    int updatePackages(Catalog &catalog, const std::vector<std::string> &onlyRepos = {});
+
+    /**
+     * @brief Result of fetching one repository's package list
+     */
+    struct PackageListFetch
+    {
+        bool notModified = false;          ///< Server confirmed the cached shard is current
+        std::vector<PackageInfo> packages; ///< Packages listed by this repository itself
+        std::vector<std::string> depend;   ///< Repositories the list depends on
+        std::string source;                ///< Format that was served ("json" or "yaml")
+        std::string etag;                  ///< ETag response header, if any
+        std::string lastModified;          ///< Last-Modified response header, if any
+    };
+
+    /**
+     * @brief Fetch the package list of a single repository
+     *
+     * Dependent repositories are not fetched; they are reported in
+     * PackageListFetch::depend. When @p cached is given, its validators are
+     * sent as If-None-Match / If-Modified-Since and a 304 response sets
+     * PackageListFetch::notModified instead of downloading the list.
+     *
      * @param repoUrl Repository base URL
-     * @param outPackages Vector to populate with package information
+     * @param cached Shard stored by the previous update, or nullptr
+     * @param out Receives the result
      * @return 0 on success, non-zero on error
      */
-    int fetchPackageListFromRepository(const std::string &repoUrl, std::vector<PackageInfo> &outPackages);
+    int fetchPackageList(const std::string &repoUrl, const ShardInfo *cached, PackageListFetch &out);
 
     /**
      * @brief Collect dependencies for a package recursively
@@ -45,15 +85,30 @@ namespace openspm
      * @return 0 on success, non-zero on error
      */
     int collectDependencies(const std::string &packageName, std::vector<PackageInfo> &collectedPackages);
-    
+
     /**
-     * @brief Helper function to recursively collect package dependencies
+     * @brief Collect dependencies for a package recursively from a loaded catalog
+     *
+     * Uses the precomputed closure when its newest versions satisfy every
+     * constraint, and the backtracking resolver (resolver.hpp) otherwise.
+     *
+     * @param catalog Session catalog (packages must be loaded)
      * @param packageName Name of package to collect dependencies for
      * @param collectedPackages Vector to populate with collected package information
-     * @param packages List of all available packages to search
      * @return 0 on success, non-zero on error
      */
-    int subCollectDependencies(const std::string &packageName, std::vector<PackageInfo> &collectedPackages, std::vector<PackageInfo> packages);
+    int collectDependencies(const Catalog &catalog, const std::string &packageName, std::vector<PackageInfo> &collectedPackages);
+
+    /**
+     * @brief Collect dependencies for another system's tags
+     * @param catalog Session catalog (packages must be loaded)
+     * @param packageName Name of package to collect dependencies for
+     * @param supportedTags Tags of the target system, used instead of the configured ones
+     * @param collectedPackages Vector to populate with collected package information
+     * @return 0 on success, non-zero on error
+     */
+    int collectDependencies(const Catalog &catalog, const std::string &packageName, const std::string &supportedTags,
+                            std::vector<PackageInfo> &collectedPackages);
     
     /**
      * @brief Collect package names from package info list
@@ -72,17 +127,43 @@ namespace openspm
     
     /**
      * @brief Download and install a list of packages
+     * @param catalog Session catalog used for package metadata
      * @param packageNames List of package names to install
+     * @param requestedNames Packages the user asked for; the others are recorded as automatic
+     *        unless already installed explicitly. Empty records every package as explicit.
      * @return 0 on success, non-zero on error
      */
-    int installCollectedPackages(const std::vector<std::string> &packageNames);
+    int installCollectedPackages(const Catalog &catalog, const std::vector<std::string> &packageNames,
+                                 const std::vector<std::string> &requestedNames = {});
     /**
-     * @brief Remove an installed package (not yet implemented)
+     * @brief Remove an installed package
      * @param packageName Name of package to remove
      * @return 0 on success, non-zero on error
      */
     int removePackage(const std::string &packageName);
 
+    /**
+     * @brief Remove installed packages in one transaction
+     *
+     * Works from the packages' manifests (installed_db.hpp) and never scans
+     * the target directory. Files are unlinked in parallel. Directories are
+     * then removed deepest first, and only if empty. Paths that a package
+     * staying installed also lists are kept. The packages are unrecorded
+     * only after all of their files are gone. Nothing is removed if an
+     * installed package outside @p packageNames depends on one of them.
+     *
+     * @param packageNames Packages to remove
+     * @return 0 on success, non-zero if a package isn't installed, is still required, or a file couldn't be removed
+     */
+    int removePackages(const std::vector<std::string> &packageNames);
+
+    /**
+     * @brief Prompt user for confirmation before removing packages
+     * @param packageNames Packages to be removed
+     * @return 0 if user confirmed, non-zero if cancelled
+     */
+    int askRemovalConfirmation(const std::vector<std::string> &packageNames);
+
     /**
      * @brief List all packages from local index
      * @param outPackages Vector to populate with package information
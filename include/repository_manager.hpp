@@ -6,6 +6,7 @@
  * and maintaining the list of configured repositories.
  */
 #pragma once
+#include <map>
 #include <string>
 #include <vector>
 namespace openspm
@@ -19,7 +20,50 @@ namespace openspm
         std::string name;         ///< Repository name
         std::string description;  ///< Repository description
         std::string mantainer;    ///< Repository maintainer (note: typo preserved for compatibility)
+        std::string sparseIndex;  ///< Path of the per-package index below the URL, empty if not served
+        int priority = 0;         ///< Local setting: a package offered by several repositories comes from the highest priority
+        std::map<std::string, std::string> pins; ///< Local setting: package name to the version range always taken from here
     };
+
+    /**
+     * @brief Parse repositories.yaml
+     *
+     * Besides the metadata fetched from each repository, entries carry the
+     * local `priority` (integer, default 0) and `pins` (package name to a
+     * version range, see version.hpp) settings.
+     *
+     * @param content File text
+     * @param outRepositories Receives the entries in file order
+     * @return 0 on success, non-zero on invalid format
+     */
+    int parseRepositoryList(const std::string &content, std::vector<RepositoryInfo> &outRepositories);
+
+    /**
+     * @brief Set the priority of a configured repository
+     * @param repoUrl Repository URL
+     * @param priority New priority; higher wins, 0 is the default
+     * @return true on success, false if the repository isn't configured or saving failed
+     */
+    bool setRepositoryPriority(const std::string &repoUrl, int priority);
+
+    /**
+     * @brief Take a package only from one repository
+     *
+     * Replaces any pin of the same package on other repositories.
+     *
+     * @param repoUrl Repository URL
+     * @param packageName Package to pin
+     * @param range Acceptable versions, e.g. "~1.1"; empty or "*" for any
+     * @return true on success, false if the repository isn't configured, the range is invalid or saving failed
+     */
+    bool pinPackage(const std::string &repoUrl, const std::string &packageName, const std::string &range);
+
+    /**
+     * @brief Remove the pins of a package from every repository
+     * @param packageName Pinned package
+     * @return true on success, false if the package isn't pinned or saving failed
+     */
+    bool unpinPackage(const std::string &packageName);
     
     /**
      * @brief Get list of all configured repository URLs
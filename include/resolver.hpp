@@ -0,0 +1,54 @@
+/**
+ * @file resolver.hpp
+ * @brief Dependency resolution with conflict-directed backtracking
+ *
+ * Picks one version per package so that every dependency's version range
+ * holds, preferring newer versions. Packages are decided one at a time in
+ * the order they become required (breadth first), each trying its
+ * versions newest first. Deciding a version immediately checks its
+ * dependencies against what is already decided and against the other
+ * ranges on the same package (forward checking).
+ *
+ * When every version of a package fails, the resolver computes which
+ * earlier decisions caused the failure and jumps straight back to the
+ * latest of them, skipping decisions that played no part. The failing
+ * combination is learned as a nogood, so the search never tries it again.
+ * Parsed dependencies, tag checks and per-package version lists are
+ * memoized for the whole resolution.
+ *
+ * When no solution exists, the error explains the conflicts that ruled
+ * out the requested package, e.g. "app 2.0 requires libfoo ^2, but libfoo
+ * 1.4 is selected (required by libbar 1.0)".
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <package_manager.hpp>
+#include <version.hpp>
+namespace openspm
+{
+    class Catalog;
+
+    /**
+     * @brief Limits and output of one resolution
+     */
+    struct ResolveResult
+    {
+        std::vector<PackageInfo> plan;         ///< Selected packages, dependencies before dependents
+        std::vector<std::string> explanation;  ///< Why resolution failed, most relevant conflicts first
+        size_t decisions = 0;                  ///< Versions tried, for tracing and benchmarks
+        size_t backjumps = 0;                  ///< Times the search jumped back over earlier decisions
+    };
+
+    /**
+     * @brief Resolve a set of requested packages against a catalog
+     * @param catalog Catalog holding every version that may be selected
+     * @param requests Packages to install, with optional version ranges
+     * @param supportedTags Tags of the target system; versions with other tags are never selected
+     * @param out Receives the plan, or the explanation on failure
+     * @param maxDecisions Give up after trying this many versions (0 for no limit)
+     * @return 0 on success, non-zero if no consistent selection exists or the limit was reached
+     */
+    int resolveDependencies(const Catalog &catalog, const std::vector<Dependency> &requests,
+                            const std::string &supportedTags, ResolveResult &out, size_t maxDecisions = 0);
+} // namespace openspm
@@ -0,0 +1,52 @@
+/**
+ * @file script_runner.hpp
+ * @brief Parallel runner for package post-install scripts
+ *
+ * Spawns scripts directly with posix_spawn and an explicit environment,
+ * captures their output into the log, enforces per-script timeouts and
+ * runs scripts of independent packages concurrently.
+ */
+#pragma once
+#include <string>
+#include <vector>
+namespace openspm
+{
+    /**
+     * @brief One script to run
+     */
+    struct ScriptJob
+    {
+        std::string name;               ///< Job name (package name), used for logging and ordering
+        std::string scriptPath;         ///< Path to the script
+        std::string command;            ///< Inline shell command, run instead of scriptPath when set
+        std::vector<std::string> env;   ///< Extra environment entries ("KEY=VALUE"), override inherited ones
+        std::vector<std::string> after; ///< Jobs that must finish successfully before this one starts
+    };
+
+    /**
+     * @brief Outcome of one script
+     */
+    struct ScriptResult
+    {
+        std::string name;      ///< Job name
+        int exitCode = -1;     ///< Exit status (-1 if it did not exit normally)
+        bool timedOut = false; ///< Killed after exceeding the timeout
+        bool skipped = false;  ///< Not run because a job it depends on failed
+    };
+
+    /**
+     * @brief Run a set of scripts, respecting ordering constraints
+     *
+     * Jobs whose @c after list is satisfied run concurrently, up to
+     * @p maxParallel at a time. Names in @c after that are not part of
+     * @p jobs are ignored.
+     *
+     * @param jobs Scripts to run
+     * @param maxParallel Maximum concurrently running scripts (0 = hardware concurrency)
+     * @param timeoutSeconds Per-script timeout in seconds (0 = no timeout)
+     * @param outResults Populated with one result per job, in completion order
+     * @return 0 if every script exited with status 0, non-zero otherwise
+     */
+    int runScripts(const std::vector<ScriptJob> &jobs, unsigned maxParallel, unsigned timeoutSeconds,
+                   std::vector<ScriptResult> &outResults);
+} // namespace openspm
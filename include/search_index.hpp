@@ -0,0 +1,105 @@
+/**
+ * @file search_index.hpp
+ * @brief Trigram index for full-text package search
+ *
+ * Built from the package list during `update` and stored in the data
+ * archive as search.idx. The index carries everything needed to rank and
+ * print results, so searching never parses the package index shards.
+ *
+ * Layout (integers little-endian):
+ * - magic "OSPMIDX1"
+ * - u32 document count, u32 trigram count
+ * - documents: name, version, description, maintainer, tags, each a
+ *   varint length followed by the bytes
+ * - trigram table sorted by key: u32 key, u32 postings offset, u32 postings count
+ * - postings: varint delta-encoded document numbers
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <package_manager.hpp>
+namespace openspm
+{
+    /// Name of the search index inside the data archive
+    constexpr const char *SearchIndexFile = "search.idx";
+
+    /**
+     * @brief One ranked search hit
+     */
+    struct SearchResult
+    {
+        std::string name;        ///< Package name
+        std::string version;     ///< Package version
+        std::string description; ///< Package description
+        int score = 0;           ///< Relevance; higher is better
+    };
+
+    /**
+     * @brief Serialize a search index for a package list
+     * @param packages Packages to index, sorted by name, then version, so a name's versions are adjacent
+     * @return Index bytes, ready to store in the archive
+     */
+    std::string buildSearchIndex(const std::vector<PackageInfo> &packages);
+
+    /**
+     * @brief A loaded search index
+     */
+    class SearchIndex
+    {
+    public:
+        SearchIndex() = default;
+        SearchIndex(const SearchIndex &) = delete; // documents point into the owned buffer
+        SearchIndex &operator=(const SearchIndex &) = delete;
+
+        /**
+         * @brief Load serialized index bytes
+         * @param data Output of buildSearchIndex()
+         * @return 0 on success, non-zero if the data is not a valid index
+         */
+        int load(std::string data);
+
+        /**
+         * @brief Find packages matching every term of a query
+         *
+         * Terms match case-insensitively anywhere in the name, description
+         * or maintainer. Name matches rank above description matches, and
+         * exact and prefix name matches rank highest. Each name is returned
+         * once, as its newest matching version compatible with the tags.
+         *
+         * @param query Whitespace-separated search terms
+         * @param supportedTags Only return packages compatible with these tags (empty = all)
+         * @param limit Maximum number of results
+         * @param outTotal Receives the number of matching names before the limit was applied
+         * @return Results, best first
+         */
+        std::vector<SearchResult> search(const std::string &query, const std::string &supportedTags,
+                                         size_t limit, size_t &outTotal) const;
+
+        /**
+         * @brief Number of indexed packages
+         * @return Document count
+         */
+        size_t size() const { return docs.size(); }
+
+    private:
+        struct Doc
+        {
+            std::string_view name;
+            std::string_view version;
+            std::string_view description;
+            std::string_view maintainer;
+            std::string_view tags;
+        };
+
+        bool postings(std::uint32_t trigram, std::vector<std::uint32_t> &out) const;
+
+        std::string blob;
+        std::vector<Doc> docs;
+        const char *table = nullptr;
+        std::uint32_t trigramCount = 0;
+        const char *postingData = nullptr;
+        size_t postingSize = 0;
+    };
+} // namespace openspm
@@ -0,0 +1,59 @@
+/**
+ * @file sparse_index.hpp
+ * @brief On-demand per-package metadata for repositories that serve it
+ *
+ * A repository advertises a sparse index with `sparse: <path>` in its
+ * repository.yaml. Below that path each package has its own document in
+ * the pkg-list.json format, placed by name prefix:
+ * @code
+ * 1/a.json
+ * 2/ab.json
+ * 3/a/abc.json
+ * li/bz/libzstd.json
+ * @endcode
+ * `install` then fetches only the packages in the dependency closure it
+ * walks, one level at a time and in parallel, instead of every repository's
+ * full package list. Responses are cached under `<dataDir>/sparse` with
+ * their ETag and Last-Modified and revalidated with conditional requests.
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <package_manager.hpp>
+namespace openspm
+{
+    class Catalog;
+
+    /// Cache directory for sparse metadata, below the data directory
+    constexpr const char *SparseCacheDir = "sparse";
+
+    /**
+     * @brief Location of a package's document below the sparse index
+     * @param name Package name
+     * @return Relative path such as `li/bz/libzstd.json`
+     */
+    std::string sparsePackagePath(const std::string &name);
+
+    /**
+     * @brief Whether any configured repository serves a sparse index
+     * @param catalog Catalog with repositories loaded
+     * @return true if at least one repository has RepositoryInfo::sparseIndex set
+     */
+    bool hasSparseRepositories(const Catalog &catalog);
+
+    /**
+     * @brief Fetch the metadata of a package and everything it depends on
+     *
+     * Repositories are asked in priority order (last configured first) and
+     * the first one that has a package wins. Names no sparse repository
+     * has are looked up in @p catalog's loaded packages, if any, so the
+     * walk can continue through them.
+     *
+     * @param catalog Catalog with repositories (and optionally packages) loaded
+     * @param packageName Package to start from
+     * @param outPackages Receives the packages fetched from sparse indexes
+     * @return 0 on success (missing packages are left to the resolver to report),
+     *         non-zero if a package's metadata could not be fetched
+     */
+    int fetchSparseClosure(const Catalog &catalog, const std::string &packageName, std::vector<PackageInfo> &outPackages);
+} // namespace openspm
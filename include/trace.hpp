@@ -0,0 +1,107 @@
+/**
+ * @file trace.hpp
+ * @brief Phase tracing with Chrome trace-event export
+ *
+ * Records nested timed spans (with thread IDs, byte and item counts) and
+ * writes them as Chrome trace-event JSON, viewable in chrome://tracing or
+ * Perfetto. Enabled with `--trace <file>`. Span durations also feed the
+ * per-phase metrics (see metrics.hpp); with neither enabled a span costs
+ * two relaxed atomic loads.
+ */
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+namespace openspm::trace
+{
+    /// Set while a trace is being recorded; use enabled() to read it
+    extern std::atomic<bool> active;
+
+    /**
+     * @brief Whether spans are being recorded
+     * @return true if tracing is on
+     */
+    inline bool enabled() { return active.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Start recording spans
+     *
+     * The trace is written to @p path when the process exits, or earlier
+     * with finish(). Calling start() again while recording is a no-op.
+     *
+     * @param path Output file for the Chrome trace JSON
+     */
+    void start(const std::string &path);
+
+    /**
+     * @brief Stop recording and write the trace file
+     * @return 0 on success (or if tracing was never started), non-zero on write failure
+     */
+    int finish();
+
+    /**
+     * @brief A timed region, recorded when it goes out of scope
+     *
+     * @code
+     * trace::Span span("extract", "install");
+     * span.setDetail(pkgName);
+     * ...
+     * span.setBytes(bytesWritten);
+     * @endcode
+     *
+     * Names and categories must be string literals (or otherwise outlive
+     * the trace); per-span strings go in setDetail().
+     */
+    class Span
+    {
+    public:
+        /**
+         * @brief Open a span
+         * @param name Span name
+         * @param category Trace category (phase group)
+         */
+        explicit Span(const char *name, const char *category = "openspm");
+        ~Span() { end(); }
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+        /**
+         * @brief Attach a byte count
+         * @param bytes Bytes read, written or transferred
+         */
+        void setBytes(std::uint64_t bytes) { this->bytes = bytes; }
+
+        /**
+         * @brief Attach an item count
+         * @param items Number of packages, files, entries, ...
+         */
+        void setItems(std::uint64_t items) { this->items = items; }
+
+        /**
+         * @brief Attach free-form detail (package name, URL, file, ...)
+         * @param detail Detail string; ignored when not recording
+         */
+        void setDetail(const std::string &detail)
+        {
+            if (recording)
+                this->detail = detail;
+        }
+
+        /**
+         * @brief Record the span now instead of at scope exit
+         *
+         * Later calls (and the destructor) do nothing.
+         */
+        void end();
+
+    private:
+        const char *name;
+        const char *category;
+        bool recording;
+        std::chrono::steady_clock::time_point begin;
+        std::uint64_t bytes = 0;
+        std::uint64_t items = 0;
+        std::string detail;
+    };
+} // namespace openspm::trace
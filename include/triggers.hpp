@@ -0,0 +1,87 @@
+/**
+ * @file triggers.hpp
+ * @brief Declarative install triggers
+ *
+ * Packages declare triggers in their pkg.yaml:
+ * @code{.yaml}
+ * triggers:
+ *   - name: ldconfig
+ *     paths: ["**.so", "**.so.*"]
+ *     command: ldconfig
+ * @endcode
+ * Triggers are collected across an install transaction, activated when any
+ * installed file matches one of their path globs (relative to the target
+ * directory), and each activated trigger runs exactly once at the end.
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+namespace openspm
+{
+    struct ScriptResult;
+
+    /**
+     * @brief A trigger declared by a package
+     */
+    struct TriggerInfo
+    {
+        std::string name;               ///< Trigger name, used to deduplicate across packages
+        std::vector<std::string> paths; ///< Path globs relative to the target directory (empty = always)
+        std::string command;            ///< Shell command to run
+        std::string package;            ///< Package that declared it
+    };
+
+    /**
+     * @brief Read the triggers section of an extracted package's pkg.yaml
+     * @param pkgYamlPath Path to pkg.yaml
+     * @param packageName Name of the declaring package
+     * @param outTriggers Vector to append triggers to
+     * @return 0 on success (including when there is no triggers section), non-zero on parse error
+     */
+    int loadPackageTriggers(const std::string &pkgYamlPath, const std::string &packageName, std::vector<TriggerInfo> &outTriggers);
+
+    /**
+     * @brief Triggers and installed paths collected during one transaction
+     */
+    class TriggerSet
+    {
+    public:
+        /**
+         * @brief Add a trigger; triggers with the same name are merged
+         *
+         * The merged trigger matches the path globs of every declaration and
+         * always runs if any declaration has no paths.
+         *
+         * @param trigger Trigger declaration
+         */
+        void declare(const TriggerInfo &trigger);
+
+        /**
+         * @brief Record a file installed by the transaction
+         * @param relativePath Path relative to the target directory, '/'-separated
+         */
+        void fileInstalled(const std::string &relativePath);
+
+        /**
+         * @brief Run every activated trigger once
+         * @param installDir Target directory, exported as PKG_INSTALL_DIR
+         * @param maxParallel Maximum triggers running at once (0 = CPU count)
+         * @param timeoutSeconds Per-trigger timeout (0 = none)
+         * @return 0 if all activated triggers succeeded, non-zero otherwise
+         */
+        int runActivated(const std::string &installDir, unsigned maxParallel, unsigned timeoutSeconds);
+
+        /**
+         * @brief Number of distinct triggers declared
+         * @return Trigger count
+         */
+        size_t size() const { return triggers.size(); }
+
+    private:
+        std::vector<TriggerInfo> triggers;
+        std::vector<char> alwaysRun;    ///< Per trigger: some declaration had no paths
+        std::unordered_map<std::string, size_t> indexByName;
+        std::vector<std::string> installedPaths;
+    };
+} // namespace openspm
@@ -6,7 +6,11 @@
  * package tags for compatibility checking.
  */
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 namespace openspm
 {
@@ -37,6 +41,157 @@ namespace openspm
     bool areTagsCompatible(const std::string &supported,
                            const std::string &packageTags);
     
+    /**
+     * @brief Match a slash-separated path against a glob pattern
+     *
+     * Supports @c * (any run of characters except '/'), @c ** (any run of
+     * characters including '/') and @c ? (any single character except '/').
+     *
+     * @param pattern Glob pattern (e.g. "lib/libz.so*", "**.desktop")
+     * @param path Path to test, using '/' as separator
+     * @return true if the whole path matches the pattern
+     */
+    bool globMatch(const std::string &pattern, const std::string &path);
+
+    /// Starting value for fnv1a64()
+    constexpr std::uint64_t Fnv1aOffsetBasis = 14695981039346656037ULL;
+
+    /**
+     * @brief 64-bit FNV-1a hash
+     *
+     * Pass the previous result as @p hash to continue hashing across chunks.
+     *
+     * @param data Bytes to hash
+     * @param size Number of bytes
+     * @param hash Hash state to continue from
+     * @return Updated hash
+     */
+    std::uint64_t fnv1a64(const char *data, std::size_t size, std::uint64_t hash = Fnv1aOffsetBasis);
+
+    /**
+     * @brief Append a little-endian 32-bit value
+     * @param out Buffer to append to
+     * @param value Value to write
+     */
+    void putU32(std::string &out, std::uint32_t value);
+
+    /**
+     * @brief Append a little-endian 64-bit value
+     * @param out Buffer to append to
+     * @param value Value to write
+     */
+    void putU64(std::string &out, std::uint64_t value);
+
+    /**
+     * @brief Read a little-endian 32-bit value
+     * @param p At least 4 readable bytes
+     * @return Decoded value
+     */
+    std::uint32_t getU32(const char *p);
+
+    /**
+     * @brief Read a little-endian 64-bit value
+     * @param p At least 8 readable bytes
+     * @return Decoded value
+     */
+    std::uint64_t getU64(const char *p);
+
+    /// One entry of a NamePool: a range of the pool, with format-specific bits allowed in the length
+    using NamePoolEntry = std::pair<std::uint32_t, std::uint32_t>;
+
+    /**
+     * @brief Serialize a sorted name table whose entries point into a shared pool of name numbers
+     *
+     * Layout (integers little-endian):
+     * - 8-byte magic
+     * - u32 name count, u32 pool length
+     * - entries: u32 pool offset, u32 length
+     * - u32 name offsets, name count + 1
+     * - pool: u32 name numbers
+     * - name bytes, sorted by name
+     *
+     * @param magic File magic
+     * @param names Names, sorted
+     * @param entries One per name
+     * @param pool Name numbers the entries point into
+     * @return Binary table
+     */
+    std::string writeNamePool(const char (&magic)[8], const std::vector<std::string_view> &names,
+                              const std::vector<NamePoolEntry> &entries, const std::vector<std::uint32_t> &pool);
+
+    /**
+     * @brief A loaded table in the writeNamePool() layout
+     */
+    class NamePool
+    {
+    public:
+        /**
+         * @brief Take ownership of the table bytes
+         * @param content Table bytes
+         * @param magic Expected file magic
+         * @return 0 on success, non-zero if the magic or the sizes don't match
+         */
+        int load(std::string content, const char (&magic)[8]);
+
+        /// Number of names; 0 unless load() succeeded
+        std::uint32_t size() const { return count; }
+
+        /**
+         * @brief Binary search for a name
+         * @param name Name to find
+         * @return Its number, or size() if absent
+         */
+        std::uint32_t find(std::string_view name) const;
+
+        /**
+         * @brief Name by number
+         * @param i Number below size()
+         * @return View into the table, empty if the offsets are corrupt
+         */
+        std::string_view nameAt(std::uint32_t i) const;
+
+        /**
+         * @brief Pool range of a name, as stored
+         * @param i Number below size()
+         * @return Offset and raw length
+         */
+        NamePoolEntry entry(std::uint32_t i) const;
+
+        /**
+         * @brief Whether a range lies within the pool
+         * @param offset First pool index
+         * @param length Number of values
+         * @return true if every index is readable
+         */
+        bool inPool(std::uint32_t offset, std::uint32_t length) const
+        {
+            return offset <= poolLength && length <= poolLength - offset;
+        }
+
+        /**
+         * @brief Pool value
+         * @param i Index checked with inPool()
+         * @return Name number, to be checked against size()
+         */
+        std::uint32_t poolValue(std::uint32_t i) const;
+
+    private:
+        std::string data;
+        std::uint32_t count = 0;
+        std::uint32_t poolLength = 0;
+        size_t entriesAt = 0;
+        size_t nameOffsetsAt = 0;
+        size_t poolAt = 0;
+        size_t namesAt = 0;
+    };
+
+    /**
+     * @brief Format a 64-bit value as 16 lowercase hex digits
+     * @param value Value to format
+     * @return Hex string
+     */
+    std::string hex64(std::uint64_t value);
+
     /**
      * @brief Parse a URL into its components
      * @param url URL string to parse
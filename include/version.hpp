@@ -0,0 +1,133 @@
+/**
+ * @file version.hpp
+ * @brief Packed version keys and dependency version constraints
+ *
+ * Versions are parsed once into a VersionKey, two integers that compare
+ * in semantic-versioning order, so sorting and range checks over large
+ * multi-version catalogs never re-parse strings.
+ *
+ * - release: major (24 bits), minor (20 bits), patch (20 bits); larger
+ *   components are clamped, missing ones are 0 and a leading 'v' is ignored
+ * - pre: all ones for a release, lower for a pre-release. The first
+ *   identifier contributes its first 6 bytes (numeric identifiers sort below
+ *   alphanumeric ones), a following numeric identifier the low 16 bits, so
+ *   1.0.0-alpha < 1.0.0-alpha.2 < 1.0.0-alpha.10 < 1.0.0-beta < 1.0.0
+ *
+ * Build metadata (+...) is ignored.
+ *
+ * A dependency is a package name optionally followed by constraints, which
+ * must all hold: "libfoo", "libfoo >=1.2, <2", "libfoo ^1.4", "libfoo (~2.1)".
+ * Supported operators are =, ==, >, >=, <, <=, ^ (same left-most non-zero
+ * component), ~ (same minor) and *. A bare version means exactly that version.
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+namespace openspm
+{
+    /**
+     * @brief Parsed, totally ordered form of a version string
+     */
+    struct VersionKey
+    {
+        std::uint64_t release = 0;  ///< major:24 | minor:20 | patch:20
+        std::uint64_t pre = ~0ULL;  ///< ~0 for releases, lower for pre-releases
+
+        bool operator==(const VersionKey &other) const { return release == other.release && pre == other.pre; }
+        bool operator!=(const VersionKey &other) const { return !(*this == other); }
+        bool operator<(const VersionKey &other) const
+        {
+            return release != other.release ? release < other.release : pre < other.pre;
+        }
+        bool operator>(const VersionKey &other) const { return other < *this; }
+        bool operator<=(const VersionKey &other) const { return !(other < *this); }
+        bool operator>=(const VersionKey &other) const { return !(*this < other); }
+    };
+
+    /**
+     * @brief Parse a version string
+     * @param text Version such as "1.4.2", "v2.0", "3.0.0-rc.1+build5"
+     * @return Comparable key; unparseable text gives 0.0.0
+     */
+    VersionKey parseVersion(std::string_view text);
+
+    /**
+     * @brief Set of acceptable versions, a single interval
+     */
+    struct VersionRange
+    {
+        VersionKey low{0, 0};        ///< Lower bound
+        VersionKey high{~0ULL, ~0ULL}; ///< Upper bound
+        bool lowInclusive = true;    ///< Whether @ref low itself is accepted
+        bool highInclusive = true;   ///< Whether @ref high itself is accepted
+
+        /**
+         * @brief Test a version against the range
+         * @param version Version to test
+         * @return true if the version is acceptable
+         */
+        bool contains(const VersionKey &version) const
+        {
+            return (lowInclusive ? version >= low : version > low) && (highInclusive ? version <= high : version < high);
+        }
+
+        /**
+         * @brief Whether the range accepts every version
+         * @return true if unconstrained
+         */
+        bool any() const { return *this == VersionRange(); }
+
+        /**
+         * @brief Whether no version can satisfy the range
+         * @return true if the constraints contradict each other
+         */
+        bool empty() const { return high < low || (high == low && !(lowInclusive && highInclusive)); }
+
+        /**
+         * @brief Narrow this range to the versions also accepted by @p other
+         * @param other Range to intersect with
+         */
+        void intersect(const VersionRange &other);
+
+        bool operator==(const VersionRange &other) const
+        {
+            return low == other.low && high == other.high && lowInclusive == other.lowInclusive &&
+                   highInclusive == other.highInclusive;
+        }
+    };
+
+    /**
+     * @brief Parse a list of constraints, separated by commas or spaces
+     * @param text Constraints, e.g. ">=1.2, <2"; empty or "*" accepts everything
+     * @param outRange Receives the intersection of all constraints
+     * @param outError Receives a description when parsing fails
+     * @return 0 on success, non-zero if a constraint is malformed
+     */
+    int parseVersionRange(std::string_view text, VersionRange &outRange, std::string &outError);
+
+    /**
+     * @brief A dependency on a range of versions of a package
+     */
+    struct Dependency
+    {
+        std::string name;   ///< Package name
+        VersionRange range; ///< Acceptable versions
+    };
+
+    /**
+     * @brief Name part of a dependency specification
+     * @param spec Dependency as written in a package list
+     * @return The package name, without constraints or surrounding spaces
+     */
+    std::string_view dependencyName(std::string_view spec);
+
+    /**
+     * @brief Parse a dependency specification
+     * @param spec Dependency as written in a package list
+     * @param outDependency Receives the name and range
+     * @param outError Receives a description when parsing fails
+     * @return 0 on success, non-zero if the name is missing or a constraint is malformed
+     */
+    int parseDependency(std::string_view spec, Dependency &outDependency, std::string &outError);
+} // namespace openspm
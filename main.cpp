@@ -36,8 +36,12 @@ int main(int argc, char *argv[])
         std::cerr << "Usage: openspm <command> [args...] [flags...]\n";
         return 1;
     }
+    std::string command = argv[1];
+    // Shell completion runs as the invoking user and only reads the name index
+    bool needsPrivileges = command != "complete";
 #ifdef _WIN32
     // Check for administrator privileges on Windows
+    if (needsPrivileges)
     {
         BOOL isAdmin = FALSE;
         PSID administratorsGroup = NULL;
@@ -58,6 +62,7 @@ int main(int argc, char *argv[])
     }
 #else
     // Check for root privileges on Unix-like systems
+    if (needsPrivileges)
     {
         if (geteuid() != 0)
         {
@@ -66,7 +71,6 @@ int main(int argc, char *argv[])
         }
     }
 #endif
-    std::string command = argv[1];
 
     // Parse arguments and flags
     std::vector<std::string> commandArgs;
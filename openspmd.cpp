@@ -0,0 +1,69 @@
+/**
+ * @file openspmd.cpp
+ * @brief Entry point for the OpenSPM query daemon
+ *
+ * Loads the configuration and package catalog once and answers queries
+ * from the openspm CLI over a Unix domain socket until stopped.
+ */
+#include <iostream>
+#include <vector>
+#include <string>
+#include <openspm_cli.hpp>
+#include <config.hpp>
+#include <daemon.hpp>
+#include <logger.hpp>
+
+/**
+ * @brief Main entry point
+ *
+ * Accepts the same global flags as openspm (--data-dir, --tags, --logfile,
+ * --debug, ...), then serves until SIGINT or SIGTERM.
+ *
+ * @param argc Argument count
+ * @param argv Argument vector
+ * @return 0 on clean shutdown, non-zero on error
+ */
+int main(int argc, char *argv[])
+{
+    std::vector<std::pair<std::string, std::string>> flagsWithValues;
+    std::vector<std::string> flagsWithoutValues;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        std::size_t eqPos = arg.find('=');
+        if (arg.rfind("--", 0) == 0 && eqPos != std::string::npos)
+        {
+            flagsWithValues.emplace_back(arg.substr(0, eqPos), arg.substr(eqPos + 1));
+        }
+        else if (arg.rfind("--", 0) == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            flagsWithValues.emplace_back(arg, argv[++i]);
+        }
+        else if (arg.rfind("-", 0) == 0)
+        {
+            flagsWithoutValues.push_back(arg);
+        }
+        else
+        {
+            std::cerr << "Usage: openspmd [flags...]\n";
+            return 1;
+        }
+    }
+
+#ifdef _WIN32
+    openspm::loadConfig("C:\\ProgramData\\openspm\\config.yaml");
+#else
+    openspm::loadConfig("/etc/openspm/config.yaml");
+#endif
+    if (openspm::cli::processFlags(flagsWithValues, flagsWithoutValues) != 0)
+    {
+        return 1;
+    }
+    if (openspm::initDataArchive() != 0)
+    {
+        openspm::logger::error("Failed to initialize data archive.");
+        return 1;
+    }
+    openspm::logger::initFileLogging();
+    return openspm::runDaemon();
+}
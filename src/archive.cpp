@@ -17,34 +17,36 @@ using ssize_t = SSIZE_T;
 #include <cstring>
 #include <filesystem>
 #include <sys/stat.h>
+#include <algorithm>
 #include <map>
 #include <vector>
 #include <logger.hpp>
+#include <trace.hpp>
 
 namespace openspm
 {
     using namespace logger;
     Archive::Archive(const std::string &path) : archivePath(path)
     {
-        debug("[DEBUG Archive::Archive] Created archive object for: " + path);
+        OPENSPM_DEBUG("[DEBUG Archive::Archive] Created archive object for: " + path);
     }
 
     int Archive::createArchive()
     {
-        debug("[DEBUG Archive::createArchive] Starting archive creation: " + archivePath);
+        OPENSPM_DEBUG("[DEBUG Archive::createArchive] Starting archive creation: " + archivePath);
         std::filesystem::path pathObj(archivePath);
         if (std::filesystem::exists(pathObj))
         {
-            debug("[DEBUG Archive::createArchive] Archive already exists, skipping creation");
+            OPENSPM_DEBUG("[DEBUG Archive::createArchive] Archive already exists, skipping creation");
             return 0; // Archive already exists
         }
         if (!std::filesystem::exists(pathObj.parent_path()))
         {
-            debug("[DEBUG Archive::createArchive] Parent directory doesn't exist, creating: " + pathObj.parent_path().string());
+            OPENSPM_DEBUG("[DEBUG Archive::createArchive] Parent directory doesn't exist, creating: " + pathObj.parent_path().string());
             try
             {
                 std::filesystem::create_directories(pathObj.parent_path());
-                debug("[DEBUG Archive::createArchive] Successfully created parent directory");
+                OPENSPM_DEBUG("[DEBUG Archive::createArchive] Successfully created parent directory");
             }
             catch (const std::exception &e)
             {
@@ -52,7 +54,7 @@ namespace openspm
                 return 1;
             }
         }
-        debug("[DEBUG Archive::createArchive] Creating new archive writer");
+        OPENSPM_DEBUG("[DEBUG Archive::createArchive] Creating new archive writer");
         struct archive *a = archive_write_new();
         if (!a)
         {
@@ -60,11 +62,11 @@ namespace openspm
             return 2;
         }
 
-        debug("[DEBUG Archive::createArchive] Setting archive format and compression");
+        OPENSPM_DEBUG("[DEBUG Archive::createArchive] Setting archive format and compression");
         archive_write_set_format_pax_restricted(a);
         archive_write_add_filter_gzip(a);
 
-        debug("[DEBUG Archive::createArchive] Opening archive file: " + pathObj.string());
+        OPENSPM_DEBUG("[DEBUG Archive::createArchive] Opening archive file: " + pathObj.string());
 #ifdef _WIN32
         int ret = archive_write_open_filename(a, pathObj.string().c_str());
 #else
@@ -77,58 +79,66 @@ namespace openspm
             return 3;
         }
 
-        debug("[DEBUG Archive::createArchive] Closing and freeing archive");
+        OPENSPM_DEBUG("[DEBUG Archive::createArchive] Closing and freeing archive");
         archive_write_close(a);
         archive_write_free(a);
-        debug("[DEBUG Archive::createArchive] Archive creation complete");
+        OPENSPM_DEBUG("[DEBUG Archive::createArchive] Archive creation complete");
         return 0;
     }
 
     int Archive::writeFile(const std::string &filePath, std::string &data)
     {
-        debug("[DEBUG Archive::writeFile] Writing to archive: " + archivePath);
-        debug("[DEBUG Archive::writeFile] Target file: " + filePath);
-        debug("[DEBUG Archive::writeFile] Data size: " + std::to_string(data.size()) + " bytes");
+        return writeFiles({{filePath, data}});
+    }
+
+    int Archive::writeFiles(const std::map<std::string, std::string> &updates,
+                            const std::vector<std::string> &removals)
+    {
+        trace::Span span("Archive::writeFile", "archive");
+        size_t updateBytes = 0;
+        for (const auto &[filePath, data] : updates)
+        {
+            updateBytes += data.size();
+            OPENSPM_DEBUG("[DEBUG Archive::writeFile] Target file: " + filePath + " (" + std::to_string(data.size()) + " bytes)");
+        }
+        span.setItems(updates.size());
+        span.setBytes(updateBytes);
+        OPENSPM_DEBUG("[DEBUG Archive::writeFile] Writing to archive: " + archivePath);
 
         std::map<std::string, std::string> files;
-        std::vector<std::string> fileList;
 
-        debug("[DEBUG Archive::writeFile] Reading existing files...");
-        if (listFiles(fileList) == 0)
+        OPENSPM_DEBUG("[DEBUG Archive::writeFile] Reading existing files...");
+        if (readEntries({}, true, files) == 0)
         {
-            debug("[DEBUG Archive::writeFile] Found " + std::to_string(fileList.size()) + " existing files");
-            for (const auto &file : fileList)
-            {
-                debug("[DEBUG Archive::writeFile] Existing file: " + file);
-                std::string content;
-                if (readFile(file, content) == 0)
-                {
-                    files[file] = content;
-                    debug("[DEBUG Archive::writeFile] Read " + std::to_string(content.size()) + " bytes from: " + file);
-                }
-                else
-                {
-                    debug("[DEBUG Archive::writeFile] Failed to read existing file: " + file);
-                }
-            }
+            OPENSPM_DEBUG("[DEBUG Archive::writeFile] Found " + std::to_string(files.size()) + " existing files");
         }
         else
         {
-            debug("[DEBUG Archive::writeFile] No existing files or error listing");
+            OPENSPM_DEBUG("[DEBUG Archive::writeFile] No existing files or error listing");
+        }
+        for (const auto &filePath : removals)
+        {
+            if (files.erase(filePath) != 0)
+            {
+                OPENSPM_DEBUG("[DEBUG Archive::writeFile] Removing file: " + filePath);
+            }
         }
 
-        // Add or update the file
-        debug("[DEBUG Archive::writeFile] Adding/updating file: " + filePath);
-        files[filePath] = data;
+        // Add or update the files
+        for (const auto &[filePath, data] : updates)
+        {
+            OPENSPM_DEBUG("[DEBUG Archive::writeFile] Adding/updating file: " + filePath);
+            files[filePath] = data;
+        }
 
-        debug("[DEBUG Archive::writeFile] Total files to write: " + std::to_string(files.size()));
+        OPENSPM_DEBUG("[DEBUG Archive::writeFile] Total files to write: " + std::to_string(files.size()));
         for (const auto &[path, content] : files)
         {
-            debug("[DEBUG Archive::writeFile] Will write: " + path + " (" + std::to_string(content.size()) + " bytes)");
+            OPENSPM_DEBUG("[DEBUG Archive::writeFile] Will write: " + path + " (" + std::to_string(content.size()) + " bytes)");
         }
 
         // Recreate archive with all files
-        debug("[DEBUG Archive::writeFile] Creating archive writer");
+        OPENSPM_DEBUG("[DEBUG Archive::writeFile] Creating archive writer");
         struct archive *a = archive_write_new();
         if (!a)
         {
@@ -139,7 +149,7 @@ namespace openspm
         archive_write_set_format_pax_restricted(a);
         archive_write_add_filter_gzip(a);
 
-        debug("[DEBUG Archive::writeFile] Opening archive for writing: " + archivePath);
+        OPENSPM_DEBUG("[DEBUG Archive::writeFile] Opening archive for writing: " + archivePath);
         if (archive_write_open_filename(a, archivePath.c_str()) != ARCHIVE_OK)
         {
             error("ERROR: Failed to open archive for writing");
@@ -149,7 +159,7 @@ namespace openspm
 
         for (const auto &[path, content] : files)
         {
-            debug("[DEBUG Archive::writeFile] Writing entry: " + path);
+            OPENSPM_DEBUG("[DEBUG Archive::writeFile] Writing entry: " + path);
             struct archive_entry *entry = archive_entry_new();
             archive_entry_set_pathname(entry, path.c_str());
             archive_entry_set_size(entry, content.size());
@@ -169,23 +179,25 @@ namespace openspm
             }
             else
             {
-                debug("[DEBUG Archive::writeFile] Successfully wrote " + std::to_string(written) + " bytes for: " + path);
+                OPENSPM_DEBUG("[DEBUG Archive::writeFile] Successfully wrote " + std::to_string(written) + " bytes for: " + path);
             }
 
             archive_entry_free(entry);
         }
 
-        debug("[DEBUG Archive::writeFile] Closing archive...");
+        OPENSPM_DEBUG("[DEBUG Archive::writeFile] Closing archive...");
         archive_write_close(a);
         archive_write_free(a);
 
-        debug("[DEBUG Archive::writeFile] Write complete!");
+        OPENSPM_DEBUG("[DEBUG Archive::writeFile] Write complete!");
         return 0;
     }
 
     int Archive::readFile(const std::string &filePath, std::string &outData)
     {
-        debug("[DEBUG Archive::readFile] Reading file: " + filePath + " from archive: " + archivePath);
+        trace::Span span("Archive::readFile", "archive");
+        span.setDetail(filePath);
+        OPENSPM_DEBUG("[DEBUG Archive::readFile] Reading file: " + filePath + " from archive: " + archivePath);
         struct archive *a = archive_read_new();
         if (!a)
         {
@@ -196,7 +208,7 @@ namespace openspm
         archive_read_support_filter_gzip(a);
         archive_read_support_format_all(a);
 
-        debug("[DEBUG Archive::readFile] Opening archive: " + archivePath);
+        OPENSPM_DEBUG("[DEBUG Archive::readFile] Opening archive: " + archivePath);
         if (archive_read_open_filename(a, archivePath.c_str(), 10240) != ARCHIVE_OK)
         {
             error("Failed to open archive");
@@ -207,18 +219,18 @@ namespace openspm
         struct archive_entry *entry;
         int found = -1;
 
-        debug("[DEBUG Archive::readFile] Searching for file in archive...");
+        OPENSPM_DEBUG("[DEBUG Archive::readFile] Searching for file in archive...");
         while (archive_read_next_header(a, &entry) == ARCHIVE_OK)
         {
             const char *pathname = archive_entry_pathname(entry);
             if (pathname)
             {
-                debug("[DEBUG Archive::readFile] Found entry: " + std::string(pathname));
+                OPENSPM_DEBUG("[DEBUG Archive::readFile] Found entry: " + std::string(pathname));
                 if (filePath == pathname)
                 {
-                    debug("[DEBUG Archive::readFile] Match found! Reading data...");
+                    OPENSPM_DEBUG("[DEBUG Archive::readFile] Match found! Reading data...");
                     size_t size = archive_entry_size(entry);
-                    debug("[DEBUG Archive::readFile] Entry size: " + std::to_string(size) + " bytes");
+                    OPENSPM_DEBUG("[DEBUG Archive::readFile] Entry size: " + std::to_string(size) + " bytes");
                     outData.resize(size);
 
                     ssize_t readSize = archive_read_data(a, &outData[0], size);
@@ -229,7 +241,8 @@ namespace openspm
                         return -1;
                     }
 
-                    debug("[DEBUG Archive::readFile] Successfully read " + std::to_string(readSize) + " bytes");
+                    OPENSPM_DEBUG("[DEBUG Archive::readFile] Successfully read " + std::to_string(readSize) + " bytes");
+                    span.setBytes(static_cast<std::uint64_t>(readSize));
                     found = 0;
                     break;
                 }
@@ -239,95 +252,107 @@ namespace openspm
 
         if (found != 0)
         {
-            debug("[DEBUG Archive::readFile] File not found in archive: " + filePath);
+            OPENSPM_DEBUG("[DEBUG Archive::readFile] File not found in archive: " + filePath);
         }
 
         archive_read_close(a);
         archive_read_free(a);
-        debug("[DEBUG Archive::readFile] Archive closed, returning status: " + std::to_string(found));
+        OPENSPM_DEBUG("[DEBUG Archive::readFile] Archive closed, returning status: " + std::to_string(found));
         return found;
     }
 
-    int Archive::deleteFile(const std::string &filePath)
+    int Archive::readFiles(const std::vector<std::string> &filePaths, std::map<std::string, std::string> &outFiles)
     {
-        debug("[DEBUG Archive::deleteFile] Deleting file: " + filePath);
-        std::map<std::string, std::string> files;
-        std::vector<std::string> fileList;
+        return readEntries(filePaths, false, outFiles);
+    }
 
-        debug("[DEBUG Archive::deleteFile] Listing files in archive");
-        if (listFiles(fileList) != 0)
+    int Archive::readEntries(const std::vector<std::string> &wanted, bool all, std::map<std::string, std::string> &outFiles)
+    {
+        trace::Span span("Archive::readFiles", "archive");
+        struct archive *a = archive_read_new();
+        if (!a)
         {
-            error("Failed to list files");
+            error("Failed to create archive reader");
             return -1;
         }
 
-        debug("[DEBUG Archive::deleteFile] Found " + std::to_string(fileList.size()) + " files");
-        bool found = false;
-        for (const auto &file : fileList)
-        {
-            if (file == filePath)
-            {
-                debug("[DEBUG Archive::deleteFile] Found target file, skipping in rebuild");
-                found = true;
-                continue;
-            }
-            debug("[DEBUG Archive::deleteFile] Preserving file: " + file);
-            std::string content;
-            if (readFile(file, content) == 0)
-            {
-                files[file] = content;
-            }
-        }
+        archive_read_support_filter_gzip(a);
+        archive_read_support_format_all(a);
 
-        if (!found)
+        if (archive_read_open_filename(a, archivePath.c_str(), 10240) != ARCHIVE_OK)
         {
-            warn("[DEBUG Archive::deleteFile] File not found in archive: " + filePath);
+            OPENSPM_DEBUG("[DEBUG Archive::readFiles] Failed to open archive (may not exist yet)");
+            archive_read_free(a);
             return -1;
         }
 
-        // Recreate archive without the deleted file
-        debug("[DEBUG Archive::deleteFile] Recreating archive without deleted file");
-        struct archive *a = archive_write_new();
-        if (!a)
+        std::uint64_t bytes = 0;
+        size_t found = 0;
+        struct archive_entry *entry;
+        while (archive_read_next_header(a, &entry) == ARCHIVE_OK)
         {
-            error("Failed to create archive writer");
-            return -1;
+            const char *pathname = archive_entry_pathname(entry);
+            if (pathname && (all || std::find(wanted.begin(), wanted.end(), pathname) != wanted.end()))
+            {
+                std::string content;
+                content.resize(static_cast<size_t>(archive_entry_size(entry)));
+                ssize_t readSize = content.empty() ? 0 : archive_read_data(a, &content[0], content.size());
+                if (readSize < 0)
+                {
+                    error("Failed to read data from entry: " + std::string(pathname));
+                    archive_read_free(a);
+                    return -1;
+                }
+                content.resize(static_cast<size_t>(readSize));
+                bytes += content.size();
+                OPENSPM_DEBUG("[DEBUG Archive::readFiles] Read " + std::to_string(content.size()) + " bytes from: " + pathname);
+                outFiles[pathname] = std::move(content);
+                ++found;
+                if (!all && found == wanted.size())
+                {
+                    break;
+                }
+                continue;
+            }
+            archive_read_data_skip(a);
         }
 
-        archive_write_set_format_pax_restricted(a);
-        archive_write_add_filter_gzip(a);
+        span.setItems(found);
+        span.setBytes(bytes);
+        archive_read_close(a);
+        archive_read_free(a);
+        return 0;
+    }
 
-        if (archive_write_open_filename(a, archivePath.c_str()) != ARCHIVE_OK)
+    int Archive::deleteFile(const std::string &filePath)
+    {
+        trace::Span span("Archive::deleteFile", "archive");
+        span.setDetail(filePath);
+        OPENSPM_DEBUG("[DEBUG Archive::deleteFile] Deleting file: " + filePath);
+        std::vector<std::string> fileList;
+
+        OPENSPM_DEBUG("[DEBUG Archive::deleteFile] Listing files in archive");
+        if (listFiles(fileList) != 0)
         {
-            error("Failed to open archive for writing");
-            archive_write_free(a);
+            error("Failed to list files");
             return -1;
         }
 
-        for (const auto &[path, content] : files)
+        if (std::find(fileList.begin(), fileList.end(), filePath) == fileList.end())
         {
-            debug("[DEBUG Archive::deleteFile] Writing preserved file: " + path);
-            struct archive_entry *entry = archive_entry_new();
-            archive_entry_set_pathname(entry, path.c_str());
-            archive_entry_set_size(entry, content.size());
-            archive_entry_set_filetype(entry, AE_IFREG);
-            archive_entry_set_perm(entry, 0644);
-
-            archive_write_header(a, entry);
-            archive_write_data(a, content.c_str(), content.size());
-            archive_entry_free(entry);
+            warn("[DEBUG Archive::deleteFile] File not found in archive: " + filePath);
+            return -1;
         }
 
-        debug("[DEBUG Archive::deleteFile] Closing archive");
-        archive_write_close(a);
-        archive_write_free(a);
-        debug("[DEBUG Archive::deleteFile] Delete operation complete");
-        return 0;
+        // Recreate archive without the deleted file
+        OPENSPM_DEBUG("[DEBUG Archive::deleteFile] Recreating archive without deleted file");
+        return writeFiles({}, {filePath});
     }
 
     int Archive::listFiles(std::vector<std::string> &outFileList)
     {
-        debug("[DEBUG Archive::listFiles] Listing files in archive: " + archivePath);
+        trace::Span span("Archive::listFiles", "archive");
+        OPENSPM_DEBUG("[DEBUG Archive::listFiles] Listing files in archive: " + archivePath);
         struct archive *a = archive_read_new();
         if (!a)
         {
@@ -340,7 +365,7 @@ namespace openspm
 
         if (archive_read_open_filename(a, archivePath.c_str(), 10240) != ARCHIVE_OK)
         {
-            debug("[DEBUG Archive::listFiles] Failed to open archive (may not exist yet)");
+            OPENSPM_DEBUG("[DEBUG Archive::listFiles] Failed to open archive (may not exist yet)");
             archive_read_free(a);
             return -1;
         }
@@ -353,13 +378,14 @@ namespace openspm
             const char *pathname = archive_entry_pathname(entry);
             if (pathname)
             {
-                debug("[DEBUG Archive::listFiles] Found file: " + std::string(pathname));
+                OPENSPM_DEBUG("[DEBUG Archive::listFiles] Found file: " + std::string(pathname));
                 outFileList.push_back(pathname);
             }
             archive_read_data_skip(a);
         }
 
-        debug("[DEBUG Archive::listFiles] Total files found: " + std::to_string(outFileList.size()));
+        OPENSPM_DEBUG("[DEBUG Archive::listFiles] Total files found: " + std::to_string(outFileList.size()));
+        span.setItems(outFileList.size());
         archive_read_close(a);
         archive_read_free(a);
         return 0;
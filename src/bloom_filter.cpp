@@ -0,0 +1,142 @@
+/**
+ * @file bloom_filter.cpp
+ * @brief Implementation of Bloom filters over package names
+ */
+#include <bloom_filter.hpp>
+#include <utils.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace openspm
+{
+    namespace
+    {
+        constexpr char Magic[8] = {'O', 'S', 'P', 'M', 'B', 'L', 'M', '1'};
+
+        /// FNV-1a followed by a 64-bit finalizer, so both halves are usable as independent hashes
+        std::uint64_t nameHash(std::string_view name)
+        {
+            std::uint64_t h = fnv1a64(name.data(), name.size());
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ULL;
+            h ^= h >> 33;
+            return h;
+        }
+    } // namespace
+
+    BloomFilter BloomFilter::build(const std::vector<std::string_view> &names, unsigned bitsPerName)
+    {
+        BloomFilter filter;
+        size_t bitCount = std::max<size_t>(64, names.size() * bitsPerName);
+        filter.bits.assign((bitCount + 7) / 8, 0);
+        // k = bits per name * ln 2 minimises the false positive rate
+        filter.hashCount = std::max(1u, std::min(16u, static_cast<unsigned>(bitsPerName * 0.69 + 0.5)));
+        std::uint64_t numBits = filter.bits.size() * 8;
+        for (std::string_view name : names)
+        {
+            std::uint64_t h = nameHash(name);
+            std::uint32_t h1 = static_cast<std::uint32_t>(h);
+            std::uint32_t h2 = static_cast<std::uint32_t>(h >> 32) | 1;
+            for (std::uint32_t i = 0; i < filter.hashCount; ++i)
+            {
+                std::uint64_t bit = (h1 + static_cast<std::uint64_t>(i) * h2) % numBits;
+                filter.bits[bit / 8] |= static_cast<std::uint8_t>(1u << (bit % 8));
+            }
+        }
+        return filter;
+    }
+
+    bool BloomFilter::mayContain(std::string_view name) const
+    {
+        if (bits.empty())
+        {
+            return false;
+        }
+        std::uint64_t numBits = bits.size() * 8;
+        std::uint64_t h = nameHash(name);
+        std::uint32_t h1 = static_cast<std::uint32_t>(h);
+        std::uint32_t h2 = static_cast<std::uint32_t>(h >> 32) | 1;
+        for (std::uint32_t i = 0; i < hashCount; ++i)
+        {
+            std::uint64_t bit = (h1 + static_cast<std::uint64_t>(i) * h2) % numBits;
+            if ((bits[bit / 8] & (1u << (bit % 8))) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void BloomFilter::serialize(std::string &out) const
+    {
+        putU32(out, hashCount);
+        putU32(out, static_cast<std::uint32_t>(bits.size()));
+        out.append(reinterpret_cast<const char *>(bits.data()), bits.size());
+    }
+
+    size_t BloomFilter::parse(const char *data, size_t size, BloomFilter &out)
+    {
+        if (size < 8)
+        {
+            return 0;
+        }
+        std::uint32_t hashCount = getU32(data);
+        std::uint32_t byteCount = getU32(data + 4);
+        if (hashCount == 0 || hashCount > 64 || byteCount > size - 8)
+        {
+            return 0;
+        }
+        out.hashCount = hashCount;
+        out.bits.assign(data + 8, data + 8 + byteCount);
+        return 8 + static_cast<size_t>(byteCount);
+    }
+
+    std::string serializeBloomFilters(const BloomFilterSet &filters)
+    {
+        std::string out(Magic, sizeof(Magic));
+        putU32(out, static_cast<std::uint32_t>(filters.size()));
+        for (const auto &[key, filter] : filters)
+        {
+            putU32(out, static_cast<std::uint32_t>(key.size()));
+            out += key;
+            filter.serialize(out);
+        }
+        return out;
+    }
+
+    int parseBloomFilters(const std::string &data, BloomFilterSet &outFilters)
+    {
+        if (data.size() < sizeof(Magic) + 4 || std::memcmp(data.data(), Magic, sizeof(Magic)) != 0)
+        {
+            return 1;
+        }
+        std::uint32_t count = getU32(data.data() + sizeof(Magic));
+        size_t pos = sizeof(Magic) + 4;
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            if (data.size() - pos < 4)
+            {
+                return 1;
+            }
+            std::uint32_t keyLength = getU32(data.data() + pos);
+            pos += 4;
+            if (data.size() - pos < keyLength)
+            {
+                return 1;
+            }
+            std::string key = data.substr(pos, keyLength);
+            pos += keyLength;
+            BloomFilter filter;
+            size_t used = BloomFilter::parse(data.data() + pos, data.size() - pos, filter);
+            if (used == 0)
+            {
+                return 1;
+            }
+            pos += used;
+            outFilters[key] = std::move(filter);
+        }
+        return 0;
+    }
+} // namespace openspm
@@ -0,0 +1,194 @@
+/**
+ * @file catalog.cpp
+ * @brief Implementation of the session-scoped package catalog
+ *
+ * Reads the package index shards and repositories.yaml from the data
+ * archive once and keeps them in memory, indexed by package name and
+ * repository URL.
+ */
+#include <catalog.hpp>
+#include <config.hpp>
+#include <index_shards.hpp>
+#include <logger.hpp>
+#include <package_list_parser.hpp>
+#include <yaml-cpp/yaml.h>
+#include <algorithm>
+#include <sstream>
+
+namespace openspm
+{
+    using namespace logger;
+
+    int parsePackageIndex(const std::string &content, std::vector<PackageInfo> &outPackages)
+    {
+        std::istringstream input(content);
+        std::vector<std::string> depends;
+        std::string parseError;
+        size_t before = outPackages.size();
+        if (parsePackageList(input, [&outPackages](PackageInfo &&pkg)
+                             { outPackages.push_back(std::move(pkg)); },
+                             depends, parseError) != 0)
+        {
+            error("Invalid installed packages list format: " + parseError);
+            return 1;
+        }
+
+        OPENSPM_DEBUG("[DEBUG parsePackageIndex] Found " + std::to_string(outPackages.size() - before) + " packages in YAML");
+        return 0;
+    }
+
+    int Catalog::load()
+    {
+        if (loadRepositories() != 0)
+        {
+            return 1;
+        }
+        return loadPackages();
+    }
+
+    int Catalog::loadPackages()
+    {
+        OPENSPM_DEBUG("[DEBUG Catalog::loadPackages] Loading package index");
+        std::vector<PackageInfo> packages;
+        ClosureIndex closures;
+        if (loadMergedPackages(packages, &closures) != 0)
+        {
+            return 1;
+        }
+        setPackages(std::move(packages));
+        setClosureIndex(std::move(closures));
+        return 0;
+    }
+
+    int Catalog::loadPackagesFor(const std::string &packageName)
+    {
+        OPENSPM_DEBUG("[DEBUG Catalog::loadPackagesFor] Loading index for " + packageName);
+        std::vector<PackageInfo> packages;
+        ClosureIndex closures;
+        if (loadPackageClosure(packageName, packages, &closures) != 0)
+        {
+            return 1;
+        }
+        setPackages(std::move(packages));
+        setClosureIndex(std::move(closures));
+        return 0;
+    }
+
+    int Catalog::loadRepositories()
+    {
+        OPENSPM_DEBUG("[DEBUG Catalog::loadRepositories] Loading repository list");
+        repositories.clear();
+        repositoryOrder.clear();
+        Archive *dataArchive = getDataArchive();
+        std::string reposFileContent;
+        if (dataArchive->readFile("repositories.yaml", reposFileContent) != 0)
+        {
+            OPENSPM_DEBUG("[DEBUG Catalog::loadRepositories] No repositories file found");
+            return 0;
+        }
+        std::vector<RepositoryInfo> repos;
+        if (parseRepositoryList(reposFileContent, repos) != 0)
+        {
+            return 1;
+        }
+        for (const auto &repoInfo : repos)
+        {
+            setRepository(repoInfo);
+        }
+        OPENSPM_DEBUG("[DEBUG Catalog::loadRepositories] Loaded " + std::to_string(repositoryOrder.size()) + " repositories");
+        return 0;
+    }
+
+    void Catalog::setPackages(std::vector<PackageInfo> packages)
+    {
+        packageList = std::move(packages);
+        closureIndex = ClosureIndex();
+        versionKeys.resize(packageList.size());
+        versionOrder.resize(packageList.size());
+        for (size_t i = 0; i < packageList.size(); ++i)
+        {
+            versionKeys[i] = parseVersion(packageList[i].version);
+            versionOrder[i] = i;
+        }
+        // The merged index is already in this order, so this is one pass in the common case
+        auto before = [this](size_t a, size_t b)
+        {
+            if (packageList[a].name != packageList[b].name)
+                return packageList[a].name < packageList[b].name;
+            return versionKeys[a] < versionKeys[b];
+        };
+        if (!std::is_sorted(versionOrder.begin(), versionOrder.end(), before))
+        {
+            std::stable_sort(versionOrder.begin(), versionOrder.end(), before);
+        }
+        packageIndex.clear();
+        packageIndex.reserve(packageList.size());
+        for (size_t i = 0; i < versionOrder.size();)
+        {
+            const std::string &name = packageList[versionOrder[i]].name;
+            size_t end = i + 1;
+            while (end < versionOrder.size() && packageList[versionOrder[end]].name == name)
+            {
+                ++end;
+            }
+            packageIndex.emplace(name, VersionSpan{i, end});
+            i = end;
+        }
+        havePackages = true;
+        OPENSPM_DEBUG("[DEBUG Catalog::setPackages] Indexed " + std::to_string(packageList.size()) + " packages");
+    }
+
+    void Catalog::setRepository(const RepositoryInfo &repoInfo)
+    {
+        if (repositories.find(repoInfo.url) == repositories.end())
+        {
+            repositoryOrder.push_back(repoInfo.url);
+        }
+        repositories[repoInfo.url] = repoInfo;
+    }
+
+    const PackageInfo *Catalog::findPackage(const std::string &name) const
+    {
+        auto it = packageIndex.find(name);
+        return it == packageIndex.end() ? nullptr : &packageList[versionOrder[it->second.end - 1]];
+    }
+
+    const PackageInfo *Catalog::findPackage(const std::string &name, const VersionRange &range) const
+    {
+        auto it = packageIndex.find(name);
+        if (it == packageIndex.end())
+        {
+            return nullptr;
+        }
+        auto first = versionOrder.begin() + static_cast<std::ptrdiff_t>(it->second.begin);
+        auto last = versionOrder.begin() + static_cast<std::ptrdiff_t>(it->second.end);
+        // First version above the range; the one before it is the newest candidate
+        auto above = std::upper_bound(first, last, range.high, [this, &range](const VersionKey &high, size_t pos)
+                                      { return range.highInclusive ? high < versionKeys[pos] : high <= versionKeys[pos]; });
+        if (above == first || !range.contains(versionKeys[*(above - 1)]))
+        {
+            return nullptr;
+        }
+        return &packageList[*(above - 1)];
+    }
+
+    std::vector<const PackageInfo *> Catalog::findVersions(const std::string &name) const
+    {
+        std::vector<const PackageInfo *> versions;
+        auto it = packageIndex.find(name);
+        if (it != packageIndex.end())
+        {
+            for (size_t i = it->second.begin; i < it->second.end; ++i)
+            {
+                versions.push_back(&packageList[versionOrder[i]]);
+            }
+        }
+        return versions;
+    }
+
+    const RepositoryInfo *Catalog::findRepository(const std::string &url) const
+    {
+        auto it = repositories.find(url);
+        return it == repositories.end() ? nullptr : &it->second;
+    }
+} // namespace openspm
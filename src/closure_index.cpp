@@ -0,0 +1,322 @@
+/**
+ * @file closure_index.cpp
+ * @brief Implementation of the precomputed dependency closure index
+ */
+#include <closure_index.hpp>
+#include <logger.hpp>
+#include <version.hpp>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace openspm
+{
+    using namespace logger;
+
+    namespace
+    {
+        constexpr char Magic[8] = {'O', 'S', 'P', 'M', 'C', 'L', 'O', '1'};
+        constexpr std::uint32_t IncompleteBit = 0x80000000u;
+        constexpr std::uint32_t Unvisited = 0xffffffffu;
+        /// Levels smaller than this are not worth starting threads for
+        constexpr size_t ParallelThreshold = 256;
+
+        /// Tarjan's algorithm without recursion; components come out dependencies first
+        std::vector<std::vector<std::uint32_t>> stronglyConnected(const std::vector<std::vector<std::uint32_t>> &edges,
+                                                                  std::vector<std::uint32_t> &outComponent)
+        {
+            size_t n = edges.size();
+            std::vector<std::uint32_t> order(n, Unvisited);
+            std::vector<std::uint32_t> low(n, 0);
+            std::vector<char> onStack(n, 0);
+            std::vector<std::uint32_t> stack;
+            std::vector<std::pair<std::uint32_t, size_t>> calls;
+            std::vector<std::vector<std::uint32_t>> components;
+            outComponent.assign(n, Unvisited);
+            std::uint32_t counter = 0;
+
+            for (std::uint32_t root = 0; root < n; ++root)
+            {
+                if (order[root] != Unvisited)
+                {
+                    continue;
+                }
+                calls.emplace_back(root, 0);
+                order[root] = low[root] = counter++;
+                stack.push_back(root);
+                onStack[root] = 1;
+                while (!calls.empty())
+                {
+                    auto &[node, edge] = calls.back();
+                    if (edge < edges[node].size())
+                    {
+                        std::uint32_t next = edges[node][edge++];
+                        if (order[next] == Unvisited)
+                        {
+                            order[next] = low[next] = counter++;
+                            stack.push_back(next);
+                            onStack[next] = 1;
+                            calls.emplace_back(next, 0);
+                        }
+                        else if (onStack[next])
+                        {
+                            low[node] = std::min(low[node], order[next]);
+                        }
+                        continue;
+                    }
+                    std::uint32_t finished = node;
+                    calls.pop_back();
+                    if (!calls.empty())
+                    {
+                        std::uint32_t parent = calls.back().first;
+                        low[parent] = std::min(low[parent], low[finished]);
+                    }
+                    if (low[finished] == order[finished])
+                    {
+                        std::vector<std::uint32_t> members;
+                        std::uint32_t member;
+                        do
+                        {
+                            member = stack.back();
+                            stack.pop_back();
+                            onStack[member] = 0;
+                            outComponent[member] = static_cast<std::uint32_t>(components.size());
+                            members.push_back(member);
+                        } while (member != finished);
+                        std::sort(members.begin(), members.end());
+                        components.push_back(std::move(members));
+                    }
+                }
+            }
+            return components;
+        }
+    } // namespace
+
+    std::string buildClosureIndex(const std::vector<PackageInfo> &packages)
+    {
+        // The last entry of each name is its newest version
+        std::vector<const PackageInfo *> newest;
+        for (size_t i = 0; i < packages.size(); ++i)
+        {
+            if (i + 1 == packages.size() || packages[i + 1].name != packages[i].name)
+            {
+                newest.push_back(&packages[i]);
+            }
+        }
+        std::uint32_t n = static_cast<std::uint32_t>(newest.size());
+        auto findPackage = [&newest](std::string_view name) -> std::uint32_t
+        {
+            auto it = std::lower_bound(newest.begin(), newest.end(), name,
+                                       [](const PackageInfo *pkg, std::string_view key)
+                                       { return pkg->name < key; });
+            return it != newest.end() && (*it)->name == name ? static_cast<std::uint32_t>(it - newest.begin()) : Unvisited;
+        };
+
+        std::vector<std::vector<std::uint32_t>> edges(n);
+        std::vector<char> incomplete(n, 0);
+        for (std::uint32_t i = 0; i < n; ++i)
+        {
+            for (const auto &dep : newest[i]->dependencies)
+            {
+                std::uint32_t target = findPackage(dependencyName(dep));
+                if (target == Unvisited)
+                    incomplete[i] = 1;
+                else
+                    edges[i].push_back(target);
+            }
+        }
+
+        std::vector<std::uint32_t> component;
+        std::vector<std::vector<std::uint32_t>> components = stronglyConnected(edges, component);
+
+        // A component's level is one more than the deepest component it depends on
+        std::vector<std::uint32_t> level(components.size(), 0);
+        std::vector<std::vector<std::uint32_t>> levels;
+        for (std::uint32_t c = 0; c < components.size(); ++c)
+        {
+            for (std::uint32_t member : components[c])
+            {
+                for (std::uint32_t dep : edges[member])
+                {
+                    if (component[dep] != c)
+                    {
+                        level[c] = std::max(level[c], level[component[dep]] + 1);
+                    }
+                }
+            }
+            if (levels.size() <= level[c])
+            {
+                levels.resize(level[c] + 1);
+            }
+            levels[level[c]].push_back(c);
+        }
+
+        std::vector<std::vector<std::uint32_t>> closures(n);
+        auto closeComponent = [&](std::uint32_t c, std::vector<std::uint32_t> &mark, std::uint32_t stamp)
+        {
+            const std::vector<std::uint32_t> &members = components[c];
+            std::vector<std::uint32_t> external;
+            bool missing = false;
+            for (std::uint32_t member : members)
+            {
+                missing = missing || incomplete[member];
+                for (std::uint32_t dep : edges[member])
+                {
+                    if (component[dep] == c)
+                    {
+                        continue;
+                    }
+                    missing = missing || incomplete[dep];
+                    for (std::uint32_t x : closures[dep])
+                    {
+                        if (mark[x] != stamp)
+                        {
+                            mark[x] = stamp;
+                            external.push_back(x);
+                        }
+                    }
+                }
+            }
+            for (std::uint32_t p : members)
+            {
+                std::vector<std::uint32_t> &closure = closures[p];
+                closure.reserve(external.size() + members.size());
+                closure.assign(external.begin(), external.end());
+                for (std::uint32_t q : members)
+                {
+                    if (q != p)
+                        closure.push_back(q);
+                }
+                closure.push_back(p);
+            }
+            // Components on the same level never depend on each other, so no one else reads these yet
+            for (std::uint32_t p : members)
+            {
+                incomplete[p] = missing ? 1 : 0;
+            }
+        };
+
+        unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+        for (const auto &levelComponents : levels)
+        {
+            if (workers == 1 || levelComponents.size() < ParallelThreshold)
+            {
+                std::vector<std::uint32_t> mark(n, 0);
+                std::uint32_t stamp = 0;
+                for (std::uint32_t c : levelComponents)
+                {
+                    closeComponent(c, mark, ++stamp);
+                }
+                continue;
+            }
+            std::atomic<size_t> next{0};
+            auto work = [&]()
+            {
+                std::vector<std::uint32_t> mark(n, 0);
+                std::uint32_t stamp = 0;
+                for (size_t i = next.fetch_add(1); i < levelComponents.size(); i = next.fetch_add(1))
+                {
+                    closeComponent(levelComponents[i], mark, ++stamp);
+                }
+            };
+            std::vector<std::thread> threads;
+            for (unsigned w = 1; w < workers; ++w)
+            {
+                threads.emplace_back(work);
+            }
+            work();
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        // A closure that begins another one is stored as the tail of its reversed form
+        std::vector<std::uint32_t> byClosure(n);
+        for (std::uint32_t i = 0; i < n; ++i)
+        {
+            byClosure[i] = i;
+        }
+        std::sort(byClosure.begin(), byClosure.end(), [&closures](std::uint32_t a, std::uint32_t b)
+                  { return closures[a] < closures[b]; });
+        std::vector<std::uint32_t> offsets(n, 0);
+        std::vector<std::uint32_t> pool;
+        for (size_t i = n; i-- > 0;)
+        {
+            const std::vector<std::uint32_t> &closure = closures[byClosure[i]];
+            if (i + 1 < n)
+            {
+                const std::vector<std::uint32_t> &next = closures[byClosure[i + 1]];
+                if (closure.size() <= next.size() && std::equal(closure.begin(), closure.end(), next.begin()))
+                {
+                    offsets[byClosure[i]] = offsets[byClosure[i + 1]] + static_cast<std::uint32_t>(next.size() - closure.size());
+                    continue;
+                }
+            }
+            offsets[byClosure[i]] = static_cast<std::uint32_t>(pool.size());
+            pool.insert(pool.end(), closure.rbegin(), closure.rend());
+        }
+
+        std::vector<std::string_view> names;
+        std::vector<NamePoolEntry> entries;
+        names.reserve(n);
+        entries.reserve(n);
+        for (std::uint32_t i = 0; i < n; ++i)
+        {
+            names.emplace_back(newest[i]->name);
+            entries.emplace_back(offsets[i], static_cast<std::uint32_t>(closures[i].size()) | (incomplete[i] ? IncompleteBit : 0));
+        }
+        std::string out = writeNamePool(Magic, names, entries, pool);
+
+        size_t total = 0;
+        for (const auto &closure : closures)
+        {
+            total += closure.size();
+        }
+        OPENSPM_DEBUG("[DEBUG buildClosureIndex] " + std::to_string(n) + " packages, " + std::to_string(components.size()) +
+                      " components in " + std::to_string(levels.size()) + " levels, " + std::to_string(total) +
+                      " closure entries stored as " + std::to_string(pool.size()));
+        return out;
+    }
+
+    int ClosureIndex::load(std::string content)
+    {
+        if (table.load(std::move(content), Magic) != 0)
+        {
+            OPENSPM_DEBUG("[DEBUG ClosureIndex::load] Not a closure index");
+            return 1;
+        }
+        return 0;
+    }
+
+    ClosureIndex::Result ClosureIndex::lookup(std::string_view name, std::vector<std::string_view> &outOrder) const
+    {
+        std::uint32_t package = table.find(name);
+        if (package == table.size())
+        {
+            return Result::Unknown;
+        }
+        auto [offset, length] = table.entry(package);
+        if (length & IncompleteBit)
+        {
+            return Result::Incomplete;
+        }
+        if (!table.inPool(offset, length))
+        {
+            return Result::Unknown;
+        }
+        outOrder.clear();
+        outOrder.reserve(length);
+        for (std::uint32_t i = offset + length; i-- > offset;)
+        {
+            std::uint32_t dependency = table.poolValue(i);
+            if (dependency >= table.size())
+            {
+                outOrder.clear();
+                return Result::Unknown;
+            }
+            outOrder.push_back(table.nameAt(dependency));
+        }
+        return Result::Found;
+    }
+} // namespace openspm
@@ -40,10 +40,10 @@ namespace openspm
                             std::istreambuf_iterator<char>());
         globalConfig = fromYaml(yamlStr);
         file.close();
-        debug("[DEBUG loadConfig] Config loaded successfully");
-        debug("[DEBUG loadConfig] dataDir: " + globalConfig.dataDir);
-        debug("[DEBUG loadConfig] targetDir: " + globalConfig.targetDir);
-        debug("[DEBUG loadConfig] supported_tags: " + globalConfig.supported_tags);
+        OPENSPM_DEBUG("[DEBUG loadConfig] Config loaded successfully");
+        OPENSPM_DEBUG("[DEBUG loadConfig] dataDir: " + globalConfig.dataDir);
+        OPENSPM_DEBUG("[DEBUG loadConfig] targetDir: " + globalConfig.targetDir);
+        OPENSPM_DEBUG("[DEBUG loadConfig] supported_tags: " + globalConfig.supported_tags);
     }
     Config *getConfig()
     {
@@ -51,16 +51,16 @@ namespace openspm
     }
     void saveConfig(std::string configPath, const Config &config)
     {
-        debug("[DEBUG saveConfig] Saving config to: " + configPath);
+        OPENSPM_DEBUG("[DEBUG saveConfig] Saving config to: " + configPath);
         log("Saving config to " + configPath);
         std::filesystem::path pathObj(configPath);
         if (!std::filesystem::exists(pathObj.parent_path()))
         {
-            debug("[DEBUG saveConfig] Parent directory doesn't exist, creating");
+            OPENSPM_DEBUG("[DEBUG saveConfig] Parent directory doesn't exist, creating");
             try
             {
                 std::filesystem::create_directories(pathObj.parent_path());
-                debug("[DEBUG saveConfig] Created directories: " + pathObj.parent_path().string());
+                OPENSPM_DEBUG("[DEBUG saveConfig] Created directories: " + pathObj.parent_path().string());
             }
             catch (const std::exception &e)
             {
@@ -68,23 +68,23 @@ namespace openspm
                 return;
             }
         }
-        debug("[DEBUG saveConfig] Opening config file for writing");
+        OPENSPM_DEBUG("[DEBUG saveConfig] Opening config file for writing");
         std::ofstream file(configPath);
         if (!file.is_open())
         {
             error("\033[0;31mFailed to open config file for writing.");
             return;
         }
-        debug("[DEBUG saveConfig] Converting config to YAML");
+        OPENSPM_DEBUG("[DEBUG saveConfig] Converting config to YAML");
         std::string yamlStr = toYaml(config);
-        debug("[DEBUG saveConfig] YAML size: " + std::to_string(yamlStr.size()) + " bytes");
+        OPENSPM_DEBUG("[DEBUG saveConfig] YAML size: " + std::to_string(yamlStr.size()) + " bytes");
         file << yamlStr;
         file.close();
-        debug("[DEBUG saveConfig] Config saved successfully");
+        OPENSPM_DEBUG("[DEBUG saveConfig] Config saved successfully");
     }
     std::string toYaml(const Config &config)
     {
-        debug("[DEBUG toYaml] Converting config to YAML");
+        OPENSPM_DEBUG("[DEBUG toYaml] Converting config to YAML");
         YAML::Emitter out;
         out << YAML::BeginMap;
         out << YAML::Key << "dataDir" << YAML::Value << config.dataDir;
@@ -94,69 +94,94 @@ namespace openspm
         out << YAML::Key << "supported_tags" << YAML::Value << config.supported_tags;
         out << YAML::Key << "supported" << YAML::Value << config.supported;
         out << YAML::Key << "unsupported_msg" << YAML::Value << config.unsupported_msg;
+        out << YAML::Key << "durability" << YAML::Value << config.durability;
+        out << YAML::Key << "scriptTimeout" << YAML::Value << config.scriptTimeout;
+        out << YAML::Key << "scriptJobs" << YAML::Value << config.scriptJobs;
+        out << YAML::Key << "metricsFile" << YAML::Value << config.metricsFile;
+        out << YAML::Key << "useDaemon" << YAML::Value << config.useDaemon;
         out << YAML::EndMap;
-        debug("[DEBUG toYaml] Conversion complete");
+        OPENSPM_DEBUG("[DEBUG toYaml] Conversion complete");
         return std::string(out.c_str());
     }
     Config fromYaml(const std::string &yamlStr)
     {
-        debug("[DEBUG fromYaml] Parsing YAML string");
+        OPENSPM_DEBUG("[DEBUG fromYaml] Parsing YAML string");
         Config config;
         YAML::Node node = YAML::Load(yamlStr);
         if (node["dataDir"]) {
             config.dataDir = node["dataDir"].as<std::string>();
-            debug("[DEBUG fromYaml] dataDir: " + config.dataDir);
+            OPENSPM_DEBUG("[DEBUG fromYaml] dataDir: " + config.dataDir);
         }
         if (node["targetDir"]) {
             config.targetDir = node["targetDir"].as<std::string>();
-            debug("[DEBUG fromYaml] targetDir: " + config.targetDir);
+            OPENSPM_DEBUG("[DEBUG fromYaml] targetDir: " + config.targetDir);
         }
         if (node["colorOutput"]) {
             config.colorOutput = node["colorOutput"].as<bool>();
-            debug("[DEBUG fromYaml] colorOutput: " + std::to_string(config.colorOutput));
+            OPENSPM_DEBUG("[DEBUG fromYaml] colorOutput: " + std::to_string(config.colorOutput));
         }
         if (node["platform"]) {
             config.platform = node["platform"].as<std::string>();
-            debug("[DEBUG fromYaml] platform: " + config.platform);
+            OPENSPM_DEBUG("[DEBUG fromYaml] platform: " + config.platform);
         }
         if (node["supported_tags"]) {
             config.supported_tags = node["supported_tags"].as<std::string>();
-            debug("[DEBUG fromYaml] supported_tags: " + config.supported_tags);
+            OPENSPM_DEBUG("[DEBUG fromYaml] supported_tags: " + config.supported_tags);
         }
         if (node["supported"]) {
             config.supported = node["supported"].as<bool>();
-            debug("[DEBUG fromYaml] supported: " + std::to_string(config.supported));
+            OPENSPM_DEBUG("[DEBUG fromYaml] supported: " + std::to_string(config.supported));
         }
         if (node["unsupported_msg"]) {
             config.unsupported_msg = node["unsupported_msg"].as<std::string>();
-            debug("[DEBUG fromYaml] unsupported_msg: " + config.unsupported_msg);
+            OPENSPM_DEBUG("[DEBUG fromYaml] unsupported_msg: " + config.unsupported_msg);
         }
-        debug("[DEBUG fromYaml] Parse complete");
+        if (node["durability"]) {
+            config.durability = node["durability"].as<std::string>();
+            OPENSPM_DEBUG("[DEBUG fromYaml] durability: " + config.durability);
+        }
+        if (node["scriptTimeout"]) {
+            config.scriptTimeout = node["scriptTimeout"].as<unsigned>();
+            OPENSPM_DEBUG("[DEBUG fromYaml] scriptTimeout: " + std::to_string(config.scriptTimeout));
+        }
+        if (node["scriptJobs"]) {
+            config.scriptJobs = node["scriptJobs"].as<unsigned>();
+            OPENSPM_DEBUG("[DEBUG fromYaml] scriptJobs: " + std::to_string(config.scriptJobs));
+        }
+        if (node["metricsFile"]) {
+            config.metricsFile = node["metricsFile"].as<std::string>();
+            OPENSPM_DEBUG("[DEBUG fromYaml] metricsFile: " + config.metricsFile);
+        }
+        if (node["useDaemon"]) {
+            config.useDaemon = node["useDaemon"].as<bool>();
+            OPENSPM_DEBUG("[DEBUG fromYaml] useDaemon: " + std::to_string(config.useDaemon));
+        }
+        OPENSPM_DEBUG("[DEBUG fromYaml] Parse complete");
         return config;
     }
     Archive *getDataArchive()
     {
-        debug("[DEBUG getDataArchive] Returning global archive pointer: " + std::to_string((long)globalArchive));
+        OPENSPM_DEBUG("[DEBUG getDataArchive] Returning global archive pointer: " + std::to_string((long)globalArchive));
         return globalArchive;
     }
     int initDataArchive()
     {
-        debug("[DEBUG initDataArchive] Initializing data archive");
+        OPENSPM_DEBUG("[DEBUG initDataArchive] Initializing data archive");
         if (globalArchive != nullptr)
         {
-            debug("[DEBUG initDataArchive] Archive already initialized");
+            OPENSPM_DEBUG("[DEBUG initDataArchive] Archive already initialized");
             return 0; // Already initialized
         }
         Config *config = getConfig();
         std::filesystem::path dataDirPath(config->dataDir);
-        debug("[DEBUG initDataArchive] Data directory: " + dataDirPath.string());
+        OPENSPM_DEBUG("[DEBUG initDataArchive] Data directory: " + dataDirPath.string());
         if (!std::filesystem::exists(dataDirPath))
         {
-            debug("[DEBUG initDataArchive] Data directory doesn't exist, creating");
+            OPENSPM_DEBUG("[DEBUG initDataArchive] Data directory doesn't exist, creating");
             try
             {
                 std::filesystem::create_directories(dataDirPath);
-                debug("[DEBUG initDataArchive] Created data directory");
+                OPENSPM_DEBUG("[DEBUG initDataArchive] Created data directory");
             }
             catch (const std::exception &e)
             {
@@ -165,11 +190,11 @@ namespace openspm
             }
         }
         std::string archivePath = dataDirPath.append("data.bin").string();
-        debug("[DEBUG initDataArchive] Archive path: " + archivePath);
+        OPENSPM_DEBUG("[DEBUG initDataArchive] Archive path: " + archivePath);
         globalArchive = new Archive(archivePath);
-        debug("[DEBUG initDataArchive] Archive object created at: " + std::to_string((long)globalArchive));
+        OPENSPM_DEBUG("[DEBUG initDataArchive] Archive object created at: " + std::to_string((long)globalArchive));
         int result = globalArchive->createArchive();
-        debug("[DEBUG initDataArchive] createArchive returned: " + std::to_string(result));
+        OPENSPM_DEBUG("[DEBUG initDataArchive] createArchive returned: " + std::to_string(result));
         return result;
     }
 
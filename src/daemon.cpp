@@ -0,0 +1,462 @@
+/**
+ * @file daemon.cpp
+ * @brief Implementation of the resident query daemon and its client
+ *
+ * The daemon serves one connection at a time: every query is answered
+ * from the in-memory catalog, so requests are short and a simple accept
+ * loop keeps the catalog free of locking.
+ */
+#include <daemon.hpp>
+#include <catalog.hpp>
+#include <config.hpp>
+#include <logger.hpp>
+#include <trace.hpp>
+#include <utils.hpp>
+#include <filesystem>
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace openspm
+{
+    using namespace logger;
+
+    std::string daemonSocketPath()
+    {
+        return (std::filesystem::path(getConfig()->dataDir) / "openspmd.sock").string();
+    }
+
+#ifdef _WIN32
+    int runDaemon()
+    {
+        error("openspmd is not supported on Windows.");
+        return 1;
+    }
+
+    bool queryDaemon(const std::string &, const std::string &, const std::string &,
+                     std::vector<PackageInfo> &, int &)
+    {
+        return false;
+    }
+#else
+    namespace
+    {
+        /// Largest request line the daemon accepts
+        constexpr size_t MaxRequestSize = 64 * 1024;
+        /// Seconds a peer may stall before the connection is dropped
+        constexpr int IoTimeoutSeconds = 30;
+
+        volatile std::sig_atomic_t stopRequested = 0;
+
+        void onStopSignal(int)
+        {
+            stopRequested = 1;
+        }
+
+        std::string escapeField(const std::string &field)
+        {
+            std::string out;
+            out.reserve(field.size());
+            for (char c : field)
+            {
+                switch (c)
+                {
+                case '\\':
+                    out += "\\\\";
+                    break;
+                case '\t':
+                    out += "\\t";
+                    break;
+                case '\n':
+                    out += "\\n";
+                    break;
+                case '\r':
+                    out += "\\r";
+                    break;
+                default:
+                    out.push_back(c);
+                }
+            }
+            return out;
+        }
+
+        std::string unescapeField(const std::string &field)
+        {
+            std::string out;
+            out.reserve(field.size());
+            for (size_t i = 0; i < field.size(); ++i)
+            {
+                if (field[i] != '\\' || i + 1 == field.size())
+                {
+                    out.push_back(field[i]);
+                    continue;
+                }
+                char next = field[++i];
+                out.push_back(next == 't' ? '\t' : next == 'n' ? '\n' : next == 'r' ? '\r' : next);
+            }
+            return out;
+        }
+
+        std::vector<std::string> splitFields(const std::string &line)
+        {
+            std::vector<std::string> fields;
+            size_t start = 0;
+            for (;;)
+            {
+                size_t tab = line.find('\t', start);
+                fields.push_back(unescapeField(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start)));
+                if (tab == std::string::npos)
+                {
+                    return fields;
+                }
+                start = tab + 1;
+            }
+        }
+
+        void appendRecord(std::string &out, const PackageInfo &pkg)
+        {
+            out += "P";
+            for (const std::string *field : {&pkg.name, &pkg.version, &pkg.description, &pkg.maintainer, &pkg.tags, &pkg.url, &pkg.repository})
+            {
+                out += '\t' + escapeField(*field);
+            }
+            for (const auto &dep : pkg.dependencies)
+            {
+                out += '\t' + escapeField(dep);
+            }
+            out += '\n';
+        }
+
+        bool parseRecord(const std::vector<std::string> &fields, PackageInfo &pkg)
+        {
+            if (fields.size() < 8)
+            {
+                return false;
+            }
+            pkg.name = fields[1];
+            pkg.version = fields[2];
+            pkg.description = fields[3];
+            pkg.maintainer = fields[4];
+            pkg.tags = fields[5];
+            pkg.url = fields[6];
+            pkg.repository = fields[7];
+            pkg.dependencies.assign(fields.begin() + 8, fields.end());
+            return true;
+        }
+
+        void setTimeouts(int fd)
+        {
+            struct timeval tv = {IoTimeoutSeconds, 0};
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        }
+
+        bool sendAll(int fd, const std::string &data)
+        {
+            size_t sent = 0;
+            while (sent < data.size())
+            {
+                ssize_t n = send(fd, data.data() + sent, data.size() - sent, 0);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    return false;
+                }
+                sent += static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        /// Read until the peer closes, or (if stopAtNewline) until the first newline
+        bool receive(int fd, std::string &out, bool stopAtNewline)
+        {
+            char buf[16384];
+            for (;;)
+            {
+                ssize_t n = recv(fd, buf, sizeof(buf), 0);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    return false;
+                }
+                if (n == 0)
+                {
+                    return !stopAtNewline || !out.empty();
+                }
+                out.append(buf, static_cast<size_t>(n));
+                if (stopAtNewline)
+                {
+                    size_t newline = out.find('\n');
+                    if (newline != std::string::npos)
+                    {
+                        out.resize(newline);
+                        return true;
+                    }
+                    if (out.size() > MaxRequestSize)
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        bool makeAddress(const std::string &path, sockaddr_un &addr)
+        {
+            std::memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            if (path.size() >= sizeof(addr.sun_path))
+            {
+                return false;
+            }
+            std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+            return true;
+        }
+
+        /**
+         * The catalog as last loaded from data.bin, reloaded when the file's
+         * size or modification time changes.
+         */
+        class DaemonCatalog
+        {
+        public:
+            const Catalog *current()
+            {
+                std::error_code ec;
+                std::filesystem::path dataFile = std::filesystem::path(getConfig()->dataDir) / "data.bin";
+                auto stamp = std::filesystem::last_write_time(dataFile, ec);
+                auto size = ec ? 0 : std::filesystem::file_size(dataFile, ec);
+                if (!ec && loaded && stamp == loadedStamp && size == loadedSize)
+                {
+                    return &catalog;
+                }
+                Catalog fresh;
+                if (fresh.loadPackages() != 0)
+                {
+                    // Possibly caught mid-rewrite; keep serving the old index and retry next time
+                    warn("Failed to reload the package index; serving the previous one.");
+                    return loaded ? &catalog : nullptr;
+                }
+                catalog = std::move(fresh);
+                loaded = true;
+                loadedStamp = stamp;
+                loadedSize = size;
+                log("Loaded " + std::to_string(catalog.packages().size()) + " packages");
+                return &catalog;
+            }
+
+        private:
+            Catalog catalog;
+            bool loaded = false;
+            std::filesystem::file_time_type loadedStamp;
+            std::uintmax_t loadedSize = 0;
+        };
+
+        std::string handleRequest(const std::string &line, DaemonCatalog &state)
+        {
+            std::vector<std::string> fields = splitFields(line);
+            const std::string &command = fields[0];
+            std::string tags = fields.size() > 1 ? fields[1] : getConfig()->supported_tags;
+            std::string argument = fields.size() > 2 ? fields[2] : "";
+            OPENSPM_DEBUG("[DEBUG handleRequest] " + command + " " + argument);
+
+            if (command == "ping")
+            {
+                return "S\t0\n";
+            }
+            const Catalog *catalog = state.current();
+            if (catalog == nullptr)
+            {
+                return "S\t1\n";
+            }
+            std::string response;
+            if (command == "list-packages")
+            {
+                for (const auto &pkg : catalog->packages())
+                {
+                    if (areTagsCompatible(tags, pkg.tags))
+                    {
+                        appendRecord(response, pkg);
+                    }
+                }
+                return response + "S\t0\n";
+            }
+            if (command == "resolve")
+            {
+                // Resolve against the caller's tags, which may differ from the daemon's (--tags)
+                std::vector<PackageInfo> collected;
+                int status = collectDependencies(*catalog, argument, tags, collected);
+                if (status != 0)
+                {
+                    return "S\t" + std::to_string(status) + "\n";
+                }
+                for (const auto &pkg : collected)
+                {
+                    appendRecord(response, pkg);
+                }
+                return response + "S\t0\n";
+            }
+            warn("Unknown daemon query: " + command);
+            return "S\t2\n";
+        }
+    } // namespace
+
+    int runDaemon()
+    {
+        std::string path = daemonSocketPath();
+        sockaddr_un addr;
+        if (!makeAddress(path, addr))
+        {
+            error("Socket path too long: " + path);
+            return 1;
+        }
+
+        // A socket file left behind by a daemon that died is removed; a live one is not
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (probe >= 0)
+        {
+            bool alive = connect(probe, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+            close(probe);
+            if (alive)
+            {
+                error("openspmd is already running on " + path);
+                return 1;
+            }
+        }
+        unlink(path.c_str());
+
+        int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd < 0)
+        {
+            error("Failed to create socket: " + std::string(std::strerror(errno)));
+            return 1;
+        }
+        mode_t oldMask = umask(077);
+        int bound = bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+        umask(oldMask);
+        if (bound != 0 || listen(listenFd, 64) != 0)
+        {
+            error("Failed to listen on " + path + ": " + std::strerror(errno));
+            close(listenFd);
+            return 1;
+        }
+
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = onStopSignal;
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+        std::signal(SIGPIPE, SIG_IGN);
+
+        DaemonCatalog state;
+        state.current();
+        log("openspmd listening on " + path);
+
+        while (!stopRequested)
+        {
+            pollfd pfd = {listenFd, POLLIN, 0};
+            int ready = poll(&pfd, 1, 1000);
+            if (ready <= 0)
+            {
+                continue; // timeout, or interrupted by a signal
+            }
+            int clientFd = accept(listenFd, nullptr, nullptr);
+            if (clientFd < 0)
+            {
+                continue;
+            }
+            setTimeouts(clientFd);
+            std::string request;
+            if (receive(clientFd, request, true))
+            {
+                sendAll(clientFd, handleRequest(request, state));
+            }
+            close(clientFd);
+        }
+
+        log("openspmd shutting down");
+        close(listenFd);
+        unlink(path.c_str());
+        return 0;
+    }
+
+    bool queryDaemon(const std::string &command, const std::string &argument, const std::string &tags,
+                     std::vector<PackageInfo> &outPackages, int &outStatus)
+    {
+        std::string path = daemonSocketPath();
+        sockaddr_un addr;
+        if (!makeAddress(path, addr))
+        {
+            return false;
+        }
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            return false;
+        }
+        if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+        {
+            OPENSPM_DEBUG("[DEBUG queryDaemon] No daemon on " + path + ", running standalone");
+            close(fd);
+            return false;
+        }
+        trace::Span span("queryDaemon", "daemon");
+        span.setDetail(command);
+        setTimeouts(fd);
+        std::signal(SIGPIPE, SIG_IGN);
+
+        std::string request = escapeField(command) + '\t' + escapeField(tags);
+        if (!argument.empty())
+        {
+            request += '\t' + escapeField(argument);
+        }
+        request += '\n';
+        std::string response;
+        bool ok = sendAll(fd, request) && receive(fd, response, false);
+        close(fd);
+        if (!ok)
+        {
+            warn("openspmd did not answer; running standalone");
+            return false;
+        }
+
+        std::vector<PackageInfo> packages;
+        size_t start = 0;
+        while (start < response.size())
+        {
+            size_t newline = response.find('\n', start);
+            if (newline == std::string::npos)
+            {
+                break;
+            }
+            std::vector<std::string> fields = splitFields(response.substr(start, newline - start));
+            start = newline + 1;
+            PackageInfo pkg;
+            if (fields[0] == "P" && parseRecord(fields, pkg))
+            {
+                packages.push_back(std::move(pkg));
+            }
+            else if (fields[0] == "S" && fields.size() > 1)
+            {
+                outStatus = std::atoi(fields[1].c_str());
+                outPackages = std::move(packages);
+                span.setItems(outPackages.size());
+                OPENSPM_DEBUG("[DEBUG queryDaemon] " + command + " answered by daemon with status " + std::to_string(outStatus));
+                return true;
+            }
+        }
+        warn("Malformed response from openspmd; running standalone");
+        return false;
+    }
+#endif
+} // namespace openspm
@@ -0,0 +1,111 @@
+/**
+ * @file dependents_index.cpp
+ * @brief Implementation of the reverse-dependency index
+ */
+#include <dependents_index.hpp>
+#include <logger.hpp>
+#include <version.hpp>
+#include <algorithm>
+
+namespace openspm
+{
+    using namespace logger;
+
+    namespace
+    {
+        constexpr char Magic[8] = {'O', 'S', 'P', 'M', 'R', 'D', 'P', '1'};
+        constexpr std::uint32_t Missing = 0xffffffffu;
+    } // namespace
+
+    std::string buildDependentsIndex(const std::vector<PackageInfo> &packages)
+    {
+        // Versions of a name are adjacent; each name gets one number
+        std::vector<std::string_view> names;
+        std::vector<std::uint32_t> numberOf(packages.size());
+        for (size_t i = 0; i < packages.size(); ++i)
+        {
+            if (names.empty() || names.back() != packages[i].name)
+            {
+                names.emplace_back(packages[i].name);
+            }
+            numberOf[i] = static_cast<std::uint32_t>(names.size() - 1);
+        }
+        std::uint32_t n = static_cast<std::uint32_t>(names.size());
+        auto findName = [&names](std::string_view name) -> std::uint32_t
+        {
+            auto it = std::lower_bound(names.begin(), names.end(), name);
+            return it != names.end() && *it == name ? static_cast<std::uint32_t>(it - names.begin()) : Missing;
+        };
+
+        // Edges dependency -> dependent, once per pair however many versions repeat them
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> edges;
+        for (size_t i = 0; i < packages.size(); ++i)
+        {
+            for (const auto &dep : packages[i].dependencies)
+            {
+                std::uint32_t target = findName(dependencyName(dep));
+                if (target != Missing && target != numberOf[i])
+                {
+                    edges.emplace_back(target, numberOf[i]);
+                }
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        std::vector<NamePoolEntry> entries;
+        entries.reserve(n);
+        std::vector<std::uint32_t> pool;
+        pool.reserve(edges.size());
+        size_t edge = 0;
+        for (std::uint32_t i = 0; i < n; ++i)
+        {
+            size_t begin = edge;
+            for (; edge < edges.size() && edges[edge].first == i; ++edge)
+            {
+                pool.push_back(edges[edge].second);
+            }
+            entries.emplace_back(static_cast<std::uint32_t>(begin), static_cast<std::uint32_t>(edge - begin));
+        }
+        std::string out = writeNamePool(Magic, names, entries, pool);
+        OPENSPM_DEBUG("[DEBUG buildDependentsIndex] " + std::to_string(n) + " packages, " + std::to_string(edges.size()) + " reverse edges");
+        return out;
+    }
+
+    int DependentsIndex::load(std::string content)
+    {
+        if (table.load(std::move(content), Magic) != 0)
+        {
+            OPENSPM_DEBUG("[DEBUG DependentsIndex::load] Not a reverse-dependency index");
+            return 1;
+        }
+        return 0;
+    }
+
+    bool DependentsIndex::lookup(std::string_view name, std::vector<std::string_view> &outDependents) const
+    {
+        std::uint32_t package = table.find(name);
+        if (package == table.size())
+        {
+            return false;
+        }
+        auto [offset, length] = table.entry(package);
+        outDependents.clear();
+        if (!table.inPool(offset, length))
+        {
+            return false;
+        }
+        outDependents.reserve(length);
+        for (std::uint32_t i = offset; i < offset + length; ++i)
+        {
+            std::uint32_t dependent = table.poolValue(i);
+            if (dependent >= table.size())
+            {
+                outDependents.clear();
+                return false;
+            }
+            outDependents.push_back(table.nameAt(dependent));
+        }
+        return true;
+    }
+} // namespace openspm
@@ -0,0 +1,203 @@
+/**
+ * @file durability.cpp
+ * @brief Implementation of the installer durability policy
+ *
+ * Batch mode issues one syncfs per filesystem touched by the transaction
+ * on Linux, and falls back to a grouped fdatasync of every written file
+ * on other platforms. Strict mode syncs each file and its directory as
+ * soon as it is written.
+ */
+#include <durability.hpp>
+#include <logger.hpp>
+#include <filesystem>
+#include <cstring>
+#include <cerrno>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace openspm
+{
+    using namespace logger;
+
+    bool parseDurabilityMode(const std::string &value, DurabilityMode &outMode)
+    {
+        if (value == "none")
+            outMode = DurabilityMode::None;
+        else if (value == "batch")
+            outMode = DurabilityMode::Batch;
+        else if (value == "strict")
+            outMode = DurabilityMode::Strict;
+        else
+            return false;
+        return true;
+    }
+
+    std::string durabilityModeName(DurabilityMode mode)
+    {
+        switch (mode)
+        {
+        case DurabilityMode::Batch:
+            return "batch";
+        case DurabilityMode::Strict:
+            return "strict";
+        default:
+            return "none";
+        }
+    }
+
+    /// Flush one file's data to stable storage
+    static int syncFile(const std::string &path)
+    {
+#ifdef _WIN32
+        // _commit needs write access, which a read-only file doesn't grant
+        int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+        if (fd < 0 && errno == EACCES)
+        {
+            warn("Not syncing read-only file: " + path);
+            return 0;
+        }
+        if (fd < 0)
+        {
+            error("Failed to open file for sync: " + path + " (" + std::strerror(errno) + ")");
+            return 1;
+        }
+        int ret = _commit(fd);
+        _close(fd);
+#else
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            error("Failed to open file for sync: " + path + " (" + std::strerror(errno) + ")");
+            return 1;
+        }
+#ifdef __APPLE__
+        int ret = fsync(fd);
+#else
+        int ret = fdatasync(fd);
+#endif
+        close(fd);
+#endif
+        if (ret != 0)
+        {
+            error("Failed to sync file: " + path);
+            return 1;
+        }
+        return 0;
+    }
+
+    /// Flush a directory so newly created entries survive a crash
+    static int syncDirectory(const std::string &path)
+    {
+#ifdef _WIN32
+        (void)path;
+        return 0;
+#else
+        int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            error("Failed to open directory for sync: " + path + " (" + std::strerror(errno) + ")");
+            return 1;
+        }
+        int ret = fsync(fd);
+        close(fd);
+        if (ret != 0)
+        {
+            error("Failed to sync directory: " + path);
+            return 1;
+        }
+        return 0;
+#endif
+    }
+
+    SyncBatch::SyncBatch(DurabilityMode mode) : mode(mode)
+    {
+        OPENSPM_DEBUG("[DEBUG SyncBatch::SyncBatch] Durability mode: " + durabilityModeName(mode));
+    }
+
+    int SyncBatch::fileWritten(const std::string &path)
+    {
+        files++;
+        if (mode == DurabilityMode::None)
+        {
+            return 0;
+        }
+        std::string parent = std::filesystem::path(path).parent_path().string();
+        bool newDir = seenDirs.insert(parent).second;
+
+        if (mode == DurabilityMode::Strict)
+        {
+            if (syncFile(path) != 0)
+                return 1;
+            return syncDirectory(parent);
+        }
+
+#if defined(__linux__)
+        // syncfs covers everything on a filesystem, so one directory per
+        // device is all batch mode needs to remember.
+        if (newDir)
+        {
+            struct stat st;
+            if (stat(parent.c_str(), &st) == 0 && seenDevices.insert(static_cast<unsigned long long>(st.st_dev)).second)
+            {
+                OPENSPM_DEBUG("[DEBUG SyncBatch::fileWritten] New filesystem under: " + parent);
+                filesystemRoots.push_back(parent);
+            }
+        }
+#else
+        (void)newDir;
+        pendingFiles.push_back(path);
+#endif
+        return 0;
+    }
+
+    int SyncBatch::commit()
+    {
+        if (mode != DurabilityMode::Batch)
+        {
+            return 0;
+        }
+        OPENSPM_DEBUG("[DEBUG SyncBatch::commit] Committing " + std::to_string(files) + " files");
+        int status = 0;
+#if defined(__linux__)
+        for (const auto &root : filesystemRoots)
+        {
+            int fd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                error("Failed to open directory for sync: " + root + " (" + std::strerror(errno) + ")");
+                status = 1;
+                continue;
+            }
+            OPENSPM_DEBUG("[DEBUG SyncBatch::commit] syncfs on filesystem of: " + root);
+            if (syncfs(fd) != 0)
+            {
+                error("syncfs failed for: " + root + " (" + std::strerror(errno) + ")");
+                status = 1;
+            }
+            close(fd);
+        }
+        filesystemRoots.clear();
+        seenDevices.clear();
+#else
+        for (const auto &path : pendingFiles)
+        {
+            if (syncFile(path) != 0)
+                status = 1;
+        }
+        for (const auto &dir : seenDirs)
+        {
+            if (syncDirectory(dir) != 0)
+                status = 1;
+        }
+        pendingFiles.clear();
+#endif
+        seenDirs.clear();
+        return status;
+    }
+} // namespace openspm
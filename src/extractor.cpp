@@ -0,0 +1,610 @@
+/**
+ * @file extractor.cpp
+ * @brief Implementation of package archive extraction
+ *
+ * The portable path streams every entry through archive_write_disk. When
+ * built with OPENSPM_HAVE_IO_URING, small regular files are buffered and
+ * flushed in batches: one io_uring_enter opens the whole batch, one writes
+ * it and one closes it, instead of several syscalls per file.
+ */
+#ifdef _WIN32
+#include <BaseTsd.h>
+using ssize_t = SSIZE_T;
+#endif
+#include <extractor.hpp>
+#include <logger.hpp>
+#include <archive.h>
+#include <archive_entry.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#ifdef OPENSPM_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#endif
+
+namespace openspm
+{
+    using namespace logger;
+
+    static const int extractFlags = ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM | ARCHIVE_EXTRACT_ACL | ARCHIVE_EXTRACT_FFLAGS;
+
+    /// Copy the current entry header and data blocks through archive_write_disk
+    static void writeEntryToDisk(struct archive *a, struct archive *ext, struct archive_entry *entry, const std::string &fullPath)
+    {
+        if (archive_write_header(ext, entry) != ARCHIVE_OK)
+        {
+            error("Failed to write header for: " + fullPath);
+            return;
+        }
+        const void *buff;
+        size_t size;
+        la_int64_t offset;
+
+        while (archive_read_data_block(a, &buff, &size, &offset) == ARCHIVE_OK)
+        {
+            archive_write_data_block(ext, buff, size, offset);
+        }
+        archive_write_finish_entry(ext);
+    }
+
+    /// Open a package archive for reading and a disk writer for extraction
+    static int openArchivePair(const std::string &archivePath, struct archive *&a, struct archive *&ext)
+    {
+        a = archive_read_new();
+        ext = archive_write_disk_new();
+        archive_read_support_format_all(a);
+        archive_read_support_filter_all(a);
+        archive_write_disk_set_options(ext, extractFlags);
+
+        if (archive_read_open_filename(a, archivePath.c_str(), 10240) != ARCHIVE_OK)
+        {
+            error("Failed to open archive: " + archivePath);
+            archive_read_free(a);
+            archive_write_free(ext);
+            return 1;
+        }
+        return 0;
+    }
+
+    static void closeArchivePair(struct archive *a, struct archive *ext)
+    {
+        archive_read_close(a);
+        archive_read_free(a);
+        archive_write_close(ext);
+        archive_write_free(ext);
+    }
+
+    /// Extract every entry through libarchive's disk writer
+    static int extractWithDiskWriter(const std::string &archivePath, const std::string &extractPath)
+    {
+        struct archive *a;
+        struct archive *ext;
+        if (openArchivePair(archivePath, a, ext) != 0)
+        {
+            return 1;
+        }
+
+        struct archive_entry *entry;
+        while (archive_read_next_header(a, &entry) == ARCHIVE_OK)
+        {
+            std::filesystem::path fullPath = std::filesystem::path(extractPath) / archive_entry_pathname(entry);
+            archive_entry_set_pathname(entry, fullPath.string().c_str());
+            writeEntryToDisk(a, ext, entry, fullPath.string());
+        }
+
+        closeArchivePair(a, ext);
+        return 0;
+    }
+
+#ifdef OPENSPM_HAVE_IO_URING
+    namespace
+    {
+        constexpr unsigned ringEntries = 64;            ///< Submission queue size, also the max files per batch
+        constexpr size_t maxBatchedFileSize = 1 << 20; ///< Larger files stream through libarchive
+        constexpr size_t maxBatchBytes = 8 << 20;      ///< Flush once this much file data is buffered
+
+        /**
+         * @brief Minimal io_uring wrapper built on the raw syscalls
+         *
+         * Only what the extraction sink needs: queue SQEs, submit, and wait
+         * for all of them. Results are stored by the SQE's user_data index.
+         */
+        class UringQueue
+        {
+        public:
+            UringQueue() = default;
+            UringQueue(const UringQueue &) = delete;
+            UringQueue &operator=(const UringQueue &) = delete;
+            ~UringQueue();
+
+            bool init(unsigned entries);
+            io_uring_sqe *nextSqe();
+            bool submitAndWait(std::vector<int> &results);
+
+        private:
+            bool probeOps();
+
+            int ringFd = -1;
+            void *sqRing = MAP_FAILED;
+            void *cqRing = MAP_FAILED;
+            size_t sqRingSize = 0;
+            size_t cqRingSize = 0;
+            io_uring_sqe *sqes = nullptr;
+            size_t sqesSize = 0;
+            unsigned *sqTail = nullptr;
+            unsigned *sqMask = nullptr;
+            unsigned *sqArray = nullptr;
+            unsigned *cqHead = nullptr;
+            unsigned *cqTail = nullptr;
+            unsigned *cqMask = nullptr;
+            io_uring_cqe *cqes = nullptr;
+            unsigned pending = 0;
+        };
+
+        UringQueue::~UringQueue()
+        {
+            if (sqes != nullptr)
+                munmap(sqes, sqesSize);
+            if (cqRing != MAP_FAILED && cqRing != sqRing)
+                munmap(cqRing, cqRingSize);
+            if (sqRing != MAP_FAILED)
+                munmap(sqRing, sqRingSize);
+            if (ringFd >= 0)
+                close(ringFd);
+        }
+
+        bool UringQueue::init(unsigned entries)
+        {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+            if (ringFd < 0)
+            {
+                OPENSPM_DEBUG("[DEBUG UringQueue::init] io_uring_setup failed: " + std::string(std::strerror(errno)));
+                return false;
+            }
+
+            sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (singleMmap)
+            {
+                sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+            }
+
+            sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+            if (sqRing == MAP_FAILED)
+            {
+                OPENSPM_DEBUG("[DEBUG UringQueue::init] Failed to map submission ring");
+                return false;
+            }
+            if (singleMmap)
+            {
+                cqRing = sqRing;
+            }
+            else
+            {
+                cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+                if (cqRing == MAP_FAILED)
+                {
+                    OPENSPM_DEBUG("[DEBUG UringQueue::init] Failed to map completion ring");
+                    return false;
+                }
+            }
+
+            sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            void *sqeMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+            if (sqeMap == MAP_FAILED)
+            {
+                OPENSPM_DEBUG("[DEBUG UringQueue::init] Failed to map SQE array");
+                return false;
+            }
+            sqes = static_cast<io_uring_sqe *>(sqeMap);
+
+            char *sq = static_cast<char *>(sqRing);
+            sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+            sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+            sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+            char *cq = static_cast<char *>(cqRing);
+            cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+            cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+            cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+            return probeOps();
+        }
+
+        /// Make sure the kernel knows every opcode the sink submits (5.6+)
+        bool UringQueue::probeOps()
+        {
+            const unsigned probeOpsLen = 256;
+            std::vector<unsigned char> buffer(sizeof(io_uring_probe) + probeOpsLen * sizeof(io_uring_probe_op), 0);
+            auto *probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+            if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, probeOpsLen) < 0)
+            {
+                OPENSPM_DEBUG("[DEBUG UringQueue::probeOps] IORING_REGISTER_PROBE failed: " + std::string(std::strerror(errno)));
+                return false;
+            }
+            for (unsigned op : {IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE})
+            {
+                if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+                {
+                    OPENSPM_DEBUG("[DEBUG UringQueue::probeOps] Kernel lacks io_uring opcode " + std::to_string(op));
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        io_uring_sqe *UringQueue::nextSqe()
+        {
+            unsigned tail = *sqTail;
+            unsigned index = tail & *sqMask;
+            io_uring_sqe *sqe = &sqes[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqArray[index] = index;
+            __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+            pending++;
+            return sqe;
+        }
+
+        bool UringQueue::submitAndWait(std::vector<int> &results)
+        {
+            unsigned expected = pending;
+            unsigned completed = 0;
+            while (completed < expected)
+            {
+                int ret = static_cast<int>(syscall(__NR_io_uring_enter, ringFd, pending, expected - completed,
+                                                   IORING_ENTER_GETEVENTS, nullptr, 0));
+                if (ret < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    error("io_uring_enter failed: " + std::string(std::strerror(errno)));
+                    return false;
+                }
+                pending -= std::min(static_cast<unsigned>(ret), pending);
+
+                unsigned head = *cqHead;
+                unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+                while (head != tail)
+                {
+                    const io_uring_cqe &cqe = cqes[head & *cqMask];
+                    if (cqe.user_data < results.size())
+                        results[cqe.user_data] = cqe.res;
+                    head++;
+                    completed++;
+                }
+                __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+            }
+            return true;
+        }
+
+        /// A regular file fully buffered in memory, waiting for the next flush
+        struct PendingFile
+        {
+            std::string path;
+            mode_t mode = 0644;
+            std::string data;
+            int fd = -1;
+            size_t written = 0;
+        };
+
+        /**
+         * @brief Collects small files and writes them in three ring round trips
+         *
+         * Each flush opens all buffered files, writes all of them (resubmitting
+         * short writes) and closes all of them, one io_uring_enter per phase.
+         */
+        class BatchedFileSink
+        {
+        public:
+            explicit BatchedFileSink(UringQueue &ring) : ring(ring) {}
+
+            bool add(PendingFile file)
+            {
+                // Two opens of one path in a submission race; flush so the later entry wins
+                if (paths.count(file.path) != 0 && !flush())
+                {
+                    return false;
+                }
+                paths.insert(file.path);
+                bufferedBytes += file.data.size();
+                files.push_back(std::move(file));
+                if (files.size() >= ringEntries || bufferedBytes >= maxBatchBytes)
+                {
+                    return flush();
+                }
+                return true;
+            }
+
+            bool flush()
+            {
+                if (files.empty())
+                {
+                    return true;
+                }
+                OPENSPM_DEBUG("[DEBUG BatchedFileSink::flush] Flushing " + std::to_string(files.size()) + " files (" + std::to_string(bufferedBytes) + " bytes)");
+                bool ok = true;
+                // Results the ring never reported stay at NotCompleted
+                std::vector<int> results(files.size(), NotCompleted);
+
+                for (size_t i = 0; i < files.size(); ++i)
+                {
+                    io_uring_sqe *sqe = ring.nextSqe();
+                    sqe->opcode = IORING_OP_OPENAT;
+                    sqe->fd = AT_FDCWD;
+                    sqe->addr = reinterpret_cast<uintptr_t>(files[i].path.c_str());
+                    sqe->len = files[i].mode;
+                    sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+                    sqe->user_data = i;
+                }
+                bool opened = ring.submitAndWait(results);
+                for (size_t i = 0; i < files.size(); ++i)
+                {
+                    if (results[i] >= 0)
+                    {
+                        files[i].fd = results[i];
+                    }
+                }
+                if (!opened)
+                {
+                    return discard();
+                }
+                for (size_t i = 0; i < files.size(); ++i)
+                {
+                    if (results[i] < 0)
+                    {
+                        error("Failed to create file: " + files[i].path + " (" + std::strerror(-results[i]) + ")");
+                        ok = false;
+                        continue;
+                    }
+                    // The open mode is masked by the umask and ignored for an existing file
+                    if (fchmod(files[i].fd, files[i].mode) != 0)
+                    {
+                        error("Failed to set permissions of " + files[i].path + " (" + std::strerror(errno) + ")");
+                        ok = false;
+                    }
+                }
+
+                while (true)
+                {
+                    unsigned queued = 0;
+                    std::fill(results.begin(), results.end(), 0);
+                    for (size_t i = 0; i < files.size(); ++i)
+                    {
+                        PendingFile &file = files[i];
+                        if (file.fd < 0 || file.written >= file.data.size())
+                            continue;
+                        io_uring_sqe *sqe = ring.nextSqe();
+                        sqe->opcode = IORING_OP_WRITE;
+                        sqe->fd = file.fd;
+                        sqe->addr = reinterpret_cast<uintptr_t>(file.data.data() + file.written);
+                        sqe->len = static_cast<unsigned>(file.data.size() - file.written);
+                        sqe->off = file.written;
+                        sqe->user_data = i;
+                        queued++;
+                    }
+                    if (queued == 0)
+                        break;
+                    if (!ring.submitAndWait(results))
+                    {
+                        return discard();
+                    }
+                    for (size_t i = 0; i < files.size(); ++i)
+                    {
+                        PendingFile &file = files[i];
+                        if (file.fd < 0 || file.written >= file.data.size())
+                            continue;
+                        if (results[i] <= 0)
+                        {
+                            error("Failed to write file: " + file.path + (results[i] < 0 ? " (" + std::string(std::strerror(-results[i])) + ")" : ""));
+                            file.written = file.data.size();
+                            ok = false;
+                            continue;
+                        }
+                        file.written += static_cast<size_t>(results[i]);
+                    }
+                }
+
+                std::fill(results.begin(), results.end(), NotCompleted);
+                for (size_t i = 0; i < files.size(); ++i)
+                {
+                    if (files[i].fd < 0)
+                        continue;
+                    io_uring_sqe *sqe = ring.nextSqe();
+                    sqe->opcode = IORING_OP_CLOSE;
+                    sqe->fd = files[i].fd;
+                    sqe->user_data = i;
+                }
+                bool closed = ring.submitAndWait(results);
+                for (size_t i = 0; i < files.size(); ++i)
+                {
+                    if (files[i].fd < 0)
+                        continue;
+                    if (results[i] == NotCompleted)
+                    {
+                        // The ring failed before closing this one; any result means the fd is gone
+                        continue;
+                    }
+                    files[i].fd = -1;
+                    if (results[i] < 0)
+                    {
+                        error("Failed to close file: " + files[i].path + " (" + std::strerror(-results[i]) + ")");
+                        ok = false;
+                    }
+                }
+                if (!closed)
+                {
+                    return discard();
+                }
+
+                files.clear();
+                paths.clear();
+                bufferedBytes = 0;
+                return ok;
+            }
+
+        private:
+            /// Sentinel for a request without a completion; no syscall returns it
+            static constexpr int NotCompleted = std::numeric_limits<int>::min();
+
+            /// Close whatever a failed flush left open and drop the batch
+            bool discard()
+            {
+                for (auto &file : files)
+                {
+                    if (file.fd >= 0)
+                    {
+                        close(file.fd);
+                        file.fd = -1;
+                    }
+                }
+                files.clear();
+                paths.clear();
+                bufferedBytes = 0;
+                return false;
+            }
+
+            UringQueue &ring;
+            std::vector<PendingFile> files;
+            /// Destinations in the current batch
+            std::unordered_set<std::string> paths;
+            size_t bufferedBytes = 0;
+        };
+    } // namespace
+
+    /// Extract small regular files through the batched sink, everything else through libarchive
+    static int extractWithIoUring(UringQueue &ring, const std::string &archivePath, const std::string &extractPath)
+    {
+        struct archive *a;
+        struct archive *ext;
+        if (openArchivePair(archivePath, a, ext) != 0)
+        {
+            return 1;
+        }
+
+        BatchedFileSink sink(ring);
+        std::unordered_set<std::string> createdDirs;
+        size_t batchedFiles = 0;
+        int status = 0;
+
+        struct archive_entry *entry;
+        while (archive_read_next_header(a, &entry) == ARCHIVE_OK)
+        {
+            std::filesystem::path fullPath = std::filesystem::path(extractPath) / archive_entry_pathname(entry);
+            la_int64_t size = archive_entry_size(entry);
+            bool batchable = archive_entry_filetype(entry) == AE_IFREG &&
+                             archive_entry_hardlink(entry) == nullptr &&
+                             archive_entry_size_is_set(entry) &&
+                             size >= 0 && static_cast<size_t>(size) <= maxBatchedFileSize;
+            if (batchable)
+            {
+                std::string parent = fullPath.parent_path().string();
+                if (createdDirs.insert(parent).second)
+                {
+                    std::error_code ec;
+                    std::filesystem::create_directories(parent, ec);
+                    if (ec)
+                    {
+                        error("Failed to create directory: " + parent + " (" + ec.message() + ")");
+                        status = 1;
+                        break;
+                    }
+                }
+
+                PendingFile file;
+                file.path = fullPath.string();
+                file.mode = archive_entry_perm(entry);
+                file.data.resize(static_cast<size_t>(size));
+                size_t got = 0;
+                while (got < file.data.size())
+                {
+                    la_ssize_t n = archive_read_data(a, &file.data[got], file.data.size() - got);
+                    if (n < 0)
+                    {
+                        error("Failed to read archive data for: " + file.path);
+                        status = 1;
+                        break;
+                    }
+                    if (n == 0)
+                        break;
+                    got += static_cast<size_t>(n);
+                }
+                if (status != 0)
+                    break;
+                file.data.resize(got);
+                batchedFiles++;
+                if (!sink.add(std::move(file)))
+                {
+                    status = 1;
+                    break;
+                }
+                continue;
+            }
+
+            // Directories, links and large files go through libarchive. Flush first
+            // so hard links and overwrites observe the files buffered before them.
+            if (!sink.flush())
+            {
+                status = 1;
+                break;
+            }
+            archive_entry_set_pathname(entry, fullPath.string().c_str());
+            writeEntryToDisk(a, ext, entry, fullPath.string());
+        }
+
+        if (status == 0 && !sink.flush())
+        {
+            status = 1;
+        }
+        OPENSPM_DEBUG("[DEBUG extractWithIoUring] Batched " + std::to_string(batchedFiles) + " files through io_uring");
+        closeArchivePair(a, ext);
+        return status;
+    }
+#endif
+
+    bool ioUringExtractionAvailable()
+    {
+#ifdef OPENSPM_HAVE_IO_URING
+        static const bool available = []
+        {
+            UringQueue ring;
+            return ring.init(ringEntries);
+        }();
+        return available;
+#else
+        return false;
+#endif
+    }
+
+    int extractPackageArchive(const std::string &archivePath, const std::string &extractPath)
+    {
+        OPENSPM_DEBUG("[DEBUG extractPackageArchive] Extracting " + archivePath + " to " + extractPath);
+#ifdef OPENSPM_HAVE_IO_URING
+        if (ioUringExtractionAvailable())
+        {
+            UringQueue ring;
+            if (ring.init(ringEntries))
+            {
+                OPENSPM_DEBUG("[DEBUG extractPackageArchive] Using io_uring extraction sink");
+                return extractWithIoUring(ring, archivePath, extractPath);
+            }
+        }
+        OPENSPM_DEBUG("[DEBUG extractPackageArchive] io_uring unavailable, using archive_write_disk");
+#endif
+        return extractWithDiskWriter(archivePath, extractPath);
+    }
+} // namespace openspm
@@ -0,0 +1,707 @@
+/**
+ * @file index_shards.cpp
+ * @brief Implementation of per-repository index shards
+ */
+#include <index_shards.hpp>
+#include <archive.hpp>
+#include <bloom_filter.hpp>
+#include <catalog.hpp>
+#include <closure_index.hpp>
+#include <config.hpp>
+#include <logger.hpp>
+#include <package_list_parser.hpp>
+#include <trace.hpp>
+#include <utils.hpp>
+#include <version.hpp>
+#include <yaml-cpp/yaml.h>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <queue>
+#include <set>
+
+namespace openspm
+{
+    using namespace logger;
+
+    namespace
+    {
+        void appendMergeOrder(const std::string &url, const ShardManifest &manifest,
+                              std::set<std::string> &inProgress, std::vector<std::string> &order)
+        {
+            auto it = manifest.find(url);
+            if (it == manifest.end() || !inProgress.insert(url).second)
+            {
+                return;
+            }
+            for (const auto &dep : it->second.depend)
+            {
+                appendMergeOrder(dep, manifest, inProgress, order);
+            }
+            inProgress.erase(url);
+            order.push_back(url);
+        }
+
+        bool byName(const PackageInfo &a, const PackageInfo &b)
+        {
+            return a.name < b.name;
+        }
+
+        /// A package read from a source, waiting for the rest of its name
+        struct RunEntry
+        {
+            size_t source;
+            PackageInfo pkg;
+        };
+
+        /**
+         * @brief Apply pins and priorities to all versions of one name and append the winners
+         *
+         * @p run is in source order, and in read order within a source, so
+         * of equal versions the last one wins.
+         */
+        void finishRun(std::vector<RunEntry> &run, const std::vector<MergeSource> &sources,
+                       const std::map<std::string, std::vector<size_t>> &pinners, std::vector<PackageInfo> &merged)
+        {
+            if (run.empty())
+            {
+                return;
+            }
+            const std::string name = run.front().pkg.name;
+            auto pinned = pinners.find(name);
+            std::vector<std::pair<VersionKey, size_t>> keys;
+            keys.reserve(run.size());
+            bool any = false;
+            int best = 0;
+            for (size_t i = 0; i < run.size(); ++i)
+            {
+                const ShardPolicy &policy = sources[run[i].source].policy;
+                VersionKey key = parseVersion(run[i].pkg.version);
+                if (pinned != pinners.end())
+                {
+                    auto pin = policy.pins.find(name);
+                    if (pin == policy.pins.end() || !pin->second.contains(key))
+                    {
+                        continue;
+                    }
+                }
+                if (!any || policy.priority > best)
+                {
+                    best = policy.priority;
+                    keys.clear();
+                    any = true;
+                }
+                if (policy.priority == best)
+                {
+                    keys.push_back({key, i});
+                }
+            }
+            if (keys.empty())
+            {
+                OPENSPM_DEBUG("[DEBUG mergeShards] No version of " + name + " matches its pin");
+            }
+            // Pairs compare by position last, so equal versions keep priority order
+            std::sort(keys.begin(), keys.end());
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                if (i + 1 < keys.size() && keys[i + 1].first == keys[i].first)
+                {
+                    continue;
+                }
+                merged.push_back(std::move(run[keys[i].second].pkg));
+            }
+            run.clear();
+        }
+
+        std::vector<RepositoryInfo> repositoryList(const std::map<std::string, std::string> &files)
+        {
+            std::vector<RepositoryInfo> repos;
+            auto content = files.find("repositories.yaml");
+            if (content != files.end() && parseRepositoryList(content->second, repos) != 0)
+            {
+                repos.clear();
+            }
+            return repos;
+        }
+
+        std::vector<std::string> repositoryUrls(const std::vector<RepositoryInfo> &repos)
+        {
+            std::vector<std::string> urls;
+            urls.reserve(repos.size());
+            for (const auto &repo : repos)
+            {
+                urls.push_back(repo.url);
+            }
+            return urls;
+        }
+
+        /// Source reading a stored shard line by line; false if the shard is missing
+        bool storedSource(std::map<std::string, std::string> &contents, const ShardInfo &info, ShardPolicy policy,
+                          MergeSource &outSource)
+        {
+            auto content = contents.find(info.file);
+            if (content == contents.end())
+            {
+                warn("Package index for " + info.url + " is missing. Run 'openspm update' to fetch it.");
+                return false;
+            }
+            auto reader = std::make_shared<PackageListReader>(std::move(content->second));
+            contents.erase(content);
+            std::string url = info.url;
+            outSource.url = url;
+            outSource.policy = std::move(policy);
+            outSource.next = [reader, url](PackageInfo &pkg)
+            {
+                if (reader->next(pkg))
+                {
+                    return true;
+                }
+                if (!reader->error().empty())
+                {
+                    warn("Package index for " + url + " is corrupt (" + reader->error() + "). Run 'openspm update' to refetch it.");
+                }
+                return false;
+            };
+            return true;
+        }
+
+        /// Parse one stored shard; a missing or corrupt shard is reported and yields false
+        bool parseShard(std::map<std::string, std::string> &contents, const ShardInfo &info,
+                        std::vector<PackageInfo> &outPackages)
+        {
+            auto content = contents.find(info.file);
+            if (content == contents.end())
+            {
+                warn("Package index for " + info.url + " is missing. Run 'openspm update' to fetch it.");
+                return false;
+            }
+            std::vector<std::string> depend;
+            std::string parseError;
+            if (parsePackageListJson(content->second, [&outPackages](PackageInfo &&pkg)
+                                     { outPackages.push_back(std::move(pkg)); },
+                                     depend, parseError) != 0)
+            {
+                warn("Package index for " + info.url + " is corrupt (" + parseError + "). Run 'openspm update' to refetch it.");
+                outPackages.clear();
+                return false;
+            }
+            return true;
+        }
+
+        /// A missing or stale closure index only costs speed, so it is never an error
+        void loadClosures(std::map<std::string, std::string> &files, ClosureIndex &out)
+        {
+            auto content = files.find(ClosureIndexFile);
+            if (content == files.end())
+            {
+                return;
+            }
+            if (out.load(std::move(content->second)) != 0)
+            {
+                OPENSPM_DEBUG("[DEBUG loadClosures] Ignoring invalid " + std::string(ClosureIndexFile));
+                out = ClosureIndex();
+            }
+        }
+    } // namespace
+
+    std::string shardFileName(const std::string &url)
+    {
+        // Hashing keeps file names short and stable for any URL
+        return "shards/" + hex64(fnv1a64(url.data(), url.size())) + ".json";
+    }
+
+    int parseShardManifest(const std::string &content, ShardManifest &outManifest)
+    {
+        try
+        {
+            YAML::Node root = YAML::Load(content);
+            if (!root.IsMap())
+            {
+                return root.IsNull() ? 0 : 1;
+            }
+            for (const auto &it : root)
+            {
+                ShardInfo info;
+                info.url = it.first.as<std::string>();
+                const YAML::Node &node = it.second;
+                info.file = node["file"] ? node["file"].as<std::string>() : shardFileName(info.url);
+                info.source = node["source"] ? node["source"].as<std::string>() : "";
+                info.etag = node["etag"] ? node["etag"].as<std::string>() : "";
+                info.lastModified = node["lastModified"] ? node["lastModified"].as<std::string>() : "";
+                info.updated = node["updated"] ? node["updated"].as<long long>() : 0;
+                info.packages = node["packages"] ? node["packages"].as<size_t>() : 0;
+                if (node["depend"] && node["depend"].IsSequence())
+                {
+                    for (const auto &dep : node["depend"])
+                    {
+                        info.depend.push_back(dep.as<std::string>());
+                    }
+                }
+                outManifest[info.url] = std::move(info);
+            }
+        }
+        catch (const YAML::Exception &e)
+        {
+            error("Invalid shard manifest: " + std::string(e.what()));
+            return 1;
+        }
+        return 0;
+    }
+
+    std::string serializeShardManifest(const ShardManifest &manifest)
+    {
+        YAML::Emitter out;
+        out << YAML::BeginMap;
+        for (const auto &[url, info] : manifest)
+        {
+            out << YAML::Key << url << YAML::Value << YAML::BeginMap;
+            out << YAML::Key << "file" << YAML::Value << info.file;
+            out << YAML::Key << "source" << YAML::Value << info.source;
+            out << YAML::Key << "etag" << YAML::Value << info.etag;
+            out << YAML::Key << "lastModified" << YAML::Value << info.lastModified;
+            out << YAML::Key << "updated" << YAML::Value << info.updated;
+            out << YAML::Key << "packages" << YAML::Value << info.packages;
+            out << YAML::Key << "depend" << YAML::Value << YAML::BeginSeq;
+            for (const auto &dep : info.depend)
+            {
+                out << dep;
+            }
+            out << YAML::EndSeq;
+            out << YAML::EndMap;
+        }
+        out << YAML::EndMap;
+        return std::string(out.c_str()) + "\n";
+    }
+
+    std::vector<std::string> shardMergeOrder(const std::vector<std::string> &repositoryUrls, const ShardManifest &manifest)
+    {
+        std::vector<std::string> expanded;
+        std::set<std::string> inProgress;
+        for (const auto &url : repositoryUrls)
+        {
+            appendMergeOrder(url, manifest, inProgress, expanded);
+        }
+        // A later occurrence overrides everything before it, so only the last one matters
+        std::vector<std::string> order;
+        std::set<std::string> seen;
+        for (auto it = expanded.rbegin(); it != expanded.rend(); ++it)
+        {
+            if (seen.insert(*it).second)
+            {
+                order.push_back(*it);
+            }
+        }
+        std::reverse(order.begin(), order.end());
+        return order;
+    }
+
+    std::vector<ShardPolicy> shardPolicies(const std::vector<std::string> &order,
+                                           const std::vector<RepositoryInfo> &repositories, const ShardManifest &manifest)
+    {
+        std::map<std::string, ShardPolicy> byUrl;
+        std::set<std::string> configured;
+        for (const auto &repo : repositories)
+        {
+            configured.insert(repo.url);
+            ShardPolicy &policy = byUrl[repo.url];
+            policy.priority = repo.priority;
+            for (const auto &[name, spec] : repo.pins)
+            {
+                VersionRange range;
+                std::string parseError;
+                if (parseVersionRange(spec, range, parseError) != 0)
+                {
+                    warn("Ignoring pin of " + name + " on " + repo.url + ": " + parseError);
+                    continue;
+                }
+                policy.pins[name] = range;
+            }
+        }
+        // Dependencies inherit the priority of the configured repositories reaching them
+        std::map<std::string, int> inherited;
+        for (const auto &repo : repositories)
+        {
+            std::vector<std::string> pending{repo.url};
+            std::set<std::string> visited{repo.url};
+            while (!pending.empty())
+            {
+                auto it = manifest.find(pending.back());
+                pending.pop_back();
+                if (it == manifest.end())
+                {
+                    continue;
+                }
+                for (const auto &dep : it->second.depend)
+                {
+                    if (configured.count(dep) == 0 && visited.insert(dep).second)
+                    {
+                        auto known = inherited.find(dep);
+                        if (known == inherited.end() || known->second < repo.priority)
+                        {
+                            inherited[dep] = repo.priority;
+                        }
+                        pending.push_back(dep);
+                    }
+                }
+            }
+        }
+
+        std::vector<ShardPolicy> policies(order.size());
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            auto own = byUrl.find(order[i]);
+            if (own != byUrl.end())
+            {
+                policies[i] = own->second;
+            }
+            else if (auto dep = inherited.find(order[i]); dep != inherited.end())
+            {
+                policies[i].priority = dep->second;
+            }
+        }
+        return policies;
+    }
+
+    MergeSource packageSource(std::vector<PackageInfo> packages, ShardPolicy policy)
+    {
+        if (!std::is_sorted(packages.begin(), packages.end(), byName))
+        {
+            std::stable_sort(packages.begin(), packages.end(), byName);
+        }
+        auto list = std::make_shared<std::vector<PackageInfo>>(std::move(packages));
+        auto pos = std::make_shared<size_t>(0);
+        MergeSource source;
+        source.policy = std::move(policy);
+        source.next = [list, pos](PackageInfo &pkg)
+        {
+            if (*pos >= list->size())
+            {
+                return false;
+            }
+            pkg = std::move((*list)[(*pos)++]);
+            return true;
+        };
+        return source;
+    }
+
+    std::vector<PackageInfo> mergeShards(std::vector<MergeSource> sources)
+    {
+        std::map<std::string, std::vector<size_t>> pinners;
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            for (const auto &pin : sources[i].policy.pins)
+            {
+                pinners[pin.first].push_back(i);
+            }
+        }
+
+        // The next package of every source; min-heap on (name, source) so equal names come out in source order
+        std::vector<PackageInfo> heads(sources.size());
+        auto after = [&heads](size_t a, size_t b)
+        {
+            if (heads[a].name != heads[b].name)
+                return heads[a].name > heads[b].name;
+            return a > b;
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(after)> heap(after);
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            if (sources[i].next(heads[i]))
+            {
+                heap.push(i);
+            }
+        }
+
+        std::vector<PackageInfo> merged;
+        std::vector<RunEntry> run;
+        while (!heap.empty())
+        {
+            size_t source = heap.top();
+            heap.pop();
+            if (!run.empty() && run.front().pkg.name != heads[source].name)
+            {
+                finishRun(run, sources, pinners, merged);
+            }
+            if (heads[source].repository.empty())
+            {
+                heads[source].repository = sources[source].url;
+            }
+            run.push_back({source, std::move(heads[source])});
+            heads[source] = PackageInfo();
+            if (sources[source].next(heads[source]))
+            {
+                if (heads[source].name < run.back().pkg.name)
+                {
+                    warn("Package index for " + sources[source].url + " is not sorted by name. Run 'openspm update' to refetch it.");
+                    continue;
+                }
+                heap.push(source);
+            }
+        }
+        finishRun(run, sources, pinners, merged);
+        return merged;
+    }
+
+    std::vector<PackageInfo> mergeShards(std::vector<std::vector<PackageInfo>> shards)
+    {
+        std::vector<MergeSource> sources;
+        sources.reserve(shards.size());
+        for (auto &shard : shards)
+        {
+            sources.push_back(packageSource(std::move(shard)));
+        }
+        return mergeShards(std::move(sources));
+    }
+
+    std::vector<PackageInfo> mergeRepositoryPackages(std::vector<PackageInfo> packages,
+                                                     const std::vector<RepositoryInfo> &repositories, ShardManifest manifest)
+    {
+        // Repositories without a shard (sparse ones) still take part, in configuration order
+        for (const auto &repo : repositories)
+        {
+            manifest.emplace(repo.url, ShardInfo());
+        }
+        std::vector<std::string> order = shardMergeOrder(repositoryUrls(repositories), manifest);
+        std::vector<ShardPolicy> policies = shardPolicies(order, repositories, manifest);
+
+        std::map<std::string, std::vector<PackageInfo>> byRepository;
+        for (auto &pkg : packages)
+        {
+            byRepository[pkg.repository].push_back(std::move(pkg));
+        }
+
+        std::vector<MergeSource> sources;
+        sources.reserve(order.size() + 1);
+        std::set<std::string> ordered(order.begin(), order.end());
+        std::vector<PackageInfo> unknown;
+        for (auto &[url, list] : byRepository)
+        {
+            if (ordered.count(url) == 0)
+            {
+                std::move(list.begin(), list.end(), std::back_inserter(unknown));
+            }
+        }
+        if (!unknown.empty())
+        {
+            sources.push_back(packageSource(std::move(unknown)));
+        }
+        for (size_t s = 0; s < order.size(); ++s)
+        {
+            auto it = byRepository.find(order[s]);
+            if (it == byRepository.end())
+            {
+                continue;
+            }
+            MergeSource source = packageSource(std::move(it->second), policies[s]);
+            source.url = order[s];
+            sources.push_back(std::move(source));
+        }
+        return mergeShards(std::move(sources));
+    }
+
+    int loadMergedPackages(std::vector<PackageInfo> &outPackages, ClosureIndex *outClosures)
+    {
+        trace::Span span("loadMergedPackages", "catalog");
+        Archive *dataArchive = getDataArchive();
+        std::map<std::string, std::string> files;
+        dataArchive->readFiles({ClosureIndexFile, ShardManifestFile, "repositories.yaml", "packages.yaml"}, files);
+
+        if (files.find(ShardManifestFile) == files.end())
+        {
+            // Index written before shards existed
+            auto legacy = files.find("packages.yaml");
+            if (legacy == files.end())
+            {
+                error("Failed to read installed packages list.");
+                return 1;
+            }
+            OPENSPM_DEBUG("[DEBUG loadMergedPackages] No shard manifest, reading packages.yaml");
+            std::vector<PackageInfo> packages;
+            if (parsePackageIndex(legacy->second, packages) != 0)
+            {
+                return 1;
+            }
+            outPackages = mergeShards({std::move(packages)});
+            return 0;
+        }
+
+        ShardManifest manifest;
+        if (parseShardManifest(files[ShardManifestFile], manifest) != 0)
+        {
+            return 1;
+        }
+        std::vector<RepositoryInfo> repos = repositoryList(files);
+        std::vector<std::string> order = shardMergeOrder(repositoryUrls(repos), manifest);
+        std::vector<ShardPolicy> policies = shardPolicies(order, repos, manifest);
+        std::vector<std::string> shardFiles;
+        for (const auto &url : order)
+        {
+            shardFiles.push_back(manifest[url].file);
+        }
+        std::map<std::string, std::string> shardContents;
+        dataArchive->readFiles(shardFiles, shardContents);
+
+        std::vector<MergeSource> shards;
+        shards.reserve(order.size());
+        for (size_t s = 0; s < order.size(); ++s)
+        {
+            MergeSource source;
+            if (storedSource(shardContents, manifest[order[s]], policies[s], source))
+            {
+                shards.push_back(std::move(source));
+            }
+        }
+        outPackages = mergeShards(std::move(shards));
+        if (outClosures != nullptr)
+        {
+            loadClosures(files, *outClosures);
+        }
+        span.setItems(outPackages.size());
+        OPENSPM_DEBUG("[DEBUG loadMergedPackages] Merged " + std::to_string(order.size()) + " shards into " +
+                      std::to_string(outPackages.size()) + " packages");
+        return 0;
+    }
+
+    int loadPackageClosure(const std::string &packageName, std::vector<PackageInfo> &outPackages,
+                           ClosureIndex *outClosures)
+    {
+        trace::Span span("loadPackageClosure", "catalog");
+        span.setDetail(packageName);
+        Archive *dataArchive = getDataArchive();
+        std::map<std::string, std::string> files;
+        dataArchive->readFiles({ClosureIndexFile, ShardManifestFile, ShardFilterFile, "repositories.yaml"}, files);
+        ShardManifest manifest;
+        BloomFilterSet filters;
+        if (files.find(ShardManifestFile) == files.end() || files.find(ShardFilterFile) == files.end() ||
+            parseShardManifest(files[ShardManifestFile], manifest) != 0 ||
+            parseBloomFilters(files[ShardFilterFile], filters) != 0)
+        {
+            OPENSPM_DEBUG("[DEBUG loadPackageClosure] No shard filters, loading the full index");
+            return loadMergedPackages(outPackages, outClosures);
+        }
+        ClosureIndex localClosures;
+        ClosureIndex &closures = outClosures != nullptr ? *outClosures : localClosures;
+        loadClosures(files, closures);
+
+        std::vector<RepositoryInfo> repos = repositoryList(files);
+        std::vector<std::string> order = shardMergeOrder(repositoryUrls(repos), manifest);
+        auto mayContain = [&](size_t shard, const std::string &name)
+        {
+            auto it = filters.find(order[shard]);
+            return it == filters.end() || it->second.mayContain(name);
+        };
+        bool anyShard = false;
+        for (size_t s = 0; s < order.size() && !anyShard; ++s)
+        {
+            anyShard = mayContain(s, packageName);
+        }
+        if (!anyShard)
+        {
+            OPENSPM_DEBUG("[DEBUG loadPackageClosure] No shard can contain " + packageName);
+            outPackages.clear();
+            return 0;
+        }
+
+        std::vector<std::string> pending{packageName};
+        std::set<std::string> seen{packageName};
+        std::vector<std::string_view> plan;
+        switch (closures.lookup(packageName, plan))
+        {
+        case ClosureIndex::Result::Found:
+            // The whole closure is known, so no name below adds a new one
+            for (std::string_view name : plan)
+            {
+                if (seen.emplace(name).second)
+                {
+                    pending.emplace_back(name);
+                }
+            }
+            break;
+        case ClosureIndex::Result::Unknown:
+            if (closures.loaded())
+            {
+                OPENSPM_DEBUG("[DEBUG loadPackageClosure] Not in the closure index: " + packageName);
+                outPackages.clear();
+                return 0;
+            }
+            break;
+        case ClosureIndex::Result::Incomplete:
+            break;
+        }
+
+        // Shards sit at the end of the archive, so reading them all costs one pass either way
+        std::vector<std::string> shardFiles;
+        for (const auto &url : order)
+        {
+            shardFiles.push_back(manifest[url].file);
+        }
+        std::map<std::string, std::string> shardContents;
+        dataArchive->readFiles(shardFiles, shardContents);
+
+        std::vector<std::vector<PackageInfo>> shards(order.size());
+        std::vector<bool> parsed(order.size(), false);
+        while (!pending.empty())
+        {
+            std::string name = std::move(pending.back());
+            pending.pop_back();
+            // Any version may end up selected, so the dependencies of all of them are followed
+            for (size_t s = 0; s < order.size(); ++s)
+            {
+                if (!mayContain(s, name))
+                {
+                    continue;
+                }
+                if (!parsed[s])
+                {
+                    parsed[s] = true;
+                    parseShard(shardContents, manifest[order[s]], shards[s]);
+                    if (!std::is_sorted(shards[s].begin(), shards[s].end(), byName))
+                    {
+                        std::stable_sort(shards[s].begin(), shards[s].end(), byName);
+                    }
+                }
+                PackageInfo probe;
+                probe.name = name;
+                auto range = std::equal_range(shards[s].begin(), shards[s].end(), probe, byName);
+                for (auto it = range.first; it != range.second; ++it)
+                {
+                    for (const auto &dep : it->dependencies)
+                    {
+                        std::string depName(dependencyName(dep));
+                        if (seen.insert(depName).second)
+                        {
+                            pending.push_back(std::move(depName));
+                        }
+                    }
+                }
+            }
+        }
+
+        std::vector<ShardPolicy> policies = shardPolicies(order, repos, manifest);
+        std::vector<MergeSource> loaded;
+        for (size_t s = 0; s < order.size(); ++s)
+        {
+            if (parsed[s])
+            {
+                loaded.push_back(packageSource(std::move(shards[s]), policies[s]));
+                loaded.back().url = order[s];
+            }
+        }
+        OPENSPM_DEBUG("[DEBUG loadPackageClosure] Parsed " + std::to_string(loaded.size()) + " of " +
+                      std::to_string(order.size()) + " shards for " + packageName);
+        outPackages = mergeShards(std::move(loaded));
+        span.setItems(outPackages.size());
+        return 0;
+    }
+
+    bool hasPackageIndex()
+    {
+        std::vector<std::string> files;
+        if (getDataArchive()->listFiles(files) != 0)
+        {
+            return false;
+        }
+        return std::find(files.begin(), files.end(), ShardManifestFile) != files.end() ||
+               std::find(files.begin(), files.end(), "packages.yaml") != files.end();
+    }
+} // namespace openspm
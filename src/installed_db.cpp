@@ -0,0 +1,746 @@
+/**
+ * @file installed_db.cpp
+ * @brief Implementation of the installed-package database
+ */
+#include <installed_db.hpp>
+#include <config.hpp>
+#include <logger.hpp>
+#include <utils.hpp>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace openspm
+{
+    using namespace logger;
+
+    namespace
+    {
+        constexpr char IndexMagic[8] = {'O', 'S', 'P', 'M', 'I', 'N', 'S', '1'};
+        constexpr char ManifestMagic[8] = {'O', 'S', 'P', 'M', 'M', 'A', 'N', '1'};
+        constexpr char PathsMagic[8] = {'O', 'S', 'P', 'M', 'P', 'T', 'H', '1'};
+        constexpr const char *IndexFile = "packages.idx";
+        constexpr const char *PathsFile = "paths.idx";
+        constexpr size_t PathEntrySize = 12;
+        constexpr std::uint32_t DirectoryOwner = 0x80000000u;
+        constexpr const char *ManifestDir = "manifests";
+        constexpr size_t HashChunkSize = 256 * 1024;
+
+        void putString(std::string &out, std::string_view text)
+        {
+            putU32(out, static_cast<std::uint32_t>(text.size()));
+            out.append(text.data(), text.size());
+        }
+
+        /// Bounds-checked reader over a record or manifest
+        struct Reader
+        {
+            const char *data;
+            size_t size;
+            size_t pos = 0;
+
+            bool u8(std::uint8_t &out)
+            {
+                if (size - pos < 1)
+                    return false;
+                out = static_cast<std::uint8_t>(data[pos++]);
+                return true;
+            }
+            bool u32(std::uint32_t &out)
+            {
+                if (size - pos < 4)
+                    return false;
+                out = getU32(data + pos);
+                pos += 4;
+                return true;
+            }
+            bool u64(std::uint64_t &out)
+            {
+                if (size - pos < 8)
+                    return false;
+                out = getU64(data + pos);
+                pos += 8;
+                return true;
+            }
+            bool string(std::string_view &out)
+            {
+                std::uint32_t length;
+                if (!u32(length) || size - pos < length)
+                    return false;
+                out = std::string_view(data + pos, length);
+                pos += length;
+                return true;
+            }
+        };
+
+        constexpr std::uint8_t AutomaticFlag = 1;
+
+        bool readNames(Reader &reader, std::vector<std::string> &out)
+        {
+            std::uint32_t names;
+            if (!reader.u32(names))
+                return false;
+            out.clear();
+            for (std::uint32_t i = 0; i < names; ++i)
+            {
+                std::string_view name;
+                if (!reader.string(name))
+                    return false;
+                out.emplace_back(name);
+            }
+            return true;
+        }
+
+        void putNames(std::string &out, const std::vector<std::string> &names)
+        {
+            putU32(out, static_cast<std::uint32_t>(names.size()));
+            for (const auto &name : names)
+            {
+                putString(out, name);
+            }
+        }
+
+        bool readRecord(std::string_view bytes, InstalledPackage &out)
+        {
+            Reader reader{bytes.data(), bytes.size()};
+            std::string_view name, version, repository;
+            std::uint64_t installedAt;
+            if (!reader.string(name) || !reader.string(version) || !reader.string(repository) ||
+                !reader.u64(installedAt) || !reader.u32(out.fileCount) || !reader.u64(out.totalBytes))
+            {
+                return false;
+            }
+            out.name.assign(name);
+            out.version.assign(version);
+            out.repository.assign(repository);
+            out.installedAt = static_cast<long long>(installedAt);
+            out.automatic = false;
+            out.dependencies.clear();
+            out.requiredBy.clear();
+            if (reader.pos == reader.size)
+            {
+                // Written before dependencies were recorded
+                return true;
+            }
+            std::uint8_t flags;
+            if (!reader.u8(flags) || !readNames(reader, out.dependencies) || !readNames(reader, out.requiredBy))
+            {
+                return false;
+            }
+            out.automatic = (flags & AutomaticFlag) != 0;
+            return true;
+        }
+
+        /// Name field of a record, without decoding the rest
+        std::string_view recordName(std::string_view bytes)
+        {
+            Reader reader{bytes.data(), bytes.size()};
+            std::string_view name;
+            return reader.string(name) ? name : std::string_view();
+        }
+
+        std::uint64_t pathHash(std::string_view path)
+        {
+            return fnv1a64(path.data(), path.size());
+        }
+
+        /// Position of a name in a list sorted by name, or count if absent
+        std::uint32_t positionOf(const std::vector<InstalledPackage> &packages, std::string_view name)
+        {
+            auto it = std::lower_bound(packages.begin(), packages.end(), name, [](const InstalledPackage &pkg, std::string_view key)
+                                       { return pkg.name < key; });
+            if (it == packages.end() || it->name != name)
+            {
+                return static_cast<std::uint32_t>(packages.size());
+            }
+            return static_cast<std::uint32_t>(it - packages.begin());
+        }
+
+        const InstalledFile *findPath(const std::vector<InstalledFile> &files, const std::string &path)
+        {
+            auto it = std::lower_bound(files.begin(), files.end(), path, [](const InstalledFile &file, const std::string &key)
+                                       { return file.path < key; });
+            return it != files.end() && it->path == path ? &*it : nullptr;
+        }
+
+        bool writeAtomically(const std::filesystem::path &path, const std::string &data)
+        {
+            std::filesystem::path tempPath = path;
+            tempPath += ".tmp";
+            {
+                std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+                if (!file || !file.write(data.data(), static_cast<std::streamsize>(data.size())))
+                {
+                    error("Failed to write " + tempPath.string());
+                    return false;
+                }
+            }
+            std::error_code ec;
+            std::filesystem::rename(tempPath, path, ec);
+            if (ec)
+            {
+                error("Failed to replace " + path.string() + ": " + ec.message());
+                std::filesystem::remove(tempPath, ec);
+                return false;
+            }
+            return true;
+        }
+    } // namespace
+
+    std::string installedDatabasePath()
+    {
+        return (std::filesystem::path(getConfig()->dataDir) / InstalledDir).string();
+    }
+
+    int hashFile(const std::string &path, std::uint64_t &outSize, std::uint64_t &outHash)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            return 1;
+        }
+        std::vector<char> buffer(HashChunkSize);
+        outSize = 0;
+        outHash = Fnv1aOffsetBasis;
+        while (file)
+        {
+            file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            std::streamsize got = file.gcount();
+            if (got <= 0)
+            {
+                break;
+            }
+            outHash = fnv1a64(buffer.data(), static_cast<size_t>(got), outHash);
+            outSize += static_cast<std::uint64_t>(got);
+        }
+        return file.bad() ? 1 : 0;
+    }
+
+    int InstalledDatabase::open(const std::string &dir)
+    {
+        directory = dir;
+        index.clear();
+        staged.clear();
+        stagedFiles.clear();
+        count = 0;
+        offsets = pool = nullptr;
+        poolSize = 0;
+        indexStamp = 0;
+        pathsLoaded = false;
+        paths.clear();
+        manifestCache.clear();
+
+        std::ifstream file(std::filesystem::path(dir) / IndexFile, std::ios::binary);
+        if (!file)
+        {
+            OPENSPM_DEBUG("[DEBUG InstalledDatabase::open] No index in " + dir);
+            return 0;
+        }
+        index.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        size_t headerSize = sizeof(IndexMagic) + 4;
+        if (index.size() < headerSize || std::memcmp(index.data(), IndexMagic, sizeof(IndexMagic)) != 0)
+        {
+            index.clear();
+            return 1;
+        }
+        std::uint32_t records = getU32(index.data() + sizeof(IndexMagic));
+        size_t offsetBytes = (static_cast<size_t>(records) + 1) * 4;
+        if (index.size() - headerSize < offsetBytes)
+        {
+            index.clear();
+            return 1;
+        }
+        // The last offset closes the last record, so it must end exactly at the file's end
+        if (getU32(index.data() + headerSize + static_cast<size_t>(records) * 4) != index.size() - headerSize - offsetBytes)
+        {
+            index.clear();
+            return 1;
+        }
+        count = records;
+        offsets = index.data() + headerSize;
+        pool = offsets + offsetBytes;
+        poolSize = index.size() - headerSize - offsetBytes;
+        indexStamp = fnv1a64(index.data(), index.size());
+        OPENSPM_DEBUG("[DEBUG InstalledDatabase::open] " + std::to_string(count) + " installed packages");
+        return 0;
+    }
+
+    std::string_view InstalledDatabase::recordAt(std::uint32_t i) const
+    {
+        std::uint32_t begin = getU32(offsets + static_cast<size_t>(i) * 4);
+        std::uint32_t end = getU32(offsets + (static_cast<size_t>(i) + 1) * 4);
+        if (begin > end || end > poolSize)
+        {
+            return {};
+        }
+        return std::string_view(pool + begin, end - begin);
+    }
+
+    bool InstalledDatabase::findStored(std::string_view name, InstalledPackage &outPackage) const
+    {
+        std::uint32_t lo = 0;
+        std::uint32_t hi = count;
+        while (lo < hi)
+        {
+            std::uint32_t mid = lo + (hi - lo) / 2;
+            if (recordName(recordAt(mid)) < name)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo == count)
+        {
+            return false;
+        }
+        std::string_view bytes = recordAt(lo);
+        return recordName(bytes) == name && readRecord(bytes, outPackage);
+    }
+
+    bool InstalledDatabase::find(std::string_view name, InstalledPackage &outPackage) const
+    {
+        auto it = staged.find(name);
+        if (it != staged.end())
+        {
+            if (!it->second)
+            {
+                return false;
+            }
+            outPackage = *it->second;
+            return true;
+        }
+        return findStored(name, outPackage);
+    }
+
+    bool InstalledDatabase::isInstalled(std::string_view name) const
+    {
+        InstalledPackage ignored;
+        return find(name, ignored);
+    }
+
+    std::vector<InstalledPackage> InstalledDatabase::list() const
+    {
+        std::vector<InstalledPackage> packages;
+        packages.reserve(count + staged.size());
+        auto change = staged.begin();
+        auto flushBefore = [&](std::string_view name)
+        {
+            for (; change != staged.end() && change->first < name; ++change)
+            {
+                if (change->second)
+                    packages.push_back(*change->second);
+            }
+        };
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            InstalledPackage pkg;
+            if (!readRecord(recordAt(i), pkg))
+            {
+                continue;
+            }
+            flushBefore(pkg.name);
+            if (change != staged.end() && change->first == pkg.name)
+            {
+                // Replaced or removed in this transaction
+                if (change->second)
+                    packages.push_back(*change->second);
+                ++change;
+                continue;
+            }
+            packages.push_back(std::move(pkg));
+        }
+        for (; change != staged.end(); ++change)
+        {
+            if (change->second)
+                packages.push_back(*change->second);
+        }
+        return packages;
+    }
+
+    std::string InstalledDatabase::manifestPath(const std::string &name) const
+    {
+        // Hashing keeps any package name a valid file name
+        return (std::filesystem::path(directory) / ManifestDir / (hex64(fnv1a64(name.data(), name.size())) + ".files")).string();
+    }
+
+    int InstalledDatabase::readManifest(const std::string &name, std::vector<InstalledFile> &outFiles) const
+    {
+        if (!isInstalled(name))
+        {
+            return 1;
+        }
+        std::ifstream file(manifestPath(name), std::ios::binary);
+        if (!file)
+        {
+            return 1;
+        }
+        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (content.size() < sizeof(ManifestMagic) || std::memcmp(content.data(), ManifestMagic, sizeof(ManifestMagic)) != 0)
+        {
+            return 1;
+        }
+        Reader reader{content.data(), content.size(), sizeof(ManifestMagic)};
+        std::string_view storedName;
+        std::uint32_t entries;
+        if (!reader.string(storedName) || storedName != name || !reader.u32(entries))
+        {
+            return 1;
+        }
+        outFiles.clear();
+        outFiles.reserve(std::min<size_t>(entries, content.size() / 25));
+        for (std::uint32_t i = 0; i < entries; ++i)
+        {
+            InstalledFile entry;
+            std::uint8_t type;
+            std::string_view path;
+            if (!reader.u8(type) || !reader.u32(entry.mode) || !reader.u64(entry.size) || !reader.u64(entry.hash) ||
+                !reader.string(path))
+            {
+                outFiles.clear();
+                return 1;
+            }
+            entry.directory = type == 'd';
+            entry.path.assign(path);
+            outFiles.push_back(std::move(entry));
+        }
+        return 0;
+    }
+
+    int InstalledDatabase::record(InstalledPackage package, std::vector<InstalledFile> files)
+    {
+        std::sort(files.begin(), files.end(), [](const InstalledFile &a, const InstalledFile &b)
+                  { return a.path < b.path; });
+        package.fileCount = 0;
+        package.totalBytes = 0;
+        std::string out(ManifestMagic, sizeof(ManifestMagic));
+        putString(out, package.name);
+        putU32(out, static_cast<std::uint32_t>(files.size()));
+        for (const auto &entry : files)
+        {
+            out.push_back(entry.directory ? 'd' : 'f');
+            putU32(out, entry.mode);
+            putU64(out, entry.size);
+            putU64(out, entry.hash);
+            putString(out, entry.path);
+            if (!entry.directory)
+            {
+                package.fileCount++;
+                package.totalBytes += entry.size;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(directory) / ManifestDir, ec);
+        if (ec || !writeAtomically(manifestPath(package.name), out))
+        {
+            error("Failed to record installed files of " + package.name);
+            return 1;
+        }
+        std::string name = package.name;
+        staged[name] = std::move(package);
+        stagedFiles[name] = std::move(files);
+        return 0;
+    }
+
+    void InstalledDatabase::forget(const std::string &name)
+    {
+        staged[name] = std::nullopt;
+        stagedFiles.erase(name);
+    }
+
+    std::vector<std::string> InstalledDatabase::dependents(std::string_view name) const
+    {
+        std::vector<std::string> result;
+        InstalledPackage stored;
+        if (findStored(name, stored))
+        {
+            for (auto &dependent : stored.requiredBy)
+            {
+                if (staged.count(dependent) == 0)
+                    result.push_back(std::move(dependent));
+            }
+        }
+        for (const auto &[other, change] : staged)
+        {
+            if (change && std::find(change->dependencies.begin(), change->dependencies.end(), name) != change->dependencies.end())
+            {
+                result.push_back(other);
+            }
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
+    std::vector<std::string> InstalledDatabase::orphans() const
+    {
+        // Everything reachable from an explicitly installed package stays
+        std::vector<InstalledPackage> packages = list();
+        std::vector<char> needed(packages.size(), 0);
+        std::vector<std::uint32_t> pending;
+        for (std::uint32_t i = 0; i < packages.size(); ++i)
+        {
+            if (!packages[i].automatic)
+            {
+                needed[i] = 1;
+                pending.push_back(i);
+            }
+        }
+        while (!pending.empty())
+        {
+            std::uint32_t current = pending.back();
+            pending.pop_back();
+            for (const auto &dep : packages[current].dependencies)
+            {
+                std::uint32_t position = positionOf(packages, dep);
+                if (position < packages.size() && !needed[position])
+                {
+                    needed[position] = 1;
+                    pending.push_back(position);
+                }
+            }
+        }
+        std::vector<std::string> result;
+        for (std::uint32_t i = 0; i < packages.size(); ++i)
+        {
+            if (!needed[i])
+                result.push_back(packages[i].name);
+        }
+        return result;
+    }
+
+    bool InstalledDatabase::installsAutomatically(std::string_view name, const std::vector<std::string> &requestedNames) const
+    {
+        if (requestedNames.empty() || std::find(requestedNames.begin(), requestedNames.end(), name) != requestedNames.end())
+        {
+            return false;
+        }
+        InstalledPackage previous;
+        return !find(name, previous) || previous.automatic;
+    }
+
+    void InstalledDatabase::loadPaths() const
+    {
+        if (pathsLoaded)
+        {
+            return;
+        }
+        pathsLoaded = true;
+        paths.clear();
+        if (count == 0)
+        {
+            return;
+        }
+        std::ifstream file(std::filesystem::path(directory) / PathsFile, std::ios::binary);
+        std::string content;
+        if (file)
+        {
+            content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        size_t headerSize = sizeof(PathsMagic) + 8 + 4;
+        if (content.size() >= headerSize && std::memcmp(content.data(), PathsMagic, sizeof(PathsMagic)) == 0 &&
+            getU64(content.data() + sizeof(PathsMagic)) == indexStamp)
+        {
+            std::uint32_t entries = getU32(content.data() + sizeof(PathsMagic) + 8);
+            if ((content.size() - headerSize) / PathEntrySize == entries && (content.size() - headerSize) % PathEntrySize == 0)
+            {
+                paths.resize(entries);
+                const char *p = content.data() + headerSize;
+                for (auto &entry : paths)
+                {
+                    entry.hash = getU64(p);
+                    entry.owner = getU32(p + 8);
+                    p += PathEntrySize;
+                }
+                return;
+            }
+        }
+
+        // Missing, or left behind by an interrupted transaction
+        OPENSPM_DEBUG("[DEBUG InstalledDatabase::loadPaths] Rebuilding the path index from " + std::to_string(count) + " manifests");
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            std::string name(recordName(recordAt(i)));
+            std::vector<InstalledFile> files;
+            if (staged.count(name) != 0)
+            {
+                // Its stored manifest may already be replaced; save() adds the staged one
+                continue;
+            }
+            if (readManifest(name, files) != 0)
+            {
+                warn("The file list of " + name + " is missing; its files are not tracked.");
+                continue;
+            }
+            for (const auto &entry : files)
+            {
+                paths.push_back({pathHash(entry.path), i | (entry.directory ? DirectoryOwner : 0)});
+            }
+        }
+        std::sort(paths.begin(), paths.end(), [](const PathEntry &a, const PathEntry &b)
+                  { return a.hash < b.hash; });
+    }
+
+    bool InstalledDatabase::listsPath(const std::string &name, const std::string &path, bool &outDirectory) const
+    {
+        auto cached = manifestCache.find(name);
+        if (cached == manifestCache.end())
+        {
+            std::vector<InstalledFile> files;
+            if (readManifest(name, files) != 0)
+            {
+                return false;
+            }
+            cached = manifestCache.emplace(name, std::move(files)).first;
+        }
+        const InstalledFile *entry = findPath(cached->second, path);
+        if (entry)
+        {
+            outDirectory = entry->directory;
+        }
+        return entry != nullptr;
+    }
+
+    std::vector<PathOwner> InstalledDatabase::owners(const std::string &path, bool exact) const
+    {
+        std::vector<PathOwner> result;
+        loadPaths();
+        std::uint64_t hash = pathHash(path);
+        auto first = std::lower_bound(paths.begin(), paths.end(), hash, [](const PathEntry &entry, std::uint64_t key)
+                                      { return entry.hash < key; });
+        for (auto it = first; it != paths.end() && it->hash == hash; ++it)
+        {
+            std::uint32_t position = it->owner & ~DirectoryOwner;
+            if (position >= count)
+            {
+                continue;
+            }
+            std::string name(recordName(recordAt(position)));
+            if (staged.count(name) != 0)
+            {
+                continue;
+            }
+            PathOwner owner{name, (it->owner & DirectoryOwner) != 0};
+            if (!exact || listsPath(name, path, owner.directory))
+            {
+                result.push_back(std::move(owner));
+            }
+        }
+        for (const auto &[name, files] : stagedFiles)
+        {
+            if (const InstalledFile *entry = findPath(files, path))
+            {
+                result.push_back({name, entry->directory});
+            }
+        }
+        std::sort(result.begin(), result.end(), [](const PathOwner &a, const PathOwner &b)
+                  { return a.package < b.package; });
+        return result;
+    }
+
+    int InstalledDatabase::save()
+    {
+        if (staged.empty())
+        {
+            return 0;
+        }
+        loadPaths();
+        std::vector<InstalledPackage> packages = list();
+        // Reverse dependencies are rebuilt from the forward ones, so they never drift
+        for (auto &pkg : packages)
+        {
+            pkg.requiredBy.clear();
+        }
+        for (const auto &pkg : packages)
+        {
+            for (const auto &dep : pkg.dependencies)
+            {
+                std::uint32_t position = positionOf(packages, dep);
+                if (position < packages.size() && packages[position].name != pkg.name)
+                {
+                    // Dependents are visited in name order, so the lists come out sorted
+                    packages[position].requiredBy.push_back(pkg.name);
+                }
+            }
+        }
+        std::string records;
+        std::string out(IndexMagic, sizeof(IndexMagic));
+        putU32(out, static_cast<std::uint32_t>(packages.size()));
+        for (auto &pkg : packages)
+        {
+            pkg.requiredBy.erase(std::unique(pkg.requiredBy.begin(), pkg.requiredBy.end()), pkg.requiredBy.end());
+            putU32(out, static_cast<std::uint32_t>(records.size()));
+            putString(records, pkg.name);
+            putString(records, pkg.version);
+            putString(records, pkg.repository);
+            putU64(records, static_cast<std::uint64_t>(pkg.installedAt));
+            putU32(records, pkg.fileCount);
+            putU64(records, pkg.totalBytes);
+            records.push_back(static_cast<char>(pkg.automatic ? AutomaticFlag : 0));
+            putNames(records, pkg.dependencies);
+            putNames(records, pkg.requiredBy);
+        }
+        putU32(out, static_cast<std::uint32_t>(records.size()));
+        out += records;
+
+        // Untouched packages keep their entries under their new positions; staged installs are merged in
+        std::vector<std::uint32_t> renumbered(count);
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            std::string_view name = recordName(recordAt(i));
+            renumbered[i] = staged.count(name) != 0 ? static_cast<std::uint32_t>(packages.size()) : positionOf(packages, name);
+        }
+        std::vector<PathEntry> kept;
+        kept.reserve(paths.size());
+        for (const auto &entry : paths)
+        {
+            std::uint32_t position = entry.owner & ~DirectoryOwner;
+            if (position < count && renumbered[position] < packages.size())
+            {
+                kept.push_back({entry.hash, renumbered[position] | (entry.owner & DirectoryOwner)});
+            }
+        }
+        std::vector<PathEntry> added;
+        for (const auto &[name, files] : stagedFiles)
+        {
+            std::uint32_t position = positionOf(packages, name);
+            for (const auto &entry : files)
+            {
+                added.push_back({pathHash(entry.path), position | (entry.directory ? DirectoryOwner : 0)});
+            }
+        }
+        auto byHash = [](const PathEntry &a, const PathEntry &b)
+        { return a.hash < b.hash; };
+        std::sort(added.begin(), added.end(), byHash);
+        std::vector<PathEntry> merged(kept.size() + added.size());
+        std::merge(kept.begin(), kept.end(), added.begin(), added.end(), merged.begin(), byHash);
+        std::string pathsOut(PathsMagic, sizeof(PathsMagic));
+        putU64(pathsOut, fnv1a64(out.data(), out.size()));
+        putU32(pathsOut, static_cast<std::uint32_t>(merged.size()));
+        pathsOut.reserve(pathsOut.size() + merged.size() * PathEntrySize);
+        for (const auto &entry : merged)
+        {
+            putU64(pathsOut, entry.hash);
+            putU32(pathsOut, entry.owner);
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec || !writeAtomically(std::filesystem::path(directory) / PathsFile, pathsOut) ||
+            !writeAtomically(std::filesystem::path(directory) / IndexFile, out))
+        {
+            error("Failed to save the installed package database.");
+            return 1;
+        }
+        // Removed packages' manifests go only once the index no longer lists them
+        for (const auto &[name, change] : staged)
+        {
+            if (!change)
+            {
+                std::filesystem::remove(manifestPath(name), ec);
+            }
+        }
+        OPENSPM_DEBUG("[DEBUG InstalledDatabase::save] " + std::to_string(packages.size()) + " installed packages");
+        return open(directory);
+    }
+} // namespace openspm
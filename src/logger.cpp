@@ -4,38 +4,357 @@
  * 
  * Provides console and file logging with ANSI color support,
  * timestamp generation, and multiple log levels.
+ *
+ * Callers only format the message and push it onto a bounded lock-free
+ * queue; a background writer thread strips colors, stamps the time and
+ * writes whole batches to the console and log file with buffered I/O.
  */
 #include <logger.hpp>
 #include <config.hpp>
-#include <fstream>
-#include <iostream>
-#include <string>
-#include <regex>
+#include <metrics.hpp>
+#include <atomic>
 #include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
 #include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace openspm::logger
 {
-    static std::ofstream logFile;
-
-    /// Generate timestamp for log entries
-    static std::string getTimestamp()
+    namespace
     {
-        auto now = std::chrono::system_clock::now();
-        auto in_time_t = std::chrono::system_clock::to_time_t(now);
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %H:%M:%S");
-        return ss.str();
-    }
+        /// Message destinations
+        enum : std::uint8_t
+        {
+            ToConsole = 1,
+            ToFile = 2,
+            KeepColor = 4
+        };
 
-    /// Remove ANSI color codes from string
-    static std::string stripAnsi(std::string str)
-    {
-        static const std::regex ansi_regex("\x1b\\[[0-9;]*[a-zA-Z]");
-        return std::regex_replace(str, ansi_regex, "");
-    }
+        /// Number of queued messages before producers have to wait for the writer
+        constexpr size_t QueueCapacity = 4096;
+        /// Buffered output is written out once it grows past this size
+        constexpr size_t WriteChunk = 64 * 1024;
+
+        struct Message
+        {
+            std::string text;
+            std::time_t time = 0;
+            std::uint8_t flags = 0;
+        };
+
+        /**
+         * Bounded multi-producer single-consumer ring. Each slot carries a
+         * sequence number telling producers whether it is free and the
+         * consumer whether it has been published, so neither side locks.
+         */
+        class MessageQueue
+        {
+        public:
+            MessageQueue() : slots(QueueCapacity)
+            {
+                for (size_t i = 0; i < QueueCapacity; ++i)
+                {
+                    slots[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            bool tryPush(Message &message)
+            {
+                size_t pos = tail.load(std::memory_order_relaxed);
+                for (;;)
+                {
+                    Slot &slot = slots[pos % QueueCapacity];
+                    size_t seq = slot.sequence.load(std::memory_order_acquire);
+                    std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+                    if (diff == 0)
+                    {
+                        if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        {
+                            slot.message = std::move(message);
+                            slot.sequence.store(pos + 1, std::memory_order_release);
+                            return true;
+                        }
+                    }
+                    else if (diff < 0)
+                    {
+                        return false; // full
+                    }
+                    else
+                    {
+                        pos = tail.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            /// Only called from the writer thread
+            bool tryPop(Message &out)
+            {
+                Slot &slot = slots[head % QueueCapacity];
+                size_t seq = slot.sequence.load(std::memory_order_acquire);
+                if (seq != head + 1)
+                {
+                    return false; // empty, or the next producer hasn't published yet
+                }
+                out = std::move(slot.message);
+                slot.message.text.clear();
+                slot.sequence.store(head + QueueCapacity, std::memory_order_release);
+                ++head;
+                return true;
+            }
+
+            /// Number of positions claimed by producers so far
+            size_t claimed() const { return tail.load(std::memory_order_acquire); }
+
+        private:
+            struct Slot
+            {
+                std::atomic<size_t> sequence{0};
+                Message message;
+            };
+            std::vector<Slot> slots;
+            alignas(64) std::atomic<size_t> tail{0};
+            alignas(64) size_t head = 0;
+        };
+
+        MessageQueue queue;
+        std::FILE *logFile = nullptr;
+        std::mutex fileMutex; ///< Guards logFile against initFileLogging
+
+        std::thread writer;
+        std::once_flag writerStarted;
+        std::atomic<bool> writerRunning{false};
+        std::atomic<bool> writerIdle{false};
+        std::atomic<size_t> written{0};
+        bool stopping = false;
+        std::mutex wakeMutex;
+        std::condition_variable wakeWriter;
+        std::condition_variable wakeFlushers;
+        std::mutex directMutex; ///< Serialises output after the writer has stopped
+
+        /// Format a time point, reformatting at most once per second
+        const std::string &timestampFor(std::time_t t)
+        {
+            static std::time_t cachedSecond = -1;
+            static std::string cached;
+            if (t != cachedSecond)
+            {
+                std::tm tm{};
+#ifdef _WIN32
+                localtime_s(&tm, &t);
+#else
+                localtime_r(&t, &tm);
+#endif
+                char buf[32];
+                size_t n = std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+                cached.assign(buf, n);
+                cachedSecond = t;
+            }
+            return cached;
+        }
+
+        /// Append str to out without ANSI CSI sequences (ESC '[' params letter)
+        void appendStripped(std::string &out, const std::string &str)
+        {
+            size_t i = 0;
+            const size_t n = str.size();
+            while (i < n)
+            {
+                size_t esc = str.find('\x1b', i);
+                if (esc == std::string::npos)
+                {
+                    out.append(str, i, n - i);
+                    return;
+                }
+                out.append(str, i, esc - i);
+                size_t j = esc + 1;
+                if (j < n && str[j] == '[')
+                {
+                    ++j;
+                    while (j < n && ((str[j] >= '0' && str[j] <= '9') || str[j] == ';'))
+                    {
+                        ++j;
+                    }
+                    if (j < n && ((str[j] >= 'a' && str[j] <= 'z') || (str[j] >= 'A' && str[j] <= 'Z')))
+                    {
+                        i = j + 1;
+                        continue;
+                    }
+                }
+                // Not a color sequence; keep the escape byte as is
+                out.push_back('\x1b');
+                i = esc + 1;
+            }
+        }
+
+        void format(const Message &message, std::string &consoleOut, std::string &fileOut, bool haveFile)
+        {
+            if (message.flags & ToConsole)
+            {
+                if (message.flags & KeepColor)
+                {
+                    consoleOut += CLR_RESET;
+                    consoleOut += message.text;
+                    consoleOut += CLR_RESET;
+                }
+                else
+                {
+                    appendStripped(consoleOut, message.text);
+                }
+                consoleOut.push_back('\n');
+            }
+            if ((message.flags & ToFile) && haveFile)
+            {
+                fileOut += timestampFor(message.time);
+                fileOut += ": ";
+                appendStripped(fileOut, message.text);
+                fileOut.push_back('\n');
+            }
+        }
+
+        void writeOut(std::string &consoleOut, std::string &fileOut)
+        {
+            if (!consoleOut.empty())
+            {
+                std::fwrite(consoleOut.data(), 1, consoleOut.size(), stdout);
+                std::fflush(stdout);
+                consoleOut.clear();
+            }
+            if (!fileOut.empty())
+            {
+                if (logFile)
+                {
+                    std::fwrite(fileOut.data(), 1, fileOut.size(), logFile);
+                    std::fflush(logFile);
+                }
+                fileOut.clear();
+            }
+        }
+
+        void writerLoop()
+        {
+            std::string consoleOut;
+            std::string fileOut;
+            Message message;
+            for (;;)
+            {
+                size_t drained = 0;
+                {
+                    std::lock_guard<std::mutex> fileLock(fileMutex);
+                    while (queue.tryPop(message))
+                    {
+                        format(message, consoleOut, fileOut, logFile != nullptr);
+                        ++drained;
+                        if (consoleOut.size() + fileOut.size() >= WriteChunk)
+                        {
+                            writeOut(consoleOut, fileOut);
+                        }
+                    }
+                    writeOut(consoleOut, fileOut);
+                }
+                if (drained > 0)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(wakeMutex);
+                        written.fetch_add(drained, std::memory_order_release);
+                    }
+                    wakeFlushers.notify_all();
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                if (stopping && written.load(std::memory_order_acquire) == queue.claimed())
+                {
+                    return;
+                }
+                writerIdle.store(true, std::memory_order_seq_cst);
+                // Re-check after announcing idleness so a push racing with us isn't missed;
+                // the timeout also covers a producer that claimed a slot but hasn't published yet
+                if (written.load(std::memory_order_acquire) == queue.claimed())
+                {
+                    wakeWriter.wait_for(lock, std::chrono::milliseconds(50));
+                }
+                writerIdle.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        void stopWriter()
+        {
+            {
+                std::lock_guard<std::mutex> lock(wakeMutex);
+                stopping = true;
+            }
+            wakeWriter.notify_one();
+            if (writer.joinable())
+            {
+                writer.join();
+            }
+            writerRunning.store(false, std::memory_order_release);
+            std::lock_guard<std::mutex> fileLock(fileMutex);
+            if (logFile)
+            {
+                std::fclose(logFile);
+                logFile = nullptr;
+            }
+        }
+
+        void startWriter()
+        {
+            std::call_once(writerStarted, []
+                           {
+                writerRunning.store(true, std::memory_order_release);
+                writer = std::thread(writerLoop);
+                std::atexit(stopWriter); });
+        }
+
+        /// Emit message to console and/or log file
+        void enqueue(const std::string &txt, std::uint8_t flags)
+        {
+            Message message;
+            message.text = txt;
+            message.time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+            message.flags = flags;
+
+            startWriter();
+            if (!writerRunning.load(std::memory_order_acquire))
+            {
+                // Logging during shutdown, after the writer has gone away
+                std::lock_guard<std::mutex> lock(directMutex);
+                std::string consoleOut;
+                std::string fileOut;
+                format(message, consoleOut, fileOut, false);
+                std::fwrite(consoleOut.data(), 1, consoleOut.size(), stdout);
+                std::fflush(stdout);
+                return;
+            }
+            while (!queue.tryPush(message))
+            {
+                // Queue full: let the writer catch up
+                wakeWriter.notify_one();
+                std::this_thread::yield();
+            }
+            if (writerIdle.load(std::memory_order_seq_cst))
+            {
+                wakeWriter.notify_one();
+            }
+        }
+
+        void emit(const std::string &txt)
+        {
+            std::uint8_t flags = ToConsole | ToFile;
+            if (getConfig()->colorOutput)
+            {
+                flags |= KeepColor;
+            }
+            enqueue(txt, flags);
+        }
+    } // namespace
 
     void initFileLogging()
     {
@@ -45,31 +364,42 @@ namespace openspm::logger
             std::filesystem::create_directories(logPath.parent_path());
         }
 
-        logFile.open(logPath, std::ios::app);
-        if (logFile.is_open())
+        flush();
+        std::FILE *file = std::fopen(logPath.string().c_str(), "a");
+        if (file)
         {
-            logFile << "\n--- Session Started: " << getTimestamp() << " ---\n";
+            std::setvbuf(file, nullptr, _IOFBF, WriteChunk);
+            std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+            std::lock_guard<std::mutex> fileLock(fileMutex);
+            std::string header = "\n--- Session Started: " + timestampFor(now) + " ---\n";
+            if (logFile)
+            {
+                std::fclose(logFile);
+            }
+            logFile = file;
+            std::fwrite(header.data(), 1, header.size(), logFile);
         }
         else
         {
-            std::cerr << "Log File Failure: " << getConfig()->logsFile << std::endl;
+            error("Log File Failure: " + getConfig()->logsFile);
         }
     }
 
-    /// Emit message to console and log file
-    static void emit(const std::string &txt)
+    void flush()
     {
-        bool useColor = getConfig()->colorOutput;
-        std::string processedText = useColor ? txt : stripAnsi(txt);
-
-        // Output to Console
-        std::cout << CLR_RESET << processedText << CLR_RESET << std::endl;
-
-        // Output to File (always stripped of ANSI codes)
-        if (logFile.is_open())
+        if (!writerRunning.load(std::memory_order_acquire))
+        {
+            return;
+        }
+        size_t target = queue.claimed();
+        if (written.load(std::memory_order_acquire) >= target)
         {
-            logFile << getTimestamp() << ": " << stripAnsi(txt) << std::endl;
+            return;
         }
+        wakeWriter.notify_one();
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wakeFlushers.wait(lock, [target]
+                          { return written.load(std::memory_order_acquire) >= target; });
     }
 
     void log(const std::string &m) { emit(m); }
@@ -78,14 +408,29 @@ namespace openspm::logger
     
     void error(const std::string &m) { emit(CLR_RED "E: " + m + CLR_RESET); }
 
+    bool debugEnabled()
+    {
+#ifdef OPENSPM_STRIP_DEBUG_LOG
+        return false;
+#else
+        return getConfig()->debug;
+#endif
+    }
+
     void debug(const std::string &m)
     {
-        if (getConfig()->debug)
+        if (debugEnabled())
             emit(CL_GRAY "D: " + m + CLR_RESET);
     }
 
+    void record(const std::string &m)
+    {
+        enqueue(m, ToFile);
+    }
+
     void logHttpRequest(const std::string &method, const std::string &url, int status)
     {
+        metrics::observeHttpRequest(url, status);
         std::string clr = status >= 400 ? CLR_RED : CLR_GREEN;
         std::string msg = std::string(CLR_CYAN) + method + " " + 
                           CL_PURPLE + url + " " + 
@@ -133,4 +478,4 @@ namespace openspm::logger
     log(BLUE + "+" + horizontal + "+" + CLR_RESET);
 }
 
-}
\ No newline at end of file
+}
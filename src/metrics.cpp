@@ -0,0 +1,247 @@
+/**
+ * @file metrics.cpp
+ * @brief Implementation of Prometheus textfile metrics
+ *
+ * Samples are kept in memory, keyed by metric name and rendered label
+ * set, and written out in the Prometheus text exposition format.
+ */
+#include <metrics.hpp>
+#include <logger.hpp>
+#include <utils.hpp>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <mutex>
+
+namespace openspm::metrics
+{
+    using namespace logger;
+
+    std::atomic<bool> active{false};
+
+    namespace
+    {
+        struct Family
+        {
+            const char *type = "untyped";
+            std::map<std::string, double> samples; ///< Rendered label set -> value
+        };
+
+        struct Description
+        {
+            const char *name;
+            const char *type;
+            const char *help;
+        };
+
+        const Description descriptions[] = {
+            {"openspm_phase_duration_seconds_total", "counter", "Time spent in each phase of the run"},
+            {"openspm_phase_calls_total", "counter", "Number of times each phase ran"},
+            {"openspm_phase_bytes_total", "counter", "Bytes read, written or transferred by each phase"},
+            {"openspm_http_requests_total", "counter", "HTTP requests by host and status"},
+            {"openspm_cache_requests_total", "counter", "Cache lookups by cache and result (hit or miss)"},
+            {"openspm_packages_indexed", "gauge", "Packages in the index after the last update"},
+            {"openspm_packages_installed_total", "counter", "Packages installed by the run"},
+            {"openspm_scripts_total", "counter", "Post-install scripts and triggers by result"},
+            {"openspm_files_installed_total", "counter", "Files copied into the target directory"},
+            {"openspm_files_unchanged_total", "counter", "Files a reinstall left in place because they were up to date"},
+            {"openspm_file_conflicts_total", "counter", "Paths that stopped an install because two packages ship them"},
+            {"openspm_files_removed_total", "counter", "Files unlinked from the target directory"},
+            {"openspm_packages_removed_total", "counter", "Packages removed by the run"},
+            {"openspm_last_run_timestamp_seconds", "gauge", "Unix time the run finished"},
+            {"openspm_last_run_duration_seconds", "gauge", "Wall-clock duration of the run"},
+            {"openspm_last_run_success", "gauge", "1 if the run exited with status 0"},
+        };
+
+        std::mutex metricsMutex;
+        std::map<std::string, Family> families;
+        std::chrono::steady_clock::time_point runStart;
+
+        void appendEscaped(std::string &out, const std::string &value)
+        {
+            for (char c : value)
+            {
+                if (c == '\\')
+                    out += "\\\\";
+                else if (c == '"')
+                    out += "\\\"";
+                else if (c == '\n')
+                    out += "\\n";
+                else
+                    out.push_back(c);
+            }
+        }
+
+        std::string renderLabels(const Labels &labels)
+        {
+            if (labels.empty())
+            {
+                return "";
+            }
+            std::string out = "{";
+            for (size_t i = 0; i < labels.size(); ++i)
+            {
+                if (i > 0)
+                    out.push_back(',');
+                out += labels[i].first + "=\"";
+                appendEscaped(out, labels[i].second);
+                out.push_back('"');
+            }
+            out.push_back('}');
+            return out;
+        }
+
+        Family &family(const std::string &name)
+        {
+            auto it = families.find(name);
+            if (it != families.end())
+            {
+                return it->second;
+            }
+            Family &created = families[name];
+            for (const auto &desc : descriptions)
+            {
+                if (name == desc.name)
+                {
+                    created.type = desc.type;
+                    break;
+                }
+            }
+            return created;
+        }
+
+        const char *helpFor(const std::string &name)
+        {
+            for (const auto &desc : descriptions)
+            {
+                if (name == desc.name)
+                    return desc.help;
+            }
+            return nullptr;
+        }
+
+        std::string formatValue(double value)
+        {
+            char buf[64];
+            std::snprintf(buf, sizeof(buf), "%.15g", value);
+            return buf;
+        }
+    } // namespace
+
+    void enable()
+    {
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        if (active.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        runStart = std::chrono::steady_clock::now();
+        active.store(true, std::memory_order_release);
+    }
+
+    void add(const std::string &name, double value, const Labels &labels)
+    {
+        if (!enabled())
+        {
+            return;
+        }
+        std::string key = renderLabels(labels);
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        family(name).samples[key] += value;
+    }
+
+    void set(const std::string &name, double value, const Labels &labels)
+    {
+        if (!enabled())
+        {
+            return;
+        }
+        std::string key = renderLabels(labels);
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        family(name).samples[key] = value;
+    }
+
+    void observeHttpRequest(const std::string &url, int status)
+    {
+        if (!enabled())
+        {
+            return;
+        }
+        add("openspm_http_requests_total", 1, {{"host", parse_url(url).host}, {"status", std::to_string(status)}});
+    }
+
+    void observePhase(const char *phase, const char *category, double seconds, unsigned long long bytes)
+    {
+        if (!enabled())
+        {
+            return;
+        }
+        Labels labels = {{"category", category}, {"phase", phase}};
+        std::string key = renderLabels(labels);
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        family("openspm_phase_duration_seconds_total").samples[key] += seconds;
+        family("openspm_phase_calls_total").samples[key] += 1;
+        if (bytes > 0)
+        {
+            family("openspm_phase_bytes_total").samples[key] += static_cast<double>(bytes);
+        }
+    }
+
+    int writeTextfile(const std::string &path, const std::string &command, int exitStatus)
+    {
+        if (!enabled())
+        {
+            return 0;
+        }
+        auto now = std::chrono::system_clock::now();
+        double finishedAt = std::chrono::duration<double>(now.time_since_epoch()).count();
+        double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+        set("openspm_last_run_timestamp_seconds", finishedAt, {{"command", command}});
+        set("openspm_last_run_duration_seconds", duration, {{"command", command}});
+        set("openspm_last_run_success", exitStatus == 0 ? 1 : 0, {{"command", command}});
+
+        std::string text;
+        {
+            std::lock_guard<std::mutex> lock(metricsMutex);
+            for (const auto &[name, fam] : families)
+            {
+                if (const char *help = helpFor(name))
+                {
+                    text += "# HELP " + name + " " + help + "\n";
+                }
+                text += "# TYPE " + name + " " + fam.type + "\n";
+                for (const auto &[labels, value] : fam.samples)
+                {
+                    text += name + labels + " " + formatValue(value) + "\n";
+                }
+            }
+        }
+
+        // node_exporter reads the directory at any time; only ever expose complete files
+        std::filesystem::path target(path);
+        std::filesystem::path temp = target;
+        temp += ".tmp";
+        std::FILE *file = std::fopen(temp.string().c_str(), "w");
+        if (!file)
+        {
+            error("Failed to write metrics file: " + temp.string());
+            return 1;
+        }
+        bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+        ok = std::fclose(file) == 0 && ok;
+        std::error_code ec;
+        if (ok)
+        {
+            std::filesystem::rename(temp, target, ec);
+        }
+        if (!ok || ec)
+        {
+            error("Failed to write metrics file: " + path);
+            std::filesystem::remove(temp, ec);
+            return 1;
+        }
+        OPENSPM_DEBUG("[DEBUG metrics::writeTextfile] Wrote " + std::to_string(families.size()) + " metric families to " + path);
+        return 0;
+    }
+} // namespace openspm::metrics
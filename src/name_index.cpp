@@ -0,0 +1,216 @@
+/**
+ * @file name_index.cpp
+ * @brief Implementation of the completion name index
+ */
+#include <name_index.hpp>
+#include <config.hpp>
+#include <logger.hpp>
+#include <repository_manager.hpp>
+#include <utils.hpp>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace openspm
+{
+    using namespace logger;
+
+    namespace
+    {
+        constexpr char Magic[8] = {'O', 'S', 'P', 'M', 'N', 'A', 'M', '1'};
+        constexpr size_t HeaderSize = sizeof(Magic) + 8;
+
+        void sortUnique(std::vector<std::string> &names)
+        {
+            std::sort(names.begin(), names.end());
+            names.erase(std::unique(names.begin(), names.end()), names.end());
+        }
+    } // namespace
+
+    std::string nameIndexPath()
+    {
+        return (std::filesystem::path(getConfig()->dataDir) / NameIndexFile).string();
+    }
+
+    int writeNameIndex(std::vector<std::string> packageNames, std::vector<std::string> repositoryUrls)
+    {
+        sortUnique(packageNames);
+        sortUnique(repositoryUrls);
+
+        std::string out(Magic, sizeof(Magic));
+        putU32(out, static_cast<std::uint32_t>(packageNames.size()));
+        putU32(out, static_cast<std::uint32_t>(repositoryUrls.size()));
+        std::string pool;
+        for (const auto *section : {&packageNames, &repositoryUrls})
+        {
+            for (const auto &name : *section)
+            {
+                putU32(out, static_cast<std::uint32_t>(pool.size()));
+                pool += name;
+            }
+            putU32(out, static_cast<std::uint32_t>(pool.size()));
+        }
+        out += pool;
+
+        std::string path = nameIndexPath();
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file || !file.write(out.data(), static_cast<std::streamsize>(out.size())))
+            {
+                error("Failed to write completion index: " + tempPath);
+                return 1;
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(tempPath, path, ec);
+        if (ec)
+        {
+            error("Failed to replace completion index: " + ec.message());
+            std::filesystem::remove(tempPath, ec);
+            return 1;
+        }
+        OPENSPM_DEBUG("[DEBUG writeNameIndex] Wrote " + std::to_string(packageNames.size()) + " package names, " +
+                      std::to_string(repositoryUrls.size()) + " repositories, " + std::to_string(out.size()) + " bytes");
+        return 0;
+    }
+
+    int refreshNameIndexRepositories()
+    {
+        std::vector<std::string> packageNames;
+        NameIndex existing;
+        if (existing.open(nameIndexPath()) == 0)
+        {
+            for (std::string_view name : existing.complete(NameIndex::Section::Packages, ""))
+            {
+                packageNames.emplace_back(name);
+            }
+        }
+        return writeNameIndex(std::move(packageNames), getRepositoryList());
+    }
+
+    NameIndex::~NameIndex()
+    {
+        close();
+    }
+
+    void NameIndex::close()
+    {
+#ifndef _WIN32
+        if (mapped)
+        {
+            munmap(const_cast<char *>(data), size);
+        }
+#endif
+        mapped = false;
+        data = nullptr;
+        size = 0;
+        buffer.clear();
+    }
+
+    int NameIndex::open(const std::string &path)
+    {
+        close();
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return 1;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0)
+        {
+            ::close(fd);
+            return 1;
+        }
+        void *map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED)
+        {
+            return 1;
+        }
+        data = static_cast<const char *>(map);
+        size = static_cast<size_t>(st.st_size);
+        mapped = true;
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            return 1;
+        }
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        size = buffer.size();
+#endif
+        if (size < HeaderSize || std::memcmp(data, Magic, sizeof(Magic)) != 0)
+        {
+            OPENSPM_DEBUG("[DEBUG NameIndex::open] Not a completion index: " + path);
+            close();
+            return 1;
+        }
+        packageCount = getU32(data + sizeof(Magic));
+        repositoryCount = getU32(data + sizeof(Magic) + 4);
+        size_t offsetBytes = (static_cast<size_t>(packageCount) + repositoryCount + 2) * 4;
+        if (size - HeaderSize < offsetBytes)
+        {
+            OPENSPM_DEBUG("[DEBUG NameIndex::open] Truncated completion index: " + path);
+            close();
+            return 1;
+        }
+        offsets = data + HeaderSize;
+        pool = offsets + offsetBytes;
+        poolSize = size - HeaderSize - offsetBytes;
+        return 0;
+    }
+
+    std::uint32_t NameIndex::count(Section section) const
+    {
+        if (data == nullptr)
+            return 0;
+        return section == Section::Packages ? packageCount : repositoryCount;
+    }
+
+    std::string_view NameIndex::at(Section section, std::uint32_t i) const
+    {
+        size_t slot = section == Section::Packages ? i : static_cast<size_t>(packageCount) + 1 + i;
+        std::uint32_t begin = getU32(offsets + slot * 4);
+        std::uint32_t end = getU32(offsets + (slot + 1) * 4);
+        if (begin > end || end > poolSize)
+        {
+            return {};
+        }
+        return std::string_view(pool + begin, end - begin);
+    }
+
+    std::vector<std::string_view> NameIndex::complete(Section section, std::string_view prefix) const
+    {
+        std::uint32_t lo = 0;
+        std::uint32_t hi = count(section);
+        while (lo < hi)
+        {
+            std::uint32_t mid = lo + (hi - lo) / 2;
+            if (at(section, mid) < prefix)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        std::vector<std::string_view> matches;
+        for (std::uint32_t i = lo; i < count(section); ++i)
+        {
+            std::string_view name = at(section, i);
+            if (name.substr(0, prefix.size()) != prefix)
+            {
+                break;
+            }
+            matches.push_back(name);
+        }
+        return matches;
+    }
+} // namespace openspm
@@ -8,20 +8,36 @@
 #include <openspm_cli.hpp>
 #include <repository_manager.hpp>
 #include <package_manager.hpp>
+#include <catalog.hpp>
 #include <filesystem>
 #include <iostream>
 #include <logger.hpp>
 #include <config.hpp>
 #include <utils.hpp>
+#include <durability.hpp>
+#include <trace.hpp>
+#include <metrics.hpp>
+#include <daemon.hpp>
+#include <search_index.hpp>
+#include <name_index.hpp>
+#include <index_shards.hpp>
+#include <sparse_index.hpp>
+#include <installed_db.hpp>
+#include <dependents_index.hpp>
+#include <iterator>
 #include <thread>
 namespace openspm
 {
     using namespace logger;
     namespace cli
     {
+        /// Repositories selected with --repo
+        static std::vector<std::string> selectedRepositories;
+
         int processFlags(const std::vector<std::pair<std::string, std::string>> &flagsWithValues,
                          const std::vector<std::string> &flagsWithoutValues)
         {
+            selectedRepositories.clear();
             for (const auto &flagPair : flagsWithValues)
             {
                 const std::string &flag = flagPair.first;
@@ -46,6 +62,48 @@ namespace openspm
                     Config *config = getConfig();
                     config->logsFile = value;
                 }
+                else if (flag == "--script-timeout" || flag == "--jobs")
+                {
+                    unsigned long number;
+                    try
+                    {
+                        number = std::stoul(value);
+                    }
+                    catch (const std::exception &)
+                    {
+                        error("Invalid number for " + flag + ": " + value);
+                        return 1;
+                    }
+                    Config *config = getConfig();
+                    if (flag == "--jobs")
+                        config->scriptJobs = static_cast<unsigned>(number);
+                    else
+                        config->scriptTimeout = static_cast<unsigned>(number);
+                }
+                else if (flag == "--durability")
+                {
+                    DurabilityMode mode;
+                    if (!parseDurabilityMode(value, mode))
+                    {
+                        error("Invalid durability mode: " + value + " (expected none, batch or strict)");
+                        return 1;
+                    }
+                    Config *config = getConfig();
+                    config->durability = value;
+                }
+                else if (flag == "--trace")
+                {
+                    trace::start(value);
+                }
+                else if (flag == "--metrics-file")
+                {
+                    Config *config = getConfig();
+                    config->metricsFile = value;
+                }
+                else if (flag == "--repo")
+                {
+                    selectedRepositories.push_back(value);
+                }
                 else
                 {
                     error("Unknown flag: " + flag);
@@ -64,6 +122,11 @@ namespace openspm
                     Config *config = getConfig();
                     config->debug = true;
                 }
+                else if (flag == "--no-daemon")
+                {
+                    Config *config = getConfig();
+                    config->useDaemon = false;
+                }
                 else
                 {
                     error("Unknown flag: " + flag);
@@ -140,6 +203,7 @@ namespace openspm
             log("Please follow the prompts to configure OpenSPM.");
             log("Enter the data directory (default: /etc/openspm/): ");
             std::string dataDir;
+            flush();
             std::getline(std::cin, dataDir);
             if (dataDir.empty())
             {
@@ -147,6 +211,7 @@ namespace openspm
             }
             log("Enter the target installation directory (default: /usr/local/): ");
             std::string targetDir;
+            flush();
             std::getline(std::cin, targetDir);
             if (targetDir.empty())
             {
@@ -169,6 +234,7 @@ namespace openspm
             log("Please follow the prompts to configure OpenSPM.");
             log("Enter the data directory (default: C:\\ProgramData\\openspm\\): ");
             std::string dataDir;
+            flush();
             std::getline(std::cin, dataDir);
             if (dataDir.empty())
             {
@@ -176,6 +242,7 @@ namespace openspm
             }
             log("Enter the target installation directory (default: C:\\Program Files\\openspm\\): ");
             std::string targetDir;
+            flush();
             std::getline(std::cin, targetDir);
             if (targetDir.empty())
             {
@@ -186,6 +253,7 @@ namespace openspm
             config->targetDir = targetDir;
             log("Do you see colored text below? \n \033[32mThis is green text.\033[0m \n \033[31mThis is red text.\033[0m \n (y/n):");
             std::string colorTestResponse;
+            flush();
             std::getline(std::cin, colorTestResponse);
             if (colorTestResponse == "n" || colorTestResponse == "N")
             {
@@ -195,6 +263,7 @@ namespace openspm
             {
                 log("Do you want to enable colored output? (y/n, default: y): ");
                 std::string colorOutputStr;
+                flush();
                 std::getline(std::cin, colorOutputStr);
                 if (colorOutputStr.empty() || colorOutputStr == "y" || colorOutputStr == "Y")
                 {
@@ -229,9 +298,59 @@ namespace openspm
         int installPackage(const std::string &packageName){
             std::vector<std::string> collectedPackages;
             std::vector<openspm::PackageInfo> packages;
-            int status = openspm::collectDependencies(packageName, packages);
-            if(status !=0){
-                return status;
+            Catalog catalog;
+            int status = 0;
+            if (getConfig()->useDaemon && queryDaemon("resolve", packageName, getConfig()->supported_tags, packages, status) && status == 0)
+            {
+                // The installer only looks up the packages it installs
+                catalog.setPackages(packages);
+            }
+            else
+            {
+                // Also taken when the daemon fails to resolve, to report the reason here
+                packages.clear();
+                if (catalog.loadRepositories() == 0 && hasSparseRepositories(catalog))
+                {
+                    // Only the dependency closure is fetched; a local index, if any, covers the other repositories
+                    if (hasPackageIndex() && catalog.loadPackages() != 0)
+                    {
+                        return 1;
+                    }
+                    std::vector<PackageInfo> fetched;
+                    status = fetchSparseClosure(catalog, packageName, fetched);
+                    if(status !=0){
+                        return status;
+                    }
+                    // Merged again with priorities and pins, which also hold between local and sparse repositories
+                    std::vector<RepositoryInfo> repositories;
+                    for (const auto &url : catalog.repositoryUrls())
+                    {
+                        repositories.push_back(*catalog.findRepository(url));
+                    }
+                    ShardManifest manifest;
+                    std::string manifestText;
+                    if (getDataArchive()->readFile(ShardManifestFile, manifestText) == 0)
+                    {
+                        parseShardManifest(manifestText, manifest);
+                    }
+                    std::vector<PackageInfo> merged = catalog.packages();
+                    std::move(fetched.begin(), fetched.end(), std::back_inserter(merged));
+                    catalog.setPackages(mergeRepositoryPackages(std::move(merged), repositories, std::move(manifest)));
+                }
+                else
+                {
+                    status = catalog.loadPackagesFor(packageName);
+                    if(status !=0){
+                        error("Failed to list packages for dependency collection.");
+                        return status;
+                    }
+                }
+                status = openspm::collectDependencies(catalog, packageName, packages);
+                if(status !=0){
+                    return status;
+                }
+                // Later lookups must see the selected versions, not the newest ones
+                catalog.setPackages(packages);
             }
             status = openspm::askInstallationConfirmation(packages);
             if(status !=0){
@@ -241,13 +360,22 @@ namespace openspm
             if(status !=0){
                 return status;
             }
-            status = openspm::installCollectedPackages(collectedPackages);
+            status = openspm::installCollectedPackages(catalog, collectedPackages, {packageName});
             return status;
         }
-        int processCommandLine(std::string command,
-                               const std::vector<std::string> &commandArgs,
-                               const std::vector<std::pair<std::string, std::string>> &flagsWithValues,
-                               const std::vector<std::string> &flagsWithoutValues)
+        int removePackages(const std::vector<std::string> &packageNames)
+        {
+            int status = openspm::askRemovalConfirmation(packageNames);
+            if (status != 0)
+            {
+                return status;
+            }
+            return openspm::removePackages(packageNames);
+        }
+        static int dispatchCommand(const std::string &command,
+                                   const std::vector<std::string> &commandArgs,
+                                   const std::vector<std::pair<std::string, std::string>> &flagsWithValues,
+                                   const std::vector<std::string> &flagsWithoutValues)
         {
             try
             {
@@ -272,6 +400,11 @@ namespace openspm
                 {
                     return 1;
                 }
+                if (command == "complete")
+                {
+                    // Runs on every <TAB>; keep it clear of the data archive and log file
+                    return complete(commandArgs);
+                }
                 status = initDataArchive();
 
                 if (status != 0)
@@ -289,6 +422,12 @@ namespace openspm
                 {
                     return 1;
                 }
+                if (!config->metricsFile.empty())
+                {
+                    metrics::enable();
+                }
+                trace::Span commandSpan("command", "cli");
+                commandSpan.setDetail(command);
                 if (command == "add-repo" || command == "add-repository" || command == "ar")
                 {
                     if (commandArgs.size() < 1)
@@ -326,12 +465,83 @@ namespace openspm
                     }
                     else
                     {
+                        Catalog catalog;
+                        catalog.loadRepositories();
                         log("Configured Repositories:");
                         for (const auto &repoUrl : repoList)
                         {
-                            log("  \033[0;34m" + repoUrl);
+                            const RepositoryInfo *info = catalog.findRepository(repoUrl);
+                            if (info == nullptr)
+                            {
+                                log("  \033[0;34m" + repoUrl);
+                                continue;
+                            }
+                            log("  \033[0;34m" + repoUrl + (info->priority != 0 ? " \033[0;37m(priority " + std::to_string(info->priority) + ")" : ""));
+                            for (const auto &[name, range] : info->pins)
+                            {
+                                log("    \033[0;37mpinned: " + name + " " + range);
+                            }
+                        }
+                    }
+                }
+                else if (command == "repo-priority" || command == "rp")
+                {
+                    if (commandArgs.size() < 2)
+                    {
+                        error("Repository URL and priority are required.");
+                        return 1;
+                    }
+                    int priority = 0;
+                    try
+                    {
+                        size_t used = 0;
+                        priority = std::stoi(commandArgs[1], &used);
+                        if (used != commandArgs[1].size())
+                        {
+                            throw std::invalid_argument(commandArgs[1]);
                         }
                     }
+                    catch (const std::exception &)
+                    {
+                        error("Invalid priority: " + commandArgs[1]);
+                        return 1;
+                    }
+                    if (!setRepositoryPriority(commandArgs[0], priority))
+                    {
+                        return 1;
+                    }
+                    log("\033[0;32mPriority of " + commandArgs[0] + " set to " + std::to_string(priority));
+                }
+                else if (command == "pin")
+                {
+                    if (commandArgs.size() < 2)
+                    {
+                        error("Repository URL and package name are required.");
+                        return 1;
+                    }
+                    std::string range;
+                    for (size_t i = 2; i < commandArgs.size(); ++i)
+                    {
+                        range += (i > 2 ? " " : "") + commandArgs[i];
+                    }
+                    if (!pinPackage(commandArgs[0], commandArgs[1], range))
+                    {
+                        return 1;
+                    }
+                    log("\033[0;32mPinned " + commandArgs[1] + (range.empty() ? "" : " " + range) + " to " + commandArgs[0]);
+                }
+                else if (command == "unpin")
+                {
+                    if (commandArgs.size() < 1)
+                    {
+                        error("Package name is required.");
+                        return 1;
+                    }
+                    if (!unpinPackage(commandArgs[0]))
+                    {
+                        return 1;
+                    }
+                    log("\033[0;32mUnpinned " + commandArgs[0]);
                 }
                 else if (command == "update-repos" || command == "update-repositories" || command == "ur")
                 {
@@ -339,7 +549,7 @@ namespace openspm
                 }
                 else if (command == "update" || command == "up")
                 {
-                    return updateAll();
+                    return updateAll(selectedRepositories);
                 }
                 else if (command == "install" || command == "i")
                 {
@@ -351,10 +561,59 @@ namespace openspm
                     std::string packageName = commandArgs[0];
                     return installPackage(packageName);
                 }
+                else if (command == "remove" || command == "r")
+                {
+                    if (commandArgs.empty())
+                    {
+                        error("Package name is required.");
+                        return 1;
+                    }
+                    return removePackages(commandArgs);
+                }
+                else if (command == "list-installed" || command == "li")
+                {
+                    return listInstalled(commandArgs);
+                }
+                else if (command == "autoremove" || command == "arm")
+                {
+                    return autoremove();
+                }
+                else if (command == "dependents" || command == "rdeps")
+                {
+                    if (commandArgs.empty())
+                    {
+                        error("Package name is required.");
+                        return 1;
+                    }
+                    return dependents(commandArgs[0]);
+                }
+                else if (command == "owns")
+                {
+                    if (commandArgs.empty())
+                    {
+                        error("A path is required.");
+                        return 1;
+                    }
+                    return owns(commandArgs);
+                }
                 else if (command == "list-packages" || command == "lp")
                 {
                     listPackages();
                 }
+                else if (command == "search" || command == "s")
+                {
+                    if (commandArgs.empty())
+                    {
+                        error("Search terms are required.");
+                        return 1;
+                    }
+                    std::string query;
+                    for (const auto &arg : commandArgs)
+                    {
+                        query += arg + " ";
+                    }
+                    return searchPackages(query);
+                }
                 else if (command == "help" || command == "--help" || command == "-h")
                 {
                     log("\033[0;32mOpenSPM - Open Source Package Manager\033[0m");
@@ -369,17 +628,34 @@ namespace openspm
                     log("  \033[0;34madd-repo \033[0;37m<url>            \033[0;35mAdd a new package repository");
                     log("  \033[0;34mrm-repo \033[0;37m<url>             \033[0;35mRemove a package repository");
                     log("  \033[0;34mlist-repos                \033[0;35mList all configured repositories");
+                    log("  \033[0;34mrepo-priority \033[0;37m<url> <n>   \033[0;35mPrefer packages from higher-priority repositories");
+                    log("  \033[0;34mpin \033[0;37m<url> <pkg> [range] \033[0;35mTake a package only from one repository");
+                    log("  \033[0;34munpin \033[0;37m<pkg>             \033[0;35mRemove the pin of a package");
                     log("  \033[0;34mupdate-repos              \033[0;35mSync repository metadata");
                     log("");
                     log("\033[0;32mPackage Management:");
                     log("  \033[0;34mlist-packages, lp         \033[0;35mList packages compatible with this system");
+                    log("  \033[0;34mlist-installed, li \033[0;37m[pkg] \033[0;35mList installed packages, or check the given ones");
+                    log("  \033[0;34mremove, r \033[0;37m<pkg...>        \033[0;35mRemove installed packages and their files");
+                    log("  \033[0;34mautoremove, arm           \033[0;35mRemove dependencies no installed package needs any more");
+                    log("  \033[0;34mowns \033[0;37m<path...>            \033[0;35mShow which installed packages own a path");
+                    log("  \033[0;34mdependents, rdeps \033[0;37m<pkg>   \033[0;35mShow which packages depend on a package");
+                    log("  \033[0;34msearch, s \033[0;37m<terms>         \033[0;35mSearch package names and descriptions");
                     log("  \033[0;34mupdate, up                \033[0;35mUpdate all installed packages");
+                    log("  \033[0;34mcomplete \033[0;37m<prefix>         \033[0;35mPrint matching names for shell completion");
                     log("");
                     log("\033[0;32mGlobal Flags:");
                     log("  \033[0;34m--logfile \033[0;37m<file>          \033[0;35mPath to save log output");
                     log("  \033[0;34m--data-dir \033[0;37m<dir>          \033[0;35mSet custom metadata directory");
                     log("  \033[0;34m--target-dir \033[0;37m<dir>        \033[0;35mSet custom installation target");
                     log("  \033[0;34m--tags \033[0;37m<tags>             \033[0;35mOverride system tags (e.g. \"gcc;bin\")");
+                    log("  \033[0;34m--durability \033[0;37m<mode>       \033[0;35mSync installed files: none, batch or strict");
+                    log("  \033[0;34m--jobs \033[0;37m<n>                \033[0;35mRun up to n post-install scripts at once");
+                    log("  \033[0;34m--script-timeout \033[0;37m<sec>    \033[0;35mKill post-install scripts after sec seconds");
+                    log("  \033[0;34m--trace \033[0;37m<file>            \033[0;35mWrite a Chrome trace of where time was spent");
+                    log("  \033[0;34m--metrics-file \033[0;37m<file>     \033[0;35mWrite Prometheus metrics for this run");
+                    log("  \033[0;34m--repo \033[0;37m<url>             \033[0;35mWith update: refresh only this repository");
+                    log("  \033[0;34m--no-daemon               \033[0;35mDon't query a running openspmd");
                     log("  \033[0;34m--no-color, -nc           \033[0;35mDisable colored output");
                     log("  \033[0;34m--debug                   \033[0;35mShow verbose debugging information");
                 }
@@ -396,15 +672,31 @@ namespace openspm
                 return 1;
             }
         }
-        int updateAll()
+        int processCommandLine(std::string command,
+                               const std::vector<std::string> &commandArgs,
+                               const std::vector<std::pair<std::string, std::string>> &flagsWithValues,
+                               const std::vector<std::string> &flagsWithoutValues)
+        {
+            int status = dispatchCommand(command, commandArgs, flagsWithValues, flagsWithoutValues);
+            if (metrics::enabled())
+            {
+                metrics::writeTextfile(getConfig()->metricsFile, command, status);
+            }
+            return status;
+        }
+        int updateAll(const std::vector<std::string> &onlyRepos)
         {
-            int status = openspm::updateAllRepositories();
-            if (status != 0)
+            int status = 0;
+            if (onlyRepos.empty())
             {
-                error("\033[0;31mFailed to update repositories.");
-                return 1;
+                status = openspm::updateAllRepositories();
+                if (status != 0)
+                {
+                    error("\033[0;31mFailed to update repositories.");
+                    return 1;
+                }
             }
-            status = openspm::updatePackages();
+            status = openspm::updatePackages(onlyRepos);
             if (status != 0)
             {
                 return 1;
@@ -431,6 +723,7 @@ namespace openspm
             {
                 log("Are you sure you want to add this repository? (y/n): ");
                 std::string response;
+                flush();
                 std::getline(std::cin, response);
                 if (response != "y" && response != "Y")
                 {
@@ -443,10 +736,17 @@ namespace openspm
                 error("\033[0;31mFailed to add repository: " + repoUrl);
                 return 1;
             }
+            if (!skipUpdate && !repoInfo.sparseIndex.empty())
+            {
+                log("\033[0;32mSuccessfully added repository: " + repoUrl);
+                log("\033[0;36mPackages from this repository are fetched on demand by install. Run 'openspm update' to also list and search them.");
+                return 0;
+            }
             if (!skipUpdate)
             {
                 log("\033[0;36mUpdating...");
-                return updatePackages();
+                // Only the new repository's shard has to be fetched
+                return openspm::updatePackages(std::vector<std::string>{repoInfo.url});
             }
             log("\033[0;32mSuccessfully added repository: " + repoUrl);
             return 0;
@@ -461,58 +761,322 @@ namespace openspm
             return status;
         }
 
+        int listInstalled(const std::vector<std::string> &names)
+        {
+            InstalledDatabase installed;
+            if (installed.open(installedDatabasePath()) != 0)
+            {
+                error("\033[0;31mThe installed package database is invalid.");
+                return 1;
+            }
+            if (!names.empty())
+            {
+                // Answered from the index alone, for scripts
+                int missing = 0;
+                for (const auto &name : names)
+                {
+                    InstalledPackage pkg;
+                    if (installed.find(name, pkg))
+                    {
+                        log("\033[0;33m" + name + " \033[0;35m" + pkg.version);
+                    }
+                    else
+                    {
+                        log("\033[0;33m" + name + " \033[0;31mnot installed");
+                        missing = 1;
+                    }
+                }
+                return missing;
+            }
+            std::vector<InstalledPackage> packages = installed.list();
+            if (packages.empty())
+            {
+                log("No packages installed.");
+                return 0;
+            }
+            log("\033[0;32mInstalled packages:");
+            for (const auto &pkg : packages)
+            {
+                std::string line = "  \033[0;33m" + pkg.name + " \033[0;35m" + pkg.version + " \033[0;37m(" +
+                                   std::to_string(pkg.fileCount) + " files, " + std::to_string(pkg.totalBytes / 1024) + " KiB";
+                if (!pkg.repository.empty())
+                {
+                    line += ", from " + pkg.repository;
+                }
+                if (pkg.automatic)
+                {
+                    line += ", automatic";
+                }
+                log(line + ")");
+            }
+            return 0;
+        }
+
+        int autoremove()
+        {
+            InstalledDatabase installed;
+            if (installed.open(installedDatabasePath()) != 0)
+            {
+                error("\033[0;31mThe installed package database is invalid.");
+                return 1;
+            }
+            std::vector<std::string> orphans = installed.orphans();
+            if (orphans.empty())
+            {
+                log("No orphaned packages.");
+                return 0;
+            }
+            // One transaction, so orphans depending on each other go together
+            return removePackages(orphans);
+        }
+
+        int dependents(const std::string &packageName)
+        {
+            InstalledDatabase installed;
+            if (installed.open(installedDatabasePath()) != 0)
+            {
+                error("\033[0;31mThe installed package database is invalid.");
+                return 1;
+            }
+            DependentsIndex index;
+            std::string indexData;
+            if (getDataArchive()->readFile(DependentsIndexFile, indexData) != 0 || index.load(std::move(indexData)) != 0)
+            {
+                // Index written by an older version; build one in memory for this query
+                warn("No reverse-dependency index found. Run 'openspm update' to create one.");
+                Catalog catalog;
+                if (catalog.loadPackages() != 0)
+                {
+                    error("\033[0;31mFailed to get packages list");
+                    return 1;
+                }
+                if (index.load(buildDependentsIndex(catalog.packages())) != 0)
+                {
+                    return 1;
+                }
+            }
+            std::vector<std::string_view> available;
+            bool known = index.lookup(packageName, available);
+            std::vector<std::string> installedDependents = installed.dependents(packageName);
+            if (!known && !installed.isInstalled(packageName))
+            {
+                error("Package not found: " + packageName);
+                return 1;
+            }
+            if (installedDependents.empty())
+            {
+                log("\033[0;36mNo installed package depends on " + packageName + ".");
+            }
+            else
+            {
+                log("\033[0;32mInstalled packages depending on " + packageName + ":");
+                for (const auto &name : installedDependents)
+                {
+                    log("  \033[0;33m" + name);
+                }
+            }
+            if (!available.empty())
+            {
+                log("\033[0;32mAvailable packages depending on " + packageName + ":");
+                for (std::string_view name : available)
+                {
+                    log("  \033[0;33m" + std::string(name) + (installed.isInstalled(name) ? " \033[0;37m(installed)" : ""));
+                }
+            }
+            return 0;
+        }
+
+        int owns(const std::vector<std::string> &paths)
+        {
+            InstalledDatabase installed;
+            if (installed.open(installedDatabasePath()) != 0)
+            {
+                error("\033[0;31mThe installed package database is invalid.");
+                return 1;
+            }
+            std::filesystem::path targetDir = std::filesystem::path(getConfig()->targetDir).lexically_normal();
+            if (!targetDir.has_filename())
+            {
+                targetDir = targetDir.parent_path();
+            }
+            int unowned = 0;
+            for (const auto &arg : paths)
+            {
+                // Absolute paths are taken below the target directory, others relative to it
+                std::filesystem::path path = std::filesystem::path(arg).lexically_normal();
+                if (path.is_absolute())
+                {
+                    path = path.lexically_relative(targetDir);
+                }
+                std::string relative = path.generic_string();
+                while (!relative.empty() && relative.back() == '/')
+                {
+                    relative.pop_back();
+                }
+                if (relative.empty() || relative == "." || relative == ".." || relative.rfind("../", 0) == 0)
+                {
+                    log("\033[0;33m" + arg + " \033[0;31mis not in " + getConfig()->targetDir);
+                    unowned = 1;
+                    continue;
+                }
+                std::vector<PathOwner> owners = installed.owners(relative);
+                if (owners.empty())
+                {
+                    log("\033[0;33m" + arg + " \033[0;31mis not owned by any package");
+                    unowned = 1;
+                    continue;
+                }
+                std::string line = "\033[0;33m" + arg + " \033[0;35m";
+                for (size_t i = 0; i < owners.size(); ++i)
+                {
+                    line += (i > 0 ? ", " : "") + owners[i].package;
+                }
+                log(line + (owners.front().directory ? " \033[0;37m(directory)" : ""));
+            }
+            return unowned;
+        }
+
         int listPackages()
         {
+            std::string tags = getConfig()->supported_tags;
             std::vector<PackageInfo> packages;
-            int status = listPackages(packages);
-            if (status != 0)
+            int status = 0;
+            if (!getConfig()->useDaemon || !queryDaemon("list-packages", "", tags, packages, status) || status != 0)
             {
-                error("\033[0;31mFailed to get packages list");
-                return status;
+                Catalog catalog;
+                status = catalog.loadPackages();
+                if (status != 0)
+                {
+                    error("\033[0;31mFailed to get packages list");
+                    return status;
+                }
+                packages.clear();
+                for (const auto &package : catalog.packages())
+                {
+                    if (areTagsCompatible(tags, package.tags))
+                    {
+                        packages.push_back(package);
+                    }
+                }
             }
-            std::string tags = getConfig()->supported_tags;
             log("\033[0;32mCompatible packages:");
             log("\033[0;32m────────────────────────────────────────────");
-            for (auto &package : packages)
+            for (const auto &package : packages)
             {
-                bool result = areTagsCompatible(tags, package.tags);
-                if (result)
-                {
+                log("  \033[0;36mName:        \033[0;33m" + package.name);
+                log("  \033[0;36mVersion:     \033[0;35m" + package.version);
 
-                    log("  \033[0;36mName:        \033[0;33m" + package.name);
-                    log("  \033[0;36mVersion:     \033[0;35m" + package.version);
-
-                    if (!package.description.empty())
-                        log("  \033[0;36mDescription: \033[0;33m" + package.description);
-                    else
-                        log("  \033[0;36mDescription: \033[0;31m<none>");
+                if (!package.description.empty())
+                    log("  \033[0;36mDescription: \033[0;33m" + package.description);
+                else
+                    log("  \033[0;36mDescription: \033[0;31m<none>");
 
-                    if (!package.maintainer.empty())
-                        log("  \033[0;36mMaintainer:  \033[0;33m" + package.maintainer);
-                    else
-                        log("  \033[0;36mMaintainer:  \033[0;31m<unknown>");
+                if (!package.maintainer.empty())
+                    log("  \033[0;36mMaintainer:  \033[0;33m" + package.maintainer);
+                else
+                    log("  \033[0;36mMaintainer:  \033[0;31m<unknown>");
 
-                    if (!package.tags.empty())
-                        log("  \033[0;36mTags:        \033[0;34m" + package.tags);
-                    else
-                        log("  \033[0;36mTags:        \033[0;31m<none>");
-                    if (package.dependencies.size() != 0)
+                if (!package.tags.empty())
+                    log("  \033[0;36mTags:        \033[0;34m" + package.tags);
+                else
+                    log("  \033[0;36mTags:        \033[0;31m<none>");
+                if (package.dependencies.size() != 0)
+                {
+                    log("  \033[0;36mDependencies:");
+                    for (const auto &dep : package.dependencies)
                     {
-                        log("  \033[0;36mDependencies:");
-                        for (auto dep : package.dependencies)
-                        {
-                            log("   \033[0;31m" + dep);
-                        }
-                        
+                        log("   \033[0;31m" + dep);
                     }
-                    if (!package.url.empty())
-                        log("  \033[0;36mURL:         \033[0;34m" + package.url);
-                    else
-                        log("  \033[0;36mURL:         \033[0;31m<none>");
+                    
+                }
+                if (!package.url.empty())
+                    log("  \033[0;36mURL:         \033[0;34m" + package.url);
+                else
+                    log("  \033[0;36mURL:         \033[0;31m<none>");
 
-                    log("\033[0;32m────────────────────────────────────────────\033[0m");
+                log("\033[0;32m────────────────────────────────────────────\033[0m");
+            }
+            return 0;
+        }
+        int searchPackages(const std::string &query)
+        {
+            const size_t maxResults = 50;
+            SearchIndex index;
+            std::string indexData;
+            if (getDataArchive()->readFile(SearchIndexFile, indexData) != 0 || index.load(std::move(indexData)) != 0)
+            {
+                // Index written by an older version; build one in memory for this search
+                warn("No search index found. Run 'openspm update' to create one.");
+                Catalog catalog;
+                if (catalog.loadPackages() != 0)
+                {
+                    error("\033[0;31mFailed to get packages list");
+                    return 1;
                 }
+                if (index.load(buildSearchIndex(catalog.packages())) != 0)
+                {
+                    return 1;
+                }
+            }
+            size_t total = 0;
+            std::vector<SearchResult> results = index.search(query, getConfig()->supported_tags, maxResults, total);
+            if (results.empty())
+            {
+                log("No packages found.");
+                return 0;
+            }
+            for (const auto &result : results)
+            {
+                std::string line = "\033[0;33m" + result.name + " \033[0;35m" + result.version;
+                if (!result.description.empty())
+                    line += " \033[0;37m- " + result.description;
+                log(line);
+            }
+            if (total > results.size())
+            {
+                log("\033[0;36m... and " + std::to_string(total - results.size()) + " more. Refine the search to see them.");
+            }
+            return 0;
+        }
+
+        int complete(const std::vector<std::string> &args)
+        {
+            NameIndex::Section section = NameIndex::Section::Packages;
+            std::string prefix;
+            if (args.size() == 2)
+            {
+                if (args[0] == "repos")
+                    section = NameIndex::Section::Repositories;
+                else if (args[0] != "packages")
+                {
+                    error("Unknown completion kind: " + args[0]);
+                    return 1;
+                }
+                prefix = args[1];
+            }
+            else if (args.size() == 1)
+            {
+                prefix = args[0];
+            }
+            else if (args.size() > 2)
+            {
+                error("Usage: openspm complete [packages|repos] <prefix>");
+                return 1;
+            }
+
+            NameIndex index;
+            if (index.open(nameIndexPath()) != 0)
+            {
+                // No index until the first update; completing nothing is the right answer
+                return 0;
+            }
+            std::string out;
+            for (std::string_view name : index.complete(section, prefix))
+            {
+                out.append(name.data(), name.size());
+                out.push_back('\n');
             }
+            std::cout << out << std::flush;
             return 0;
         }
     } // namespace cli
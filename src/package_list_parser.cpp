@@ -0,0 +1,737 @@
+/**
+ * @file package_list_parser.cpp
+ * @brief Implementation of the streaming package list parser
+ */
+#include <package_list_parser.hpp>
+#include <logger.hpp>
+#include <yaml-cpp/eventhandler.h>
+#include <yaml-cpp/exceptions.h>
+#include <yaml-cpp/parser.h>
+#include <simdjson.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace openspm
+{
+    using namespace logger;
+
+    namespace
+    {
+        /// Bytes the download may run ahead of the parser before feed() blocks
+        constexpr size_t MaxPendingBytes = 256 * 1024;
+        /// Characters yaml-cpp may put back while detecting the encoding
+        constexpr size_t PutbackSize = 4;
+
+        /// Thrown by the handler to stop parsing on a schema error
+        struct SchemaError
+        {
+            std::string message;
+        };
+
+        /**
+         * @brief Builds PackageInfo records from parser events
+         *
+         * Tracks only the current position in the schema and the package
+         * being filled in; any value the schema doesn't use is skipped by
+         * counting nesting depth.
+         */
+        class PackageListHandler : public YAML::EventHandler
+        {
+        public:
+            PackageListHandler(const PackageCallback &onPackage, std::vector<std::string> &depends)
+                : onPackage(onPackage), depends(depends) {}
+
+            bool sawPackages() const { return packagesFound; }
+
+            void OnDocumentStart(const YAML::Mark &) override {}
+            void OnDocumentEnd() override {}
+
+            void OnNull(const YAML::Mark &, YAML::anchor_t) override { scalar("", false); }
+            void OnAlias(const YAML::Mark &, YAML::anchor_t) override { scalar("", false); }
+            void OnScalar(const YAML::Mark &, const std::string &, YAML::anchor_t, const std::string &value) override
+            {
+                scalar(value, true);
+            }
+
+            void OnSequenceStart(const YAML::Mark &, const std::string &, YAML::anchor_t, YAML::EmitterStyle::value) override
+            {
+                switch (state)
+                {
+                case State::Start:
+                    throw SchemaError{"document is not a mapping"};
+                case State::TopValue:
+                    if (key == "depend")
+                        state = State::DependSeq;
+                    else if (key == "packages")
+                    {
+                        packagesFound = true;
+                        state = State::PackagesSeq;
+                    }
+                    else
+                        beginSkip(State::TopKey);
+                    break;
+                case State::PackageValue:
+                    if (key == "dependencies")
+                        state = State::PackageDeps;
+                    else
+                        beginSkip(State::PackageKey);
+                    break;
+                case State::TopKey:
+                case State::PackageKey:
+                    throw SchemaError{"complex keys are not supported"};
+                default:
+                    nested();
+                }
+            }
+
+            void OnMapStart(const YAML::Mark &, const std::string &, YAML::anchor_t, YAML::EmitterStyle::value) override
+            {
+                switch (state)
+                {
+                case State::Start:
+                    state = State::TopKey;
+                    break;
+                case State::TopValue:
+                    if (key == "packages")
+                        throw SchemaError{"'packages' is not a sequence"};
+                    beginSkip(State::TopKey);
+                    break;
+                case State::PackagesSeq:
+                    current = PackageInfo();
+                    state = State::PackageKey;
+                    break;
+                case State::PackageValue:
+                    beginSkip(State::PackageKey);
+                    break;
+                case State::TopKey:
+                case State::PackageKey:
+                    throw SchemaError{"complex keys are not supported"};
+                default:
+                    nested();
+                }
+            }
+
+            void OnSequenceEnd() override { end(); }
+            void OnMapEnd() override { end(); }
+
+        private:
+            enum class State
+            {
+                Start,        ///< Before the root mapping
+                TopKey,       ///< Expecting a key of the root mapping
+                TopValue,     ///< Expecting the value for `key` in the root mapping
+                DependSeq,    ///< Inside `depend`
+                PackagesSeq,  ///< Inside `packages`, between records
+                PackageKey,   ///< Expecting a key of a package record
+                PackageValue, ///< Expecting the value for `key` in a package record
+                PackageDeps,  ///< Inside a package's `dependencies`
+                Skip,         ///< Inside an ignored collection
+                Done          ///< After the root mapping
+            };
+
+            void beginSkip(State after)
+            {
+                resume = after;
+                skipDepth = 1;
+                state = State::Skip;
+            }
+
+            /// A collection where only scalars are expected; ignore it
+            void nested()
+            {
+                if (state == State::Skip)
+                    ++skipDepth;
+                else
+                    beginSkip(state);
+            }
+
+            void scalar(const std::string &value, bool present)
+            {
+                switch (state)
+                {
+                case State::Start:
+                    throw SchemaError{"document is not a mapping"};
+                case State::TopKey:
+                    key = value;
+                    state = State::TopValue;
+                    break;
+                case State::TopValue:
+                    if (key == "packages")
+                        throw SchemaError{"'packages' is not a sequence"};
+                    state = State::TopKey;
+                    break;
+                case State::DependSeq:
+                    if (present)
+                        depends.push_back(value);
+                    break;
+                case State::PackageKey:
+                    key = value;
+                    state = State::PackageValue;
+                    break;
+                case State::PackageValue:
+                    assign(value);
+                    state = State::PackageKey;
+                    break;
+                case State::PackageDeps:
+                    if (present)
+                        current.dependencies.push_back(value);
+                    break;
+                default:
+                    // Scalars in skipped collections, or stray entries in `packages`
+                    break;
+                }
+            }
+
+            void assign(const std::string &value)
+            {
+                if (key == "name")
+                    current.name = value;
+                else if (key == "version")
+                    current.version = value;
+                else if (key == "description")
+                    current.description = value;
+                else if (key == "maintainer")
+                    current.maintainer = value;
+                else if (key == "tags")
+                    current.tags = value;
+                else if (key == "url")
+                    current.url = value;
+            }
+
+            void end()
+            {
+                switch (state)
+                {
+                case State::Skip:
+                    if (--skipDepth == 0)
+                        state = resume;
+                    break;
+                case State::DependSeq:
+                case State::PackagesSeq:
+                    state = State::TopKey;
+                    break;
+                case State::PackageDeps:
+                    state = State::PackageKey;
+                    break;
+                case State::PackageKey:
+                    OPENSPM_DEBUG("[DEBUG PackageListHandler] Package: " + current.name + " v" + current.version);
+                    onPackage(std::move(current));
+                    state = State::PackagesSeq;
+                    break;
+                case State::TopKey:
+                    state = State::Done;
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            const PackageCallback &onPackage;
+            std::vector<std::string> &depends;
+            State state = State::Start;
+            State resume = State::Start;
+            size_t skipDepth = 0;
+            bool packagesFound = false;
+            std::string key;
+            PackageInfo current;
+        };
+    } // namespace
+
+    int parsePackageList(std::istream &input, const PackageCallback &onPackage,
+                         std::vector<std::string> &outDepends, std::string &outError)
+    {
+        PackageListHandler handler(onPackage, outDepends);
+        try
+        {
+            YAML::Parser parser(input);
+            parser.HandleNextDocument(handler);
+        }
+        catch (const SchemaError &e)
+        {
+            outError = e.message;
+            return 1;
+        }
+        catch (const YAML::Exception &e)
+        {
+            outError = e.what();
+            return 1;
+        }
+        if (!handler.sawPackages())
+        {
+            outError = "missing 'packages' list";
+            return 1;
+        }
+        return 0;
+    }
+
+    namespace
+    {
+        /// Read a scalar as text; containers read as empty and are skipped by the caller
+        simdjson::error_code jsonText(simdjson::ondemand::value value, std::string &out)
+        {
+            std::string_view text;
+            simdjson::error_code error = value.get_string().get(text);
+            if (error != simdjson::INCORRECT_TYPE)
+            {
+                if (!error)
+                    out.assign(text);
+                return error;
+            }
+            out.clear();
+            simdjson::ondemand::json_type type;
+            if ((error = value.type().get(type)))
+            {
+                return error;
+            }
+            if (type == simdjson::ondemand::json_type::number)
+            {
+                simdjson::ondemand::number number;
+                error = value.get_number().get(number);
+            }
+            else if (type == simdjson::ondemand::json_type::boolean)
+            {
+                bool flag;
+                error = value.get_bool().get(flag);
+            }
+            else
+            {
+                return simdjson::SUCCESS;
+            }
+            if (error)
+            {
+                return error;
+            }
+            // Keep the literal as written, like YAML does for unquoted scalars
+            text = value.raw_json_token();
+            while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\n' || text.back() == '\r'))
+                text.remove_suffix(1);
+            out.assign(text);
+            return simdjson::SUCCESS;
+        }
+
+        /// Append every string of an array; other elements are ignored
+        simdjson::error_code jsonStrings(simdjson::ondemand::value value, std::vector<std::string> &out)
+        {
+            simdjson::ondemand::array array;
+            if (value.get_array().get(array))
+            {
+                return simdjson::SUCCESS; // not an array: ignored, as in YAML
+            }
+            for (auto element : array)
+            {
+                std::string_view text;
+                simdjson::error_code error = element.get_string().get(text);
+                if (error == simdjson::INCORRECT_TYPE)
+                    continue;
+                if (error)
+                    return error;
+                out.emplace_back(text);
+            }
+            return simdjson::SUCCESS;
+        }
+
+        simdjson::error_code jsonPackage(simdjson::ondemand::object object, PackageInfo &pkg)
+        {
+            for (auto field : object)
+            {
+                std::string_view key;
+                simdjson::error_code error = field.unescaped_key().get(key);
+                if (error)
+                    return error;
+                simdjson::ondemand::value value;
+                error = field.value().get(value);
+                if (error)
+                    return error;
+                if (key == "name")
+                    error = jsonText(value, pkg.name);
+                else if (key == "version")
+                    error = jsonText(value, pkg.version);
+                else if (key == "description")
+                    error = jsonText(value, pkg.description);
+                else if (key == "maintainer")
+                    error = jsonText(value, pkg.maintainer);
+                else if (key == "dependencies")
+                    error = jsonStrings(value, pkg.dependencies);
+                else if (key == "tags")
+                    error = jsonText(value, pkg.tags);
+                else if (key == "url")
+                    error = jsonText(value, pkg.url);
+                if (error)
+                    return error;
+            }
+            return simdjson::SUCCESS;
+        }
+    } // namespace
+
+    int parsePackageListJson(std::string &json, const PackageCallback &onPackage,
+                             std::vector<std::string> &outDepends, std::string &outError)
+    {
+        size_t length = json.size();
+        json.reserve(length + simdjson::SIMDJSON_PADDING);
+
+        simdjson::ondemand::parser parser;
+        simdjson::ondemand::document document;
+        simdjson::ondemand::object root;
+        simdjson::error_code error = parser.iterate(json.data(), length, json.capacity()).get(document);
+        if (!error)
+        {
+            error = document.get_object().get(root);
+            if (error == simdjson::INCORRECT_TYPE)
+            {
+                outError = "document is not an object";
+                return 1;
+            }
+        }
+        bool packagesFound = false;
+        if (!error)
+        {
+            for (auto field : root)
+            {
+                std::string_view key;
+                if ((error = field.unescaped_key().get(key)))
+                    break;
+                simdjson::ondemand::value value;
+                if ((error = field.value().get(value)))
+                    break;
+                if (key == "depend")
+                {
+                    error = jsonStrings(value, outDepends);
+                }
+                else if (key == "packages")
+                {
+                    simdjson::ondemand::array packages;
+                    if (value.get_array().get(packages))
+                    {
+                        outError = "'packages' is not an array";
+                        return 1;
+                    }
+                    packagesFound = true;
+                    for (auto element : packages)
+                    {
+                        simdjson::ondemand::object object;
+                        if ((error = element.get_object().get(object)))
+                        {
+                            if (error != simdjson::INCORRECT_TYPE)
+                                break;
+                            error = simdjson::SUCCESS; // stray non-object entry
+                            continue;
+                        }
+                        PackageInfo pkg;
+                        if ((error = jsonPackage(object, pkg)))
+                            break;
+                        OPENSPM_DEBUG("[DEBUG parsePackageListJson] Package: " + pkg.name + " v" + pkg.version);
+                        onPackage(std::move(pkg));
+                    }
+                }
+                if (error)
+                    break;
+            }
+        }
+        if (!error && !document.at_end())
+        {
+            error = simdjson::TRAILING_CONTENT;
+        }
+        if (error)
+        {
+            outError = simdjson::error_message(error);
+            return 1;
+        }
+        if (!packagesFound)
+        {
+            outError = "missing 'packages' list";
+            return 1;
+        }
+        return 0;
+    }
+
+    namespace
+    {
+        void appendJsonString(std::string &out, const std::string &text)
+        {
+            static const char hex[] = "0123456789abcdef";
+            out.push_back('"');
+            for (char c : text)
+            {
+                unsigned char u = static_cast<unsigned char>(c);
+                if (c == '"' || c == '\\')
+                {
+                    out.push_back('\\');
+                    out.push_back(c);
+                }
+                else if (u < 0x20)
+                {
+                    out += "\\u00";
+                    out.push_back(hex[u >> 4]);
+                    out.push_back(hex[u & 0xf]);
+                }
+                else
+                {
+                    out.push_back(c);
+                }
+            }
+            out.push_back('"');
+        }
+    } // namespace
+
+    std::string serializePackageListJson(const std::vector<PackageInfo> &packages, const std::string &repository)
+    {
+        std::string out = "{\"repository\":";
+        appendJsonString(out, repository);
+        out += ",\"packages\":[";
+        for (size_t i = 0; i < packages.size(); ++i)
+        {
+            const PackageInfo &pkg = packages[i];
+            out += i == 0 ? "\n{\"name\":" : ",\n{\"name\":";
+            appendJsonString(out, pkg.name);
+            out += ",\"version\":";
+            appendJsonString(out, pkg.version);
+            out += ",\"description\":";
+            appendJsonString(out, pkg.description);
+            out += ",\"maintainer\":";
+            appendJsonString(out, pkg.maintainer);
+            out += ",\"dependencies\":[";
+            for (size_t d = 0; d < pkg.dependencies.size(); ++d)
+            {
+                if (d != 0)
+                    out.push_back(',');
+                appendJsonString(out, pkg.dependencies[d]);
+            }
+            out += "],\"tags\":";
+            appendJsonString(out, pkg.tags);
+            out += ",\"url\":";
+            appendJsonString(out, pkg.url);
+            out.push_back('}');
+        }
+        out += "\n]}\n";
+        return out;
+    }
+
+    /**
+     * @brief simdjson state reused for every line of a document
+     */
+    class PackageListReader::LineParser
+    {
+    public:
+        simdjson::ondemand::parser parser;
+        std::string buffer; ///< Current line plus the padding simdjson reads past the end
+    };
+
+    PackageListReader::PackageListReader(std::string json) : text(std::move(json)) {}
+
+    PackageListReader::~PackageListReader() = default;
+
+    bool PackageListReader::next(PackageInfo &outPackage)
+    {
+        if (!started)
+        {
+            started = true;
+            constexpr std::string_view Opening = "\"packages\":[";
+            size_t end = text.find('\n');
+            std::string_view header(text.data(), end == std::string::npos ? text.size() : end);
+            if (end != std::string::npos && !header.empty() && header.front() == '{' &&
+                header.size() >= Opening.size() && header.substr(header.size() - Opening.size()) == Opening)
+            {
+                lines.reset(new LineParser());
+                pos = end + 1;
+            }
+            else
+            {
+                OPENSPM_DEBUG("[DEBUG PackageListReader] Not one package per line, parsing the whole document");
+                std::vector<std::string> depends;
+                if (parsePackageListJson(text, [this](PackageInfo &&pkg)
+                                         { whole.push_back(std::move(pkg)); },
+                                         depends, errorMessage) != 0)
+                {
+                    whole.clear();
+                }
+                std::reverse(whole.begin(), whole.end());
+                std::string().swap(text);
+            }
+        }
+        if (!lines)
+        {
+            if (whole.empty())
+            {
+                return false;
+            }
+            outPackage = std::move(whole.back());
+            whole.pop_back();
+            return true;
+        }
+        if (done)
+        {
+            return false;
+        }
+
+        size_t end = text.find('\n', pos);
+        std::string_view line(text.data() + pos, (end == std::string::npos ? text.size() : end) - pos);
+        pos = end == std::string::npos ? text.size() : end + 1;
+        while (!line.empty() && (line.back() == '\r' || line.back() == ','))
+            line.remove_suffix(1);
+        if (line == "]}")
+        {
+            done = true;
+            if (text.find_first_not_of(" \t\r\n", pos) != std::string::npos)
+            {
+                errorMessage = simdjson::error_message(simdjson::TRAILING_CONTENT);
+            }
+            return false;
+        }
+        if (line.empty())
+        {
+            done = true;
+            errorMessage = "unexpected end of document";
+            return false;
+        }
+
+        LineParser &state = *lines;
+        state.buffer.assign(line);
+        state.buffer.reserve(line.size() + simdjson::SIMDJSON_PADDING);
+        simdjson::ondemand::document document;
+        simdjson::ondemand::object object;
+        PackageInfo pkg;
+        simdjson::error_code error = state.parser.iterate(state.buffer.data(), line.size(), state.buffer.capacity()).get(document);
+        if (!error)
+            error = document.get_object().get(object);
+        if (!error)
+            error = jsonPackage(object, pkg);
+        if (!error && !document.at_end())
+            error = simdjson::TRAILING_CONTENT;
+        if (error)
+        {
+            done = true;
+            errorMessage = simdjson::error_message(error);
+            return false;
+        }
+        outPackage = std::move(pkg);
+        return true;
+    }
+
+    /**
+     * @brief Bounded hand-off of downloaded chunks to the parser thread
+     */
+    class PackageListStream::ChunkBuffer : public std::streambuf
+    {
+    public:
+        /// Queue a chunk; false if the reader has stopped
+        bool push(const char *data, size_t size)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            space.wait(lock, [this]
+                       { return pendingBytes < MaxPendingBytes || readerDone; });
+            if (readerDone)
+            {
+                return false;
+            }
+            chunks.emplace_back(data, size);
+            pendingBytes += size;
+            available.notify_one();
+            return true;
+        }
+
+        /// No more chunks will be pushed
+        void close()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+            available.notify_one();
+        }
+
+        /// The reader has finished; drop anything still queued
+        void stopReading()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            readerDone = true;
+            chunks.clear();
+            pendingBytes = 0;
+            space.notify_all();
+        }
+
+    protected:
+        int_type underflow() override
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this]
+                           { return !chunks.empty() || closed; });
+            if (chunks.empty())
+            {
+                return traits_type::eof();
+            }
+            // Keep the tail of the previous chunk so the reader can put characters back
+            size_t keep = std::min<size_t>(PutbackSize, static_cast<size_t>(gptr() - eback()));
+            std::string next;
+            next.reserve(keep + chunks.front().size());
+            next.append(gptr() - keep, keep);
+            next += chunks.front();
+            chunks.pop_front();
+            pendingBytes -= next.size() - keep;
+            space.notify_one();
+            currentChunk.swap(next);
+            char *begin = &currentChunk[0];
+            setg(begin, begin + keep, begin + currentChunk.size());
+            return traits_type::to_int_type(*gptr());
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable available;
+        std::condition_variable space;
+        std::deque<std::string> chunks;
+        std::string currentChunk;
+        size_t pendingBytes = 0;
+        bool closed = false;
+        bool readerDone = false;
+    };
+
+    PackageListStream::PackageListStream(PackageCallback onPackage)
+        : buffer(new ChunkBuffer()), onPackage(std::move(onPackage))
+    {
+        worker = std::thread([this]
+                             {
+                                 std::istream input(buffer.get());
+                                 status = parsePackageList(input, this->onPackage, depends, errorMessage);
+                                 // Trailing data after the document, or a failed parse, needs no reader
+                                 buffer->stopReading(); });
+    }
+
+    PackageListStream::~PackageListStream()
+    {
+        if (worker.joinable())
+        {
+            buffer->close();
+            worker.join();
+        }
+    }
+
+    bool PackageListStream::feed(const char *data, size_t size)
+    {
+        if (size == 0)
+        {
+            return true;
+        }
+        if (buffer->push(data, size))
+        {
+            return true;
+        }
+        // The parser has stopped: fine if it completed, an error otherwise
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+        return status == 0;
+    }
+
+    int PackageListStream::finish(std::vector<std::string> &outDepends, std::string &outError)
+    {
+        buffer->close();
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+        outDepends = std::move(depends);
+        outError = errorMessage;
+        return status;
+    }
+} // namespace openspm
@@ -14,419 +14,630 @@ using ssize_t = SSIZE_T;
 #include <archive.h>
 #include <archive.hpp>
 #include <repository_manager.hpp>
+#include <catalog.hpp>
 #include <config.hpp>
 #include <yaml-cpp/yaml.h>
 #define CPPHTTPLIB_OPENSSL_SUPPORT
 #include <httplib.h>
 #include <utils.hpp>
+#include <extractor.hpp>
+#include <durability.hpp>
+#include <script_runner.hpp>
+#include <triggers.hpp>
+#include <trace.hpp>
+#include <metrics.hpp>
+#include <search_index.hpp>
+#include <name_index.hpp>
+#include <package_list_parser.hpp>
+#include <index_shards.hpp>
+#include <bloom_filter.hpp>
+#include <closure_index.hpp>
+#include <dependents_index.hpp>
+#include <installed_db.hpp>
+#include <resolver.hpp>
+#include <version.hpp>
 #include <indicators/progress_bar.hpp>
 #include <fstream>
 #include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <archive_entry.h>
 namespace openspm
 {
     using namespace logger;
-    int updatePackages()
+    int updatePackages(const std::vector<std::string> &onlyRepos)
     {
-        debug("[DEBUG updatePackages] Starting package update");
+        Catalog catalog;
+        if (catalog.loadRepositories() != 0)
+        {
+            return 1;
+        }
+        return updatePackages(catalog, onlyRepos);
+    }
+
+    int updatePackages(Catalog &catalog, const std::vector<std::string> &onlyRepos)
+    {
+        trace::Span span("updatePackages", "update");
+        OPENSPM_DEBUG("[DEBUG updatePackages] Starting package update");
         Archive *dataArchive = getDataArchive();
-        debug("[DEBUG updatePackages] Archive pointer: " + std::to_string((long)dataArchive));
+        OPENSPM_DEBUG("[DEBUG updatePackages] Archive pointer: " + std::to_string((long)dataArchive));
 
-        std::vector<std::string> repoList = getRepositoryList();
-        debug("[DEBUG updatePackages] Found " + std::to_string(repoList.size()) + " repositories");
+        std::vector<std::string> repoList = catalog.repositoryUrls();
+        OPENSPM_DEBUG("[DEBUG updatePackages] Found " + std::to_string(repoList.size()) + " repositories");
 
         if (repoList.empty())
         {
             warn("No repositories found. Cannot update packages.");
             return 1;
         }
+        for (const auto &url : onlyRepos)
+        {
+            if (std::find(repoList.begin(), repoList.end(), url) == repoList.end())
+            {
+                error("Repository not found: " + url);
+                return 1;
+            }
+        }
 
-        std::unordered_map<std::string, PackageInfo> packageMap;
-        std::vector<PackageInfo> allPackages;
+        // Shards are read once up front: unchanged ones are needed for the merge anyway
+        ShardManifest manifest;
+        std::map<std::string, std::string> shardContents;
+        {
+            trace::Span readSpan("readShards", "update");
+            std::map<std::string, std::string> manifestFile;
+            dataArchive->readFiles({ShardManifestFile}, manifestFile);
+            if (!manifestFile.empty() && parseShardManifest(manifestFile[ShardManifestFile], manifest) != 0)
+            {
+                warn("Package index manifest is invalid. Refetching all repositories.");
+                manifest.clear();
+            }
+            std::vector<std::string> shardFiles;
+            for (const auto &[url, info] : manifest)
+            {
+                shardFiles.push_back(info.file);
+            }
+            dataArchive->readFiles(shardFiles, shardContents);
+            for (auto it = manifest.begin(); it != manifest.end();)
+            {
+                if (shardContents.find(it->second.file) == shardContents.end())
+                    it = manifest.erase(it);
+                else
+                    ++it;
+            }
+        }
 
-        size_t repoIndex = 0;
-        for (const auto &repoUrl : repoList)
+        bool fullUpdate = onlyRepos.empty();
+        if (!fullUpdate && manifest.empty())
         {
-            debug("[DEBUG updatePackages] Repository: " + repoUrl);
+            log("\033[0;36mNo per-repository index yet; updating all repositories.");
+            fullUpdate = true;
+        }
+        std::deque<std::string> pending(fullUpdate ? repoList.begin() : onlyRepos.begin(),
+                                        fullUpdate ? repoList.end() : onlyRepos.end());
+        std::set<std::string> visited;
+        std::map<std::string, std::vector<PackageInfo>> freshShards;
+        std::map<std::string, std::string> writes;
+        size_t unchanged = 0;
+        size_t failed = 0;
+        long long now = static_cast<long long>(std::time(nullptr));
 
-            RepositoryInfo repoInfo;
-            bool infoStatus = getRepositoryInfo(repoUrl, repoInfo);
-            if (!infoStatus)
+        while (!pending.empty())
+        {
+            std::string repoUrl = pending.front();
+            pending.pop_front();
+            if (!visited.insert(repoUrl).second)
             {
-                error("Failed to get repository info: " + repoUrl);
                 continue;
             }
-            debug("[DEBUG updatePackages] Repository info retrieved: " + repoInfo.name);
+            OPENSPM_DEBUG("[DEBUG updatePackages] Repository: " + repoUrl);
+            auto cachedIt = manifest.find(repoUrl);
+            const ShardInfo *cached = cachedIt != manifest.end() ? &cachedIt->second : nullptr;
 
-            std::vector<PackageInfo> repoPackages;
-            int fetchStatus = fetchPackageListFromRepository(repoUrl, repoPackages);
-            if (fetchStatus != 0)
+            bool configured = std::find(repoList.begin(), repoList.end(), repoUrl) != repoList.end();
+            bool ok = true;
+            if (configured)
             {
-                warn("\033[0;33mFailed to fetch packages from repository: " + repoUrl + ". Skipping.");
-                continue;
+                RepositoryInfo repoInfo;
+                const RepositoryInfo *cachedInfo = catalog.findRepository(repoUrl);
+                if (cachedInfo != nullptr && validateRepositoryInfo(*cachedInfo))
+                {
+                    metrics::add("openspm_cache_requests_total", 1, {{"cache", "repository_info"}, {"result", "hit"}});
+                }
+                else if (fetchRepositoryInfo(repoUrl, repoInfo))
+                {
+                    if (cachedInfo != nullptr)
+                    {
+                        // Local settings aren't part of the fetched metadata
+                        repoInfo.priority = cachedInfo->priority;
+                        repoInfo.pins = cachedInfo->pins;
+                    }
+                    catalog.setRepository(repoInfo);
+                    metrics::add("openspm_cache_requests_total", 1, {{"cache", "repository_info"}, {"result", "miss"}});
+                }
+                else
+                {
+                    error("Failed to get repository info: " + repoUrl);
+                    ok = false;
+                }
+            }
+            else
+            {
+                log("\033[0;36mProcessing dependency: " + repoUrl);
             }
 
-            debug("[DEBUG updatePackages] Fetched " + std::to_string(repoPackages.size()) + " packages from this repository");
+            PackageListFetch fetched;
+            if (ok && fetchPackageList(repoUrl, cached, fetched) != 0)
+            {
+                ok = false;
+            }
+            if (ok && fetched.notModified && cached == nullptr)
+            {
+                // A 304 nobody asked for; there is nothing to keep
+                ok = false;
+            }
 
-            for (const auto &pkg : repoPackages)
+            if (!ok)
+            {
+                failed++;
+                warn(cached != nullptr
+                         ? "\033[0;33mFailed to fetch packages from repository: " + repoUrl + ". Keeping the previous index."
+                         : "\033[0;33mFailed to fetch packages from repository: " + repoUrl + ". Skipping.");
+                if (cached != nullptr)
+                {
+                    pending.insert(pending.end(), cached->depend.begin(), cached->depend.end());
+                }
+                continue;
+            }
+            if (fetched.notModified)
             {
-                debug("[DEBUG updatePackages] Adding package to map: " + pkg.name);
-                packageMap[pkg.name] = pkg;
+                OPENSPM_DEBUG("[DEBUG updatePackages] Not modified: " + repoUrl);
+                metrics::add("openspm_cache_requests_total", 1, {{"cache", "package_list"}, {"result", "hit"}});
+                unchanged++;
+                pending.insert(pending.end(), cached->depend.begin(), cached->depend.end());
+                continue;
             }
-            repoIndex++;
-        }
+            metrics::add("openspm_cache_requests_total", 1, {{"cache", "package_list"}, {"result", "miss"}});
+            OPENSPM_DEBUG("[DEBUG updatePackages] Fetched " + std::to_string(fetched.packages.size()) + " packages from this repository");
 
-        debug("[DEBUG updatePackages] Total unique packages in map: " + std::to_string(packageMap.size()));
+            std::stable_sort(fetched.packages.begin(), fetched.packages.end(),
+                             [](const PackageInfo &a, const PackageInfo &b)
+                             { return a.name < b.name; });
+            ShardInfo &info = manifest[repoUrl];
+            info.url = repoUrl;
+            info.file = shardFileName(repoUrl);
+            info.source = fetched.source;
+            info.etag = fetched.etag;
+            info.lastModified = fetched.lastModified;
+            info.updated = now;
+            info.packages = fetched.packages.size();
+            info.depend = fetched.depend;
+            writes[info.file] = serializePackageListJson(fetched.packages, repoUrl);
+            shardContents.erase(info.file);
+            freshShards[repoUrl] = std::move(fetched.packages);
+            pending.insert(pending.end(), fetched.depend.begin(), fetched.depend.end());
+        }
 
-        for (const auto &[_, pkg] : packageMap)
+        std::vector<std::string> removals;
+        if (fullUpdate)
         {
-            debug("[DEBUG updatePackages] Package in final list: " + pkg.name);
-            allPackages.push_back(pkg);
+            // Shards of repositories that are no longer configured or depended on
+            std::vector<std::string> reachable = shardMergeOrder(repoList, manifest);
+            for (auto it = manifest.begin(); it != manifest.end();)
+            {
+                if (std::find(reachable.begin(), reachable.end(), it->first) == reachable.end())
+                {
+                    OPENSPM_DEBUG("[DEBUG updatePackages] Dropping unused shard: " + it->first);
+                    removals.push_back(it->second.file);
+                    it = manifest.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
         }
-        log("\033[0;32mFound " + std::to_string(allPackages.size()) + " packages");
-        log("\033[0;36mBuilding package database...");
-        debug("[DEBUG updatePackages] Building YAML...");
-        YAML::Emitter out;
-
-        out << YAML::BeginMap;
-        out << YAML::Key << "packages";
-        out << YAML::Value << YAML::BeginSeq;
 
-        for (const auto &pkg : allPackages)
+        std::string summary = std::to_string(freshShards.size()) + " updated, " + std::to_string(unchanged) +
+                              " unchanged, " + std::to_string(failed) + " failed";
+        if (writes.empty() && removals.empty())
         {
-            out << YAML::BeginMap;
-            out << YAML::Key << "name" << YAML::Value << pkg.name;
-            out << YAML::Key << "version" << YAML::Value << pkg.version;
-            out << YAML::Key << "description" << YAML::Value << pkg.description;
-            out << YAML::Key << "maintainer" << YAML::Value << pkg.maintainer;
-
-            out << YAML::Key << "dependencies" << YAML::Value << YAML::BeginSeq;
-            for (const auto &dep : pkg.dependencies)
+            if (unchanged == 0 && failed > 0)
             {
-                out << dep;
+                error("\033[0;31mFailed to update packages from any repository.");
+                return 1;
             }
-            out << YAML::EndSeq;
-
-            out << YAML::Key << "tags" << YAML::Value << pkg.tags;
-            out << YAML::Key << "url" << YAML::Value << pkg.url;
-            out << YAML::EndMap;
+            log("\033[0;32mPackages list is up to date (" + summary + ")");
+            return 0;
         }
 
-        out << YAML::EndSeq;
-        out << YAML::EndMap;
-        std::string data = out.c_str();
-
-        debug("[DEBUG updatePackages] YAML data length: " + std::to_string(data.length()) + " bytes");
-        debug("[DEBUG updatePackages] Writing to archive...");
+        std::vector<RepositoryInfo> repos;
+        for (const auto &url : repoList)
+        {
+            repos.push_back(*catalog.findRepository(url));
+        }
+        std::vector<std::string> order = shardMergeOrder(repoList, manifest);
+        std::vector<ShardPolicy> policies = shardPolicies(order, repos, manifest);
+        // Filters cover every name a shard offers, including the ones that lose the merge
+        std::map<std::string, std::vector<std::string>> shardNames;
+        std::vector<MergeSource> shards;
+        for (size_t s = 0; s < order.size(); ++s)
+        {
+            const std::string &url = order[s];
+            MergeSource source;
+            auto freshIt = freshShards.find(url);
+            if (freshIt != freshShards.end())
+            {
+                source = packageSource(std::move(freshIt->second), policies[s]);
+            }
+            else
+            {
+                auto reader = std::make_shared<PackageListReader>(std::move(shardContents[manifest[url].file]));
+                source.policy = policies[s];
+                source.next = [reader, url](PackageInfo &pkg)
+                {
+                    if (reader->next(pkg))
+                    {
+                        return true;
+                    }
+                    if (!reader->error().empty())
+                    {
+                        warn("\033[0;33mStored index for " + url + " is corrupt (" + reader->error() + "). Skipping the rest of it.");
+                    }
+                    return false;
+                };
+            }
+            source.url = url;
+            std::vector<std::string> &names = shardNames[url];
+            source.next = [next = std::move(source.next), &names](PackageInfo &pkg)
+            {
+                if (!next(pkg))
+                {
+                    return false;
+                }
+                if (names.empty() || names.back() != pkg.name)
+                {
+                    names.push_back(pkg.name);
+                }
+                return true;
+            };
+            shards.push_back(std::move(source));
+        }
+        std::vector<PackageInfo> allPackages;
+        {
+            trace::Span mergeSpan("mergeShards", "update");
+            allPackages = mergeShards(std::move(shards));
+            mergeSpan.setItems(allPackages.size());
+        }
+        BloomFilterSet filters;
+        for (const auto &[url, names] : shardNames)
+        {
+            filters[url] = BloomFilter::build(std::vector<std::string_view>(names.begin(), names.end()));
+        }
+        log("\033[0;32mFound " + std::to_string(allPackages.size()) + " package versions");
+        log("\033[0;36mBuilding package database...");
+        span.setItems(allPackages.size());
 
-        int writeStatus = dataArchive->writeFile("packages.yaml", data);
+        {
+            trace::Span searchSpan("buildSearchIndex", "update");
+            writes[SearchIndexFile] = buildSearchIndex(allPackages);
+            searchSpan.setBytes(writes[SearchIndexFile].size());
+        }
+        {
+            trace::Span closureSpan("buildClosureIndex", "update");
+            writes[ClosureIndexFile] = buildClosureIndex(allPackages);
+            closureSpan.setBytes(writes[ClosureIndexFile].size());
+        }
+        {
+            trace::Span dependentsSpan("buildDependentsIndex", "update");
+            writes[DependentsIndexFile] = buildDependentsIndex(allPackages);
+            dependentsSpan.setBytes(writes[DependentsIndexFile].size());
+        }
+        writes[ShardManifestFile] = serializeShardManifest(manifest);
+        writes[ShardFilterFile] = serializeBloomFilters(filters);
+        // Superseded by the shards
+        removals.push_back("packages.yaml");
+        OPENSPM_DEBUG("[DEBUG updatePackages] Writing " + std::to_string(writes.size()) + " files to archive...");
+        int writeStatus = dataArchive->writeFiles(writes, removals);
         if (writeStatus != 0)
         {
             error("\033[0;31mFailed to write to archive! Status: " + std::to_string(writeStatus));
             return 1;
         }
 
-        debug("[DEBUG updatePackages] Write successful!");
-        log("\033[0;32mSuccessfully updated packages list");
+        std::vector<std::string> packageNames;
+        packageNames.reserve(allPackages.size());
+        for (const auto &pkg : allPackages)
+        {
+            // Versions of a name are adjacent
+            if (packageNames.empty() || packageNames.back() != pkg.name)
+            {
+                packageNames.push_back(pkg.name);
+            }
+        }
+        if (writeNameIndex(std::move(packageNames), repoList) != 0)
+        {
+            warn("Shell completion index could not be updated.");
+        }
+
+        metrics::set("openspm_packages_indexed", static_cast<double>(allPackages.size()));
+        catalog.setPackages(std::move(allPackages));
+        ClosureIndex closures;
+        if (closures.load(writes[ClosureIndexFile]) == 0)
+        {
+            catalog.setClosureIndex(std::move(closures));
+        }
+        OPENSPM_DEBUG("[DEBUG updatePackages] Write successful!");
+        log("\033[0;32mSuccessfully updated packages list (" + summary + ")");
         return 0;
     }
 
-    int fetchPackageListFromRepository(const std::string &repoUrl, std::vector<PackageInfo> &outPackages)
+    int fetchPackageList(const std::string &repoUrl, const ShardInfo *cached, PackageListFetch &out)
     {
-        debug("[DEBUG fetchPackageListFromRepository] Fetching from: " + repoUrl);
+        trace::Span span("fetchPackageList", "update");
+        span.setDetail(repoUrl);
+        OPENSPM_DEBUG("[DEBUG fetchPackageList] Fetching from: " + repoUrl);
         auto parsed = parse_url(repoUrl);
-        debug("[DEBUG fetchPackageListFromRepository] Parsed URL - scheme: " + parsed.scheme + ", host: " + parsed.host + ", path: " + parsed.path);
+        OPENSPM_DEBUG("[DEBUG fetchPackageList] Parsed URL - scheme: " + parsed.scheme + ", host: " + parsed.host + ", path: " + parsed.path);
 
-        httplib::Client *cli = nullptr;
-        httplib::SSLClient *sslCli = nullptr;
+        std::unique_ptr<httplib::Client> cli;
+        std::unique_ptr<httplib::SSLClient> sslCli;
         bool useSSL = false;
         if (parsed.scheme == "https")
         {
-            debug("[DEBUG fetchPackageListFromRepository] Using HTTPS");
+            OPENSPM_DEBUG("[DEBUG fetchPackageList] Using HTTPS");
             if (parsed.port > 0)
-                sslCli = new httplib::SSLClient(parsed.host, parsed.port);
+                sslCli.reset(new httplib::SSLClient(parsed.host, parsed.port));
             else
-                sslCli = new httplib::SSLClient(parsed.host);
+                sslCli.reset(new httplib::SSLClient(parsed.host));
             useSSL = true;
         }
         else
         {
-            debug("[DEBUG fetchPackageListFromRepository] Using HTTP");
+            OPENSPM_DEBUG("[DEBUG fetchPackageList] Using HTTP");
             if (parsed.port > 0)
-                cli = new httplib::Client(parsed.host, parsed.port);
+                cli.reset(new httplib::Client(parsed.host, parsed.port));
             else
-                cli = new httplib::Client(parsed.host);
+                cli.reset(new httplib::Client(parsed.host));
         }
 
-        std::string fullUrl = parsed.scheme + "://" + parsed.host;
+        std::string baseUrl = parsed.scheme + "://" + parsed.host;
         if (parsed.port > 0)
         {
-            fullUrl += ":" + std::to_string(parsed.port);
+            baseUrl += ":" + std::to_string(parsed.port);
         }
-        fullUrl += parsed.path + "/pkg-list.yaml";
+        baseUrl += parsed.path;
 
-        if (useSSL)
+        // Validators only apply to the document they were captured from
+        auto conditionalHeaders = [cached](const std::string &source)
         {
-            debug("[DEBUG fetchPackageListFromRepository] Making HTTPS request");
-            auto res = sslCli->Get((parsed.path + "/pkg-list.yaml").c_str());
-            if (res && res->status == 200)
+            httplib::Headers headers;
+            if (cached != nullptr && cached->source == source)
             {
-                logHttpRequest("GET", fullUrl, res->status);
-                debug("[DEBUG fetchPackageListFromRepository] Request successful, response size: " + std::to_string(res->body.size()) + " bytes");
-
-                debug("[DEBUG fetchPackageListFromRepository] Parsing YAML");
-                YAML::Node root = YAML::Load(res->body);
-
-                const YAML::Node &dependNode = root["depend"];
-                if (dependNode && dependNode.IsSequence())
-                {
-                    debug("[DEBUG fetchPackageListFromRepository] Found " + std::to_string(dependNode.size()) + " dependencies");
-                    for (const auto &dep : dependNode)
-                    {
-                        std::string depUrl = dep.as<std::string>();
-                        log("\033[0;36mProcessing dependency: " + depUrl);
-                        debug("[DEBUG fetchPackageListFromRepository] Processing dependency: " + depUrl);
-                        std::vector<PackageInfo> depPackages;
-                        int depStatus = fetchPackageListFromRepository(depUrl, depPackages);
-                        if (depStatus != 0)
-                        {
-                            warn("\033[0;33mFailed to fetch dependent repository: " + depUrl + ". Skipping.");
-                            continue;
-                        }
-                        debug("[DEBUG fetchPackageListFromRepository] Added " + std::to_string(depPackages.size()) + " packages from dependency");
-                        outPackages.insert(outPackages.end(), depPackages.begin(), depPackages.end());
-                    }
-                }
-
-                const YAML::Node &packages = root["packages"];
-                if (!packages || !packages.IsSequence())
-                {
-                    error("\033[0;31mInvalid package index format in repository: " + repoUrl);
-                    delete sslCli;
-                    return 1;
-                }
-
-                debug("[DEBUG fetchPackageListFromRepository] Found " + std::to_string(packages.size()) + " packages");
-                for (const auto &node : packages)
-                {
-                    PackageInfo pkg;
-                    pkg.name = node["name"] ? node["name"].as<std::string>() : "";
-                    pkg.version = node["version"] ? node["version"].as<std::string>() : "";
-                    pkg.description = node["description"] ? node["description"].as<std::string>() : "";
-                    pkg.maintainer = node["maintainer"] ? node["maintainer"].as<std::string>() : "";
-
-                    if (node["dependencies"] && node["dependencies"].IsSequence())
-                    {
-                        for (const auto &depNode : node["dependencies"])
-                        {
-                            pkg.dependencies.push_back(depNode.as<std::string>());
-                        }
-                    }
-
-                    pkg.tags = node["tags"] ? node["tags"].as<std::string>() : "";
-                    pkg.url = node["url"] ? node["url"].as<std::string>() : "";
-
-                    debug("[DEBUG fetchPackageListFromRepository] Package: " + pkg.name + " v" + pkg.version);
-                    outPackages.push_back(std::move(pkg));
-                }
-                delete sslCli;
-                debug("[DEBUG fetchPackageListFromRepository] Successfully fetched " + std::to_string(outPackages.size()) + " total packages");
-                return 0;
+                if (!cached->etag.empty())
+                    headers.emplace("If-None-Match", cached->etag);
+                if (!cached->lastModified.empty())
+                    headers.emplace("If-Modified-Since", cached->lastModified);
             }
-            else
+            return headers;
+        };
+        auto collect = [&out](PackageInfo &&pkg)
+        { out.packages.push_back(std::move(pkg)); };
+
+        // Prefer pkg-list.json: it is read whole, but parsing it is far cheaper than YAML
+        {
+            OPENSPM_DEBUG("[DEBUG fetchPackageList] Requesting pkg-list.json");
+            trace::Span getSpan("GET pkg-list.json", "http");
+            std::string jsonPath = parsed.path + "/pkg-list.json";
+            httplib::Headers headers = conditionalHeaders("json");
+            auto res = useSSL ? sslCli->Get(jsonPath.c_str(), headers) : cli->Get(jsonPath.c_str(), headers);
+            getSpan.setBytes(res ? res->body.size() : 0);
+            getSpan.end();
+            logHttpRequest("GET", baseUrl + "/pkg-list.json", res ? res->status : 0);
+            if (res && res->status == 304)
             {
-                logHttpRequest("GET", fullUrl, res ? res->status : 0);
-                debug("[DEBUG fetchPackageListFromRepository] Request failed");
-                delete sslCli;
-                return 1;
+                out.notModified = true;
+                return 0;
             }
-        }
-        else
-        {
-            debug("[DEBUG fetchPackageListFromRepository] Making HTTP request");
-            auto res = cli->Get((parsed.path + "/pkg-list.yaml").c_str());
             if (res && res->status == 200)
             {
-                logHttpRequest("GET", fullUrl, res->status);
-                debug("[DEBUG fetchPackageListFromRepository] Request successful, response size: " + std::to_string(res->body.size()) + " bytes");
-
-                debug("[DEBUG fetchPackageListFromRepository] Parsing YAML");
-                YAML::Node root = YAML::Load(res->body);
-
-                const YAML::Node &dependNode = root["depend"];
-                if (dependNode && dependNode.IsSequence())
+                trace::Span parseSpan("parseJson", "update");
+                parseSpan.setBytes(res->body.size());
+                std::string parseError;
+                if (parsePackageListJson(res->body, collect, out.depend, parseError) == 0)
                 {
-                    debug("[DEBUG fetchPackageListFromRepository] Found " + std::to_string(dependNode.size()) + " dependencies");
-                    for (const auto &dep : dependNode)
-                    {
-                        std::string depUrl = dep.as<std::string>();
-                        log("Processing dependency: " + depUrl);
-                        debug("[DEBUG fetchPackageListFromRepository] Processing dependency: " + depUrl);
-                        std::vector<PackageInfo> depPackages;
-                        int depStatus = fetchPackageListFromRepository(depUrl, depPackages);
-                        if (depStatus != 0)
-                        {
-                            warn("Failed to fetch dependent repository: " + depUrl + ". Skipping.");
-                            continue;
-                        }
-                        debug("[DEBUG fetchPackageListFromRepository] Added " + std::to_string(depPackages.size()) + " packages from dependency");
-                        outPackages.insert(outPackages.end(), depPackages.begin(), depPackages.end());
-                    }
+                    out.source = "json";
+                    out.etag = res->get_header_value("ETag");
+                    out.lastModified = res->get_header_value("Last-Modified");
+                    OPENSPM_DEBUG("[DEBUG fetchPackageList] Parsed " + std::to_string(out.packages.size()) + " packages");
+                    return 0;
                 }
-
-                const YAML::Node &packages = root["packages"];
-                if (!packages || !packages.IsSequence())
-                {
-                    error("Invalid package index format in repository: " + repoUrl);
-                    delete cli;
-                    return 1;
-                }
-
-                debug("[DEBUG fetchPackageListFromRepository] Found " + std::to_string(packages.size()) + " packages");
-                for (const auto &node : packages)
-                {
-                    PackageInfo pkg;
-                    pkg.name = node["name"] ? node["name"].as<std::string>() : "";
-                    pkg.version = node["version"] ? node["version"].as<std::string>() : "";
-                    pkg.description = node["description"] ? node["description"].as<std::string>() : "";
-                    pkg.maintainer = node["maintainer"] ? node["maintainer"].as<std::string>() : "";
-
-                    if (node["dependencies"] && node["dependencies"].IsSequence())
-                    {
-                        for (const auto &depNode : node["dependencies"])
-                        {
-                            pkg.dependencies.push_back(depNode.as<std::string>());
-                        }
-                    }
-
-                    pkg.tags = node["tags"] ? node["tags"].as<std::string>() : "";
-                    pkg.url = node["url"] ? node["url"].as<std::string>() : "";
-
-                    debug("[DEBUG fetchPackageListFromRepository] Package: " + pkg.name + " v" + pkg.version);
-                    outPackages.push_back(std::move(pkg));
-                }
-                delete cli;
-                debug("[DEBUG fetchPackageListFromRepository] Successfully fetched " + std::to_string(outPackages.size()) + " total packages");
-                return 0;
+                warn("\033[0;33mInvalid pkg-list.json in repository: " + repoUrl + " (" + parseError + "). Using pkg-list.yaml.");
+                out.packages.clear();
+                out.depend.clear();
             }
-            else
+        }
+
+        // Records are parsed as the body arrives; nothing holds the whole document
+        PackageListStream parser(collect);
+        int status = 0;
+        size_t received = 0;
+        auto onResponse = [&status, &out](const httplib::Response &response)
+        {
+            status = response.status;
+            out.etag = response.get_header_value("ETag");
+            out.lastModified = response.get_header_value("Last-Modified");
+            return true;
+        };
+        auto onContent = [&](const char *data, size_t len)
+        {
+            if (status != 200)
             {
-                logHttpRequest("GET", fullUrl, res ? res->status : 0);
-                debug("[DEBUG fetchPackageListFromRepository] Request failed");
-                delete cli;
-                return 1;
+                return true;
             }
-        }
-    }
+            received += len;
+            return parser.feed(data, len);
+        };
 
-    int listPackages(std::vector<PackageInfo> &outPackages)
-    {
-        debug("[DEBUG listPackages] Starting package list");
-        Archive *dataArchive = getDataArchive();
-        debug("[DEBUG listPackages] Getting archive pointer: " + std::to_string((long)dataArchive));
+        trace::Span getSpan("GET pkg-list.yaml", "http");
+        std::string yamlPath = parsed.path + "/pkg-list.yaml";
+        httplib::Headers headers = conditionalHeaders("yaml");
+        httplib::Result res;
+        if (useSSL)
+        {
+            OPENSPM_DEBUG("[DEBUG fetchPackageList] Making HTTPS request");
+            res = sslCli->Get(yamlPath.c_str(), headers, onResponse, onContent);
+        }
+        else
+        {
+            OPENSPM_DEBUG("[DEBUG fetchPackageList] Making HTTP request");
+            res = cli->Get(yamlPath.c_str(), headers, onResponse, onContent);
+        }
+        std::string parseError;
+        int parseStatus = parser.finish(out.depend, parseError);
+        getSpan.setBytes(received);
+        getSpan.end();
+        logHttpRequest("GET", baseUrl + "/pkg-list.yaml", status);
 
-        std::string packagesFileContent;
-        debug("[DEBUG listPackages] Reading packages.yaml from archive...");
-        int status = dataArchive->readFile("packages.yaml", packagesFileContent);
-        if (status != 0)
+        if (status == 304)
+        {
+            out.notModified = true;
+            out.packages.clear();
+            out.depend.clear();
+            return 0;
+        }
+        if (status != 200)
         {
-            error("Failed to read installed packages list.");
+            OPENSPM_DEBUG("[DEBUG fetchPackageList] Request failed");
             return 1;
         }
-
-        debug("[DEBUG listPackages] Read " + std::to_string(packagesFileContent.length()) + " bytes");
-        debug("[DEBUG listPackages] Parsing YAML");
-
-        YAML::Node root = YAML::Load(packagesFileContent);
-        const YAML::Node &packages = root["packages"];
-        if (!packages || !packages.IsSequence())
+        if (parseStatus != 0)
         {
-            error("Invalid installed packages list format.");
+            error("\033[0;31mInvalid package index format in repository: " + repoUrl + " (" + parseError + ")");
             return 1;
         }
-
-        debug("[DEBUG listPackages] Found " + std::to_string(packages.size()) + " packages in YAML");
-
-        for (const auto &node : packages)
+        if (!res)
         {
-            PackageInfo pkg;
-            pkg.name = node["name"] ? node["name"].as<std::string>() : "";
-            pkg.version = node["version"] ? node["version"].as<std::string>() : "";
-            pkg.description = node["description"] ? node["description"].as<std::string>() : "";
-            pkg.maintainer = node["maintainer"] ? node["maintainer"].as<std::string>() : "";
-
-            if (node["dependencies"] && node["dependencies"].IsSequence())
-            {
-                for (const auto &depNode : node["dependencies"])
-                {
-                    pkg.dependencies.push_back(depNode.as<std::string>());
-                }
-            }
-
-            pkg.tags = node["tags"] ? node["tags"].as<std::string>() : "";
-            pkg.url = node["url"] ? node["url"].as<std::string>() : "";
-
-            debug("[DEBUG listPackages] Package: " + pkg.name + " v" + pkg.version);
-            outPackages.push_back(std::move(pkg));
+            error("\033[0;31mDownload of package index interrupted: " + repoUrl);
+            return 1;
         }
+        out.source = "yaml";
+        OPENSPM_DEBUG("[DEBUG fetchPackageList] Request successful, " + std::to_string(received) + " bytes, " +
+                      std::to_string(out.packages.size()) + " packages, " + std::to_string(out.depend.size()) + " dependencies");
+        return 0;
+    }
 
-        debug("[DEBUG listPackages] Total packages added to output: " + std::to_string(outPackages.size()));
+    int listPackages(std::vector<PackageInfo> &outPackages)
+    {
+        OPENSPM_DEBUG("[DEBUG listPackages] Starting package list");
+        if (loadMergedPackages(outPackages) != 0)
+        {
+            return 1;
+        }
+        OPENSPM_DEBUG("[DEBUG listPackages] Total packages added to output: " + std::to_string(outPackages.size()));
         return 0;
     }
 
     int collectDependencies(const std::string &packageName, std::vector<PackageInfo> &collectedPackages)
     {
-        std::vector<PackageInfo> packages;
-        int status = listPackages(packages);
+        Catalog catalog;
+        int status = catalog.loadPackagesFor(packageName);
         if (status != 0)
         {
             error("Failed to list packages for dependency collection.");
             return 1;
         }
-        return subCollectDependencies(packageName, collectedPackages, packages);
+        return collectDependencies(catalog, packageName, collectedPackages);
     }
-    int subCollectDependencies(const std::string &packageName, std::vector<PackageInfo> &collectedPackages, std::vector<PackageInfo> packages)
+    int collectDependencies(const Catalog &catalog, const std::string &packageName, std::vector<PackageInfo> &collectedPackages)
     {
-        for (const auto &pkg : packages)
+        return collectDependencies(catalog, packageName, getConfig()->supported_tags, collectedPackages);
+    }
+    int collectDependencies(const Catalog &catalog, const std::string &packageName, const std::string &supportedTags,
+                            std::vector<PackageInfo> &collectedPackages)
+    {
+        trace::Span span("resolve", "resolve");
+        span.setDetail(packageName);
+        std::vector<std::string_view> plan;
+        if (catalog.closures().lookup(packageName, plan) == ClosureIndex::Result::Found)
         {
-            if (pkg.name == packageName)
+            OPENSPM_DEBUG("[DEBUG collectDependencies] Using precomputed closure of " + std::to_string(plan.size()) + " packages");
+            std::vector<PackageInfo> planned;
+            planned.reserve(plan.size());
+            bool complete = true;
+            for (std::string_view name : plan)
             {
-                debug("[DEBUG subCollectDependencies] Found package: " + pkg.name);
-                bool compatible = areTagsCompatible(getConfig()->supported_tags, pkg.tags);
-                if (!compatible)
+                const PackageInfo *pkg = catalog.findPackage(std::string(name));
+                // Missing from the loaded packages, or an older version may still fit the system
+                if (pkg == nullptr || !areTagsCompatible(supportedTags, pkg->tags))
                 {
-                    error("Package " + pkg.name + " is not compatible with the system tags.");
-                    return 1;
+                    complete = false;
+                    break;
                 }
-                debug("[DEBUG subCollectDependencies] Package is compatible");
-                for (const auto &depName : pkg.dependencies)
+                planned.push_back(*pkg);
+            }
+            // The plan follows newest versions; any unmet constraint needs the resolver
+            for (size_t i = 0; i < planned.size() && complete; ++i)
+            {
+                for (const auto &spec : planned[i].dependencies)
                 {
-                    bool alreadyCollected = false;
-                    for (const auto &collectedPkg : collectedPackages)
+                    Dependency dep;
+                    std::string parseError;
+                    const PackageInfo *target = nullptr;
+                    if (parseDependency(spec, dep, parseError) != 0 ||
+                        (!dep.range.any() && ((target = catalog.findPackage(dep.name)) == nullptr ||
+                                              !dep.range.contains(catalog.versionOf(*target)))))
                     {
-                        if (collectedPkg.name == depName)
-                        {
-                            alreadyCollected = true;
-                            break;
-                        }
+                        complete = false;
+                        break;
                     }
+                }
+            }
+            if (complete)
+            {
+                for (auto &pkg : planned)
+                {
+                    bool alreadyCollected = std::any_of(collectedPackages.begin(), collectedPackages.end(),
+                                                        [&pkg](const PackageInfo &collected)
+                                                        { return collected.name == pkg.name; });
                     if (!alreadyCollected)
                     {
-                        debug("[DEBUG subCollectDependencies] Collecting dependency: " + depName);
-                        int status = subCollectDependencies(depName, collectedPackages, packages);
-                        if (status != 0)
-                        {
-                            return status;
-                        }
+                        collectedPackages.push_back(std::move(pkg));
                     }
                 }
-                collectedPackages.push_back(pkg);
-                debug("[DEBUG subCollectDependencies] Added package to collected list: " + pkg.name);
+                span.setItems(collectedPackages.size());
                 return 0;
             }
         }
-        error("Package not found: " + packageName);
-        return 1;
+        ResolveResult result;
+        int status = resolveDependencies(catalog, {Dependency{packageName, VersionRange()}}, supportedTags, result);
+        if (status != 0)
+        {
+            for (const auto &line : result.explanation)
+            {
+                error(line);
+            }
+            return status;
+        }
+        for (auto &pkg : result.plan)
+        {
+            bool alreadyCollected = std::any_of(collectedPackages.begin(), collectedPackages.end(),
+                                                [&pkg](const PackageInfo &collected)
+                                                { return collected.name == pkg.name; });
+            if (!alreadyCollected)
+            {
+                collectedPackages.push_back(std::move(pkg));
+            }
+        }
+        span.setItems(collectedPackages.size());
+        return 0;
     }
     int askInstallationConfirmation(std::vector<PackageInfo> packages)
     {
@@ -437,6 +648,7 @@ namespace openspm
         }
         log("\033[0;33mDo you want to proceed? (\033[0;32my\033[0;33m/\033[0;31mn\033[0;33m): ");
         char response;
+        flush();
         std::cin >> response;
         if (response == 'y' || response == 'Y')
         {
@@ -455,15 +667,17 @@ namespace openspm
         httplib::SSLClient *sslCli = nullptr;
         for (const auto &targetPackage : packages)
         {
-            debug("[DEBUG collectPackages] Collecting packages");
-            debug("[DEBUG collectPackages] Found package: " + targetPackage.name + " v" + targetPackage.version);
+            trace::Span span("download", "download");
+            span.setDetail(targetPackage.name);
+            OPENSPM_DEBUG("[DEBUG collectPackages] Collecting packages");
+            OPENSPM_DEBUG("[DEBUG collectPackages] Found package: " + targetPackage.name + " v" + targetPackage.version);
             auto parsed = parse_url(targetPackage.url);
-            debug("[DEBUG collectPackages] Parsed URL - scheme: " + parsed.scheme + ", host: " + parsed.host + ", path: " + parsed.path);
+            OPENSPM_DEBUG("[DEBUG collectPackages] Parsed URL - scheme: " + parsed.scheme + ", host: " + parsed.host + ", path: " + parsed.path);
 
             bool useSSL = false;
             if (parsed.scheme == "https")
             {
-                debug("[DEBUG collectPackages] Using HTTPS");
+                OPENSPM_DEBUG("[DEBUG collectPackages] Using HTTPS");
                 if (parsed.port > 0)
                     sslCli = new httplib::SSLClient(parsed.host, parsed.port);
                 else
@@ -472,7 +686,7 @@ namespace openspm
             }
             else
             {
-                debug("[DEBUG collectPackages] Using HTTP");
+                OPENSPM_DEBUG("[DEBUG collectPackages] Using HTTP");
                 if (parsed.port > 0)
                     cli = new httplib::Client(parsed.host, parsed.port);
                 else
@@ -481,10 +695,10 @@ namespace openspm
             std::filesystem::path downloadPath = std::filesystem::temp_directory_path() / (targetPackage.name + ".pkg");
             if(std::filesystem::exists(downloadPath))
             {
-                debug("[DEBUG collectPackages] Temporary file exists. Removing: " + downloadPath.string());
+                OPENSPM_DEBUG("[DEBUG collectPackages] Temporary file exists. Removing: " + downloadPath.string());
                 std::filesystem::remove(downloadPath);
             }
-            debug("[DEBUG collectPackages] Download path: " + downloadPath.string());
+            OPENSPM_DEBUG("[DEBUG collectPackages] Download path: " + downloadPath.string());
             indicators::ProgressBar bar{
                 indicators::option::BarWidth{50},
                 indicators::option::Start{"["},
@@ -494,6 +708,7 @@ namespace openspm
                 indicators::option::ShowElapsedTime{true},
                 indicators::option::ShowRemainingTime{true},
                 indicators::option::MaxProgress{100}};
+            std::uint64_t downloaded = 0;
             if (useSSL)
             {
                 logHttpRequest("GET", targetPackage.url);
@@ -501,6 +716,7 @@ namespace openspm
                 auto res = sslCli->Get((parsed.path).c_str(),
                                        [&](const char *data, size_t len)
                                        {
+                                           downloaded += len;
                                            outFile.write(data, len);
                                            return true;
                                        },
@@ -508,14 +724,16 @@ namespace openspm
                                        {
                                            if (total > 0)
                                            {
+                                               flush();
                                                bar.set_progress(static_cast<size_t>((current * 100) / total));
                                            }
                                            return true;
                                        });
+                metrics::observeHttpRequest(targetPackage.url, res ? res->status : 0);
                 if (res && res->status == 200)
                 {
                     outFile.close();
-                    debug("[DEBUG collectPackages] Download successful");
+                    OPENSPM_DEBUG("[DEBUG collectPackages] Download successful");
                     delete sslCli;
                 }
                 else
@@ -533,6 +751,7 @@ namespace openspm
                 auto res = cli->Get((parsed.path).c_str(),
                                     [&](const char *data, size_t len)
                                     {
+                                        downloaded += len;
                                         outFile.write(data, len);
                                         return true;
                                     },
@@ -540,14 +759,16 @@ namespace openspm
                                     {
                                         if (total > 0)
                                         {
+                                            flush();
                                             bar.set_progress(static_cast<size_t>((current * 100) / total));
                                         }
                                         return true;
                                     });
+                metrics::observeHttpRequest(targetPackage.url, res ? res->status : 0);
                 if (res && res->status == 200)
                 {
                     outFile.close();
-                    debug("[DEBUG collectPackages] Download successful");
+                    OPENSPM_DEBUG("[DEBUG collectPackages] Download successful");
                     delete cli;
                 }
                 else
@@ -558,12 +779,241 @@ namespace openspm
                     return 1;
                 }
             }
+            span.setBytes(downloaded);
             collectedPackages.push_back(targetPackage.name);
         }
         return 0;
     }
-    int installCollectedPackages(const std::vector<std::string> &packageNames)
+    namespace
     {
+        /// Conflicts listed before giving up; the rest are only counted
+        constexpr size_t MaxReportedConflicts = 20;
+
+        /// Manifest paths must stay inside the target directory
+        bool isContainedPath(const std::string &path)
+        {
+            if (path.empty() || path.front() == '/' || path.find('\\') != std::string::npos)
+            {
+                return false;
+            }
+            for (const auto &part : std::filesystem::path(path))
+            {
+                if (part == "..")
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// Removes directories of a manifest that are empty, deepest first; anything still holding files stays
+        size_t pruneDirectories(std::vector<std::string> directories)
+        {
+            trace::Span span("pruneDirectories", "remove");
+            std::sort(directories.begin(), directories.end(), [](const std::string &a, const std::string &b)
+                      {
+                          auto depthA = std::count(a.begin(), a.end(), '/');
+                          auto depthB = std::count(b.begin(), b.end(), '/');
+                          return depthA != depthB ? depthA > depthB : a > b;
+                      });
+            directories.erase(std::unique(directories.begin(), directories.end()), directories.end());
+            std::filesystem::path targetDir = getConfig()->targetDir;
+            size_t pruned = 0;
+            for (const auto &dir : directories)
+            {
+                std::error_code ec;
+                if (std::filesystem::remove(targetDir / dir, ec))
+                {
+                    ++pruned;
+                }
+                else if (ec)
+                {
+                    OPENSPM_DEBUG("[DEBUG pruneDirectories] Keeping directory " + dir + ": " + ec.message());
+                }
+            }
+            span.setItems(pruned);
+            return pruned;
+        }
+
+        /**
+         * Unlinks what reinstalled packages shipped before but no longer do,
+         * unless a package of the transaction or one staying installed still
+         * lists the path.
+         */
+        size_t removeDroppedFiles(const InstalledDatabase &installed,
+                                  const std::map<std::string, std::vector<InstalledFile>> &previousManifests,
+                                  const std::vector<std::pair<InstalledPackage, std::vector<InstalledFile>>> &manifests)
+        {
+            trace::Span span("removeDropped", "install");
+            std::set<std::string> transaction;
+            std::unordered_set<std::string> shipped;
+            for (const auto &[record, files] : manifests)
+            {
+                transaction.insert(record.name);
+                for (const auto &file : files)
+                {
+                    shipped.insert(file.path);
+                }
+            }
+            auto claimedByOthers = [&](const std::string &path)
+            {
+                auto owners = installed.owners(path);
+                return std::any_of(owners.begin(), owners.end(), [&](const PathOwner &owner)
+                                   { return transaction.count(owner.package) == 0; });
+            };
+            std::filesystem::path targetDir = getConfig()->targetDir;
+            std::vector<std::string> directories;
+            size_t removed = 0;
+            for (const auto &[name, files] : previousManifests)
+            {
+                for (const auto &entry : files)
+                {
+                    if (shipped.count(entry.path) != 0 || !isContainedPath(entry.path) || claimedByOthers(entry.path))
+                    {
+                        continue;
+                    }
+                    if (entry.directory)
+                    {
+                        directories.push_back(entry.path);
+                        continue;
+                    }
+                    std::error_code ec;
+                    if (std::filesystem::remove(targetDir / entry.path, ec))
+                    {
+                        ++removed;
+                    }
+                    else if (ec)
+                    {
+                        warn("Failed to remove " + entry.path + ", which " + name + " no longer ships: " + ec.message());
+                    }
+                }
+            }
+            pruneDirectories(std::move(directories));
+            span.setItems(removed);
+            return removed;
+        }
+
+        /**
+         * Paths the extracted packages would install over files of other
+         * installed packages, or that two of them ship. A directory may be
+         * shared, but not by a package that has a file at the same path.
+         */
+        int checkFileConflicts(const InstalledDatabase &installed, const std::vector<std::string> &packageNames)
+        {
+            trace::Span span("checkConflicts", "install");
+            std::set<std::string> transaction(packageNames.begin(), packageNames.end());
+            std::unordered_map<std::string, std::pair<std::string, bool>> shipped;
+            std::vector<std::string> conflicts;
+            size_t checked = 0;
+            for (const auto &pkgName : packageNames)
+            {
+                std::filesystem::path root = std::filesystem::temp_directory_path() / "openspm" / pkgName / "TARGET";
+                std::error_code ec;
+                if (!std::filesystem::is_directory(root, ec))
+                {
+                    continue;
+                }
+                for (const auto &dirEntry : std::filesystem::recursive_directory_iterator(root))
+                {
+                    std::string path = dirEntry.path().lexically_relative(root).generic_string();
+                    bool directory = dirEntry.is_directory();
+                    ++checked;
+                    auto [it, inserted] = shipped.try_emplace(path, pkgName, directory);
+                    if (!inserted && it->second.first != pkgName && !(directory && it->second.second))
+                    {
+                        conflicts.push_back(path + " is in both " + it->second.first + " and " + pkgName);
+                    }
+                    // Packages being reinstalled own their old files; only hits from others are confirmed
+                    bool suspect = false;
+                    for (const auto &owner : installed.owners(path, false))
+                    {
+                        suspect = suspect || (transaction.count(owner.package) == 0 && !(directory && owner.directory));
+                    }
+                    if (!suspect)
+                    {
+                        continue;
+                    }
+                    for (const auto &owner : installed.owners(path))
+                    {
+                        if (transaction.count(owner.package) == 0 && !(directory && owner.directory))
+                        {
+                            conflicts.push_back(path + " from " + pkgName + " is owned by " + owner.package);
+                        }
+                    }
+                }
+            }
+            span.setItems(checked);
+            if (conflicts.empty())
+            {
+                return 0;
+            }
+            error("File conflicts, nothing was installed:");
+            for (size_t i = 0; i < conflicts.size() && i < MaxReportedConflicts; ++i)
+            {
+                error("  " + conflicts[i]);
+            }
+            if (conflicts.size() > MaxReportedConflicts)
+            {
+                error("  ... and " + std::to_string(conflicts.size() - MaxReportedConflicts) + " more");
+            }
+            metrics::add("openspm_file_conflicts_total", static_cast<double>(conflicts.size()));
+            return 1;
+        }
+
+        /**
+         * @brief Order post-install scripts by the dependency closure
+         *
+         * Each job waits on every job earlier in @p plan that its package
+         * depends on, directly or through packages without a script. Edges
+         * to later jobs are left out, so a dependency cycle runs in plan order.
+         */
+        void orderScriptJobs(const Catalog &catalog, const std::vector<std::string> &plan, std::vector<ScriptJob> &jobs)
+        {
+            std::unordered_map<std::string, size_t> position;
+            for (size_t i = 0; i < plan.size(); ++i)
+            {
+                position.emplace(plan[i], i);
+            }
+            std::unordered_set<std::string> withScript;
+            for (const auto &job : jobs)
+            {
+                withScript.insert(job.name);
+            }
+            for (auto &job : jobs)
+            {
+                job.after.clear();
+                size_t self = position.at(job.name);
+                std::unordered_set<std::string> visited = {job.name};
+                std::vector<std::string> pending = {job.name};
+                while (!pending.empty())
+                {
+                    std::string current = std::move(pending.back());
+                    pending.pop_back();
+                    const PackageInfo *pkg = catalog.findPackage(current);
+                    if (pkg == nullptr)
+                        continue;
+                    for (const auto &dep : pkg->dependencies)
+                    {
+                        std::string name(dependencyName(dep));
+                        if (!visited.insert(name).second)
+                            continue;
+                        auto it = position.find(name);
+                        if (it != position.end() && it->second < self && withScript.count(name) != 0)
+                        {
+                            job.after.push_back(name);
+                        }
+                        pending.push_back(std::move(name));
+                    }
+                }
+            }
+        }
+    } // namespace
+
+    int installCollectedPackages(const Catalog &catalog, const std::vector<std::string> &packageNames,
+                                 const std::vector<std::string> &requestedNames)
+    {
+        trace::Span span("installCollectedPackages", "install");
+        span.setItems(packageNames.size());
         log("Installing packages...");
         indicators::ProgressBar bar{
             indicators::option::BarWidth{50},
@@ -574,61 +1024,70 @@ namespace openspm
             indicators::option::ShowElapsedTime{true},
             indicators::option::ShowRemainingTime{true},
             indicators::option::MaxProgress{static_cast<size_t>(packageNames.size())}};
+        DurabilityMode durability = DurabilityMode::None;
+        if (!parseDurabilityMode(getConfig()->durability, durability))
+        {
+            warn("Unknown durability mode '" + getConfig()->durability + "', using none");
+        }
+        SyncBatch syncBatch(durability);
+        std::vector<ScriptJob> scriptJobs;
+        TriggerSet triggers;
+        InstalledDatabase installed;
+        if (installed.open(installedDatabasePath()) != 0)
+        {
+            warn("The installed package database is invalid; it will only list the packages installed from now on.");
+        }
+        // Everything is extracted and checked before the first file is written
         for (const auto &pkgName : packageNames)
         {
-            bar.set_option(indicators::option::PrefixText{"Installing " + pkgName + ": "});
-            bar.print_progress();
             std::filesystem::path downloadPath = std::filesystem::temp_directory_path() / (pkgName + ".pkg");
             std::filesystem::path extractPath = std::filesystem::temp_directory_path() / "openspm" / pkgName;
             std::filesystem::create_directories(extractPath);
 
-            debug("[DEBUG installCollectedPackages] Extracting " + downloadPath.string() + " to " + extractPath.string());
-
-            struct archive *a = archive_read_new();
-            struct archive *ext = archive_write_disk_new();
-            archive_read_support_format_all(a);
-            archive_read_support_filter_all(a);
-            archive_write_disk_set_options(ext, ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM | ARCHIVE_EXTRACT_ACL | ARCHIVE_EXTRACT_FFLAGS);
+            {
+                trace::Span extractSpan("extract", "install");
+                extractSpan.setDetail(pkgName);
+                if (extractPackageArchive(downloadPath.string(), extractPath.string()) != 0)
+                {
+                    return 1;
+                }
+            }
 
-            if (archive_read_open_filename(a, downloadPath.string().c_str(), 10240) != ARCHIVE_OK)
+            OPENSPM_DEBUG("[DEBUG installCollectedPackages] Extraction complete for " + pkgName);
+            std::vector<TriggerInfo> packageTriggers;
+            if (loadPackageTriggers((extractPath / "pkg.yaml").string(), pkgName, packageTriggers) != 0)
             {
-                error("Failed to open archive: " + downloadPath.string());
-                archive_read_free(a);
-                archive_write_free(ext);
                 return 1;
             }
-
-            struct archive_entry *entry;
-            while (archive_read_next_header(a, &entry) == ARCHIVE_OK)
+            for (const auto &trigger : packageTriggers)
             {
-                std::filesystem::path fullPath = extractPath / archive_entry_pathname(entry);
-                archive_entry_set_pathname(entry, fullPath.string().c_str());
-
-                if (archive_write_header(ext, entry) != ARCHIVE_OK)
-                {
-                    error("Failed to write header for: " + fullPath.string());
-                }
-                else
-                {
-                    const void *buff;
-                    size_t size;
-                    la_int64_t offset;
-
-                    while (archive_read_data_block(a, &buff, &size, &offset) == ARCHIVE_OK)
-                    {
-                        archive_write_data_block(ext, buff, size, offset);
-                    }
-                    archive_write_finish_entry(ext);
-                }
+                triggers.declare(trigger);
             }
+        }
+        if (checkFileConflicts(installed, packageNames) != 0)
+        {
+            return 1;
+        }
 
-            archive_read_close(a);
-            archive_read_free(a);
-            archive_write_close(ext);
-            archive_write_free(ext);
-
-            debug("[DEBUG installCollectedPackages] Extraction complete for " + pkgName);
-            debug("[DEBUG installCollectedPackages] Moving files to system directories");
+        std::vector<std::pair<InstalledPackage, std::vector<InstalledFile>>> manifests;
+        std::map<std::string, std::vector<InstalledFile>> previousManifests;
+        long long now = static_cast<long long>(std::time(nullptr));
+        for (const auto &pkgName : packageNames)
+        {
+            bar.set_option(indicators::option::PrefixText{"Installing " + pkgName + ": "});
+            flush();
+            bar.print_progress();
+            std::filesystem::path extractPath = std::filesystem::temp_directory_path() / "openspm" / pkgName;
+            OPENSPM_DEBUG("[DEBUG installCollectedPackages] Moving files to system directories");
+            trace::Span copySpan("copy", "install");
+            copySpan.setDetail(pkgName);
+            std::uint64_t copiedFiles = 0;
+            std::uint64_t copiedBytes = 0;
+            std::uint64_t unchangedFiles = 0;
+            // A reinstall only rewrites files that differ from the recorded and the on-disk copy
+            std::vector<InstalledFile> previousFiles;
+            installed.readManifest(pkgName, previousFiles);
+            std::vector<InstalledFile> files;
             for (const auto &dirEntry : std::filesystem::recursive_directory_iterator(extractPath / "TARGET"))
             {
                 std::filesystem::path relativePath = std::filesystem::relative(dirEntry.path(), extractPath / "TARGET");
@@ -636,14 +1095,48 @@ namespace openspm
 
                 try
                 {
+                    InstalledFile entry;
+                    entry.path = relativePath.generic_string();
+                    entry.mode = static_cast<std::uint32_t>(dirEntry.status().permissions()) & 07777;
                     if (dirEntry.is_directory())
                     {
                         std::filesystem::create_directories(targetPath);
+                        entry.directory = true;
+                        files.push_back(std::move(entry));
                     }
                     else if (dirEntry.is_regular_file())
                     {
-                        std::filesystem::create_directories(targetPath.parent_path());
-                        std::filesystem::copy_file(dirEntry.path(), targetPath, std::filesystem::copy_options::overwrite_existing);
+                        if (hashFile(dirEntry.path().string(), entry.size, entry.hash) != 0)
+                        {
+                            error("Failed to read " + dirEntry.path().string());
+                            return 1;
+                        }
+                        auto previous = std::lower_bound(previousFiles.begin(), previousFiles.end(), entry.path,
+                                                         [](const InstalledFile &file, const std::string &path)
+                                                         { return file.path < path; });
+                        std::uint64_t targetSize = 0;
+                        std::uint64_t targetHash = 0;
+                        bool unchanged = previous != previousFiles.end() && previous->path == entry.path && !previous->directory &&
+                                         previous->size == entry.size && previous->hash == entry.hash &&
+                                         hashFile(targetPath.string(), targetSize, targetHash) == 0 &&
+                                         targetSize == entry.size && targetHash == entry.hash;
+                        if (unchanged)
+                        {
+                            ++unchangedFiles;
+                        }
+                        else
+                        {
+                            std::filesystem::create_directories(targetPath.parent_path());
+                            std::filesystem::copy_file(dirEntry.path(), targetPath, std::filesystem::copy_options::overwrite_existing);
+                            if (syncBatch.fileWritten(targetPath.string()) != 0)
+                            {
+                                return 1;
+                            }
+                            ++copiedFiles;
+                            copiedBytes += entry.size;
+                        }
+                        triggers.fileInstalled(entry.path);
+                        files.push_back(std::move(entry));
                     }
                 }
                 catch (const std::filesystem::filesystem_error &e)
@@ -652,73 +1145,322 @@ namespace openspm
                     return 1;
                 }
             }
-            debug("Executing post-install scripts if any");
+            copySpan.setItems(copiedFiles);
+            copySpan.setBytes(copiedBytes);
+            metrics::add("openspm_files_installed_total", static_cast<double>(copiedFiles));
+            if (unchangedFiles > 0)
+            {
+                OPENSPM_DEBUG("[DEBUG installCollectedPackages] " + std::to_string(unchangedFiles) + " files of " + pkgName + " already up to date");
+                metrics::add("openspm_files_unchanged_total", static_cast<double>(unchangedFiles));
+            }
+            InstalledPackage record;
+            record.name = pkgName;
+            if (const PackageInfo *found = catalog.findPackage(pkgName))
+            {
+                record.version = found->version;
+                record.repository = found->repository;
+                for (const auto &dep : found->dependencies)
+                {
+                    record.dependencies.emplace_back(dependencyName(dep));
+                }
+            }
+            record.installedAt = now;
+            record.automatic = installed.installsAutomatically(pkgName, requestedNames);
+            manifests.emplace_back(std::move(record), std::move(files));
+            if (!previousFiles.empty())
+            {
+                previousManifests.emplace(pkgName, std::move(previousFiles));
+            }
+#ifdef _WIN32
+            std::filesystem::path postInstallScript = extractPath / "install.bat";
+#else
             std::filesystem::path postInstallScript = extractPath / "install.sh";
+#endif
             if (std::filesystem::exists(postInstallScript) && std::filesystem::is_regular_file(postInstallScript))
             {
-                debug("[DEBUG installCollectedPackages] Found post-install script for " + pkgName);
+                OPENSPM_DEBUG("[DEBUG installCollectedPackages] Found post-install script for " + pkgName);
 
-                // Get package info for environment variables
-                std::vector<PackageInfo> packages;
-                listPackages(packages);
+                // Get package info for environment variables and script ordering
                 PackageInfo pkgInfo;
-                for (const auto &pkg : packages)
+                if (const PackageInfo *found = catalog.findPackage(pkgName))
                 {
-                    if (pkg.name == pkgName)
-                    {
-                        pkgInfo = pkg;
-                        break;
-                    }
+                    pkgInfo = *found;
                 }
 
-#ifdef _WIN32
-                // On Windows, try to execute install.bat if available
-                std::filesystem::path postInstallBat = extractPath / "install.bat";
-                if (std::filesystem::exists(postInstallBat))
-                {
-                    std::string command = "set PKG_NAME=" + pkgInfo.name + " && " + 
-                              "set PKG_VERSION=" + pkgInfo.version + " && " + 
-                              "set PKG_MAINTAINER=" + pkgInfo.maintainer + " && " + 
-                              "set PKG_DESCRIPTION=" + pkgInfo.description + " && " + 
-                              "set PKG_TAGS=" + pkgInfo.tags + " && " + 
-                              "set PKG_INSTALL_DIR=" + getConfig()->targetDir + " && " + 
-                              "set PKG_SOURCE_DIR=" + extractPath.string() + " && " + 
-                              "cmd /c \"" + postInstallBat.string() + "\" > nul";
-                    
-                    int ret = system(command.c_str());
-                    if (ret != 0)
-                    {
-                        error("Post-install script failed for package: " + pkgName);
-                        return 1;
-                    }
-                    debug("[DEBUG installCollectedPackages] Post-install script executed successfully for " + pkgName);
-                }
-                else
-                {
-                    // No post-install script available for Windows
-                    debug("[DEBUG installCollectedPackages] No Windows post-install script found (install.bat) for " + pkgName);
-                }
-#else
-                std::string command = "PKG_NAME=" + pkgInfo.name + " " + "PKG_VERSION=" + pkgInfo.version + " " + "PKG_MAINTAINER=\"" + pkgInfo.maintainer + "\" " + "PKG_DESCRIPTION=\"" + pkgInfo.description + "\" " + "PKG_TAGS=\"" + pkgInfo.tags + "\" " + "PKG_INSTALL_DIR=" + getConfig()->targetDir + " " + "PKG_SOURCE_DIR=" + extractPath.string() + " " + "sh " + postInstallScript.string() + " > /dev/null";
+                ScriptJob job;
+                job.name = pkgName;
+                job.scriptPath = postInstallScript.string();
+                job.env = {
+                    "PKG_NAME=" + pkgInfo.name,
+                    "PKG_VERSION=" + pkgInfo.version,
+                    "PKG_MAINTAINER=" + pkgInfo.maintainer,
+                    "PKG_DESCRIPTION=" + pkgInfo.description,
+                    "PKG_TAGS=" + pkgInfo.tags,
+                    "PKG_INSTALL_DIR=" + getConfig()->targetDir,
+                    "PKG_SOURCE_DIR=" + extractPath.string()};
+                scriptJobs.push_back(std::move(job));
+            }
+            else
+            {
+                OPENSPM_DEBUG("[DEBUG installCollectedPackages] No post-install script found for " + pkgName);
+            }
+            OPENSPM_DEBUG("[DEBUG installCollectedPackages] Installation complete for " + pkgName);
+            flush();
+            bar.tick();
+        }
 
-                int ret = system(command.c_str());
-                if (ret != 0)
+        if (!previousManifests.empty())
+        {
+            size_t dropped = removeDroppedFiles(installed, previousManifests, manifests);
+            if (dropped > 0)
+            {
+                OPENSPM_DEBUG("[DEBUG installCollectedPackages] Removed " + std::to_string(dropped) + " files no longer shipped");
+                metrics::add("openspm_files_removed_total", static_cast<double>(dropped));
+            }
+        }
+
+        // Nothing counts as installed until the whole transaction is on disk. That happens before
+        // scripts and triggers run, so the copied files keep an owner even if one of them fails
+        {
+            trace::Span syncSpan("sync", "install");
+            syncSpan.setItems(syncBatch.fileCount());
+            if (syncBatch.commit() != 0)
+            {
+                error("Failed to sync installed files to disk.");
+                return 1;
+            }
+        }
+        {
+            trace::Span recordSpan("record", "install");
+            recordSpan.setItems(manifests.size());
+            for (auto &[record, files] : manifests)
+            {
+                if (installed.record(std::move(record), std::move(files)) != 0)
                 {
-                    error("Post-install script failed for package: " + pkgName);
                     return 1;
                 }
-                debug("[DEBUG installCollectedPackages] Post-install script executed successfully for " + pkgName);
-#endif
             }
-            else
+            if (installed.save() != 0)
             {
-                debug("[DEBUG installCollectedPackages] No post-install script found for " + pkgName);
+                error("Packages were installed but could not be recorded as installed.");
+                return 1;
             }
-            debug("[DEBUG installCollectedPackages] Installation complete for " + pkgName);
-            bar.tick();
         }
 
+        // Scripts of packages that don't depend on each other run concurrently
+        if (!scriptJobs.empty())
+        {
+            orderScriptJobs(catalog, packageNames, scriptJobs);
+            trace::Span scriptsSpan("scripts", "install");
+            scriptsSpan.setItems(scriptJobs.size());
+            log("Running " + std::to_string(scriptJobs.size()) + " post-install scripts...");
+            std::vector<ScriptResult> scriptResults;
+            int scriptStatus = runScripts(scriptJobs, getConfig()->scriptJobs, getConfig()->scriptTimeout, scriptResults);
+            for (const auto &result : scriptResults)
+            {
+                const char *outcome = result.skipped ? "skipped" : result.timedOut ? "timeout" : result.exitCode == 0 ? "ok" : "failed";
+                metrics::add("openspm_scripts_total", 1, {{"result", outcome}});
+            }
+            if (scriptStatus != 0)
+            {
+                return 1;
+            }
+        }
+
+        // Triggers shared by several packages run once for the whole transaction
+        {
+            trace::Span triggersSpan("triggers", "install");
+            triggersSpan.setItems(triggers.size());
+            if (triggers.runActivated(getConfig()->targetDir, getConfig()->scriptJobs, getConfig()->scriptTimeout) != 0)
+            {
+                return 1;
+            }
+        }
+
+        OPENSPM_DEBUG("[DEBUG installCollectedPackages] " + std::to_string(syncBatch.fileCount()) + " files written with durability mode " + durabilityModeName(durability));
+        metrics::add("openspm_packages_installed_total", static_cast<double>(packageNames.size()));
         log("\033[0;32mAll packages installed successfully.\033[0m");
         return 0;
     }
-}
\ No newline at end of file
+
+    namespace
+    {
+        /// Unlinking is bound by filesystem metadata, so a few threads saturate it
+        constexpr size_t MaxRemoveThreads = 8;
+        /// Below this many files per thread, extra threads cost more than they save
+        constexpr size_t FilesPerRemoveThread = 256;
+    } // namespace
+
+    int removePackage(const std::string &packageName)
+    {
+        return removePackages({packageName});
+    }
+
+    int removePackages(const std::vector<std::string> &packageNames)
+    {
+        trace::Span span("removePackages", "remove");
+        span.setItems(packageNames.size());
+        InstalledDatabase installed;
+        if (installed.open(installedDatabasePath()) != 0)
+        {
+            error("The installed package database is invalid.");
+            return 1;
+        }
+        std::set<std::string> removing(packageNames.begin(), packageNames.end());
+        std::vector<InstalledFile> entries;
+        for (const auto &name : removing)
+        {
+            if (!installed.isInstalled(name))
+            {
+                error("Package is not installed: " + name);
+                return 1;
+            }
+            std::vector<InstalledFile> files;
+            if (installed.readManifest(name, files) != 0)
+            {
+                error("The file list of " + name + " is missing or invalid.");
+                return 1;
+            }
+            entries.insert(entries.end(), std::make_move_iterator(files.begin()), std::make_move_iterator(files.end()));
+        }
+
+        // Refuse to break installed packages that still need one of these
+        bool required = false;
+        for (const auto &name : removing)
+        {
+            std::string users;
+            for (const auto &dependent : installed.dependents(name))
+            {
+                if (removing.count(dependent) == 0)
+                    users += (users.empty() ? "" : ", ") + dependent;
+            }
+            if (!users.empty())
+            {
+                error("Cannot remove " + name + ": required by " + users);
+                required = true;
+            }
+        }
+        if (required)
+        {
+            return 1;
+        }
+
+        // Paths that packages staying installed also list, from the path index
+        auto claimedByOthers = [&](const InstalledFile &entry)
+        {
+            auto claimedIn = [&](const std::vector<PathOwner> &owners)
+            {
+                return std::any_of(owners.begin(), owners.end(), [&](const PathOwner &owner)
+                                   { return removing.count(owner.package) == 0; });
+            };
+            // A shared directory is only kept, so an unconfirmed hit is good enough
+            return claimedIn(installed.owners(entry.path, false)) && (entry.directory || claimedIn(installed.owners(entry.path)));
+        };
+
+        std::filesystem::path targetDir = getConfig()->targetDir;
+        std::vector<std::filesystem::path> files;
+        std::vector<std::string> directories;
+        size_t kept = 0;
+        for (const auto &entry : entries)
+        {
+            if (!isContainedPath(entry.path))
+            {
+                warn("Skipping invalid path in file list: " + entry.path);
+                continue;
+            }
+            if (claimedByOthers(entry))
+            {
+                ++kept;
+                continue;
+            }
+            if (entry.directory)
+                directories.push_back(entry.path);
+            else
+                files.push_back(targetDir / entry.path);
+        }
+        std::sort(files.begin(), files.end());
+        files.erase(std::unique(files.begin(), files.end()), files.end());
+
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> failures{0};
+        std::mutex errorMutex;
+        std::string firstError;
+        {
+            trace::Span unlinkSpan("unlink", "remove");
+            unlinkSpan.setItems(files.size());
+            auto work = [&]()
+            {
+                for (size_t i = next.fetch_add(1); i < files.size(); i = next.fetch_add(1))
+                {
+                    std::error_code ec;
+                    std::filesystem::remove(files[i], ec);
+                    if (ec)
+                    {
+                        failures.fetch_add(1);
+                        std::lock_guard<std::mutex> lock(errorMutex);
+                        if (firstError.empty())
+                        {
+                            firstError = files[i].string() + ": " + ec.message();
+                        }
+                    }
+                }
+            };
+            size_t threadCount = std::min({MaxRemoveThreads, files.size() / FilesPerRemoveThread + 1,
+                                           static_cast<size_t>(std::max(1u, std::thread::hardware_concurrency()))});
+            std::vector<std::thread> threads;
+            for (size_t t = 1; t < threadCount; ++t)
+            {
+                threads.emplace_back(work);
+            }
+            work();
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+        }
+        if (failures > 0)
+        {
+            error("Failed to remove " + std::to_string(failures.load()) + " files, e.g. " + firstError);
+            error("The packages stay recorded as installed; fix the problem and run remove again.");
+            return 1;
+        }
+
+        size_t prunedDirectories = pruneDirectories(std::move(directories));
+
+        for (const auto &name : removing)
+        {
+            installed.forget(name);
+        }
+        if (installed.save() != 0)
+        {
+            error("Files were removed but the packages could not be unrecorded.");
+            return 1;
+        }
+        metrics::add("openspm_files_removed_total", static_cast<double>(files.size()));
+        metrics::add("openspm_packages_removed_total", static_cast<double>(removing.size()));
+        OPENSPM_DEBUG("[DEBUG removePackages] Removed " + std::to_string(files.size()) + " files and " +
+                      std::to_string(prunedDirectories) + " directories, kept " + std::to_string(kept) + " shared paths");
+        log("\033[0;32mRemoved " + std::to_string(removing.size()) + " package" + (removing.size() == 1 ? "" : "s") + " (" +
+            std::to_string(files.size()) + " file" + (files.size() == 1 ? "" : "s") + ").\033[0m");
+        return 0;
+    }
+
+    int askRemovalConfirmation(const std::vector<std::string> &packageNames)
+    {
+        log("The following packages will be removed:");
+        for (const auto &name : packageNames)
+        {
+            log("\033[0;34m - " + name);
+        }
+        log("\033[0;33mDo you want to proceed? (\033[0;32my\033[0;33m/\033[0;31mn\033[0;33m): ");
+        char response;
+        flush();
+        std::cin >> response;
+        if (response == 'y' || response == 'Y')
+        {
+            return 0;
+        }
+        error("Removal cancelled by user.");
+        return 1;
+    }
+}
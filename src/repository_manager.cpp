@@ -12,53 +12,134 @@
 #define CPPHTTPLIB_OPENSSL_SUPPORT
 #include <httplib.h>
 #include <utils.hpp>
+#include <name_index.hpp>
+#include <version.hpp>
 namespace openspm
 {
     using namespace logger;
+
+    namespace
+    {
+        /// Fill @p outInfo from one entry of repositories.yaml
+        void readRepositoryNode(const std::string &url, const YAML::Node &repoNode, RepositoryInfo &outInfo)
+        {
+            outInfo.url = url;
+            outInfo.name = repoNode["name"] ? repoNode["name"].as<std::string>() : "";
+            outInfo.description = repoNode["description"] ? repoNode["description"].as<std::string>() : "";
+            outInfo.mantainer = repoNode["mantainer"] ? repoNode["mantainer"].as<std::string>() : "";
+            outInfo.sparseIndex = repoNode["sparse"] ? repoNode["sparse"].as<std::string>() : "";
+            outInfo.priority = repoNode["priority"] ? repoNode["priority"].as<int>() : 0;
+            outInfo.pins.clear();
+            if (repoNode["pins"] && repoNode["pins"].IsMap())
+            {
+                for (const auto &pin : repoNode["pins"])
+                {
+                    outInfo.pins[pin.first.as<std::string>()] = pin.second.IsNull() ? "" : pin.second.as<std::string>();
+                }
+            }
+        }
+
+        /// Load repositories.yaml for modification; a missing file reads as an empty map
+        bool loadRepositoryFile(YAML::Node &outNode)
+        {
+            std::string content;
+            if (getDataArchive()->readFile("repositories.yaml", content) != 0)
+            {
+                outNode = YAML::Node(YAML::NodeType::Map);
+                return true;
+            }
+            try
+            {
+                outNode = YAML::Load(content);
+            }
+            catch (const YAML::Exception &e)
+            {
+                error("Invalid repositories.yaml: " + std::string(e.what()));
+                return false;
+            }
+            if (outNode.IsNull())
+            {
+                outNode = YAML::Node(YAML::NodeType::Map);
+            }
+            return true;
+        }
+
+        bool saveRepositoryFile(const YAML::Node &reposNode)
+        {
+            std::stringstream ss;
+            ss << reposNode;
+            std::string data = ss.str();
+            return getDataArchive()->writeFile("repositories.yaml", data) == 0;
+        }
+    } // namespace
+
+    int parseRepositoryList(const std::string &content, std::vector<RepositoryInfo> &outRepositories)
+    {
+        try
+        {
+            YAML::Node reposNode = YAML::Load(content);
+            if (!reposNode.IsMap())
+            {
+                return reposNode.IsNull() ? 0 : 1;
+            }
+            for (const auto &it : reposNode)
+            {
+                RepositoryInfo repoInfo;
+                readRepositoryNode(it.first.as<std::string>(), it.second, repoInfo);
+                outRepositories.push_back(std::move(repoInfo));
+            }
+        }
+        catch (const YAML::Exception &e)
+        {
+            error("Invalid repositories.yaml: " + std::string(e.what()));
+            return 1;
+        }
+        return 0;
+    }
     std::vector<std::string> getRepositoryList()
     {
-        debug("[DEBUG getRepositoryList] Getting repository list");
+        OPENSPM_DEBUG("[DEBUG getRepositoryList] Getting repository list");
         Config *config = getConfig();
         std::vector<std::string> repoList;
         Archive *dataArchive = getDataArchive();
-        debug("[DEBUG getRepositoryList] Archive pointer: " + std::to_string((long)dataArchive));
+        OPENSPM_DEBUG("[DEBUG getRepositoryList] Archive pointer: " + std::to_string((long)dataArchive));
         
         std::string reposFileContent;
-        debug("[DEBUG getRepositoryList] Reading repositories.yaml");
+        OPENSPM_DEBUG("[DEBUG getRepositoryList] Reading repositories.yaml");
         int status = dataArchive->readFile("repositories.yaml", reposFileContent);
         if (status != 0)
         {
-            debug("[DEBUG getRepositoryList] No repositories file found");
+            OPENSPM_DEBUG("[DEBUG getRepositoryList] No repositories file found");
             warn("No repositories found.");
         }
         else
         {
-            debug("[DEBUG getRepositoryList] Repositories file size: " + std::to_string(reposFileContent.size()) + " bytes");
-            debug("[DEBUG getRepositoryList] Parsing YAML");
+            OPENSPM_DEBUG("[DEBUG getRepositoryList] Repositories file size: " + std::to_string(reposFileContent.size()) + " bytes");
+            OPENSPM_DEBUG("[DEBUG getRepositoryList] Parsing YAML");
             YAML::Node reposNode = YAML::Load(reposFileContent);
             for (const auto &it : reposNode)
             {
                 std::string url = it.first.as<std::string>();
-                debug("[DEBUG getRepositoryList] Found repository: " + url);
+                OPENSPM_DEBUG("[DEBUG getRepositoryList] Found repository: " + url);
                 repoList.push_back(url);
             }
         }
-        debug("[DEBUG getRepositoryList] Total repositories: " + std::to_string(repoList.size()));
+        OPENSPM_DEBUG("[DEBUG getRepositoryList] Total repositories: " + std::to_string(repoList.size()));
         return repoList;
     }
     
     bool fetchRepositoryInfo(const std::string &repoUrl, RepositoryInfo &outInfo)
     {
-        debug("[DEBUG fetchRepositoryInfo] Fetching info for: " + repoUrl);
+        OPENSPM_DEBUG("[DEBUG fetchRepositoryInfo] Fetching info for: " + repoUrl);
         auto parsed = parse_url(repoUrl);
-        debug("[DEBUG fetchRepositoryInfo] Parsed URL - scheme: " + parsed.scheme + ", host: " + parsed.host + ", path: " + parsed.path);
+        OPENSPM_DEBUG("[DEBUG fetchRepositoryInfo] Parsed URL - scheme: " + parsed.scheme + ", host: " + parsed.host + ", path: " + parsed.path);
 
         httplib::Client *cli = nullptr;
         httplib::SSLClient *sslCli = nullptr;
         bool useSSL = false;
         if (parsed.scheme == "https")
         {
-            debug("[DEBUG fetchRepositoryInfo] Using HTTPS");
+            OPENSPM_DEBUG("[DEBUG fetchRepositoryInfo] Using HTTPS");
             if (parsed.port > 0)
                 sslCli = new httplib::SSLClient(parsed.host, parsed.port);
             else
@@ -67,7 +148,7 @@ namespace openspm
         }
         else
         {
-            debug("[DEBUG fetchRepositoryInfo] Using HTTP");
+            OPENSPM_DEBUG("[DEBUG fetchRepositoryInfo] Using HTTP");
             if (parsed.port > 0)
                 cli = new httplib::Client(parsed.host, parsed.port);
             else
@@ -84,52 +165,54 @@ namespace openspm
 
         if (useSSL)
         {
-            debug("[DEBUG fetchRepositoryInfo] Making HTTPS request");
+            OPENSPM_DEBUG("[DEBUG fetchRepositoryInfo] Making HTTPS request");
             auto res = sslCli->Get((parsed.path + "/repository.yaml").c_str());
             if (res && res->status == 200)
             {
                 logHttpRequest("GET", fullUrl, res->status);
-                debug("[DEBUG fetchRepositoryInfo] Request successful, response size: " + std::to_string(res->body.size()) + " bytes");
+                OPENSPM_DEBUG("[DEBUG fetchRepositoryInfo] Request successful, response size: " + std::to_string(res->body.size()) + " bytes");
                 YAML::Node repoNode = YAML::Load(res->body);
                 outInfo.url = repoUrl;
                 outInfo.name = repoNode["name"].as<std::string>();
                 outInfo.description = repoNode["description"].as<std::string>();
                 outInfo.mantainer = repoNode["mantainer"].as<std::string>();
-                debug("[DEBUG fetchRepositoryInfo] Repository name: " + outInfo.name);
-                debug("[DEBUG fetchRepositoryInfo] Maintainer: " + outInfo.mantainer);
+                outInfo.sparseIndex = repoNode["sparse"] ? repoNode["sparse"].as<std::string>() : "";
+                OPENSPM_DEBUG("[DEBUG fetchRepositoryInfo] Repository name: " + outInfo.name);
+                OPENSPM_DEBUG("[DEBUG fetchRepositoryInfo] Maintainer: " + outInfo.mantainer);
                 delete sslCli;
                 return true;
             }
             else
             {
                 logHttpRequest("GET", fullUrl, res ? res->status : 0);
-                debug("[DEBUG fetchRepositoryInfo] Request failed");
+                OPENSPM_DEBUG("[DEBUG fetchRepositoryInfo] Request failed");
                 delete sslCli;
                 return false;
             }
         }
         else
         {
-            debug("[DEBUG fetchRepositoryInfo] Making HTTP request");
+            OPENSPM_DEBUG("[DEBUG fetchRepositoryInfo] Making HTTP request");
             auto res = cli->Get((parsed.path + "/repository.yaml").c_str());
             if (res && res->status == 200)
             {
                 logHttpRequest("GET", fullUrl, res->status);
-                debug("[DEBUG fetchRepositoryInfo] Request successful, response size: " + std::to_string(res->body.size()) + " bytes");
+                OPENSPM_DEBUG("[DEBUG fetchRepositoryInfo] Request successful, response size: " + std::to_string(res->body.size()) + " bytes");
                 YAML::Node repoNode = YAML::Load(res->body);
                 outInfo.url = repoUrl;
                 outInfo.name = repoNode["name"].as<std::string>();
                 outInfo.description = repoNode["description"].as<std::string>();
                 outInfo.mantainer = repoNode["mantainer"].as<std::string>();
-                debug("[DEBUG fetchRepositoryInfo] Repository name: " + outInfo.name);
-                debug("[DEBUG fetchRepositoryInfo] Maintainer: " + outInfo.mantainer);
+                outInfo.sparseIndex = repoNode["sparse"] ? repoNode["sparse"].as<std::string>() : "";
+                OPENSPM_DEBUG("[DEBUG fetchRepositoryInfo] Repository name: " + outInfo.name);
+                OPENSPM_DEBUG("[DEBUG fetchRepositoryInfo] Maintainer: " + outInfo.mantainer);
                 delete cli;
                 return true;
             }
             else
             {
                 logHttpRequest("GET", fullUrl, res ? res->status : 0);
-                debug("[DEBUG fetchRepositoryInfo] Request failed");
+                OPENSPM_DEBUG("[DEBUG fetchRepositoryInfo] Request failed");
                 delete cli;
                 return false;
             }
@@ -138,34 +221,30 @@ namespace openspm
     
     bool getRepositoryInfo(const std::string &repoUrl, RepositoryInfo &outInfo)
     {
-        debug("[DEBUG getRepositoryInfo] Getting info for: " + repoUrl);
+        OPENSPM_DEBUG("[DEBUG getRepositoryInfo] Getting info for: " + repoUrl);
         Config *config = getConfig();
         Archive *dataArchive = getDataArchive();
         std::string reposFileContent;
-        debug("[DEBUG getRepositoryInfo] Reading repositories.yaml");
+        OPENSPM_DEBUG("[DEBUG getRepositoryInfo] Reading repositories.yaml");
         int status = dataArchive->readFile("repositories.yaml", reposFileContent);
         if (status == 0)
         {
-            debug("[DEBUG getRepositoryInfo] Repositories file found, checking cache");
+            OPENSPM_DEBUG("[DEBUG getRepositoryInfo] Repositories file found, checking cache");
             YAML::Node reposNode = YAML::Load(reposFileContent);
             if (!reposNode[repoUrl])
             {
-                debug("[DEBUG getRepositoryInfo] Not in cache, fetching from network");
+                OPENSPM_DEBUG("[DEBUG getRepositoryInfo] Not in cache, fetching from network");
                 bool fetchStatus = fetchRepositoryInfo(repoUrl, outInfo);
                 return fetchStatus;
             }
-            debug("[DEBUG getRepositoryInfo] Found in cache");
-            YAML::Node repoNode = reposNode[repoUrl];
-            outInfo.url = repoUrl;
-            outInfo.name = repoNode["name"].as<std::string>();
-            outInfo.description = repoNode["description"].as<std::string>();
-            outInfo.mantainer = repoNode["mantainer"].as<std::string>();
-            debug("[DEBUG getRepositoryInfo] Retrieved from cache: " + outInfo.name);
+            OPENSPM_DEBUG("[DEBUG getRepositoryInfo] Found in cache");
+            readRepositoryNode(repoUrl, reposNode[repoUrl], outInfo);
+            OPENSPM_DEBUG("[DEBUG getRepositoryInfo] Retrieved from cache: " + outInfo.name);
             return true;
         }
         else
         {
-            debug("[DEBUG getRepositoryInfo] No cache file, fetching from network");
+            OPENSPM_DEBUG("[DEBUG getRepositoryInfo] No cache file, fetching from network");
             bool fetchStatus = fetchRepositoryInfo(repoUrl, outInfo);
             return fetchStatus;
         }
@@ -173,37 +252,37 @@ namespace openspm
     
     bool validateRepositoryInfo(const RepositoryInfo &repoInfo)
     {
-        debug("[DEBUG validateRepositoryInfo] Validating repository info");
+        OPENSPM_DEBUG("[DEBUG validateRepositoryInfo] Validating repository info");
         if (repoInfo.url.empty() || repoInfo.name.empty() || repoInfo.description.empty() || repoInfo.mantainer.empty())
         {
-            debug("[DEBUG validateRepositoryInfo] Validation failed - missing fields");
+            OPENSPM_DEBUG("[DEBUG validateRepositoryInfo] Validation failed - missing fields");
             return false;
         }
-        debug("[DEBUG validateRepositoryInfo] Validation passed");
+        OPENSPM_DEBUG("[DEBUG validateRepositoryInfo] Validation passed");
         return true;
     }
     
     int updateAllRepositories()
     {
-        debug("[DEBUG updateAllRepositories] Updating all repositories");
+        OPENSPM_DEBUG("[DEBUG updateAllRepositories] Updating all repositories");
         Config *config = getConfig();
         Archive *dataArchive = getDataArchive();
         std::string reposFileContent;
-        debug("[DEBUG updateAllRepositories] Reading repositories.yaml");
+        OPENSPM_DEBUG("[DEBUG updateAllRepositories] Reading repositories.yaml");
         int status = dataArchive->readFile("repositories.yaml", reposFileContent);
         if (status != 0)
         {
             error("No repositories found.");
             return 1;
         }
-        debug("[DEBUG updateAllRepositories] Repositories file size: " + std::to_string(reposFileContent.size()) + " bytes");
+        OPENSPM_DEBUG("[DEBUG updateAllRepositories] Repositories file size: " + std::to_string(reposFileContent.size()) + " bytes");
         YAML::Node reposNode = YAML::Load(reposFileContent);
-        debug("[DEBUG updateAllRepositories] Processing " + std::to_string(reposNode.size()) + " repositories");
+        OPENSPM_DEBUG("[DEBUG updateAllRepositories] Processing " + std::to_string(reposNode.size()) + " repositories");
         size_t repoIndex = 0;
         for (const auto &it : reposNode)
         {
             std::string repoUrl = it.first.as<std::string>();
-            debug("[DEBUG updateAllRepositories] Updating repository: " + repoUrl);
+            OPENSPM_DEBUG("[DEBUG updateAllRepositories] Updating repository: " + repoUrl);
             RepositoryInfo repoInfo;
             bool fetchStatus = fetchRepositoryInfo(repoUrl, repoInfo);
             if (!fetchStatus)
@@ -211,22 +290,30 @@ namespace openspm
                 error("Failed to fetch repository info: " + repoUrl);
                 return 1;
             }
-            debug("[DEBUG updateAllRepositories] Fetched info for: " + repoInfo.name);
-            YAML::Node repoNode;
+            OPENSPM_DEBUG("[DEBUG updateAllRepositories] Fetched info for: " + repoInfo.name);
+            // Updated in place, so the local priority and pins are kept
+            YAML::Node repoNode = it.second;
             repoNode["name"] = repoInfo.name;
             repoNode["description"] = repoInfo.description;
             repoNode["mantainer"] = repoInfo.mantainer;
-            reposNode[repoUrl] = repoNode;
+            if (!repoInfo.sparseIndex.empty())
+            {
+                repoNode["sparse"] = repoInfo.sparseIndex;
+            }
+            else if (repoNode["sparse"])
+            {
+                repoNode.remove("sparse");
+            }
             repoIndex++;
         }
-        debug("[DEBUG updateAllRepositories] All repositories updated successfully");
+        OPENSPM_DEBUG("[DEBUG updateAllRepositories] All repositories updated successfully");
         log("\033[0;32mSuccessfully updated all repositories");
         return 0;
     }
     
     bool addRepository(RepositoryInfo repoInfo)
     {
-        debug("[DEBUG addRepository] Adding repository: " + repoInfo.url);
+        OPENSPM_DEBUG("[DEBUG addRepository] Adding repository: " + repoInfo.url);
         bool valid = validateRepositoryInfo(repoInfo);
         if (!valid)
         {
@@ -236,17 +323,17 @@ namespace openspm
         Config *config = getConfig();
         Archive *dataArchive = getDataArchive();
         std::string reposFileContent;
-        debug("[DEBUG addRepository] Reading repositories.yaml");
+        OPENSPM_DEBUG("[DEBUG addRepository] Reading repositories.yaml");
         int status = dataArchive->readFile("repositories.yaml", reposFileContent);
         YAML::Node reposNode;
         if (status == 0)
         {
-            debug("[DEBUG addRepository] Repositories file found, loading");
+            OPENSPM_DEBUG("[DEBUG addRepository] Repositories file found, loading");
             reposNode = YAML::Load(reposFileContent);
         }
         else
         {
-            debug("[DEBUG addRepository] No repositories file, creating new");
+            OPENSPM_DEBUG("[DEBUG addRepository] No repositories file, creating new");
             reposNode = YAML::Node(YAML::NodeType::Map);
         }
         for (const auto &it : reposNode)
@@ -257,51 +344,64 @@ namespace openspm
                 return false;
             }
         }
-        debug("[DEBUG addRepository] Creating repository node");
+        OPENSPM_DEBUG("[DEBUG addRepository] Creating repository node");
         YAML::Node repoNode;
         repoNode["name"] = repoInfo.name;
         repoNode["description"] = repoInfo.description;
         repoNode["mantainer"] = repoInfo.mantainer;
+        if (!repoInfo.sparseIndex.empty())
+        {
+            repoNode["sparse"] = repoInfo.sparseIndex;
+        }
+        if (repoInfo.priority != 0)
+        {
+            repoNode["priority"] = repoInfo.priority;
+        }
+        for (const auto &[name, range] : repoInfo.pins)
+        {
+            repoNode["pins"][name] = range;
+        }
         reposNode[repoInfo.url] = repoNode;
         
-        debug("[DEBUG addRepository] Converting to YAML string");
+        OPENSPM_DEBUG("[DEBUG addRepository] Converting to YAML string");
         std::stringstream ss;
         ss << reposNode;
         std::string data = ss.str();
-        debug("[DEBUG addRepository] YAML data size: " + std::to_string(data.size()) + " bytes");
+        OPENSPM_DEBUG("[DEBUG addRepository] YAML data size: " + std::to_string(data.size()) + " bytes");
         
-        debug("[DEBUG addRepository] Writing to archive");
+        OPENSPM_DEBUG("[DEBUG addRepository] Writing to archive");
         status = dataArchive->writeFile("repositories.yaml", data);
         if (status != 0)
         {
             error("Failed to add repository: " + repoInfo.url);
             return false;
         }
-        debug("[DEBUG addRepository] Repository added successfully");
+        refreshNameIndexRepositories();
+        OPENSPM_DEBUG("[DEBUG addRepository] Repository added successfully");
         return true;
     }
     
     bool removeRepository(RepositoryInfo repoInfo)
     {
-        debug("[DEBUG removeRepository] Removing repository: " + repoInfo.url);
+        OPENSPM_DEBUG("[DEBUG removeRepository] Removing repository: " + repoInfo.url);
         Config *config = getConfig();
         Archive *dataArchive = getDataArchive();
         std::string reposFileContent;
-        debug("[DEBUG removeRepository] Reading repositories.yaml");
+        OPENSPM_DEBUG("[DEBUG removeRepository] Reading repositories.yaml");
         int status = dataArchive->readFile("repositories.yaml", reposFileContent);
         if (status != 0)
         {
             error("No repositories found.");
             return false;
         }
-        debug("[DEBUG removeRepository] Repositories file size: " + std::to_string(reposFileContent.size()) + " bytes");
+        OPENSPM_DEBUG("[DEBUG removeRepository] Repositories file size: " + std::to_string(reposFileContent.size()) + " bytes");
         YAML::Node reposNode = YAML::Load(reposFileContent);
         bool found = false;
         for (auto it = reposNode.begin(); it != reposNode.end(); ++it)
         {
             if (it->first.as<std::string>() == repoInfo.url)
             {
-                debug("[DEBUG removeRepository] Found repository, removing");
+                OPENSPM_DEBUG("[DEBUG removeRepository] Found repository, removing");
                 reposNode.remove(it->first);
                 found = true;
                 break;
@@ -312,24 +412,137 @@ namespace openspm
             warn("Repository not found: " + repoInfo.url);
             return false;
         }
-        debug("[DEBUG removeRepository] Converting updated list to YAML");
+        OPENSPM_DEBUG("[DEBUG removeRepository] Converting updated list to YAML");
         std::stringstream ss;
         ss << reposNode;
         std::string data = ss.str();
-        debug("[DEBUG removeRepository] Writing updated list to archive");
+        OPENSPM_DEBUG("[DEBUG removeRepository] Writing updated list to archive");
         status = dataArchive->writeFile("repositories.yaml", data);
         if (status != 0)
         {
             error("Failed to remove repository: " + repoInfo.url);
             return false;
         }
-        debug("[DEBUG removeRepository] Repository removed successfully");
+        refreshNameIndexRepositories();
+        OPENSPM_DEBUG("[DEBUG removeRepository] Repository removed successfully");
         return true;
     }
     
+    bool setRepositoryPriority(const std::string &repoUrl, int priority)
+    {
+        OPENSPM_DEBUG("[DEBUG setRepositoryPriority] " + repoUrl + ": " + std::to_string(priority));
+        YAML::Node reposNode;
+        if (!loadRepositoryFile(reposNode))
+        {
+            return false;
+        }
+        if (!reposNode[repoUrl])
+        {
+            error("Repository not found: " + repoUrl);
+            return false;
+        }
+        YAML::Node repoNode = reposNode[repoUrl];
+        if (priority != 0)
+        {
+            repoNode["priority"] = priority;
+        }
+        else if (repoNode["priority"])
+        {
+            repoNode.remove("priority");
+        }
+        if (!saveRepositoryFile(reposNode))
+        {
+            error("Failed to save repository priority: " + repoUrl);
+            return false;
+        }
+        return true;
+    }
+
+    bool pinPackage(const std::string &repoUrl, const std::string &packageName, const std::string &range)
+    {
+        OPENSPM_DEBUG("[DEBUG pinPackage] " + packageName + " " + range + " from " + repoUrl);
+        VersionRange parsed;
+        std::string parseError;
+        if (packageName.empty() || dependencyName(packageName) != packageName)
+        {
+            error("Invalid package name: " + packageName);
+            return false;
+        }
+        if (parseVersionRange(range, parsed, parseError) != 0)
+        {
+            error("Invalid version range '" + range + "': " + parseError);
+            return false;
+        }
+        YAML::Node reposNode;
+        if (!loadRepositoryFile(reposNode))
+        {
+            return false;
+        }
+        if (!reposNode[repoUrl])
+        {
+            error("Repository not found: " + repoUrl);
+            return false;
+        }
+        // A package is pinned to one repository at a time
+        for (auto it : reposNode)
+        {
+            YAML::Node pins = it.second["pins"];
+            if (pins && pins.IsMap() && pins[packageName])
+            {
+                pins.remove(packageName);
+                if (pins.size() == 0)
+                {
+                    it.second.remove("pins");
+                }
+            }
+        }
+        reposNode[repoUrl]["pins"][packageName] = range.empty() ? "*" : range;
+        if (!saveRepositoryFile(reposNode))
+        {
+            error("Failed to save pin for " + packageName);
+            return false;
+        }
+        return true;
+    }
+
+    bool unpinPackage(const std::string &packageName)
+    {
+        OPENSPM_DEBUG("[DEBUG unpinPackage] " + packageName);
+        YAML::Node reposNode;
+        if (!loadRepositoryFile(reposNode))
+        {
+            return false;
+        }
+        bool found = false;
+        for (auto it : reposNode)
+        {
+            YAML::Node pins = it.second["pins"];
+            if (pins && pins.IsMap() && pins[packageName])
+            {
+                pins.remove(packageName);
+                if (pins.size() == 0)
+                {
+                    it.second.remove("pins");
+                }
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            warn("Package is not pinned: " + packageName);
+            return false;
+        }
+        if (!saveRepositoryFile(reposNode))
+        {
+            error("Failed to remove pin for " + packageName);
+            return false;
+        }
+        return true;
+    }
+
     bool verifyRepository(const std::string &repoUrl)
     {
-        debug("[DEBUG verifyRepository] Verifying repository: " + repoUrl);
+        OPENSPM_DEBUG("[DEBUG verifyRepository] Verifying repository: " + repoUrl);
         Config *config = getConfig();
         Archive *dataArchive = getDataArchive();
         std::string reposFileContent;
@@ -0,0 +1,551 @@
+/**
+ * @file resolver.cpp
+ * @brief Implementation of conflict-directed dependency resolution
+ */
+#include <resolver.hpp>
+#include <catalog.hpp>
+#include <logger.hpp>
+#include <utils.hpp>
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace openspm
+{
+    namespace
+    {
+        /// Level of the user's requests, which are never undone
+        constexpr int RootLevel = -1;
+        constexpr size_t MaxExplanations = 8;
+        constexpr size_t MaxListedVersions = 5;
+
+        struct NameState;
+
+        struct Candidate
+        {
+            VersionKey key;
+            const PackageInfo *pkg;
+        };
+
+        struct ResolvedDependency
+        {
+            NameState *state;
+            VersionRange range;
+            const std::string *spec;  ///< As written, for messages
+        };
+
+        /// Parsed dependencies of one package version
+        struct DependencyList
+        {
+            std::vector<ResolvedDependency> dependencies;
+            std::string error;  ///< Set if a dependency could not be parsed
+        };
+
+        struct Constraint
+        {
+            int level;                 ///< Decision that imposed it
+            const PackageInfo *source; ///< nullptr for a request
+            const std::string *spec;
+            VersionRange previous;     ///< Range before this constraint, restored on undo
+        };
+
+        struct NameState
+        {
+            const std::string *name = nullptr;
+            std::vector<Constraint> constraints;
+            VersionRange range;
+            int agendaPos = -1;                   ///< Position in the agenda, -1 while not required
+            const PackageInfo *selected = nullptr;
+            VersionKey selectedKey;
+            bool versionsLoaded = false;
+            std::vector<Candidate> versions;      ///< Versions with compatible tags, oldest first
+            size_t incompatibleVersions = 0;
+        };
+
+        /// A required package; agenda entry i is decided at level i
+        struct Decision
+        {
+            NameState *state;
+            int addedBy;             ///< Level whose decision required it
+            bool started = false;
+            size_t low = 0;          ///< Candidates are versions[low, next), tried from the top
+            size_t next = 0;
+            std::set<int> conflicts; ///< Levels blamed by failed candidates
+            std::vector<std::string> reasons;
+        };
+
+        struct Nogood
+        {
+            std::vector<std::pair<NameState *, const PackageInfo *>> members;
+        };
+
+        std::string describe(const PackageInfo &pkg)
+        {
+            return pkg.name + " " + pkg.version;
+        }
+
+        void addReason(std::vector<std::string> &reasons, const std::string &reason)
+        {
+            if (reasons.size() < MaxExplanations && std::find(reasons.begin(), reasons.end(), reason) == reasons.end())
+            {
+                reasons.push_back(reason);
+            }
+        }
+
+        class Solver
+        {
+        public:
+            Solver(const Catalog &catalog, const std::string &supportedTags, ResolveResult &out, size_t maxDecisions)
+                : catalog(catalog), supportedTags(supportedTags), out(out), maxDecisions(maxDecisions)
+            {
+            }
+
+            int solve(const std::vector<Dependency> &requests)
+            {
+                requestSpecs.reserve(requests.size());
+                for (const auto &request : requests)
+                {
+                    if (catalog.findPackage(request.name) == nullptr)
+                    {
+                        out.explanation.push_back("Package not found: " + request.name);
+                        return 1;
+                    }
+                    requestSpecs.push_back(request.name);
+                }
+                for (size_t i = 0; i < requests.size(); ++i)
+                {
+                    NameState &state = stateOf(requests[i].name);
+                    impose(state, RootLevel, nullptr, &requestSpecs[i], requests[i].range);
+                }
+
+                size_t cursor = 0;
+                while (cursor < agenda.size())
+                {
+                    Decision &decision = agenda[cursor];
+                    if (!decision.started)
+                    {
+                        start(decision);
+                    }
+                    bool decided = false;
+                    while (decision.next > decision.low)
+                    {
+                        const Candidate &candidate = decision.state->versions[--decision.next];
+                        if (maxDecisions != 0 && out.decisions >= maxDecisions)
+                        {
+                            out.explanation.insert(out.explanation.begin(), "Gave up after trying " +
+                                                   std::to_string(out.decisions) + " versions.");
+                            return 1;
+                        }
+                        ++out.decisions;
+                        std::set<int> blame;
+                        std::string reason;
+                        if (tryDecide(static_cast<int>(cursor), decision, candidate, blame, reason))
+                        {
+                            decided = true;
+                            break;
+                        }
+                        decision.conflicts.insert(blame.begin(), blame.end());
+                        addReason(decision.reasons, reason);
+                    }
+                    if (decided)
+                    {
+                        ++cursor;
+                        continue;
+                    }
+
+                    // Every version failed: blame what failed them and whatever narrowed or required this package
+                    std::set<int> blame = decision.conflicts;
+                    for (const auto &constraint : decision.state->constraints)
+                    {
+                        if (constraint.level != RootLevel)
+                        {
+                            blame.insert(constraint.level);
+                        }
+                    }
+                    blame.erase(static_cast<int>(cursor));
+                    if (blame.empty())
+                    {
+                        // Only the requests themselves are left to blame
+                        out.explanation.push_back("Cannot install " + *decision.state->name + ":");
+                        if (decision.reasons.empty())
+                        {
+                            out.explanation.push_back(summarize(*decision.state));
+                        }
+                        for (const auto &reason : decision.reasons)
+                        {
+                            addReason(out.explanation, reason);
+                        }
+                        return 1;
+                    }
+                    std::string summary = summarize(*decision.state);
+                    learn(blame);
+                    int target = *blame.rbegin();
+                    blame.erase(target);
+                    std::vector<std::string> carried{summary};
+                    carried.insert(carried.end(), decision.reasons.begin(), decision.reasons.end());
+                    if (target + 1 < static_cast<int>(cursor))
+                    {
+                        ++out.backjumps;
+                    }
+                    backjump(target, cursor);
+                    Decision &resumed = agenda[static_cast<size_t>(target)];
+                    resumed.conflicts.insert(blame.begin(), blame.end());
+                    for (const auto &reason : carried)
+                    {
+                        addReason(resumed.reasons, reason);
+                    }
+                    cursor = static_cast<size_t>(target);
+                }
+                buildPlan(requests);
+                return 0;
+            }
+
+        private:
+            NameState &stateOf(const std::string &name)
+            {
+                auto it = states.find(name);
+                if (it == states.end())
+                {
+                    it = states.emplace(name, NameState()).first;
+                    it->second.name = &it->first;
+                }
+                return it->second;
+            }
+
+            bool compatible(const PackageInfo &pkg)
+            {
+                auto it = tagsCompatible.find(pkg.tags);
+                if (it == tagsCompatible.end())
+                {
+                    it = tagsCompatible.emplace(pkg.tags, areTagsCompatible(supportedTags, pkg.tags)).first;
+                }
+                return it->second;
+            }
+
+            const std::vector<Candidate> &versionsOf(NameState &state)
+            {
+                if (!state.versionsLoaded)
+                {
+                    state.versionsLoaded = true;
+                    for (const PackageInfo *pkg : catalog.findVersions(*state.name))
+                    {
+                        if (compatible(*pkg))
+                            state.versions.push_back({catalog.versionOf(*pkg), pkg});
+                        else
+                            ++state.incompatibleVersions;
+                    }
+                }
+                return state.versions;
+            }
+
+            /// Candidates within @p range are versions[low, high)
+            void slice(NameState &state, const VersionRange &range, size_t &low, size_t &high)
+            {
+                const std::vector<Candidate> &versions = versionsOf(state);
+                auto first = std::partition_point(versions.begin(), versions.end(), [&range](const Candidate &c)
+                                                  { return range.lowInclusive ? c.key < range.low : c.key <= range.low; });
+                auto last = std::partition_point(first, versions.end(), [&range](const Candidate &c)
+                                                 { return range.highInclusive ? c.key <= range.high : c.key < range.high; });
+                low = static_cast<size_t>(first - versions.begin());
+                high = static_cast<size_t>(last - versions.begin());
+            }
+
+            bool hasCandidate(NameState &state, const VersionRange &range)
+            {
+                size_t low;
+                size_t high;
+                slice(state, range, low, high);
+                return low < high;
+            }
+
+            const DependencyList &dependenciesOf(const PackageInfo &pkg)
+            {
+                auto it = dependencyCache.find(&pkg);
+                if (it != dependencyCache.end())
+                {
+                    return it->second;
+                }
+                DependencyList list;
+                for (const auto &spec : pkg.dependencies)
+                {
+                    Dependency dep;
+                    std::string parseError;
+                    if (parseDependency(spec, dep, parseError) != 0)
+                    {
+                        list.error = describe(pkg) + " has an invalid dependency: " + parseError;
+                        list.dependencies.clear();
+                        break;
+                    }
+                    list.dependencies.push_back({&stateOf(dep.name), dep.range, &spec});
+                }
+                return dependencyCache.emplace(&pkg, std::move(list)).first->second;
+            }
+
+            void impose(NameState &state, int level, const PackageInfo *source, const std::string *spec, const VersionRange &range)
+            {
+                state.constraints.push_back({level, source, spec, state.range});
+                state.range.intersect(range);
+                if (state.agendaPos < 0)
+                {
+                    state.agendaPos = static_cast<int>(agenda.size());
+                    Decision decision;
+                    decision.state = &state;
+                    decision.addedBy = level;
+                    agenda.push_back(std::move(decision));
+                }
+            }
+
+            void start(Decision &decision)
+            {
+                size_t high;
+                slice(*decision.state, decision.state->range, decision.low, high);
+                decision.next = high;
+                decision.conflicts.clear();
+                decision.reasons.clear();
+                decision.started = true;
+            }
+
+            std::string requiredBy(const NameState &state)
+            {
+                std::string out;
+                for (const auto &constraint : state.constraints)
+                {
+                    if (constraint.source != nullptr)
+                    {
+                        out += (out.empty() ? " (required by " : ", ") + describe(*constraint.source);
+                    }
+                }
+                return out.empty() ? out : out + ")";
+            }
+
+            std::string availableVersions(NameState &state)
+            {
+                const std::vector<Candidate> &versions = versionsOf(state);
+                if (versions.empty())
+                {
+                    return state.incompatibleVersions > 0 ? "no version of " + *state.name + " is compatible with the system tags"
+                                                          : *state.name + " is not in any repository";
+                }
+                std::string out = "available: ";
+                size_t shown = std::min(versions.size(), MaxListedVersions);
+                for (size_t i = 0; i < shown; ++i)
+                {
+                    out += (i == 0 ? "" : ", ") + versions[versions.size() - 1 - i].pkg->version;
+                }
+                return out + (versions.size() > shown ? ", ..." : "");
+            }
+
+            std::string summarize(NameState &state)
+            {
+                std::string specs;
+                for (const auto &constraint : state.constraints)
+                {
+                    specs += (specs.empty() ? "" : ", ") + *constraint.spec;
+                    if (constraint.source != nullptr)
+                    {
+                        specs += " from " + describe(*constraint.source);
+                    }
+                }
+                return "no usable version of " + *state.name + " for " + specs + " (" + availableVersions(state) + ")";
+            }
+
+            bool tryDecide(int level, Decision &decision, const Candidate &candidate, std::set<int> &blame, std::string &reason)
+            {
+                const PackageInfo &pkg = *candidate.pkg;
+                const DependencyList &list = dependenciesOf(pkg);
+                if (!list.error.empty())
+                {
+                    reason = list.error;
+                    return false;
+                }
+
+                auto learned = nogoodIndex.find(&pkg);
+                if (learned != nogoodIndex.end())
+                {
+                    for (size_t id : learned->second)
+                    {
+                        bool holds = true;
+                        for (const auto &[state, member] : nogoods[id].members)
+                        {
+                            holds = holds && (member == &pkg || state->selected == member);
+                        }
+                        if (holds)
+                        {
+                            for (const auto &[state, member] : nogoods[id].members)
+                            {
+                                if (member != &pkg)
+                                    blame.insert(state->agendaPos);
+                            }
+                            reason = describe(pkg) + " was already ruled out together with the packages chosen before it";
+                            return false;
+                        }
+                    }
+                }
+
+                for (const auto &dep : list.dependencies)
+                {
+                    NameState &target = *dep.state;
+                    if (&target == decision.state)
+                    {
+                        if (!dep.range.contains(candidate.key))
+                        {
+                            reason = describe(pkg) + " requires " + *dep.spec + ", which excludes itself";
+                            return false;
+                        }
+                        continue;
+                    }
+                    if (target.selected != nullptr)
+                    {
+                        if (!dep.range.contains(target.selectedKey))
+                        {
+                            blame.insert(target.agendaPos);
+                            reason = describe(pkg) + " requires " + *dep.spec + ", but " + describe(*target.selected) +
+                                     " is selected" + requiredBy(target);
+                            return false;
+                        }
+                        continue;
+                    }
+                    VersionRange combined = target.range;
+                    combined.intersect(dep.range);
+                    if (!hasCandidate(target, combined))
+                    {
+                        if (!hasCandidate(target, dep.range))
+                        {
+                            reason = describe(pkg) + " requires " + *dep.spec + ", but " +
+                                     (versionsOf(target).empty() ? availableVersions(target)
+                                                                 : "no version of " + *target.name + " matches (" + availableVersions(target) + ")");
+                            return false;
+                        }
+                        for (const auto &constraint : target.constraints)
+                        {
+                            if (constraint.level != RootLevel)
+                                blame.insert(constraint.level);
+                        }
+                        reason = describe(pkg) + " requires " + *dep.spec + ", which conflicts with the other requirements on " +
+                                 *target.name + requiredBy(target);
+                        return false;
+                    }
+                }
+
+                decision.state->selected = &pkg;
+                decision.state->selectedKey = candidate.key;
+                for (const auto &dep : list.dependencies)
+                {
+                    impose(*dep.state, level, &pkg, dep.spec, dep.range);
+                }
+                return true;
+            }
+
+            /// Undo the selection at @p level, dropping constraints and requirements it added
+            void undoSelection(int level)
+            {
+                Decision &decision = agenda[static_cast<size_t>(level)];
+                const PackageInfo *pkg = decision.state->selected;
+                if (pkg == nullptr)
+                {
+                    return;
+                }
+                const DependencyList &list = dependenciesOf(*pkg);
+                for (auto it = list.dependencies.rbegin(); it != list.dependencies.rend(); ++it)
+                {
+                    NameState &target = *it->state;
+                    target.range = target.constraints.back().previous;
+                    target.constraints.pop_back();
+                }
+                while (!agenda.empty() && agenda.back().addedBy == level)
+                {
+                    agenda.back().state->agendaPos = -1;
+                    agenda.pop_back();
+                }
+                decision.state->selected = nullptr;
+            }
+
+            void backjump(int target, size_t cursor)
+            {
+                for (int level = static_cast<int>(cursor); level > target; --level)
+                {
+                    if (static_cast<size_t>(level) < agenda.size())
+                    {
+                        undoSelection(level);
+                    }
+                    if (static_cast<size_t>(level) < agenda.size())
+                    {
+                        agenda[static_cast<size_t>(level)].started = false;
+                    }
+                }
+                undoSelection(target);
+            }
+
+            void learn(const std::set<int> &levels)
+            {
+                Nogood nogood;
+                for (int level : levels)
+                {
+                    NameState *state = agenda[static_cast<size_t>(level)].state;
+                    nogood.members.emplace_back(state, state->selected);
+                }
+                for (const auto &member : nogood.members)
+                {
+                    nogoodIndex[member.second].push_back(nogoods.size());
+                }
+                nogoods.push_back(std::move(nogood));
+            }
+
+            /// Dependencies before dependents, in declaration order, like a depth-first walk
+            void buildPlan(const std::vector<Dependency> &requests)
+            {
+                std::unordered_set<const PackageInfo *> visited;
+                std::vector<std::pair<const PackageInfo *, size_t>> stack;
+                for (const auto &request : requests)
+                {
+                    const PackageInfo *root = stateOf(request.name).selected;
+                    if (root == nullptr || !visited.insert(root).second)
+                    {
+                        continue;
+                    }
+                    stack.emplace_back(root, 0);
+                    while (!stack.empty())
+                    {
+                        auto &[pkg, nextDep] = stack.back();
+                        const DependencyList &list = dependenciesOf(*pkg);
+                        if (nextDep < list.dependencies.size())
+                        {
+                            const PackageInfo *dep = list.dependencies[nextDep++].state->selected;
+                            if (dep != nullptr && visited.insert(dep).second)
+                            {
+                                stack.emplace_back(dep, 0);
+                            }
+                            continue;
+                        }
+                        out.plan.push_back(*pkg);
+                        stack.pop_back();
+                    }
+                }
+            }
+
+            const Catalog &catalog;
+            const std::string &supportedTags;
+            ResolveResult &out;
+            size_t maxDecisions;
+            std::vector<std::string> requestSpecs;
+            std::unordered_map<std::string, NameState> states;
+            std::unordered_map<std::string, bool> tagsCompatible;
+            std::unordered_map<const PackageInfo *, DependencyList> dependencyCache;
+            std::vector<Decision> agenda;
+            std::vector<Nogood> nogoods;
+            std::unordered_map<const PackageInfo *, std::vector<size_t>> nogoodIndex;
+        };
+    } // namespace
+
+    int resolveDependencies(const Catalog &catalog, const std::vector<Dependency> &requests,
+                            const std::string &supportedTags, ResolveResult &out, size_t maxDecisions)
+    {
+        out = ResolveResult();
+        Solver solver(catalog, supportedTags, out, maxDecisions);
+        int status = solver.solve(requests);
+        OPENSPM_DEBUG("[DEBUG resolveDependencies] " + std::string(status == 0 ? "Resolved " : "Failed after ") +
+                      std::to_string(out.decisions) + " decisions, " + std::to_string(out.backjumps) + " backjumps");
+        return status;
+    }
+} // namespace openspm
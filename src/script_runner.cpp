@@ -0,0 +1,433 @@
+/**
+ * @file script_runner.cpp
+ * @brief Implementation of the post-install script runner
+ *
+ * On POSIX systems scripts are started with posix_spawn in their own
+ * process group, with stdout/stderr piped back and forwarded line by line
+ * to the log. A poll loop multiplexes all running scripts and enforces
+ * timeouts (SIGTERM, then SIGKILL after a grace period). Windows runs
+ * the scripts one after another through cmd.
+ */
+#include <script_runner.hpp>
+#include <logger.hpp>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstring>
+#include <cerrno>
+#ifndef _WIN32
+#include <spawn.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char **environ;
+#endif
+
+namespace openspm
+{
+    using namespace logger;
+
+    namespace
+    {
+        enum class JobState
+        {
+            Pending,
+            Running,
+            Succeeded,
+            Failed
+        };
+    } // namespace
+
+#ifndef _WIN32
+    namespace
+    {
+        using Clock = std::chrono::steady_clock;
+        const auto killGracePeriod = std::chrono::seconds(5);
+
+        /// A spawned script and its captured output
+        struct RunningScript
+        {
+            size_t job = 0;
+            pid_t pid = -1;
+            int fds[2] = {-1, -1}; ///< stdout, stderr read ends
+            std::string buffers[2];
+            bool hasDeadline = false;
+            Clock::time_point deadline;
+            bool timedOut = false;
+            Clock::time_point killAt;
+        };
+    } // namespace
+
+    /// Inherited environment with the job's entries overriding same-named variables
+    static std::vector<std::string> buildEnvironment(const std::vector<std::string> &extra)
+    {
+        std::unordered_set<std::string> overridden;
+        for (const auto &entry : extra)
+        {
+            overridden.insert(entry.substr(0, entry.find('=')));
+        }
+        std::vector<std::string> env;
+        for (char **p = environ; p != nullptr && *p != nullptr; ++p)
+        {
+            std::string entry(*p);
+            if (overridden.count(entry.substr(0, entry.find('='))) == 0)
+            {
+                env.push_back(std::move(entry));
+            }
+        }
+        env.insert(env.end(), extra.begin(), extra.end());
+        return env;
+    }
+
+    /// Forward complete lines from a capture buffer to the log
+    static void flushLines(const std::string &name, std::string &buffer, bool final)
+    {
+        size_t start = 0;
+        size_t newline;
+        while ((newline = buffer.find('\n', start)) != std::string::npos)
+        {
+            std::string line = "[" + name + "] " + buffer.substr(start, newline - start);
+            record(line);
+            OPENSPM_DEBUG("[DEBUG runScripts] " + line);
+            start = newline + 1;
+        }
+        buffer.erase(0, start);
+        if (final && !buffer.empty())
+        {
+            std::string line = "[" + name + "] " + buffer;
+            record(line);
+            OPENSPM_DEBUG("[DEBUG runScripts] " + line);
+            buffer.clear();
+        }
+    }
+
+    /// Read whatever is available on a script's pipes; closes a pipe on EOF
+    static void drainOutput(const ScriptJob &job, RunningScript &script)
+    {
+        char chunk[4096];
+        for (int i = 0; i < 2; ++i)
+        {
+            while (script.fds[i] >= 0)
+            {
+                ssize_t n = read(script.fds[i], chunk, sizeof(chunk));
+                if (n > 0)
+                {
+                    script.buffers[i].append(chunk, static_cast<size_t>(n));
+                    flushLines(job.name, script.buffers[i], false);
+                    continue;
+                }
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                    break;
+                if (n < 0 && errno == EINTR)
+                    continue;
+                close(script.fds[i]);
+                script.fds[i] = -1;
+                flushLines(job.name, script.buffers[i], true);
+            }
+        }
+    }
+
+    static bool spawnScript(const ScriptJob &job, unsigned timeoutSeconds, RunningScript &outScript)
+    {
+        int outPipe[2];
+        int errPipe[2];
+        if (pipe(outPipe) != 0)
+        {
+            error("Failed to create pipe for script: " + job.name);
+            return false;
+        }
+        if (pipe(errPipe) != 0)
+        {
+            close(outPipe[0]);
+            close(outPipe[1]);
+            error("Failed to create pipe for script: " + job.name);
+            return false;
+        }
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+        posix_spawn_file_actions_adddup2(&actions, outPipe[1], 1);
+        posix_spawn_file_actions_adddup2(&actions, errPipe[1], 2);
+        posix_spawn_file_actions_addclose(&actions, outPipe[0]);
+        posix_spawn_file_actions_addclose(&actions, errPipe[0]);
+        posix_spawn_file_actions_addclose(&actions, outPipe[1]);
+        posix_spawn_file_actions_addclose(&actions, errPipe[1]);
+
+        // Own process group, so a timeout also reaches anything the script started
+        posix_spawnattr_t attr;
+        posix_spawnattr_init(&attr);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+        posix_spawnattr_setpgroup(&attr, 0);
+
+        std::vector<std::string> env = buildEnvironment(job.env);
+        std::vector<char *> envp;
+        envp.reserve(env.size() + 1);
+        for (auto &entry : env)
+        {
+            envp.push_back(&entry[0]);
+        }
+        envp.push_back(nullptr);
+
+        std::string shell = "/bin/sh";
+        std::string commandFlag = "-c";
+        std::string script = job.command.empty() ? job.scriptPath : job.command;
+        char *scriptArgv[] = {&shell[0], &script[0], nullptr};
+        char *commandArgv[] = {&shell[0], &commandFlag[0], &script[0], nullptr};
+        char **argv = job.command.empty() ? scriptArgv : commandArgv;
+
+        pid_t pid = -1;
+        int rc = posix_spawn(&pid, shell.c_str(), &actions, &attr, argv, envp.data());
+        posix_spawn_file_actions_destroy(&actions);
+        posix_spawnattr_destroy(&attr);
+        close(outPipe[1]);
+        close(errPipe[1]);
+        if (rc != 0)
+        {
+            close(outPipe[0]);
+            close(errPipe[0]);
+            error("Failed to start post-install script for " + job.name + ": " + std::strerror(rc));
+            return false;
+        }
+
+        outScript.pid = pid;
+        outScript.fds[0] = outPipe[0];
+        outScript.fds[1] = errPipe[0];
+        for (int fd : outScript.fds)
+        {
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        }
+        if (timeoutSeconds > 0)
+        {
+            outScript.hasDeadline = true;
+            outScript.deadline = Clock::now() + std::chrono::seconds(timeoutSeconds);
+        }
+        OPENSPM_DEBUG("[DEBUG runScripts] Started " + script + " for " + job.name + " (pid " + std::to_string(pid) + ")");
+        return true;
+    }
+#endif
+
+    int runScripts(const std::vector<ScriptJob> &jobs, unsigned maxParallel, unsigned timeoutSeconds,
+                   std::vector<ScriptResult> &outResults)
+    {
+        if (jobs.empty())
+        {
+            return 0;
+        }
+        if (maxParallel == 0)
+        {
+            maxParallel = std::max(1u, std::thread::hardware_concurrency());
+        }
+        OPENSPM_DEBUG("[DEBUG runScripts] Running " + std::to_string(jobs.size()) + " scripts, up to " + std::to_string(maxParallel) + " at a time");
+
+        std::unordered_map<std::string, size_t> indexByName;
+        for (size_t i = 0; i < jobs.size(); ++i)
+        {
+            indexByName[jobs[i].name] = i;
+        }
+        std::vector<JobState> states(jobs.size(), JobState::Pending);
+        size_t finished = 0;
+        int status = 0;
+
+        auto finish = [&](size_t job, const ScriptResult &result, bool success)
+        {
+            states[job] = success ? JobState::Succeeded : JobState::Failed;
+            outResults.push_back(result);
+            finished++;
+            if (!success)
+                status = 1;
+        };
+
+#ifndef _WIN32
+        std::vector<RunningScript> running;
+#endif
+        while (finished < jobs.size())
+        {
+            bool progressed = false;
+            for (size_t i = 0; i < jobs.size(); ++i)
+            {
+                if (states[i] != JobState::Pending)
+                    continue;
+                bool blocked = false;
+                bool depFailed = false;
+                for (const auto &dep : jobs[i].after)
+                {
+                    auto it = indexByName.find(dep);
+                    if (it == indexByName.end() || it->second == i)
+                        continue;
+                    if (states[it->second] == JobState::Failed)
+                        depFailed = true;
+                    else if (states[it->second] != JobState::Succeeded)
+                        blocked = true;
+                }
+                if (depFailed)
+                {
+                    ScriptResult result;
+                    result.name = jobs[i].name;
+                    result.skipped = true;
+                    error("Skipping post-install script for " + jobs[i].name + ": a dependency's script failed");
+                    finish(i, result, false);
+                    progressed = true;
+                    continue;
+                }
+                if (blocked)
+                    continue;
+#ifdef _WIN32
+                std::string command;
+                for (const auto &entry : jobs[i].env)
+                {
+                    command += "set " + entry + " && ";
+                }
+                if (jobs[i].command.empty())
+                    command += "cmd /c \"" + jobs[i].scriptPath + "\" > nul";
+                else
+                    command += jobs[i].command + " > nul";
+                ScriptResult result;
+                result.name = jobs[i].name;
+                result.exitCode = system(command.c_str());
+                if (result.exitCode != 0)
+                {
+                    error("Post-install script failed for package: " + jobs[i].name);
+                }
+                finish(i, result, result.exitCode == 0);
+                progressed = true;
+#else
+                if (running.size() >= maxParallel)
+                    break;
+                RunningScript script;
+                script.job = i;
+                if (!spawnScript(jobs[i], timeoutSeconds, script))
+                {
+                    ScriptResult result;
+                    result.name = jobs[i].name;
+                    finish(i, result, false);
+                }
+                else
+                {
+                    states[i] = JobState::Running;
+                    running.push_back(std::move(script));
+                }
+                progressed = true;
+#endif
+            }
+
+#ifndef _WIN32
+            bool idle = running.empty();
+#else
+            bool idle = true;
+#endif
+            if (idle)
+            {
+                if (!progressed)
+                {
+                    // Only reachable with an ordering cycle, which callers break by plan order; run nothing rather than hang
+                    for (size_t i = 0; i < jobs.size(); ++i)
+                    {
+                        if (states[i] == JobState::Pending)
+                        {
+                            ScriptResult result;
+                            result.name = jobs[i].name;
+                            result.skipped = true;
+                            error("Skipping post-install script for " + jobs[i].name + ": circular ordering");
+                            finish(i, result, false);
+                        }
+                    }
+                }
+                continue;
+            }
+
+#ifndef _WIN32
+            std::vector<pollfd> pollFds;
+            auto now = Clock::now();
+            auto wake = now + std::chrono::milliseconds(200);
+            for (const auto &script : running)
+            {
+                for (int fd : script.fds)
+                {
+                    if (fd >= 0)
+                        pollFds.push_back({fd, POLLIN, 0});
+                }
+                if (script.hasDeadline && !script.timedOut && script.deadline < wake)
+                    wake = script.deadline;
+                if (script.timedOut && script.killAt < wake)
+                    wake = script.killAt;
+            }
+            int waitMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count());
+            if (waitMs < 0)
+                waitMs = 0;
+            if (pollFds.empty())
+                std::this_thread::sleep_for(std::chrono::milliseconds(std::min(waitMs, 20)));
+            else
+                poll(pollFds.data(), pollFds.size(), waitMs);
+
+            now = Clock::now();
+            for (size_t r = 0; r < running.size();)
+            {
+                RunningScript &script = running[r];
+                const ScriptJob &job = jobs[script.job];
+                drainOutput(job, script);
+
+                if (script.hasDeadline && !script.timedOut && now >= script.deadline)
+                {
+                    warn("Post-install script for " + job.name + " timed out after " + std::to_string(timeoutSeconds) + "s, terminating");
+                    kill(-script.pid, SIGTERM);
+                    script.timedOut = true;
+                    script.killAt = now + killGracePeriod;
+                }
+                else if (script.timedOut && now >= script.killAt)
+                {
+                    kill(-script.pid, SIGKILL);
+                }
+
+                int waitStatus = 0;
+                pid_t done = waitpid(script.pid, &waitStatus, WNOHANG);
+                if (done == 0 || (done < 0 && errno == EINTR))
+                {
+                    ++r;
+                    continue;
+                }
+
+                // Exited: collect what is left and stop listening, even if a
+                // background child still holds the pipes open.
+                drainOutput(job, script);
+                for (int i = 0; i < 2; ++i)
+                {
+                    if (script.fds[i] >= 0)
+                    {
+                        close(script.fds[i]);
+                        script.fds[i] = -1;
+                    }
+                    flushLines(job.name, script.buffers[i], true);
+                }
+
+                ScriptResult result;
+                result.name = job.name;
+                result.timedOut = script.timedOut;
+                if (done > 0 && WIFEXITED(waitStatus))
+                    result.exitCode = WEXITSTATUS(waitStatus);
+                bool success = result.exitCode == 0 && !result.timedOut;
+                if (success)
+                {
+                    OPENSPM_DEBUG("[DEBUG runScripts] Post-install script executed successfully for " + job.name);
+                }
+                else if (result.timedOut)
+                {
+                    error("Post-install script timed out for package: " + job.name);
+                }
+                else
+                {
+                    error("Post-install script failed for package: " + job.name + " (exit code " + std::to_string(result.exitCode) + ")");
+                }
+                finish(script.job, result, success);
+                running.erase(running.begin() + static_cast<std::ptrdiff_t>(r));
+            }
+#endif
+        }
+        return status;
+    }
+} // namespace openspm
@@ -0,0 +1,395 @@
+/**
+ * @file search_index.cpp
+ * @brief Implementation of the trigram search index
+ *
+ * Candidates come from intersecting the posting lists of every trigram in
+ * the query terms; each candidate is then checked for the actual terms
+ * and scored.
+ */
+#include <search_index.hpp>
+#include <logger.hpp>
+#include <utils.hpp>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace openspm
+{
+    using namespace logger;
+
+    namespace
+    {
+        constexpr char Magic[8] = {'O', 'S', 'P', 'M', 'I', 'D', 'X', '1'};
+        constexpr size_t TableEntrySize = 12;
+
+        char lower(char c)
+        {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        std::uint32_t trigramAt(std::string_view text, size_t i)
+        {
+            return (static_cast<std::uint32_t>(static_cast<unsigned char>(lower(text[i]))) << 16) |
+                   (static_cast<std::uint32_t>(static_cast<unsigned char>(lower(text[i + 1]))) << 8) |
+                   static_cast<std::uint32_t>(static_cast<unsigned char>(lower(text[i + 2])));
+        }
+
+        void putVarint(std::string &out, std::uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<char>(value));
+        }
+
+        bool getVarint(const char *&p, const char *end, std::uint64_t &value)
+        {
+            value = 0;
+            for (int shift = 0; p < end && shift < 64; shift += 7)
+            {
+                unsigned char byte = static_cast<unsigned char>(*p++);
+                value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// Case-insensitive substring search; needle must already be lowercase
+        size_t findInsensitive(std::string_view haystack, std::string_view needle)
+        {
+            if (needle.size() > haystack.size())
+            {
+                return std::string_view::npos;
+            }
+            for (size_t i = 0; i + needle.size() <= haystack.size(); ++i)
+            {
+                size_t j = 0;
+                while (j < needle.size() && lower(haystack[i + j]) == needle[j])
+                {
+                    ++j;
+                }
+                if (j == needle.size())
+                {
+                    return i;
+                }
+            }
+            return std::string_view::npos;
+        }
+
+        /// Same rule as areTagsCompatible(), without allocating per document
+        bool tagsCompatible(const std::vector<std::string> &supported, std::string_view packageTags)
+        {
+            size_t start = 0;
+            while (start <= packageTags.size())
+            {
+                size_t end = packageTags.find(';', start);
+                if (end == std::string_view::npos)
+                    end = packageTags.size();
+                std::string_view tag = packageTags.substr(start, end - start);
+                if (!tag.empty() && std::find(supported.begin(), supported.end(), tag) == supported.end())
+                {
+                    return false;
+                }
+                start = end + 1;
+            }
+            return true;
+        }
+
+        void intersect(std::vector<std::uint32_t> &into, const std::vector<std::uint32_t> &other)
+        {
+            std::vector<std::uint32_t> result;
+            std::set_intersection(into.begin(), into.end(), other.begin(), other.end(), std::back_inserter(result));
+            into.swap(result);
+        }
+    } // namespace
+
+    std::string buildSearchIndex(const std::vector<PackageInfo> &packages)
+    {
+        std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> postingLists;
+        std::string out(Magic, sizeof(Magic));
+        putU32(out, static_cast<std::uint32_t>(packages.size()));
+        size_t trigramCountOffset = out.size();
+        putU32(out, 0);
+
+        for (std::uint32_t doc = 0; doc < packages.size(); ++doc)
+        {
+            const PackageInfo &pkg = packages[doc];
+            for (const std::string *field : {&pkg.name, &pkg.version, &pkg.description, &pkg.maintainer, &pkg.tags})
+            {
+                putVarint(out, field->size());
+                out += *field;
+            }
+            for (const std::string *field : {&pkg.name, &pkg.description, &pkg.maintainer})
+            {
+                for (size_t i = 0; i + 3 <= field->size(); ++i)
+                {
+                    std::vector<std::uint32_t> &list = postingLists[trigramAt(*field, i)];
+                    // Documents are visited in order, so duplicates are always at the back
+                    if (list.empty() || list.back() != doc)
+                    {
+                        list.push_back(doc);
+                    }
+                }
+            }
+        }
+
+        std::vector<std::uint32_t> keys;
+        keys.reserve(postingLists.size());
+        for (const auto &entry : postingLists)
+        {
+            keys.push_back(entry.first);
+        }
+        std::sort(keys.begin(), keys.end());
+
+        std::string table;
+        std::string postingBytes;
+        table.reserve(keys.size() * TableEntrySize);
+        for (std::uint32_t key : keys)
+        {
+            const std::vector<std::uint32_t> &list = postingLists[key];
+            putU32(table, key);
+            putU32(table, static_cast<std::uint32_t>(postingBytes.size()));
+            putU32(table, static_cast<std::uint32_t>(list.size()));
+            std::uint32_t previous = 0;
+            for (std::uint32_t doc : list)
+            {
+                putVarint(postingBytes, doc - previous);
+                previous = doc;
+            }
+        }
+
+        std::string count;
+        putU32(count, static_cast<std::uint32_t>(keys.size()));
+        out.replace(trigramCountOffset, 4, count);
+        out += table;
+        out += postingBytes;
+        OPENSPM_DEBUG("[DEBUG buildSearchIndex] Indexed " + std::to_string(packages.size()) + " packages, " +
+                      std::to_string(keys.size()) + " trigrams, " + std::to_string(out.size()) + " bytes");
+        return out;
+    }
+
+    int SearchIndex::load(std::string data)
+    {
+        blob = std::move(data);
+        docs.clear();
+        const char *p = blob.data();
+        const char *end = p + blob.size();
+        if (blob.size() < sizeof(Magic) + 8 || std::memcmp(p, Magic, sizeof(Magic)) != 0)
+        {
+            error("Search index is corrupt or from an incompatible version.");
+            return 1;
+        }
+        p += sizeof(Magic);
+        std::uint32_t docCount = getU32(p);
+        trigramCount = getU32(p + 4);
+        p += 8;
+
+        docs.reserve(docCount);
+        for (std::uint32_t i = 0; i < docCount; ++i)
+        {
+            Doc doc;
+            for (std::string_view *field : {&doc.name, &doc.version, &doc.description, &doc.maintainer, &doc.tags})
+            {
+                std::uint64_t length;
+                if (!getVarint(p, end, length) || length > static_cast<std::uint64_t>(end - p))
+                {
+                    error("Search index is truncated.");
+                    return 1;
+                }
+                *field = std::string_view(p, length);
+                p += length;
+            }
+            docs.push_back(doc);
+        }
+        if (static_cast<size_t>(end - p) < static_cast<size_t>(trigramCount) * TableEntrySize)
+        {
+            error("Search index is truncated.");
+            return 1;
+        }
+        table = p;
+        postingData = p + static_cast<size_t>(trigramCount) * TableEntrySize;
+        postingSize = static_cast<size_t>(end - postingData);
+        OPENSPM_DEBUG("[DEBUG SearchIndex::load] Loaded " + std::to_string(docs.size()) + " documents, " + std::to_string(trigramCount) + " trigrams");
+        return 0;
+    }
+
+    bool SearchIndex::postings(std::uint32_t trigram, std::vector<std::uint32_t> &out) const
+    {
+        out.clear();
+        std::uint32_t lo = 0;
+        std::uint32_t hi = trigramCount;
+        while (lo < hi)
+        {
+            std::uint32_t mid = lo + (hi - lo) / 2;
+            std::uint32_t key = getU32(table + static_cast<size_t>(mid) * TableEntrySize);
+            if (key < trigram)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo == trigramCount || getU32(table + static_cast<size_t>(lo) * TableEntrySize) != trigram)
+        {
+            return false;
+        }
+        const char *entry = table + static_cast<size_t>(lo) * TableEntrySize;
+        std::uint32_t offset = getU32(entry + 4);
+        std::uint32_t count = getU32(entry + 8);
+        if (offset > postingSize)
+        {
+            return false;
+        }
+        const char *p = postingData + offset;
+        const char *end = postingData + postingSize;
+        out.reserve(count);
+        std::uint64_t doc = 0;
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            std::uint64_t delta;
+            if (!getVarint(p, end, delta))
+            {
+                return false;
+            }
+            doc += delta;
+            out.push_back(static_cast<std::uint32_t>(doc));
+        }
+        return true;
+    }
+
+    std::vector<SearchResult> SearchIndex::search(const std::string &query, const std::string &supportedTags,
+                                                  size_t limit, size_t &outTotal) const
+    {
+        std::vector<std::string> terms;
+        std::string term;
+        for (char c : query + " ")
+        {
+            if (c == ' ' || c == '\t' || c == '\n')
+            {
+                if (!term.empty())
+                    terms.push_back(term);
+                term.clear();
+            }
+            else
+            {
+                term.push_back(lower(c));
+            }
+        }
+        outTotal = 0;
+        if (terms.empty())
+        {
+            return {};
+        }
+
+        // Narrow down with trigrams; terms shorter than three characters are only checked below
+        bool narrowed = false;
+        std::vector<std::uint32_t> candidates;
+        std::vector<std::uint32_t> list;
+        for (const auto &t : terms)
+        {
+            for (size_t i = 0; i + 3 <= t.size(); ++i)
+            {
+                if (!postings(trigramAt(t, i), list))
+                {
+                    return {};
+                }
+                if (!narrowed)
+                {
+                    candidates = list;
+                    narrowed = true;
+                }
+                else
+                {
+                    intersect(candidates, list);
+                }
+                if (candidates.empty())
+                {
+                    return {};
+                }
+            }
+        }
+        if (!narrowed)
+        {
+            candidates.resize(docs.size());
+            for (std::uint32_t i = 0; i < candidates.size(); ++i)
+            {
+                candidates[i] = i;
+            }
+        }
+        OPENSPM_DEBUG("[DEBUG SearchIndex::search] " + std::to_string(candidates.size()) + " trigram candidates");
+
+        struct Hit
+        {
+            std::uint32_t doc;
+            int score;
+        };
+        std::vector<Hit> hits;
+        const std::vector<std::string> supported = splitTags(supportedTags);
+        for (std::uint32_t docNumber : candidates)
+        {
+            const Doc &doc = docs[docNumber];
+            int score = 0;
+            bool allTermsFound = true;
+            for (const auto &t : terms)
+            {
+                size_t inName = findInsensitive(doc.name, t);
+                int termScore = 0;
+                if (inName != std::string_view::npos)
+                {
+                    termScore = doc.name.size() == t.size() ? 100 : inName == 0 ? 40 : 20;
+                }
+                if (findInsensitive(doc.description, t) != std::string_view::npos)
+                    termScore += 5;
+                if (findInsensitive(doc.maintainer, t) != std::string_view::npos)
+                    termScore += 2;
+                if (termScore == 0)
+                {
+                    allTermsFound = false;
+                    break;
+                }
+                score += termScore;
+            }
+            if (!allTermsFound)
+            {
+                continue;
+            }
+            if (!supportedTags.empty() && !tagsCompatible(supported, doc.tags))
+            {
+                continue;
+            }
+            // Candidates come in document order, so a name's versions are adjacent, oldest first
+            if (!hits.empty() && docs[hits.back().doc].name == doc.name)
+            {
+                hits.back() = {docNumber, score};
+                continue;
+            }
+            hits.push_back({docNumber, score});
+        }
+
+        outTotal = hits.size();
+        auto better = [this](const Hit &a, const Hit &b)
+        {
+            if (a.score != b.score)
+                return a.score > b.score;
+            const Doc &da = docs[a.doc];
+            const Doc &db = docs[b.doc];
+            if (da.name.size() != db.name.size())
+                return da.name.size() < db.name.size();
+            return da.name < db.name;
+        };
+        size_t keep = std::min(limit, hits.size());
+        std::partial_sort(hits.begin(), hits.begin() + keep, hits.end(), better);
+
+        std::vector<SearchResult> results;
+        results.reserve(keep);
+        for (size_t i = 0; i < keep; ++i)
+        {
+            const Doc &doc = docs[hits[i].doc];
+            results.push_back({std::string(doc.name), std::string(doc.version), std::string(doc.description), hits[i].score});
+        }
+        return results;
+    }
+} // namespace openspm
@@ -0,0 +1,433 @@
+/**
+ * @file sparse_index.cpp
+ * @brief Implementation of on-demand per-package metadata fetching
+ */
+#include <sparse_index.hpp>
+#include <catalog.hpp>
+#include <config.hpp>
+#include <logger.hpp>
+#include <metrics.hpp>
+#include <package_list_parser.hpp>
+#include <repository_manager.hpp>
+#include <trace.hpp>
+#include <utils.hpp>
+#include <version.hpp>
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#include <httplib.h>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
+
+namespace openspm
+{
+    using namespace logger;
+
+    namespace
+    {
+        /// Requests in flight at once while walking one level of the closure
+        constexpr size_t MaxParallelFetches = 8;
+
+        struct SparseRepository
+        {
+            std::string url;
+            ParsedUrl parsed;
+            std::string indexPath;           ///< Server path of the sparse index
+            std::string indexUrl;            ///< Full URL of the sparse index, for logging
+            std::filesystem::path cacheDir;  ///< Local cache for this repository
+            int priority = 0;                ///< From repositories.yaml
+            std::map<std::string, VersionRange> pins; ///< From repositories.yaml
+        };
+
+        /// Keep-alive connection to one repository, owned by one worker
+        class SparseClient
+        {
+        public:
+            explicit SparseClient(const ParsedUrl &parsed)
+            {
+                if (parsed.scheme == "https")
+                {
+                    if (parsed.port > 0)
+                        sslCli.reset(new httplib::SSLClient(parsed.host, parsed.port));
+                    else
+                        sslCli.reset(new httplib::SSLClient(parsed.host));
+                    sslCli->set_keep_alive(true);
+                }
+                else
+                {
+                    if (parsed.port > 0)
+                        cli.reset(new httplib::Client(parsed.host, parsed.port));
+                    else
+                        cli.reset(new httplib::Client(parsed.host));
+                    cli->set_keep_alive(true);
+                }
+            }
+
+            httplib::Result get(const std::string &path, const httplib::Headers &headers)
+            {
+                return sslCli ? sslCli->Get(path.c_str(), headers) : cli->Get(path.c_str(), headers);
+            }
+
+        private:
+            std::unique_ptr<httplib::Client> cli;
+            std::unique_ptr<httplib::SSLClient> sslCli;
+        };
+
+        enum class LookupStatus
+        {
+            Found,
+            NotFound,
+            Failed
+        };
+
+        struct Lookup
+        {
+            LookupStatus status = LookupStatus::NotFound;
+            std::vector<PackageInfo> versions;
+        };
+
+        bool readText(const std::filesystem::path &path, std::string &out)
+        {
+            std::ifstream file(path, std::ios::binary);
+            if (!file)
+            {
+                return false;
+            }
+            out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            return true;
+        }
+
+        /// Written to a temporary file and renamed, so concurrent readers never see half a document
+        void writeCache(const std::filesystem::path &path, const std::string &body,
+                        const std::string &etag, const std::string &lastModified)
+        {
+            std::error_code ec;
+            std::filesystem::create_directories(path.parent_path(), ec);
+            std::filesystem::path metaPath = path;
+            metaPath += ".meta";
+            for (const auto &[target, content] : {std::make_pair(path, body),
+                                                  std::make_pair(metaPath, etag + "\n" + lastModified + "\n")})
+            {
+                std::filesystem::path tempPath = target;
+                tempPath += ".tmp";
+                {
+                    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+                    if (!file || !file.write(content.data(), static_cast<std::streamsize>(content.size())))
+                    {
+                        OPENSPM_DEBUG("[DEBUG writeCache] Failed to write " + tempPath.string());
+                        std::filesystem::remove(tempPath, ec);
+                        return;
+                    }
+                }
+                std::filesystem::rename(tempPath, target, ec);
+            }
+        }
+
+        void removeCache(const std::filesystem::path &path)
+        {
+            std::error_code ec;
+            std::filesystem::path metaPath = path;
+            metaPath += ".meta";
+            std::filesystem::remove(path, ec);
+            std::filesystem::remove(metaPath, ec);
+        }
+
+        /// A document lists every version of the package; entries for other names are ignored
+        int pickPackage(std::string &document, const std::string &name, Lookup &out, std::string &parseError)
+        {
+            std::vector<std::string> depend;
+            out.status = LookupStatus::NotFound;
+            out.versions.clear();
+            return parsePackageListJson(document, [&](PackageInfo &&pkg)
+                                        {
+                                            if (pkg.name == name)
+                                            {
+                                                out.versions.push_back(std::move(pkg));
+                                                out.status = LookupStatus::Found;
+                                            } },
+                                        depend, parseError);
+        }
+
+        LookupStatus lookupInRepository(const SparseRepository &repo, SparseClient &client,
+                                        const std::string &name, Lookup &out)
+        {
+            std::string relative = sparsePackagePath(name);
+            std::filesystem::path cacheFile = repo.cacheDir / relative;
+            std::string cachedBody;
+            bool haveCache = readText(cacheFile, cachedBody);
+
+            httplib::Headers headers;
+            if (haveCache)
+            {
+                std::filesystem::path metaPath = cacheFile;
+                metaPath += ".meta";
+                std::ifstream meta(metaPath);
+                std::string etag;
+                std::string lastModified;
+                std::getline(meta, etag);
+                std::getline(meta, lastModified);
+                if (!etag.empty())
+                    headers.emplace("If-None-Match", etag);
+                if (!lastModified.empty())
+                    headers.emplace("If-Modified-Since", lastModified);
+            }
+
+            trace::Span getSpan("GET sparse", "http");
+            getSpan.setDetail(name);
+            auto res = client.get(repo.indexPath + "/" + relative, headers);
+            getSpan.setBytes(res ? res->body.size() : 0);
+            getSpan.end();
+            logHttpRequest("GET", repo.indexUrl + "/" + relative, res ? res->status : 0);
+
+            std::string parseError;
+            if (res && res->status == 304 && haveCache)
+            {
+                metrics::add("openspm_cache_requests_total", 1, {{"cache", "sparse"}, {"result", "hit"}});
+                if (pickPackage(cachedBody, name, out, parseError) != 0)
+                {
+                    warn("\033[0;33mCached metadata for " + name + " is corrupt (" + parseError + ")");
+                    removeCache(cacheFile);
+                    return LookupStatus::Failed;
+                }
+                return out.status;
+            }
+            if (res && res->status == 200)
+            {
+                metrics::add("openspm_cache_requests_total", 1, {{"cache", "sparse"}, {"result", "miss"}});
+                if (pickPackage(res->body, name, out, parseError) != 0)
+                {
+                    warn("\033[0;33mInvalid metadata for " + name + " in repository: " + repo.url + " (" + parseError + ")");
+                    return LookupStatus::Failed;
+                }
+                writeCache(cacheFile, res->body, res->get_header_value("ETag"), res->get_header_value("Last-Modified"));
+                return out.status;
+            }
+            if (res && res->status == 404)
+            {
+                if (haveCache)
+                {
+                    removeCache(cacheFile);
+                }
+                return LookupStatus::NotFound;
+            }
+            if (haveCache && pickPackage(cachedBody, name, out, parseError) == 0)
+            {
+                warn("\033[0;33mUsing cached metadata for " + name + ": " + repo.url + " could not be reached");
+                return out.status;
+            }
+            return LookupStatus::Failed;
+        }
+    } // namespace
+
+    std::string sparsePackagePath(const std::string &name)
+    {
+        switch (name.size())
+        {
+        case 1:
+            return "1/" + name + ".json";
+        case 2:
+            return "2/" + name + ".json";
+        case 3:
+            return "3/" + name.substr(0, 1) + "/" + name + ".json";
+        default:
+            return name.substr(0, 2) + "/" + name.substr(2, 2) + "/" + name + ".json";
+        }
+    }
+
+    bool hasSparseRepositories(const Catalog &catalog)
+    {
+        for (const auto &url : catalog.repositoryUrls())
+        {
+            const RepositoryInfo *info = catalog.findRepository(url);
+            if (info != nullptr && !info->sparseIndex.empty())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int fetchSparseClosure(const Catalog &catalog, const std::string &packageName, std::vector<PackageInfo> &outPackages)
+    {
+        trace::Span span("fetchSparseClosure", "resolve");
+        span.setDetail(packageName);
+
+        // Highest priority first; of equal priorities, later repositories override earlier ones
+        std::vector<SparseRepository> repos;
+        const std::vector<std::string> &urls = catalog.repositoryUrls();
+        for (auto it = urls.rbegin(); it != urls.rend(); ++it)
+        {
+            const RepositoryInfo *info = catalog.findRepository(*it);
+            if (info == nullptr || info->sparseIndex.empty())
+            {
+                continue;
+            }
+            SparseRepository repo;
+            repo.url = *it;
+            repo.parsed = parse_url(*it);
+            std::string sparsePath = info->sparseIndex;
+            while (!sparsePath.empty() && sparsePath.front() == '/')
+                sparsePath.erase(0, 1);
+            while (!sparsePath.empty() && sparsePath.back() == '/')
+                sparsePath.pop_back();
+            repo.indexPath = repo.parsed.path + "/" + sparsePath;
+            repo.indexUrl = repo.parsed.scheme + "://" + repo.parsed.host;
+            if (repo.parsed.port > 0)
+            {
+                repo.indexUrl += ":" + std::to_string(repo.parsed.port);
+            }
+            repo.indexUrl += repo.indexPath;
+            repo.cacheDir = std::filesystem::path(getConfig()->dataDir) / SparseCacheDir / hex64(fnv1a64(it->data(), it->size()));
+            repo.priority = info->priority;
+            for (const auto &[name, spec] : info->pins)
+            {
+                VersionRange range;
+                std::string parseError;
+                if (parseVersionRange(spec, range, parseError) == 0)
+                {
+                    repo.pins[name] = range;
+                }
+            }
+            repos.push_back(std::move(repo));
+        }
+        std::stable_sort(repos.begin(), repos.end(), [](const SparseRepository &a, const SparseRepository &b)
+                         { return a.priority > b.priority; });
+        std::set<std::string> pinnedNames;
+        for (const auto &repo : repos)
+        {
+            for (const auto &pin : repo.pins)
+            {
+                pinnedNames.insert(pin.first);
+            }
+        }
+        if (repos.empty())
+        {
+            error("No repository serves a sparse index.");
+            return 1;
+        }
+
+        std::set<std::string> seen{packageName};
+        std::vector<std::string> frontier{packageName};
+        while (!frontier.empty())
+        {
+            OPENSPM_DEBUG("[DEBUG fetchSparseClosure] Fetching " + std::to_string(frontier.size()) + " packages");
+            std::vector<Lookup> results(frontier.size());
+            std::atomic<size_t> next{0};
+            auto work = [&]()
+            {
+                std::vector<std::unique_ptr<SparseClient>> clients(repos.size());
+                for (size_t i = next.fetch_add(1); i < frontier.size(); i = next.fetch_add(1))
+                {
+                    const std::string &name = frontier[i];
+                    // Names become file paths on both ends
+                    if (name.empty() || name.front() == '.' || name.find_first_of("/\\") != std::string::npos)
+                    {
+                        continue;
+                    }
+                    bool failed = false;
+                    bool pinned = pinnedNames.count(name) != 0;
+                    for (size_t r = 0; r < repos.size(); ++r)
+                    {
+                        auto pin = repos[r].pins.find(name);
+                        if (pinned && pin == repos[r].pins.end())
+                        {
+                            continue;
+                        }
+                        if (!clients[r])
+                        {
+                            clients[r].reset(new SparseClient(repos[r].parsed));
+                        }
+                        Lookup lookup;
+                        LookupStatus status = lookupInRepository(repos[r], *clients[r], name, lookup);
+                        if (status == LookupStatus::Found && pinned)
+                        {
+                            const VersionRange &range = pin->second;
+                            lookup.versions.erase(std::remove_if(lookup.versions.begin(), lookup.versions.end(),
+                                                                 [&range](const PackageInfo &pkg)
+                                                                 { return !range.contains(parseVersion(pkg.version)); }),
+                                                  lookup.versions.end());
+                            if (lookup.versions.empty())
+                            {
+                                status = LookupStatus::NotFound;
+                            }
+                        }
+                        if (status == LookupStatus::Found)
+                        {
+                            for (auto &pkg : lookup.versions)
+                            {
+                                pkg.repository = repos[r].url;
+                            }
+                            results[i] = std::move(lookup);
+                            failed = false;
+                            break;
+                        }
+                        failed = failed || status == LookupStatus::Failed;
+                    }
+                    if (failed)
+                    {
+                        results[i].status = LookupStatus::Failed;
+                    }
+                }
+            };
+            size_t workers = std::min(frontier.size(), MaxParallelFetches);
+            std::vector<std::thread> threads;
+            for (size_t w = 1; w < workers; ++w)
+            {
+                threads.emplace_back(work);
+            }
+            work();
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+
+            std::vector<std::string> nextFrontier;
+            for (size_t i = 0; i < frontier.size(); ++i)
+            {
+                // Any version may be selected, so the dependencies of all of them are fetched
+                std::vector<std::string> dependencies;
+                if (results[i].status == LookupStatus::Found)
+                {
+                    for (auto &pkg : results[i].versions)
+                    {
+                        dependencies.insert(dependencies.end(), pkg.dependencies.begin(), pkg.dependencies.end());
+                        outPackages.push_back(std::move(pkg));
+                    }
+                }
+                else if (std::vector<const PackageInfo *> local = catalog.findVersions(frontier[i]); !local.empty())
+                {
+                    for (const PackageInfo *version : local)
+                    {
+                        dependencies.insert(dependencies.end(), version->dependencies.begin(), version->dependencies.end());
+                    }
+                }
+                else if (results[i].status == LookupStatus::Failed)
+                {
+                    error("\033[0;31mFailed to fetch package metadata: " + frontier[i]);
+                    return 1;
+                }
+                else
+                {
+                    OPENSPM_DEBUG("[DEBUG fetchSparseClosure] Not in any repository: " + frontier[i]);
+                    continue;
+                }
+                for (const auto &dep : dependencies)
+                {
+                    std::string depName(dependencyName(dep));
+                    if (seen.insert(depName).second)
+                    {
+                        nextFrontier.push_back(std::move(depName));
+                    }
+                }
+            }
+            frontier = std::move(nextFrontier);
+        }
+        span.setItems(outPackages.size());
+        OPENSPM_DEBUG("[DEBUG fetchSparseClosure] Fetched " + std::to_string(outPackages.size()) + " packages");
+        return 0;
+    }
+} // namespace openspm
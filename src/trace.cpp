@@ -0,0 +1,206 @@
+/**
+ * @file trace.cpp
+ * @brief Implementation of phase tracing
+ *
+ * Completed spans are appended to an in-memory list and written out as
+ * Chrome "complete" (ph: X) events when the trace is finished. Spans also
+ * feed the per-phase metrics when a metrics file is configured.
+ */
+#include <trace.hpp>
+#include <logger.hpp>
+#include <metrics.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace openspm::trace
+{
+    using namespace logger;
+
+    std::atomic<bool> active{false};
+
+    namespace
+    {
+        struct Event
+        {
+            const char *name;
+            const char *category;
+            std::int64_t startMicros;
+            std::int64_t durationMicros;
+            unsigned threadId;
+            std::uint64_t bytes;
+            std::uint64_t items;
+            std::string detail;
+        };
+
+        std::mutex eventsMutex;
+        std::vector<Event> events;
+        std::string outputPath;
+        std::chrono::steady_clock::time_point origin;
+        std::atomic<unsigned> nextThreadId{1};
+
+        /// Small stable per-thread number, easier to read in the viewer than native IDs
+        unsigned currentThreadId()
+        {
+            thread_local unsigned id = nextThreadId.fetch_add(1, std::memory_order_relaxed);
+            return id;
+        }
+
+        std::int64_t micros(std::chrono::steady_clock::duration d)
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+        }
+
+        void appendJsonString(std::string &out, const std::string &str)
+        {
+            out.push_back('"');
+            for (char c : str)
+            {
+                switch (c)
+                {
+                case '"':
+                    out += "\\\"";
+                    break;
+                case '\\':
+                    out += "\\\\";
+                    break;
+                case '\n':
+                    out += "\\n";
+                    break;
+                case '\t':
+                    out += "\\t";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                    {
+                        char buf[8];
+                        std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(c)));
+                        out += buf;
+                    }
+                    else
+                    {
+                        out.push_back(c);
+                    }
+                }
+            }
+            out.push_back('"');
+        }
+
+        void finishAtExit()
+        {
+            finish();
+        }
+    } // namespace
+
+    void start(const std::string &path)
+    {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        if (active.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        bool first = outputPath.empty();
+        outputPath = path;
+        origin = std::chrono::steady_clock::now();
+        events.clear();
+        currentThreadId(); // the thread starting the trace is shown as thread 1
+        active.store(true, std::memory_order_release);
+        if (first)
+        {
+            std::atexit(finishAtExit);
+        }
+        OPENSPM_DEBUG("[DEBUG trace::start] Recording trace to " + path);
+    }
+
+    int finish()
+    {
+        std::vector<Event> recorded;
+        std::string path;
+        {
+            std::lock_guard<std::mutex> lock(eventsMutex);
+            if (!active.load(std::memory_order_relaxed))
+            {
+                return 0;
+            }
+            active.store(false, std::memory_order_release);
+            recorded.swap(events);
+            path = outputPath;
+        }
+
+        std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        json += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"openspm\"}}";
+        for (const auto &event : recorded)
+        {
+            json += ",\n{\"name\":";
+            appendJsonString(json, event.name);
+            json += ",\"cat\":";
+            appendJsonString(json, event.category);
+            json += ",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(event.threadId) +
+                    ",\"ts\":" + std::to_string(event.startMicros) +
+                    ",\"dur\":" + std::to_string(event.durationMicros) + ",\"args\":{";
+            bool needComma = false;
+            if (event.bytes > 0)
+            {
+                json += "\"bytes\":" + std::to_string(event.bytes);
+                needComma = true;
+            }
+            if (event.items > 0)
+            {
+                json += std::string(needComma ? "," : "") + "\"items\":" + std::to_string(event.items);
+                needComma = true;
+            }
+            if (!event.detail.empty())
+            {
+                json += std::string(needComma ? "," : "") + "\"detail\":";
+                appendJsonString(json, event.detail);
+            }
+            json += "}}";
+        }
+        json += "\n]}\n";
+
+        std::FILE *file = std::fopen(path.c_str(), "w");
+        if (!file)
+        {
+            error("Failed to write trace file: " + path);
+            return 1;
+        }
+        bool ok = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+        ok = std::fclose(file) == 0 && ok;
+        if (!ok)
+        {
+            error("Failed to write trace file: " + path);
+            return 1;
+        }
+        record("Trace with " + std::to_string(recorded.size()) + " spans written to " + path);
+        return 0;
+    }
+
+    Span::Span(const char *name, const char *category)
+        : name(name), category(category), recording(enabled() || metrics::enabled())
+    {
+        if (recording)
+        {
+            begin = std::chrono::steady_clock::now();
+        }
+    }
+
+    void Span::end()
+    {
+        if (!recording)
+        {
+            return;
+        }
+        recording = false;
+        auto finishedAt = std::chrono::steady_clock::now();
+        metrics::observePhase(name, category, std::chrono::duration<double>(finishedAt - begin).count(), bytes);
+        if (!enabled())
+        {
+            return;
+        }
+        unsigned threadId = currentThreadId();
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        events.push_back(Event{name, category, micros(begin - origin), micros(finishedAt - begin),
+                               threadId, bytes, items, std::move(detail)});
+    }
+} // namespace openspm::trace
@@ -0,0 +1,149 @@
+/**
+ * @file triggers.cpp
+ * @brief Implementation of declarative install triggers
+ *
+ * Parses trigger declarations from pkg.yaml, merges them by name across
+ * the transaction and runs each activated trigger once through the
+ * script runner.
+ */
+#include <triggers.hpp>
+#include <script_runner.hpp>
+#include <logger.hpp>
+#include <utils.hpp>
+#include <yaml-cpp/yaml.h>
+#include <filesystem>
+
+namespace openspm
+{
+    using namespace logger;
+
+    int loadPackageTriggers(const std::string &pkgYamlPath, const std::string &packageName, std::vector<TriggerInfo> &outTriggers)
+    {
+        if (!std::filesystem::exists(pkgYamlPath))
+        {
+            OPENSPM_DEBUG("[DEBUG loadPackageTriggers] No pkg.yaml for " + packageName);
+            return 0;
+        }
+        YAML::Node root;
+        try
+        {
+            root = YAML::LoadFile(pkgYamlPath);
+        }
+        catch (const YAML::Exception &e)
+        {
+            error("Invalid pkg.yaml in package " + packageName + ": " + e.what());
+            return 1;
+        }
+        const YAML::Node &triggersNode = root["triggers"];
+        if (!triggersNode)
+        {
+            return 0;
+        }
+        if (!triggersNode.IsSequence())
+        {
+            error("Invalid triggers section in package " + packageName);
+            return 1;
+        }
+        for (const auto &node : triggersNode)
+        {
+            TriggerInfo trigger;
+            trigger.package = packageName;
+            trigger.name = node["name"] ? node["name"].as<std::string>() : "";
+            trigger.command = node["command"] ? node["command"].as<std::string>() : "";
+            if (node["paths"] && node["paths"].IsSequence())
+            {
+                for (const auto &pathNode : node["paths"])
+                {
+                    trigger.paths.push_back(pathNode.as<std::string>());
+                }
+            }
+            if (trigger.name.empty())
+            {
+                error("Trigger without a name in package " + packageName);
+                return 1;
+            }
+            OPENSPM_DEBUG("[DEBUG loadPackageTriggers] " + packageName + " declares trigger " + trigger.name + " (" + std::to_string(trigger.paths.size()) + " path globs)");
+            outTriggers.push_back(std::move(trigger));
+        }
+        return 0;
+    }
+
+    void TriggerSet::declare(const TriggerInfo &trigger)
+    {
+        auto it = indexByName.find(trigger.name);
+        if (it == indexByName.end())
+        {
+            indexByName[trigger.name] = triggers.size();
+            triggers.push_back(trigger);
+            alwaysRun.push_back(trigger.paths.empty() ? 1 : 0);
+            return;
+        }
+        TriggerInfo &existing = triggers[it->second];
+        if (trigger.paths.empty())
+        {
+            alwaysRun[it->second] = 1;
+        }
+        existing.paths.insert(existing.paths.end(), trigger.paths.begin(), trigger.paths.end());
+        if (existing.command.empty())
+        {
+            existing.command = trigger.command;
+            existing.package = trigger.package;
+        }
+        else if (!trigger.command.empty() && trigger.command != existing.command)
+        {
+            warn("Trigger " + trigger.name + " from " + trigger.package + " has a different command than the one from " +
+                 existing.package + "; keeping the first");
+        }
+    }
+
+    void TriggerSet::fileInstalled(const std::string &relativePath)
+    {
+        installedPaths.push_back(relativePath);
+    }
+
+    int TriggerSet::runActivated(const std::string &installDir, unsigned maxParallel, unsigned timeoutSeconds)
+    {
+        std::vector<ScriptJob> jobs;
+        for (size_t t = 0; t < triggers.size(); ++t)
+        {
+            const TriggerInfo &trigger = triggers[t];
+            if (trigger.command.empty())
+            {
+                warn("Trigger " + trigger.name + " has no command; skipping");
+                continue;
+            }
+            bool activated = alwaysRun[t] != 0;
+            for (size_t i = 0; !activated && i < installedPaths.size(); ++i)
+            {
+                for (const auto &pattern : trigger.paths)
+                {
+                    if (globMatch(pattern, installedPaths[i]))
+                    {
+                        OPENSPM_DEBUG("[DEBUG TriggerSet::runActivated] " + installedPaths[i] + " activates trigger " + trigger.name);
+                        activated = true;
+                        break;
+                    }
+                }
+            }
+            if (!activated)
+            {
+                OPENSPM_DEBUG("[DEBUG TriggerSet::runActivated] Trigger not activated: " + trigger.name);
+                continue;
+            }
+            ScriptJob job;
+            job.name = "trigger:" + trigger.name;
+            job.command = trigger.command;
+            job.env = {
+                "OPENSPM_TRIGGER=" + trigger.name,
+                "PKG_INSTALL_DIR=" + installDir};
+            jobs.push_back(std::move(job));
+        }
+        if (jobs.empty())
+        {
+            return 0;
+        }
+        log("Running " + std::to_string(jobs.size()) + " triggers...");
+        std::vector<ScriptResult> results;
+        return runScripts(jobs, maxParallel, timeoutSeconds, results);
+    }
+} // namespace openspm
@@ -16,7 +16,7 @@ namespace openspm
     
     ParsedUrl parse_url(const std::string &url)
     {
-        debug("[DEBUG parse_url] Parsing URL: " + url);
+        OPENSPM_DEBUG("[DEBUG parse_url] Parsing URL: " + url);
         ParsedUrl result;
         result.port = -1;
         result.path = "";
@@ -26,7 +26,7 @@ namespace openspm
         if (scheme_pos != std::string::npos)
         {
             result.scheme = s.substr(0, scheme_pos);
-            debug("[DEBUG parse_url] Scheme: " + result.scheme);
+            OPENSPM_DEBUG("[DEBUG parse_url] Scheme: " + result.scheme);
             s = s.substr(scheme_pos + 3);
         }
 
@@ -34,14 +34,14 @@ namespace openspm
         if (path_pos != std::string::npos)
         {
             result.path = s.substr(path_pos);
-            debug("[DEBUG parse_url] Path: " + result.path);
+            OPENSPM_DEBUG("[DEBUG parse_url] Path: " + result.path);
             s = s.substr(0, path_pos);
         }
 
         if (result.path.size() > 1 && result.path.back() == '/')
         {
             result.path.pop_back();
-            debug("[DEBUG parse_url] Removed trailing slash from path");
+            OPENSPM_DEBUG("[DEBUG parse_url] Removed trailing slash from path");
         }
 
         auto port_pos = s.find(':');
@@ -49,21 +49,21 @@ namespace openspm
         {
             result.host = s.substr(0, port_pos);
             result.port = std::stoi(s.substr(port_pos + 1));
-            debug("[DEBUG parse_url] Host: " + result.host + ", Port: " + std::to_string(result.port));
+            OPENSPM_DEBUG("[DEBUG parse_url] Host: " + result.host + ", Port: " + std::to_string(result.port));
         }
         else
         {
             result.host = s;
-            debug("[DEBUG parse_url] Host: " + result.host + " (no explicit port)");
+            OPENSPM_DEBUG("[DEBUG parse_url] Host: " + result.host + " (no explicit port)");
         }
 
-        debug("[DEBUG parse_url] Parse complete");
+        OPENSPM_DEBUG("[DEBUG parse_url] Parse complete");
         return result;
     }
     
     std::vector<std::string> splitTags(const std::string &tags)
     {
-        debug("[DEBUG splitTags] Splitting tags: " + tags);
+        OPENSPM_DEBUG("[DEBUG splitTags] Splitting tags: " + tags);
         std::vector<std::string> result;
         std::stringstream ss(tags);
         std::string tag;
@@ -71,26 +71,26 @@ namespace openspm
         while (std::getline(ss, tag, ';'))
         {
             if (!tag.empty()) {
-                debug("[DEBUG splitTags] Found tag: " + tag);
+                OPENSPM_DEBUG("[DEBUG splitTags] Found tag: " + tag);
                 result.push_back(tag);
             }
         }
-        debug("[DEBUG splitTags] Total tags found: " + std::to_string(result.size()));
+        OPENSPM_DEBUG("[DEBUG splitTags] Total tags found: " + std::to_string(result.size()));
         return result;
     }
     
     bool areTagsCompatible(const std::string &supported,
                            const std::string &packageTags)
     {
-        debug("[DEBUG areTagsCompatible] Checking compatibility");
-        debug("[DEBUG areTagsCompatible] Supported tags: " + supported);
-        debug("[DEBUG areTagsCompatible] Package tags: " + packageTags);
+        OPENSPM_DEBUG("[DEBUG areTagsCompatible] Checking compatibility");
+        OPENSPM_DEBUG("[DEBUG areTagsCompatible] Supported tags: " + supported);
+        OPENSPM_DEBUG("[DEBUG areTagsCompatible] Package tags: " + packageTags);
         
         auto supportedVec = splitTags(supported);
         auto packageVec = splitTags(packageTags);
 
-        debug("[DEBUG areTagsCompatible] Supported count: " + std::to_string(supportedVec.size()));
-        debug("[DEBUG areTagsCompatible] Package tags count: " + std::to_string(packageVec.size()));
+        OPENSPM_DEBUG("[DEBUG areTagsCompatible] Supported count: " + std::to_string(supportedVec.size()));
+        OPENSPM_DEBUG("[DEBUG areTagsCompatible] Package tags count: " + std::to_string(packageVec.size()));
 
         std::unordered_set<std::string> supportedSet(
             supportedVec.begin(), supportedVec.end());
@@ -98,12 +98,202 @@ namespace openspm
         for (const auto &tag : packageVec)
         {
             if (supportedSet.find(tag) == supportedSet.end()) {
-                debug("[DEBUG areTagsCompatible] Incompatible tag found: " + tag);
+                OPENSPM_DEBUG("[DEBUG areTagsCompatible] Incompatible tag found: " + tag);
                 return false;
             }
         }
 
-        debug("[DEBUG areTagsCompatible] All tags compatible");
+        OPENSPM_DEBUG("[DEBUG areTagsCompatible] All tags compatible");
         return true;
     }
-} // namespace openspm
\ No newline at end of file
+
+    bool globMatch(const std::string &pattern, const std::string &path)
+    {
+        size_t p = 0;
+        size_t s = 0;
+        // Backtracking points for the most recent '*' and '**'
+        size_t starP = std::string::npos, starS = 0;
+        size_t globP = std::string::npos, globS = 0;
+        while (s < path.size())
+        {
+            if (p + 1 < pattern.size() && pattern[p] == '*' && pattern[p + 1] == '*')
+            {
+                p += 2;
+                globP = p;
+                globS = s;
+                starP = std::string::npos;
+                continue;
+            }
+            if (p < pattern.size() && pattern[p] == '*')
+            {
+                p++;
+                starP = p;
+                starS = s;
+                continue;
+            }
+            if (p < pattern.size() && (pattern[p] == path[s] || (pattern[p] == '?' && path[s] != '/')))
+            {
+                p++;
+                s++;
+                continue;
+            }
+            if (starP != std::string::npos && path[starS] != '/')
+            {
+                p = starP;
+                s = ++starS;
+                continue;
+            }
+            if (globP != std::string::npos)
+            {
+                p = globP;
+                s = ++globS;
+                starP = std::string::npos;
+                continue;
+            }
+            return false;
+        }
+        while (p < pattern.size() && pattern[p] == '*')
+        {
+            p++;
+        }
+        return p == pattern.size();
+    }
+
+    std::uint64_t fnv1a64(const char *data, std::size_t size, std::uint64_t hash)
+    {
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    std::string hex64(std::uint64_t value)
+    {
+        static const char digits[] = "0123456789abcdef";
+        std::string out(16, '0');
+        for (int i = 15; i >= 0; --i)
+        {
+            out[i] = digits[value & 0xf];
+            value >>= 4;
+        }
+        return out;
+    }
+
+    void putU32(std::string &out, std::uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    void putU64(std::string &out, std::uint64_t value)
+    {
+        putU32(out, static_cast<std::uint32_t>(value));
+        putU32(out, static_cast<std::uint32_t>(value >> 32));
+    }
+
+    std::uint32_t getU32(const char *p)
+    {
+        const unsigned char *u = reinterpret_cast<const unsigned char *>(p);
+        return static_cast<std::uint32_t>(u[0]) | (static_cast<std::uint32_t>(u[1]) << 8) |
+               (static_cast<std::uint32_t>(u[2]) << 16) | (static_cast<std::uint32_t>(u[3]) << 24);
+    }
+
+    std::uint64_t getU64(const char *p)
+    {
+        return static_cast<std::uint64_t>(getU32(p)) | (static_cast<std::uint64_t>(getU32(p + 4)) << 32);
+    }
+
+    std::string writeNamePool(const char (&magic)[8], const std::vector<std::string_view> &names,
+                              const std::vector<NamePoolEntry> &entries, const std::vector<std::uint32_t> &pool)
+    {
+        std::string out(magic, sizeof(magic));
+        putU32(out, static_cast<std::uint32_t>(names.size()));
+        putU32(out, static_cast<std::uint32_t>(pool.size()));
+        for (const auto &[offset, length] : entries)
+        {
+            putU32(out, offset);
+            putU32(out, length);
+        }
+        std::uint32_t nameOffset = 0;
+        for (std::string_view name : names)
+        {
+            putU32(out, nameOffset);
+            nameOffset += static_cast<std::uint32_t>(name.size());
+        }
+        putU32(out, nameOffset);
+        for (std::uint32_t value : pool)
+        {
+            putU32(out, value);
+        }
+        for (std::string_view name : names)
+        {
+            out.append(name.data(), name.size());
+        }
+        return out;
+    }
+
+    int NamePool::load(std::string content, const char (&magic)[8])
+    {
+        constexpr size_t HeaderSize = sizeof(magic) + 8;
+        data = std::move(content);
+        count = 0;
+        if (data.size() < HeaderSize || data.compare(0, sizeof(magic), magic, sizeof(magic)) != 0)
+        {
+            return 1;
+        }
+        std::uint32_t names = getU32(data.data() + sizeof(magic));
+        poolLength = getU32(data.data() + sizeof(magic) + 4);
+        entriesAt = HeaderSize;
+        nameOffsetsAt = entriesAt + static_cast<size_t>(names) * 8;
+        poolAt = nameOffsetsAt + (static_cast<size_t>(names) + 1) * 4;
+        namesAt = poolAt + static_cast<size_t>(poolLength) * 4;
+        if (namesAt > data.size() || namesAt + getU32(data.data() + poolAt - 4) != data.size())
+        {
+            OPENSPM_DEBUG("[DEBUG NamePool::load] Truncated table");
+            return 1;
+        }
+        count = names;
+        return 0;
+    }
+
+    std::uint32_t NamePool::find(std::string_view name) const
+    {
+        std::uint32_t lo = 0;
+        std::uint32_t hi = count;
+        while (lo < hi)
+        {
+            std::uint32_t mid = lo + (hi - lo) / 2;
+            if (nameAt(mid) < name)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo < count && nameAt(lo) == name ? lo : count;
+    }
+
+    std::string_view NamePool::nameAt(std::uint32_t i) const
+    {
+        std::uint32_t begin = getU32(data.data() + nameOffsetsAt + static_cast<size_t>(i) * 4);
+        std::uint32_t end = getU32(data.data() + nameOffsetsAt + (static_cast<size_t>(i) + 1) * 4);
+        if (begin > end || namesAt + end > data.size())
+        {
+            return {};
+        }
+        return std::string_view(data.data() + namesAt + begin, end - begin);
+    }
+
+    NamePoolEntry NamePool::entry(std::uint32_t i) const
+    {
+        const char *at = data.data() + entriesAt + static_cast<size_t>(i) * 8;
+        return {getU32(at), getU32(at + 4)};
+    }
+
+    std::uint32_t NamePool::poolValue(std::uint32_t i) const
+    {
+        return getU32(data.data() + poolAt + static_cast<size_t>(i) * 4);
+    }
+} // namespace openspm
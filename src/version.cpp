@@ -0,0 +1,252 @@
+/**
+ * @file version.cpp
+ * @brief Implementation of version keys and constraint parsing
+ */
+#include <version.hpp>
+#include <algorithm>
+
+namespace openspm
+{
+    namespace
+    {
+        constexpr std::uint64_t MaxMajor = (1ULL << 24) - 1;
+        constexpr std::uint64_t MaxMinor = (1ULL << 20) - 1;
+        constexpr std::uint64_t MaxPatch = (1ULL << 20) - 1;
+        constexpr std::uint64_t MaxPreNumber = 0xffff;
+        /// Characters that end a dependency name
+        constexpr std::string_view NameTerminators = " \t<>=^~!(,*";
+
+        std::uint64_t packRelease(std::uint64_t major, std::uint64_t minor, std::uint64_t patch)
+        {
+            return (std::min(major, MaxMajor) << 40) | (std::min(minor, MaxMinor) << 20) | std::min(patch, MaxPatch);
+        }
+
+        bool isDigit(char c)
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        /// Reads digits at @p pos, saturating instead of overflowing
+        std::uint64_t readNumber(std::string_view text, size_t &pos)
+        {
+            std::uint64_t value = 0;
+            while (pos < text.size() && isDigit(text[pos]))
+            {
+                value = std::min<std::uint64_t>(value * 10 + static_cast<std::uint64_t>(text[pos] - '0'), 0xffffffffULL);
+                ++pos;
+            }
+            return value;
+        }
+
+        std::uint64_t packPreRelease(std::string_view pre)
+        {
+            size_t dot = pre.find('.');
+            std::string_view first = pre.substr(0, dot);
+            std::string_view second = dot == std::string_view::npos ? std::string_view() : pre.substr(dot + 1);
+            second = second.substr(0, second.find('.'));
+            bool numericFirst = !first.empty() && std::all_of(first.begin(), first.end(), isDigit);
+            if (numericFirst)
+            {
+                size_t pos = 0;
+                return std::min(readNumber(first, pos), MaxPreNumber);
+            }
+            std::uint64_t key = 0;
+            for (size_t i = 0; i < 6; ++i)
+            {
+                key = (key << 8) | (i < first.size() ? static_cast<unsigned char>(first[i]) : 0);
+            }
+            key <<= 16;
+            if (!second.empty() && std::all_of(second.begin(), second.end(), isDigit))
+            {
+                size_t pos = 0;
+                key |= std::min(readNumber(second, pos) + 1, MaxPreNumber);
+            }
+            return key;
+        }
+
+        /// Parses a version and reports how many numeric components were written
+        VersionKey parseVersionParts(std::string_view text, int &outComponents, std::uint64_t (&outParts)[3])
+        {
+            VersionKey key;
+            outComponents = 0;
+            outParts[0] = outParts[1] = outParts[2] = 0;
+            size_t pos = 0;
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t'))
+                ++pos;
+            if (pos < text.size() && (text[pos] == 'v' || text[pos] == 'V'))
+                ++pos;
+            while (outComponents < 3 && pos < text.size() && isDigit(text[pos]))
+            {
+                outParts[outComponents++] = readNumber(text, pos);
+                if (pos < text.size() && text[pos] == '.' && pos + 1 < text.size() && isDigit(text[pos + 1]))
+                    ++pos;
+                else
+                    break;
+            }
+            // Components past the third are not significant
+            while (pos < text.size() && (isDigit(text[pos]) || text[pos] == '.'))
+                ++pos;
+            key.release = packRelease(outParts[0], outParts[1], outParts[2]);
+            if (pos < text.size() && text[pos] == '-')
+            {
+                std::string_view pre = text.substr(pos + 1);
+                key.pre = packPreRelease(pre.substr(0, pre.find('+')));
+            }
+            return key;
+        }
+    } // namespace
+
+    VersionKey parseVersion(std::string_view text)
+    {
+        int components;
+        std::uint64_t parts[3];
+        return parseVersionParts(text, components, parts);
+    }
+
+    void VersionRange::intersect(const VersionRange &other)
+    {
+        if (other.low > low)
+        {
+            low = other.low;
+            lowInclusive = other.lowInclusive;
+        }
+        else if (other.low == low)
+        {
+            lowInclusive = lowInclusive && other.lowInclusive;
+        }
+        if (other.high < high)
+        {
+            high = other.high;
+            highInclusive = other.highInclusive;
+        }
+        else if (other.high == high)
+        {
+            highInclusive = highInclusive && other.highInclusive;
+        }
+    }
+
+    int parseVersionRange(std::string_view text, VersionRange &outRange, std::string &outError)
+    {
+        outRange = VersionRange();
+        auto isSeparator = [](char c)
+        { return c == ' ' || c == '\t' || c == ',' || c == '(' || c == ')'; };
+        auto isOperator = [](char c)
+        { return c == '<' || c == '>' || c == '=' || c == '^' || c == '~' || c == '!'; };
+        size_t pos = 0;
+        while (pos < text.size())
+        {
+            if (isSeparator(text[pos]))
+            {
+                ++pos;
+                continue;
+            }
+            size_t opStart = pos;
+            while (pos < text.size() && isOperator(text[pos]))
+                ++pos;
+            std::string_view op = text.substr(opStart, pos - opStart);
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t'))
+                ++pos;
+            size_t versionStart = pos;
+            while (pos < text.size() && !isSeparator(text[pos]) && !isOperator(text[pos]))
+                ++pos;
+            std::string_view version = text.substr(versionStart, pos - versionStart);
+
+            if (version == "*" && op.empty())
+            {
+                continue;
+            }
+            if (version.empty() || !(isDigit(version[0]) || version[0] == 'v' || version[0] == 'V'))
+            {
+                outError = "expected a version after '" + std::string(op) + "'";
+                return 1;
+            }
+            int components;
+            std::uint64_t parts[3];
+            VersionKey key = parseVersionParts(version, components, parts);
+            if (components == 0)
+            {
+                outError = "invalid version '" + std::string(version) + "'";
+                return 1;
+            }
+            bool explicitPre = version.find('-') != std::string_view::npos;
+            // Upper bounds like "<2" also exclude 2.0.0's pre-releases
+            VersionKey below{key.release, explicitPre ? key.pre : 0};
+
+            VersionRange constraint;
+            if (op.empty() || op == "=" || op == "==")
+            {
+                constraint.low = key;
+                constraint.high = key;
+            }
+            else if (op == ">=")
+            {
+                constraint.low = key;
+            }
+            else if (op == ">")
+            {
+                constraint.low = key;
+                constraint.lowInclusive = false;
+            }
+            else if (op == "<=")
+            {
+                constraint.high = key;
+            }
+            else if (op == "<")
+            {
+                constraint.high = below;
+                constraint.highInclusive = false;
+            }
+            else if (op == "^" || op == "~")
+            {
+                constraint.low = key;
+                std::uint64_t next;
+                if (op == "~")
+                    next = components >= 2 ? packRelease(parts[0], parts[1] + 1, 0) : packRelease(parts[0] + 1, 0, 0);
+                else if (parts[0] > 0 || components == 1)
+                    next = packRelease(parts[0] + 1, 0, 0);
+                else if (parts[1] > 0 || components == 2)
+                    next = packRelease(0, parts[1] + 1, 0);
+                else
+                    next = packRelease(0, 0, parts[2] + 1);
+                constraint.high = {next, 0};
+                constraint.highInclusive = false;
+            }
+            else
+            {
+                outError = "unsupported operator '" + std::string(op) + "'";
+                return 1;
+            }
+            outRange.intersect(constraint);
+        }
+        return 0;
+    }
+
+    std::string_view dependencyName(std::string_view spec)
+    {
+        size_t start = spec.find_first_not_of(" \t");
+        if (start == std::string_view::npos)
+        {
+            return {};
+        }
+        size_t end = spec.find_first_of(NameTerminators, start);
+        return spec.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+    }
+
+    int parseDependency(std::string_view spec, Dependency &outDependency, std::string &outError)
+    {
+        std::string_view name = dependencyName(spec);
+        if (name.empty())
+        {
+            outError = "missing package name in '" + std::string(spec) + "'";
+            return 1;
+        }
+        outDependency.name = std::string(name);
+        size_t rest = static_cast<size_t>(name.data() + name.size() - spec.data());
+        if (parseVersionRange(spec.substr(rest), outDependency.range, outError) != 0)
+        {
+            outError = "in '" + std::string(spec) + "': " + outError;
+            return 1;
+        }
+        return 0;
+    }
+} // namespace openspm
@@ -0,0 +1,67 @@
+#include <bloom_filter.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "test_support.hpp"
+using namespace openspm;
+using namespace openspm::test;
+
+namespace
+{
+    std::vector<std::string> namesFrom(size_t first, size_t count)
+    {
+        std::vector<std::string> names;
+        for (size_t i = first; i < first + count; ++i)
+        {
+            names.push_back("pkg-" + std::to_string(i));
+        }
+        return names;
+    }
+
+    BloomFilter filterOf(const std::vector<std::string> &names)
+    {
+        std::vector<std::string_view> views(names.begin(), names.end());
+        return BloomFilter::build(views);
+    }
+} // namespace
+
+int main()
+{
+    std::vector<std::string> present = namesFrom(0, 5000);
+    std::vector<std::string> absent = namesFrom(100000, 10000);
+    BloomFilterSet filters;
+    filters["https://a.example"] = filterOf(present);
+    filters["https://b.example"] = filterOf({});
+
+    BloomFilterSet parsed;
+    if (parseBloomFilters(serializeBloomFilters(filters), parsed) != 0 || parsed.size() != 2)
+        return fail("filter set does not round-trip");
+
+    const BloomFilter &filter = parsed["https://a.example"];
+    for (const auto &name : present)
+    {
+        if (!filter.mayContain(name))
+            return fail("inserted name missed after the round trip: " + name);
+    }
+    size_t falsePositives = 0;
+    for (const auto &name : absent)
+    {
+        falsePositives += filter.mayContain(name) ? 1 : 0;
+        if (filter.mayContain(name) != filters["https://a.example"].mayContain(name))
+            return fail("parsed filter answers differently for " + name);
+    }
+    // About 1% is expected at 10 bits per name
+    if (falsePositives > absent.size() * 3 / 100)
+        return fail("false positive rate too high: " + std::to_string(falsePositives) + " of " + std::to_string(absent.size()));
+    if (parsed["https://b.example"].mayContain("pkg-1"))
+        return fail("empty filter reports a name");
+
+    std::string data = serializeBloomFilters(filters);
+    for (size_t cut : {size_t(0), size_t(4), size_t(12), data.size() / 2, data.size() - 1})
+    {
+        BloomFilterSet truncated;
+        if (parseBloomFilters(data.substr(0, cut), truncated) == 0)
+            return fail("truncated filter set accepted at " + std::to_string(cut) + " bytes");
+    }
+    return 0;
+}
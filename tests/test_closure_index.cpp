@@ -0,0 +1,136 @@
+#include <closure_index.hpp>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "test_support.hpp"
+using namespace openspm;
+using namespace openspm::test;
+
+namespace
+{
+    int indexOf(std::vector<PackageInfo> packages, ClosureIndex &index)
+    {
+        std::stable_sort(packages.begin(), packages.end(), [](const PackageInfo &a, const PackageInfo &b)
+                         { return a.name < b.name; });
+        return index.load(buildClosureIndex(packages));
+    }
+
+    /// The install order as a space-separated list, or the lookup outcome
+    std::string closureOf(const ClosureIndex &index, const std::string &name)
+    {
+        std::vector<std::string_view> order;
+        switch (index.lookup(name, order))
+        {
+        case ClosureIndex::Result::Unknown:
+            return "unknown";
+        case ClosureIndex::Result::Incomplete:
+            return "incomplete";
+        case ClosureIndex::Result::Found:
+            break;
+        }
+        std::string out;
+        for (std::string_view entry : order)
+        {
+            out += (out.empty() ? "" : " ") + std::string(entry);
+        }
+        return out;
+    }
+
+    int expect(const ClosureIndex &index, const std::string &name, const std::string &expected)
+    {
+        std::string actual = closureOf(index, name);
+        if (actual != expected)
+            return fail(name + ": expected '" + expected + "', got '" + actual + "'");
+        return 0;
+    }
+
+    int testOrder()
+    {
+        ClosureIndex index;
+        if (indexOf({package("app", "1.0.0", {"libb", "liba"}), package("libb", "1.0.0", {"libc >=1"}),
+                     package("liba", "1.0.0", {"libc"}), package("libc", "1.0.0")},
+                    index) != 0)
+            return fail("index does not load");
+        int failures = 0;
+        failures += expect(index, "app", "libc libb liba app");
+        failures += expect(index, "liba", "libc liba");
+        failures += expect(index, "libc", "libc");
+        failures += expect(index, "nothing", "unknown");
+        return failures;
+    }
+
+    int testCycles()
+    {
+        // a and b form a cycle (one component); c depends on it; self depends on itself
+        ClosureIndex index;
+        if (indexOf({package("a", "1.0.0", {"b"}), package("b", "1.0.0", {"a"}), package("c", "1.0.0", {"a"}),
+                     package("self", "1.0.0", {"self"}), package("big1", "1.0.0", {"big2"}), package("big2", "1.0.0", {"big3"}),
+                     package("big3", "1.0.0", {"big1", "c"})},
+                    index) != 0)
+            return fail("index with cycles does not load");
+        int failures = 0;
+        failures += expect(index, "a", "b a");
+        failures += expect(index, "b", "a b");
+        failures += expect(index, "c", "b a c");
+        failures += expect(index, "self", "self");
+        failures += expect(index, "big1", "b a c big2 big3 big1");
+        failures += expect(index, "big3", "b a c big1 big2 big3");
+        return failures;
+    }
+
+    int testIncompleteAndNewest()
+    {
+        ClosureIndex index;
+        if (indexOf({package("tool", "1.0.0", {"gone"}), package("tool", "2.0.0", {"lib"}), package("lib", "1.0.0"),
+                     package("broken", "1.0.0", {"missing"}), package("user", "1.0.0", {"broken"}),
+                     package("loop", "1.0.0", {"loop2", "missing"}), package("loop2", "1.0.0", {"loop"})},
+                    index) != 0)
+            return fail("index with missing dependencies does not load");
+        int failures = 0;
+        failures += expect(index, "tool", "lib tool");
+        failures += expect(index, "broken", "incomplete");
+        failures += expect(index, "user", "incomplete");
+        failures += expect(index, "loop2", "incomplete");
+        return failures;
+    }
+
+    int testWideLevel()
+    {
+        // Enough packages on one level for the parallel path
+        std::vector<PackageInfo> packages = {package("base", "1.0.0"), package("core", "1.0.0", {"base"})};
+        for (int i = 0; i < 2000; ++i)
+        {
+            packages.push_back(package("leaf-" + std::to_string(i), "1.0.0", {"core", i % 2 == 0 ? "base" : "core"}));
+        }
+        ClosureIndex index;
+        if (indexOf(std::move(packages), index) != 0)
+            return fail("wide index does not load");
+        int failures = 0;
+        failures += expect(index, "leaf-0", "base core leaf-0");
+        failures += expect(index, "leaf-1999", "base core leaf-1999");
+        return failures;
+    }
+
+    int testInvalid()
+    {
+        ClosureIndex index;
+        if (index.load("OSPMCLO1") == 0 || index.load("not an index at all") == 0 || index.loaded())
+            return fail("invalid index accepted");
+        std::string valid = buildClosureIndex({package("a", "1.0.0")});
+        if (index.load(valid.substr(0, valid.size() - 1)) == 0)
+            return fail("truncated index accepted");
+        return 0;
+    }
+} // namespace
+
+int main()
+{
+    int failures = 0;
+    failures += testOrder();
+    failures += testCycles();
+    failures += testIncompleteAndNewest();
+    failures += testWideLevel();
+    failures += testInvalid();
+    return failures == 0 ? 0 : 1;
+}
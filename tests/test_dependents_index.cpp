@@ -0,0 +1,54 @@
+#include <dependents_index.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "test_support.hpp"
+using namespace openspm;
+using namespace openspm::test;
+
+namespace
+{
+    /// Dependents as a space-separated list, or "unknown"
+    std::string dependentsOf(const DependentsIndex &index, const std::string &name)
+    {
+        std::vector<std::string_view> dependents;
+        if (!index.lookup(name, dependents))
+            return "unknown";
+        std::string out;
+        for (std::string_view dependent : dependents)
+        {
+            out += (out.empty() ? "" : " ") + std::string(dependent);
+        }
+        return out;
+    }
+} // namespace
+
+int main()
+{
+    // Sorted by name, then version, as the merged view is
+    std::vector<PackageInfo> packages = {package("app", "1.0.0", {"lib >=1", "missing"}), package("base", "1.0.0"),
+                                         package("cycle-a", "1.0.0", {"cycle-b"}), package("cycle-b", "1.0.0", {"cycle-a", "cycle-b"}),
+                                         package("extra", "1.0.0"), package("lib", "1.0.0", {"base"}),
+                                         package("lib", "2.0.0", {"base ^1", "extra"}), package("tool", "1.0.0", {"lib", "base"})};
+    DependentsIndex index;
+    if (index.load(buildDependentsIndex(packages)) != 0 || !index.loaded())
+        return fail("index does not load");
+
+    int failures = 0;
+    const std::pair<std::string, std::string> cases[] = {
+        {"base", "lib tool"}, {"lib", "app tool"}, {"extra", "lib"}, {"app", ""},
+        {"cycle-a", "cycle-b"}, {"cycle-b", "cycle-a"}, {"missing", "unknown"}, {"other", "unknown"},
+    };
+    for (const auto &[name, expected] : cases)
+    {
+        std::string actual = dependentsOf(index, name);
+        if (actual != expected)
+            failures += fail(name + ": expected '" + expected + "', got '" + actual + "'");
+    }
+
+    DependentsIndex broken;
+    std::string valid = buildDependentsIndex(packages);
+    if (broken.load("OSPMRDP1") == 0 || broken.load(valid.substr(0, valid.size() - 1)) == 0 || broken.loaded())
+        failures += fail("corrupt index accepted");
+    return failures == 0 ? 0 : 1;
+}
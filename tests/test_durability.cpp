@@ -0,0 +1,111 @@
+#include <durability.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "test_support.hpp"
+using namespace openspm;
+using namespace openspm::test;
+
+namespace
+{
+    const DurabilityMode Modes[] = {DurabilityMode::None, DurabilityMode::Batch, DurabilityMode::Strict};
+
+    /// Write a file and report it to the batch, as the installer does
+    int install(SyncBatch &batch, const std::filesystem::path &path, const std::string &content)
+    {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path) << content;
+        return batch.fileWritten(path.string());
+    }
+
+    int testNames()
+    {
+        for (DurabilityMode mode : Modes)
+        {
+            DurabilityMode parsed;
+            if (!parseDurabilityMode(durabilityModeName(mode), parsed) || parsed != mode)
+                return fail("mode name does not round-trip: " + durabilityModeName(mode));
+        }
+        DurabilityMode parsed;
+        if (parseDurabilityMode("fsync", parsed) || parseDurabilityMode("", parsed))
+            return fail("unknown mode name accepted");
+        return 0;
+    }
+
+    int testCommit(const TempDir &dir)
+    {
+        for (DurabilityMode mode : Modes)
+        {
+            std::string name = durabilityModeName(mode);
+            std::filesystem::path root = dir / name;
+            SyncBatch batch(mode);
+            std::vector<std::filesystem::path> paths = {root / "bin" / "tool", root / "lib" / "libz.so", root / "lib" / "libz.so.1",
+                                                        root / "share" / "doc" / "README"};
+            for (const auto &path : paths)
+            {
+                if (install(batch, path, name + ":" + path.filename().string()) != 0)
+                    return fail(name + ": file not accepted: " + path.string());
+            }
+            // A read-only file is synced like any other
+            std::filesystem::permissions(paths[0], std::filesystem::perms::owner_read | std::filesystem::perms::group_read);
+            if (batch.fileWritten(paths[0].string()) != 0)
+                return fail(name + ": read-only file not accepted");
+            if (batch.fileCount() != paths.size() + 1)
+                return fail(name + ": files not counted");
+            if (batch.commit() != 0)
+                return fail(name + ": commit failed");
+            if (batch.commit() != 0)
+                return fail(name + ": empty commit failed");
+            for (const auto &path : paths)
+            {
+                std::string content;
+                std::ifstream(path) >> content;
+                if (content != name + ":" + path.filename().string())
+                    return fail(name + ": committed file has the wrong contents: " + path.string());
+            }
+        }
+        return 0;
+    }
+
+    int testSyncErrors(const TempDir &dir)
+    {
+        // Only strict mode touches the file when it is recorded
+        std::string missing = (dir / "missing" / "file").string();
+        for (DurabilityMode mode : Modes)
+        {
+            SyncBatch batch(mode);
+            bool rejected = batch.fileWritten(missing) != 0;
+            if (rejected != (mode == DurabilityMode::Strict))
+                return fail(durabilityModeName(mode) + ": unexpected result for a file that was never written");
+        }
+#if defined(__linux__)
+        // Batch mode syncs the filesystems it saw at commit time, so a directory removed in between fails the commit
+        std::filesystem::path gone = dir / "gone";
+        SyncBatch batch(DurabilityMode::Batch);
+        if (install(batch, gone / "file", "data") != 0)
+            return fail("batch: file not accepted");
+        std::filesystem::remove_all(gone);
+        if (batch.commit() == 0)
+            return fail("batch: commit did not sync the recorded filesystem");
+        SyncBatch none(DurabilityMode::None);
+        if (install(none, gone / "file", "data") != 0)
+            return fail("none: file not accepted");
+        std::filesystem::remove_all(gone);
+        if (none.commit() != 0)
+            return fail("none: commit tried to sync");
+#endif
+        return 0;
+    }
+} // namespace
+
+int main()
+{
+    TempDir dir("openspm-test-durability");
+    int failures = 0;
+    failures += testNames();
+    failures += testCommit(dir);
+    failures += testSyncErrors(dir);
+    return failures == 0 ? 0 : 1;
+}
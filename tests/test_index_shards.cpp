@@ -0,0 +1,186 @@
+#include <index_shards.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "test_support.hpp"
+using namespace openspm;
+using namespace openspm::test;
+
+namespace
+{
+    PackageInfo hosted(const std::string &name, const std::string &version, const std::string &repository)
+    {
+        PackageInfo pkg = package(name, version);
+        pkg.repository = repository;
+        return pkg;
+    }
+
+    MergeSource source(const std::string &url, std::vector<PackageInfo> packages, int priority = 0,
+                       std::map<std::string, std::string> pins = {})
+    {
+        ShardPolicy policy;
+        policy.priority = priority;
+        for (const auto &[name, spec] : pins)
+        {
+            std::string parseError;
+            parseVersionRange(spec, policy.pins[name], parseError);
+        }
+        MergeSource merged = packageSource(std::move(packages), std::move(policy));
+        merged.url = url;
+        return merged;
+    }
+
+    /// "name version@repository" for each package, space-separated
+    std::string describe(const std::vector<PackageInfo> &packages)
+    {
+        std::string out;
+        for (const auto &pkg : packages)
+        {
+            out += (out.empty() ? "" : " ") + pkg.name + " " + pkg.version + "@" + pkg.repository;
+        }
+        return out;
+    }
+
+    RepositoryInfo repository(const std::string &url, int priority = 0, std::map<std::string, std::string> pins = {})
+    {
+        RepositoryInfo repo;
+        repo.url = url;
+        repo.priority = priority;
+        repo.pins = std::move(pins);
+        return repo;
+    }
+
+    int testUnion()
+    {
+        std::vector<MergeSource> sources;
+        sources.push_back(source("a", {package("zlib", "1.0.0"), package("curl", "8.0.0"), package("zlib", "1.3.0")}));
+        sources.push_back(source("b", {package("zlib", "1.3.0"), package("zlib", "1.2.0")}));
+        std::string merged = describe(mergeShards(std::move(sources)));
+        if (merged != "curl 8.0.0@a zlib 1.0.0@a zlib 1.2.0@b zlib 1.3.0@b")
+            return fail("equal priorities: " + merged);
+        return 0;
+    }
+
+    int testPriority()
+    {
+        std::vector<MergeSource> sources;
+        sources.push_back(source("low", {package("zlib", "2.0.0"), package("only-low", "1.0.0")}));
+        sources.push_back(source("high", {package("zlib", "1.0.0")}, 10));
+        std::string merged = describe(mergeShards(std::move(sources)));
+        if (merged != "only-low 1.0.0@low zlib 1.0.0@high")
+            return fail("priority: " + merged);
+        return 0;
+    }
+
+    int testPins()
+    {
+        std::vector<MergeSource> sources;
+        sources.push_back(source("stable", {package("zlib", "1.2.0"), package("zlib", "1.3.0"), package("zlib", "2.0.0")}, 0,
+                                 {{"zlib", "^1"}, {"gone", ">=5"}}));
+        sources.push_back(source("edge", {package("zlib", "3.0.0"), package("gone", "1.0.0")}, 10));
+        std::string merged = describe(mergeShards(std::move(sources)));
+        if (merged != "zlib 1.2.0@stable zlib 1.3.0@stable")
+            return fail("pins: " + merged);
+        return 0;
+    }
+
+    int testUnsortedSource()
+    {
+        std::vector<MergeSource> sources;
+        sources.push_back(source("a", {package("b", "1.0.0"), package("a", "1.0.0")}));
+        sources.push_back(source("b", {package("c", "1.0.0")}));
+        std::string merged = describe(mergeShards(std::move(sources)));
+        if (merged != "a 1.0.0@a b 1.0.0@a c 1.0.0@b")
+            return fail("unsorted input: " + merged);
+
+        // A source yielding names out of order stops there instead of corrupting the result
+        std::vector<PackageInfo> broken = {package("m", "1.0.0"), package("a", "1.0.0")};
+        size_t next = 0;
+        MergeSource raw;
+        raw.url = "raw";
+        raw.next = [&](PackageInfo &pkg)
+        {
+            if (next >= broken.size())
+                return false;
+            pkg = broken[next++];
+            return true;
+        };
+        std::vector<MergeSource> rawSources;
+        rawSources.push_back(std::move(raw));
+        merged = describe(mergeShards(std::move(rawSources)));
+        if (merged != "m 1.0.0@raw")
+            return fail("out-of-order source: " + merged);
+        return 0;
+    }
+
+    int testMergeOrderAndPolicies()
+    {
+        ShardManifest manifest;
+        manifest["main"].depend = {"base"};
+        manifest["base"].depend = {"main"};
+        manifest["extra"].depend = {"base"};
+        std::vector<std::string> order = shardMergeOrder({"main", "extra"}, manifest);
+        std::string joined;
+        for (const auto &url : order)
+            joined += url + " ";
+        if (joined != "main base extra ")
+            return fail("merge order: " + joined);
+
+        std::vector<ShardPolicy> policies =
+            shardPolicies(order, {repository("main", 3, {{"zlib", "^1"}}), repository("extra", 7, {{"bad", ">>"}})}, manifest);
+        if (policies.size() != 3 || policies[0].priority != 3 || policies[1].priority != 7 || policies[2].priority != 7)
+            return fail("dependency-only repositories do not inherit the highest priority");
+        if (policies[0].pins.count("zlib") == 0 || !policies[1].pins.empty() || !policies[2].pins.empty())
+            return fail("pins are not limited to valid pins of configured repositories");
+        return 0;
+    }
+
+    int testRepositoryRemerge()
+    {
+        // The local full index and packages fetched from a sparse repository at install time
+        std::vector<PackageInfo> packages = {hosted("zlib", "1.0.0", "full"), hosted("zlib", "9.0.0", "sparse"),
+                                             hosted("curl", "8.0.0", "sparse"), hosted("curl", "7.0.0", "full"),
+                                             hosted("orphan", "1.0.0", "")};
+        std::vector<RepositoryInfo> repos = {repository("sparse"), repository("full", 5, {{"curl", "<8"}})};
+        std::string merged = describe(mergeRepositoryPackages(std::move(packages), repos, ShardManifest()));
+        if (merged != "curl 7.0.0@full orphan 1.0.0@ zlib 1.0.0@full")
+            return fail("remerge: " + merged);
+        return 0;
+    }
+
+    int testManifestRoundTrip()
+    {
+        ShardManifest manifest;
+        ShardInfo &info = manifest["https://repo.example"];
+        info.url = "https://repo.example";
+        info.file = shardFileName(info.url);
+        info.source = "json";
+        info.etag = "\"abc\"";
+        info.updated = 1700000000;
+        info.packages = 42;
+        info.depend = {"https://base.example"};
+        ShardManifest parsed;
+        if (parseShardManifest(serializeShardManifest(manifest), parsed) != 0 || parsed.size() != 1)
+            return fail("manifest does not round-trip");
+        const ShardInfo &back = parsed["https://repo.example"];
+        if (back.file != info.file || back.etag != info.etag || back.updated != info.updated || back.packages != 42 ||
+            back.depend != info.depend)
+            return fail("manifest entry changed in the round trip");
+        if (shardFileName("https://a.example") == shardFileName("https://b.example"))
+            return fail("shard file names collide");
+        return 0;
+    }
+} // namespace
+
+int main()
+{
+    int failures = 0;
+    failures += testUnion();
+    failures += testPriority();
+    failures += testPins();
+    failures += testUnsortedSource();
+    failures += testMergeOrderAndPolicies();
+    failures += testRepositoryRemerge();
+    failures += testManifestRoundTrip();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,391 @@
+#include <installed_db.hpp>
+#include <config.hpp>
+#include <package_manager.hpp>
+#include <utils.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "test_support.hpp"
+using namespace openspm;
+using namespace openspm::test;
+
+namespace
+{
+    InstalledFile file(const std::string &path, std::uint64_t size = 1)
+    {
+        InstalledFile entry;
+        entry.path = path;
+        entry.mode = 0644;
+        entry.size = size;
+        entry.hash = fnv1a64(path.data(), path.size());
+        return entry;
+    }
+
+    InstalledFile directory(const std::string &path)
+    {
+        InstalledFile entry;
+        entry.path = path;
+        entry.directory = true;
+        entry.mode = 0755;
+        return entry;
+    }
+
+    InstalledPackage installed(const std::string &name, const std::string &version, std::vector<std::string> dependencies = {},
+                               bool automatic = false)
+    {
+        InstalledPackage pkg;
+        pkg.name = name;
+        pkg.version = version;
+        pkg.repository = "https://repo.example";
+        pkg.installedAt = 1700000000;
+        pkg.automatic = automatic;
+        pkg.dependencies = std::move(dependencies);
+        return pkg;
+    }
+
+    std::string names(const std::vector<InstalledPackage> &packages)
+    {
+        std::string out;
+        for (const auto &pkg : packages)
+        {
+            out += (out.empty() ? "" : " ") + pkg.name;
+        }
+        return out;
+    }
+
+    std::string readAll(const std::filesystem::path &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void writeAll(const std::filesystem::path &path, const std::string &content)
+    {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+    }
+
+    size_t filesIn(const std::filesystem::path &dir)
+    {
+        size_t files = 0;
+        for (const auto &entry : std::filesystem::recursive_directory_iterator(dir))
+        {
+            files += entry.is_regular_file() ? 1 : 0;
+        }
+        return files;
+    }
+
+    std::string ownersOf(const InstalledDatabase &db, const std::string &path)
+    {
+        std::string out;
+        for (const auto &owner : db.owners(path))
+        {
+            out += (out.empty() ? "" : " ") + owner.package + (owner.directory ? "/" : "");
+        }
+        return out;
+    }
+
+    int testRoundTrip(const TempDir &dir)
+    {
+        std::string path = (dir / "roundtrip").string();
+        InstalledDatabase db;
+        if (db.open(path) != 0 || !db.list().empty())
+            return fail("missing database is not empty");
+        if (db.record(installed("zlib", "1.3.0"), {file("lib/libz.so.1", 100), directory("lib"), file("include/zlib.h", 20)}) != 0 ||
+            db.record(installed("curl", "8.0.0", {"zlib"}), {file("bin/curl", 300), directory("bin")}) != 0)
+            return fail("packages not recorded");
+        InstalledPackage found;
+        if (!db.find("zlib", found) || found.version != "1.3.0")
+            return fail("staged package not visible before save");
+        if (db.save() != 0)
+            return fail("database not saved");
+
+        InstalledDatabase reopened;
+        if (reopened.open(path) != 0)
+            return fail("saved database does not open");
+        if (names(reopened.list()) != "curl zlib")
+            return fail("list not sorted by name: " + names(reopened.list()));
+        if (!reopened.find("zlib", found) || found.version != "1.3.0" || found.repository != "https://repo.example" ||
+            found.installedAt != 1700000000 || found.fileCount != 2 || found.totalBytes != 120)
+            return fail("record fields changed in the round trip");
+        if (!reopened.find("curl", found) || found.dependencies != std::vector<std::string>{"zlib"})
+            return fail("dependencies not stored");
+        if (reopened.isInstalled("wget") || reopened.find("cur", found) || reopened.find("zlib2", found))
+            return fail("lookup of a missing package succeeded");
+        std::vector<InstalledFile> files;
+        if (reopened.readManifest("zlib", files) != 0 || files.size() != 3 || files[0].path != "include/zlib.h" ||
+            !files[1].directory || files[2].hash != file("lib/libz.so.1").hash)
+            return fail("manifest not sorted or entries changed");
+        for (const auto &entry : std::filesystem::recursive_directory_iterator(path))
+        {
+            if (entry.path().extension() == ".tmp")
+                return fail("temporary file left behind: " + entry.path().string());
+        }
+
+        // Replacing and removing; the removed manifest goes with the save
+        size_t manifests = filesIn(std::filesystem::path(path) / "manifests");
+        if (reopened.record(installed("curl", "8.1.0", {"zlib"}), {file("bin/curl", 310)}) != 0)
+            return fail("reinstall not recorded");
+        reopened.forget("zlib");
+        if (reopened.isInstalled("zlib") || names(reopened.list()) != "curl")
+            return fail("staged removal not visible before save");
+        if (reopened.save() != 0)
+            return fail("database with a removal not saved");
+        InstalledDatabase after;
+        if (after.open(path) != 0 || names(after.list()) != "curl" || !after.find("curl", found) || found.version != "8.1.0")
+            return fail("reinstall or removal lost in the round trip");
+        if (after.readManifest("zlib", files) == 0 || filesIn(std::filesystem::path(path) / "manifests") != manifests - 1)
+            return fail("manifest of the removed package kept");
+        return 0;
+    }
+
+    int testOlderIndex(const TempDir &dir)
+    {
+        // Records written before dependencies and flags were stored
+        std::string pool;
+        std::string offsets;
+        for (const char *name : {"legacy", "old"})
+        {
+            putU32(offsets, static_cast<std::uint32_t>(pool.size()));
+            for (std::string field : {std::string(name), std::string("1.0.0"), std::string("https://old.example")})
+            {
+                putU32(pool, static_cast<std::uint32_t>(field.size()));
+                pool += field;
+            }
+            putU64(pool, 1600000000);
+            putU32(pool, 0);
+            putU64(pool, 0);
+        }
+        putU32(offsets, static_cast<std::uint32_t>(pool.size()));
+        std::string index = "OSPMINS1";
+        putU32(index, 2);
+        index += offsets + pool;
+        std::filesystem::path path = dir / "older";
+        std::filesystem::create_directories(path);
+        writeAll(path / "packages.idx", index);
+
+        InstalledDatabase db;
+        InstalledPackage found;
+        if (db.open(path.string()) != 0 || names(db.list()) != "legacy old")
+            return fail("older index does not open");
+        if (!db.find("old", found) || found.version != "1.0.0" || found.installedAt != 1600000000 || found.automatic ||
+            !found.dependencies.empty())
+            return fail("older record misread");
+
+        // Saving rewrites every record in the current layout
+        if (db.record(installed("new", "2.0.0", {"old"}, true), {file("bin/new")}) != 0 || db.save() != 0)
+            return fail("older database not updated");
+        InstalledDatabase reopened;
+        if (reopened.open(path.string()) != 0 || names(reopened.list()) != "legacy new old")
+            return fail("updated older database does not open");
+        if (!reopened.find("new", found) || !found.automatic || !reopened.find("old", found) ||
+            found.requiredBy != std::vector<std::string>{"new"} || found.repository != "https://old.example")
+            return fail("older records not carried over");
+        return 0;
+    }
+
+    int testCorrupt(const TempDir &dir)
+    {
+        std::string path = (dir / "corrupt").string();
+        InstalledDatabase db;
+        if (db.open(path) != 0 || db.record(installed("a", "1.0.0"), {file("a")}) != 0 ||
+            db.record(installed("b", "1.0.0"), {file("b")}) != 0 || db.save() != 0)
+            return fail("database not written");
+        std::filesystem::path indexPath = std::filesystem::path(path) / "packages.idx";
+        std::string valid = readAll(indexPath);
+
+        std::string badMagic = valid;
+        badMagic[7] = '9';
+        for (const std::string &content : {badMagic, valid.substr(0, 10), valid.substr(0, 16), valid.substr(0, valid.size() - 1),
+                                           valid + "x", std::string()})
+        {
+            writeAll(indexPath, content);
+            InstalledDatabase broken;
+            if (broken.open(path) == 0)
+                return fail("corrupt index of " + std::to_string(content.size()) + " bytes opened");
+        }
+        writeAll(indexPath, valid);
+
+        // A damaged manifest is reported, not misread
+        std::vector<InstalledFile> files;
+        for (const auto &entry : std::filesystem::directory_iterator(std::filesystem::path(path) / "manifests"))
+        {
+            std::string manifest = readAll(entry.path());
+            writeAll(entry.path(), manifest.substr(0, manifest.size() - 1));
+        }
+        InstalledDatabase reopened;
+        if (reopened.open(path) != 0 || reopened.readManifest("a", files) == 0 || !files.empty())
+            return fail("truncated manifest read");
+        return 0;
+    }
+
+    int expectOwners(const InstalledDatabase &db, const std::string &path, const std::string &expected, const std::string &when)
+    {
+        std::string actual = ownersOf(db, path);
+        if (actual != expected)
+            return fail(when + ": owners of '" + path + "' are '" + actual + "', expected '" + expected + "'");
+        return 0;
+    }
+
+    int testOwnership(const TempDir &dir)
+    {
+        std::string path = (dir / "paths").string();
+        std::filesystem::path pathsFile = std::filesystem::path(path) / "paths.idx";
+        InstalledDatabase db;
+        if (db.open(path) != 0 || db.record(installed("ma", "1.0.0"), {directory("bin"), file("bin/ma"), file("share/ma/old")}) != 0 ||
+            db.record(installed("mb", "1.0.0"), {directory("bin"), file("bin/mb")}) != 0 || db.save() != 0)
+            return fail("database not written");
+        std::string firstPaths = readAll(pathsFile);
+
+        int failures = 0;
+        InstalledDatabase stored;
+        if (stored.open(path) != 0)
+            return fail("database does not open");
+        failures += expectOwners(stored, "bin", "ma/ mb/", "after save");
+        failures += expectOwners(stored, "bin/ma", "ma", "after save");
+        failures += expectOwners(stored, "share/ma/old", "ma", "after save");
+        failures += expectOwners(stored, "bin/m", "", "after save");
+        failures += expectOwners(stored, "", "", "after save");
+
+        // A reinstall hides the old manifest as soon as it is staged
+        if (stored.record(installed("ma", "2.0.0"), {directory("bin"), file("bin/ma"), file("share/ma/new")}) != 0)
+            return fail("reinstall not recorded");
+        failures += expectOwners(stored, "share/ma/old", "", "reinstall staged");
+        failures += expectOwners(stored, "share/ma/new", "ma", "reinstall staged");
+        failures += expectOwners(stored, "bin", "ma/ mb/", "reinstall staged");
+        // A package sorting first moves every stored owner up by one
+        if (stored.record(installed("aa", "1.0.0"), {file("bin/aa")}) != 0 || stored.save() != 0)
+            return fail("reinstall not saved");
+        InstalledDatabase renumbered;
+        if (renumbered.open(path) != 0)
+            return fail("renumbered database does not open");
+        failures += expectOwners(renumbered, "bin/mb", "mb", "after renumbering");
+        failures += expectOwners(renumbered, "bin/aa", "aa", "after renumbering");
+        failures += expectOwners(renumbered, "share/ma/old", "", "after reinstall");
+        failures += expectOwners(renumbered, "share/ma/new", "ma", "after reinstall");
+
+        // A path index left by an earlier transaction, or none at all, is rebuilt from the manifests
+        for (const std::string &stale : {firstPaths, std::string("OSPMPTH1 truncated"), std::string()})
+        {
+            writeAll(pathsFile, stale);
+            InstalledDatabase rebuilt;
+            if (rebuilt.open(path) != 0)
+                return fail("database with a stale path index does not open");
+            failures += expectOwners(rebuilt, "bin/mb", "mb", "stale path index");
+            failures += expectOwners(rebuilt, "share/ma/old", "", "stale path index");
+            failures += expectOwners(rebuilt, "bin", "ma/ mb/", "stale path index");
+        }
+
+        // Removal drops the package's entries, and the next save writes a fresh index
+        InstalledDatabase removing;
+        if (removing.open(path) != 0)
+            return fail("database does not open for removal");
+        removing.forget("mb");
+        failures += expectOwners(removing, "bin/mb", "", "removal staged");
+        if (removing.save() != 0 || removing.open(path) != 0)
+            return fail("removal not saved");
+        failures += expectOwners(removing, "bin/mb", "", "after removal");
+        failures += expectOwners(removing, "bin", "ma/", "after removal");
+        failures += expectOwners(removing, "bin/aa", "aa", "after removal");
+        return failures;
+    }
+
+    std::string joined(const std::vector<std::string> &names)
+    {
+        std::string out;
+        for (const auto &name : names)
+        {
+            out += (out.empty() ? "" : " ") + name;
+        }
+        return out;
+    }
+
+    int testOrphans(const TempDir &dir)
+    {
+        // app is explicit; lib and base come with it; cycle-a and cycle-b only need each other
+        std::string path = (dir / "orphans").string();
+        InstalledDatabase db;
+        if (db.open(path) != 0 || db.record(installed("app", "1.0.0", {"lib", "missing"}), {file("bin/app")}) != 0 ||
+            db.record(installed("lib", "1.0.0", {"base"}, true), {file("lib/liblib.so")}) != 0 ||
+            db.record(installed("base", "1.0.0", {}, true), {file("lib/libbase.so")}) != 0 ||
+            db.record(installed("cycle-a", "1.0.0", {"cycle-b"}, true), {file("bin/cycle-a")}) != 0 ||
+            db.record(installed("cycle-b", "1.0.0", {"cycle-a"}, true), {file("bin/cycle-b")}) != 0 ||
+            db.record(installed("loose", "1.0.0", {"base"}, true), {file("bin/loose")}) != 0)
+            return fail("packages not recorded");
+        if (joined(db.orphans()) != "cycle-a cycle-b loose")
+            return fail("staged orphans: " + joined(db.orphans()));
+        if (db.save() != 0)
+            return fail("database not saved");
+
+        InstalledDatabase stored;
+        if (stored.open(path) != 0)
+            return fail("database does not open");
+        if (joined(stored.orphans()) != "cycle-a cycle-b loose")
+            return fail("stored orphans: " + joined(stored.orphans()));
+        if (joined(stored.dependents("base")) != "lib loose" || joined(stored.dependents("lib")) != "app" ||
+            joined(stored.dependents("cycle-a")) != "cycle-b" || !stored.dependents("app").empty())
+            return fail("dependents not recorded");
+
+        // The flag of a package installed again depends on how it got there first
+        const std::vector<std::string> requested = {"tool"};
+        if (!stored.installsAutomatically("new-dep", requested) || !stored.installsAutomatically("lib", requested) ||
+            stored.installsAutomatically("app", requested) || stored.installsAutomatically("tool", requested) ||
+            stored.installsAutomatically("lib", {"lib"}) || stored.installsAutomatically("new-dep", {}))
+            return fail("automatic flag not carried over");
+
+        // A staged change moves the dependents and the orphans with it
+        stored.forget("app");
+        if (joined(stored.orphans()) != "base cycle-a cycle-b lib loose")
+            return fail("orphans after removing the only explicit package: " + joined(stored.orphans()));
+        if (!stored.dependents("lib").empty())
+            return fail("removed package still listed as a dependent");
+        if (stored.record(installed("loose", "2.0.0", {}, false), {file("bin/loose")}) != 0)
+            return fail("reinstall not recorded");
+        if (joined(stored.orphans()) != "base cycle-a cycle-b lib" || joined(stored.dependents("base")) != "lib")
+            return fail("explicit reinstall not taken into account");
+        return 0;
+    }
+
+    int testRemoveRequired(const TempDir &dir)
+    {
+        getConfig()->dataDir = (dir / "data").string();
+        getConfig()->targetDir = (dir / "target").string();
+        InstalledDatabase db;
+        if (db.open(installedDatabasePath()) != 0 || db.record(installed("app", "1.0.0", {"lib"}), {directory("bin"), file("bin/app")}) != 0 ||
+            db.record(installed("lib", "1.0.0", {}, true), {directory("lib"), file("lib/liblib.so")}) != 0 || db.save() != 0)
+            return fail("database not written");
+        for (const char *name : {"bin/app", "lib/liblib.so"})
+        {
+            std::filesystem::path target = dir / "target" / name;
+            std::filesystem::create_directories(target.parent_path());
+            std::ofstream(target) << name;
+        }
+
+        if (removePackages({"lib"}) == 0)
+            return fail("removed a package another one requires");
+        InstalledDatabase after;
+        if (after.open(installedDatabasePath()) != 0 || !after.isInstalled("lib") ||
+            !std::filesystem::exists(dir / "target" / "lib" / "liblib.so"))
+            return fail("refused removal changed something");
+        // Removed together, the dependent no longer blocks it
+        if (removePackages({"lib", "app"}) != 0)
+            return fail("package and its only dependent not removed together");
+        if (after.open(installedDatabasePath()) != 0 || !after.list().empty() || std::filesystem::exists(dir / "target" / "bin" / "app"))
+            return fail("removal left packages or files behind");
+        return 0;
+    }
+} // namespace
+
+int main()
+{
+    TempDir dir("openspm-test-installed");
+    int failures = 0;
+    failures += testRoundTrip(dir);
+    failures += testOlderIndex(dir);
+    failures += testCorrupt(dir);
+    failures += testOwnership(dir);
+    failures += testOrphans(dir);
+    failures += testRemoveRequired(dir);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+#include <name_index.hpp>
+#include <config.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "test_support.hpp"
+using namespace openspm;
+using namespace openspm::test;
+
+namespace
+{
+    std::string joined(const std::vector<std::string_view> &names)
+    {
+        std::string out;
+        for (std::string_view name : names)
+        {
+            out += (out.empty() ? "" : " ") + std::string(name);
+        }
+        return out;
+    }
+} // namespace
+
+int main()
+{
+    TempDir dir("openspm-test-names");
+    getConfig()->dataDir = dir.path().string();
+
+    if (writeNameIndex({"zlib", "curl", "libfoo", "libfoo-dev", "libbar", "curl", "lib"},
+                       {"https://repo.example", "https://mirror.example", "https://repo.example"}) != 0)
+        return fail("index not written");
+
+    NameIndex index;
+    if (index.open(nameIndexPath()) != 0)
+        return fail("index does not open");
+
+    using Section = NameIndex::Section;
+    const std::pair<std::string, std::string> cases[] = {
+        {"lib", "lib libbar libfoo libfoo-dev"},
+        {"libfoo", "libfoo libfoo-dev"},
+        {"libfoo-", "libfoo-dev"},
+        {"c", "curl"},
+        {"", "curl lib libbar libfoo libfoo-dev zlib"},
+        {"zz", ""},
+        {"a", ""},
+        {"zlib-extra", ""},
+    };
+    for (const auto &[prefix, expected] : cases)
+    {
+        std::string actual = joined(index.complete(Section::Packages, prefix));
+        if (actual != expected)
+            return fail("'" + prefix + "': expected '" + expected + "', got '" + actual + "'");
+    }
+    if (joined(index.complete(Section::Repositories, "https://")) != "https://mirror.example https://repo.example")
+        return fail("repository section not deduplicated and sorted");
+    if (!index.complete(Section::Repositories, "lib").empty())
+        return fail("sections are mixed up");
+
+    NameIndex empty;
+    if (writeNameIndex({}, {}) != 0 || empty.open(nameIndexPath()) != 0 || !empty.complete(Section::Packages, "").empty())
+        return fail("empty index does not work");
+
+    std::ofstream(dir / "broken.idx") << "OSPMNAM1 but then nothing useful";
+    NameIndex broken;
+    if (broken.open((dir / "broken.idx").string()) == 0)
+        return fail("corrupt index opened");
+    NameIndex missing;
+    if (missing.open((dir / "missing.idx").string()) == 0)
+        return fail("missing index opened");
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <package_list_parser.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "test_support.hpp"
+using namespace openspm;
+using namespace openspm::test;
+
+namespace
+{
+    /// A package with every serialized field set, including ones that need escaping
+    PackageInfo documented(const std::string &name, const std::string &version, std::vector<std::string> dependencies)
+    {
+        PackageInfo pkg = package(name, version, std::move(dependencies));
+        pkg.description = "Line one\n\"quoted\" \\ tab\t end";
+        pkg.maintainer = "Jane <jane@example.org>";
+        pkg.url = "https://example.org/" + name + ".tar.gz";
+        return pkg;
+    }
+
+    bool samePackage(const PackageInfo &a, const PackageInfo &b)
+    {
+        return a.name == b.name && a.version == b.version && a.description == b.description && a.maintainer == b.maintainer &&
+               a.tags == b.tags && a.url == b.url && a.dependencies == b.dependencies;
+    }
+
+    int testDocument()
+    {
+        std::string json = R"({
+  "name": "Example repository",
+  "depend": ["https://base.example"],
+  "metadata": {"packages": [{"name": "not-a-package"}], "count": 3},
+  "packages": [
+    {"name": "libfoo", "version": 1.10, "dependencies": ["libbar ^1.2"], "homepage": "https://example.org",
+     "extra": {"nested": [1, 2, {"name": "ignored"}]}},
+    {"name": "libbar", "version": "1.2.0", "description": "caf\u00e9 \"bar\"", "tags": "bin"}
+  ]
+})";
+        std::vector<PackageInfo> packages;
+        std::vector<std::string> depends;
+        std::string parseError;
+        if (parsePackageListJson(json, [&](PackageInfo &&pkg) { packages.push_back(std::move(pkg)); }, depends, parseError) != 0)
+            return fail("valid document rejected: " + parseError);
+        if (depends != std::vector<std::string>{"https://base.example"})
+            return fail("depend list not read");
+        if (packages.size() != 2)
+            return fail("expected 2 packages, got " + std::to_string(packages.size()));
+        if (packages[0].name != "libfoo" || packages[0].version != "1.10" ||
+            packages[0].dependencies != std::vector<std::string>{"libbar ^1.2"})
+            return fail("libfoo misparsed, version '" + packages[0].version + "'");
+        if (packages[1].description != "caf\xc3\xa9 \"bar\"" || packages[1].tags != "bin")
+            return fail("escaped strings misparsed");
+        return 0;
+    }
+
+    int testInvalid()
+    {
+        const char *invalid[] = {
+            "[]",
+            "{\"packages\": {}}",
+            "{\"name\": \"no packages\"}",
+            "{\"packages\": [{\"name\": \"a\"}",
+            "not json",
+            "",
+        };
+        for (const char *text : invalid)
+        {
+            std::string json = text;
+            std::vector<std::string> depends;
+            std::string parseError;
+            if (parsePackageListJson(json, [](PackageInfo &&) {}, depends, parseError) == 0 || parseError.empty())
+                return fail(std::string("invalid document accepted: ") + text);
+        }
+        return 0;
+    }
+
+    int testRoundTrip()
+    {
+        std::vector<PackageInfo> packages = {documented("libfoo", "1.10", {"libbar ^1.2", "libbaz >=2, <3"}),
+                                             documented("libbar", "1.2.0", {}), documented("libbaz", "2.0.0-rc.1", {"libbar"})};
+        std::string json = serializePackageListJson(packages, "https://repo.example");
+
+        // Whole-document parser
+        std::string copy = json;
+        std::vector<PackageInfo> parsed;
+        std::vector<std::string> depends;
+        std::string parseError;
+        if (parsePackageListJson(copy, [&](PackageInfo &&pkg) { parsed.push_back(std::move(pkg)); }, depends, parseError) != 0)
+            return fail("serialized document rejected: " + parseError);
+        if (parsed.size() != packages.size())
+            return fail("serialized document lost packages");
+        for (size_t i = 0; i < packages.size(); ++i)
+        {
+            if (!samePackage(parsed[i], packages[i]))
+                return fail("package changed in the round trip: " + packages[i].name);
+        }
+
+        // Line reader, which takes the serializer's layout one package at a time
+        PackageListReader reader(json);
+        PackageInfo pkg;
+        size_t read = 0;
+        while (reader.next(pkg))
+        {
+            if (read >= packages.size() || !samePackage(pkg, packages[read]))
+                return fail("reader returned a different package at " + std::to_string(read));
+            ++read;
+        }
+        if (read != packages.size() || !reader.error().empty())
+            return fail("reader stopped early: " + reader.error());
+
+        // Any other layout is read whole
+        PackageListReader compact("{\"packages\":[{\"name\":\"a\",\"version\":\"1\"},{\"name\":\"b\",\"version\":\"2\"}]}");
+        std::string names;
+        while (compact.next(pkg))
+            names += pkg.name;
+        if (names != "ab" || !compact.error().empty())
+            return fail("reader does not fall back to whole-document parsing");
+
+        PackageListReader broken("{\"packages\": [");
+        if (broken.next(pkg) || broken.error().empty())
+            return fail("reader accepts a truncated document");
+        return 0;
+    }
+} // namespace
+
+int main()
+{
+    int failures = 0;
+    failures += testDocument();
+    failures += testInvalid();
+    failures += testRoundTrip();
+    return failures == 0 ? 0 : 1;
+}
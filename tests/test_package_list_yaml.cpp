@@ -0,0 +1,120 @@
+#include <package_list_parser.hpp>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "test_support.hpp"
+using namespace openspm;
+using namespace openspm::test;
+
+namespace
+{
+    const char *Document = R"(# A repository package list
+name: Example repository
+depend:
+  - https://base.example
+  - https://extra.example
+metadata:
+  mirrors: [a, b]
+  nested: {packages: [{name: not-a-package}]}
+packages:
+  - name: libfoo
+    version: 1.10
+    description: "Foo: the library"
+    maintainer: Jane <jane@example.org>
+    dependencies: [libbar ^1.2, "libbaz >=2, <3"]
+    tags: bin;linux-x86_64
+    url: https://example.org/libfoo-1.10.tar.gz
+    homepage: https://example.org
+  - name: libbar
+    version: 1.2.0
+    dependencies:
+      - libbaz
+    extra:
+      - {ignored: true}
+  - {name: libbaz, version: "2.0.0"}
+)";
+
+    int checkPackages(const std::vector<PackageInfo> &packages, const std::vector<std::string> &depends)
+    {
+        if (depends != std::vector<std::string>{"https://base.example", "https://extra.example"})
+            return fail("depend list not read");
+        if (packages.size() != 3)
+            return fail("expected 3 packages, got " + std::to_string(packages.size()));
+        const PackageInfo &foo = packages[0];
+        if (foo.name != "libfoo" || foo.version != "1.10" || foo.description != "Foo: the library" ||
+            foo.maintainer != "Jane <jane@example.org>" || foo.tags != "bin;linux-x86_64" ||
+            foo.url != "https://example.org/libfoo-1.10.tar.gz")
+            return fail("scalar fields of libfoo not read verbatim");
+        if (foo.dependencies != std::vector<std::string>{"libbar ^1.2", "libbaz >=2, <3"})
+            return fail("flow dependency list not read");
+        if (packages[1].name != "libbar" || packages[1].dependencies != std::vector<std::string>{"libbaz"})
+            return fail("block dependency list not read");
+        if (packages[2].name != "libbaz" || packages[2].version != "2.0.0" || !packages[2].dependencies.empty())
+            return fail("flow mapping package not read");
+        return 0;
+    }
+
+    int testStream()
+    {
+        std::istringstream input(Document);
+        std::vector<PackageInfo> packages;
+        std::vector<std::string> depends;
+        std::string parseError;
+        if (parsePackageList(input, [&](PackageInfo &&pkg) { packages.push_back(std::move(pkg)); }, depends, parseError) != 0)
+            return fail("valid document rejected: " + parseError);
+        return checkPackages(packages, depends);
+    }
+
+    int testChunks()
+    {
+        // Chunks that split lines, keys and values
+        for (size_t chunk : {size_t(1), size_t(7), size_t(64), size_t(100000)})
+        {
+            std::vector<PackageInfo> packages;
+            PackageListStream stream([&](PackageInfo &&pkg) { packages.push_back(std::move(pkg)); });
+            std::string text = Document;
+            for (size_t pos = 0; pos < text.size(); pos += chunk)
+            {
+                if (!stream.feed(text.data() + pos, std::min(chunk, text.size() - pos)))
+                    return fail("feed failed at chunk size " + std::to_string(chunk));
+            }
+            std::vector<std::string> depends;
+            std::string parseError;
+            if (stream.finish(depends, parseError) != 0)
+                return fail("chunked document rejected: " + parseError);
+            if (checkPackages(packages, depends) != 0)
+                return fail("chunk size " + std::to_string(chunk) + " changes the result");
+        }
+        return 0;
+    }
+
+    int testInvalid()
+    {
+        const char *invalid[] = {
+            "- just\n- a list\n",
+            "packages: not-a-list\n",
+            "name: no packages\n",
+            "",
+            "packages:\n  - name: a\n    version: 1\n  - {name: b\n",
+        };
+        for (const char *text : invalid)
+        {
+            std::istringstream input(text);
+            std::vector<std::string> depends;
+            std::string parseError;
+            if (parsePackageList(input, [](PackageInfo &&) {}, depends, parseError) == 0 || parseError.empty())
+                return fail(std::string("invalid document accepted: ") + text);
+        }
+        return 0;
+    }
+} // namespace
+
+int main()
+{
+    int failures = 0;
+    failures += testStream();
+    failures += testChunks();
+    failures += testInvalid();
+    return failures == 0 ? 0 : 1;
+}
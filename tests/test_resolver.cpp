@@ -0,0 +1,223 @@
+#include <catalog.hpp>
+#include <resolver.hpp>
+#include <version.hpp>
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include "test_support.hpp"
+using namespace openspm;
+using namespace openspm::test;
+
+namespace
+{
+    Catalog catalogOf(std::vector<PackageInfo> packages)
+    {
+        std::sort(packages.begin(), packages.end(), [](const PackageInfo &a, const PackageInfo &b)
+                  { return a.name < b.name; });
+        Catalog catalog;
+        catalog.setPackages(std::move(packages));
+        return catalog;
+    }
+
+    int resolve(const Catalog &catalog, const std::string &name, ResolveResult &result)
+    {
+        return resolveDependencies(catalog, {Dependency{name, VersionRange()}}, Tags, result);
+    }
+
+    std::string versionIn(const ResolveResult &result, const std::string &name)
+    {
+        for (const auto &pkg : result.plan)
+        {
+            if (pkg.name == name)
+                return pkg.version;
+        }
+        return "";
+    }
+
+    /// One version per name, every dependency in range and placed before its dependent
+    bool planHolds(const ResolveResult &result, std::string &outProblem)
+    {
+        std::map<std::string, VersionKey> placed;
+        for (const auto &pkg : result.plan)
+        {
+            if (placed.count(pkg.name) != 0)
+            {
+                outProblem = pkg.name + " selected twice";
+                return false;
+            }
+            for (const auto &spec : pkg.dependencies)
+            {
+                Dependency dep;
+                std::string parseError;
+                if (parseDependency(spec, dep, parseError) != 0)
+                {
+                    outProblem = parseError;
+                    return false;
+                }
+                if (dep.name == pkg.name)
+                {
+                    if (!dep.range.contains(parseVersion(pkg.version)))
+                    {
+                        outProblem = pkg.name + " excludes itself";
+                        return false;
+                    }
+                    continue;
+                }
+                auto it = placed.find(dep.name);
+                if (it == placed.end() || !dep.range.contains(it->second))
+                {
+                    outProblem = pkg.name + " " + pkg.version + " requires " + spec;
+                    return false;
+                }
+            }
+            placed.emplace(pkg.name, parseVersion(pkg.version));
+        }
+        return true;
+    }
+
+    bool explains(const ResolveResult &result, const std::string &text)
+    {
+        return std::any_of(result.explanation.begin(), result.explanation.end(), [&](const std::string &line)
+                           { return line.find(text) != std::string::npos; });
+    }
+
+    int testNewestFirst()
+    {
+        Catalog catalog = catalogOf({package("app", "1.0.0", {"libfoo"}), package("app", "2.0.0", {"libfoo >=1.2"}),
+                                     package("libfoo", "1.0.0"), package("libfoo", "1.4.0"), package("libfoo", "2.0.0-rc.1")});
+        ResolveResult result;
+        if (resolve(catalog, "app", result) != 0)
+            return fail("simple plan not resolved");
+        std::string problem;
+        if (!planHolds(result, problem))
+            return fail("simple plan: " + problem);
+        if (versionIn(result, "app") != "2.0.0" || versionIn(result, "libfoo") != "2.0.0-rc.1" || result.plan.back().name != "app")
+            return fail("simple plan does not pick the newest versions, dependencies first");
+        return 0;
+    }
+
+    int testBacktracking()
+    {
+        // libbar 2 wants libfoo ^2, which app rules out, so libbar has to step back to 1
+        Catalog catalog = catalogOf({package("app", "1.0.0", {"libfoo ^1", "libbar"}), package("libbar", "1.0.0", {"libfoo ^1"}),
+                                     package("libbar", "2.0.0", {"libfoo ^2"}), package("libfoo", "1.0.0"),
+                                     package("libfoo", "1.4.0"), package("libfoo", "2.0.0")});
+        ResolveResult result;
+        if (resolve(catalog, "app", result) != 0)
+            return fail("backtracking plan not resolved");
+        std::string problem;
+        if (!planHolds(result, problem))
+            return fail("backtracking plan: " + problem);
+        if (versionIn(result, "libbar") != "1.0.0" || versionIn(result, "libfoo") != "1.4.0")
+            return fail("backtracking picked libbar " + versionIn(result, "libbar") + ", libfoo " + versionIn(result, "libfoo"));
+        if (result.decisions < 4)
+            return fail("backtracking plan found without trying libbar 2.0.0");
+        return 0;
+    }
+
+    int testBackjumpOverUnrelated()
+    {
+        // The conflict on libz is caused by top's choice of mid, not by the unrelated packages decided in between
+        std::vector<PackageInfo> packages = {package("top", "1.0.0", {"mid", "u1", "u2", "u3", "u4"}),
+                                             package("mid", "1.0.0", {"libz ^1"}), package("mid", "2.0.0", {"libz ^2", "tail"}),
+                                             package("tail", "1.0.0", {"libz ^1"}), package("libz", "1.0.0"),
+                                             package("libz", "2.0.0")};
+        for (const char *name : {"u1", "u2", "u3", "u4"})
+        {
+            packages.push_back(package(name, "1.0.0"));
+            packages.push_back(package(name, "2.0.0"));
+        }
+        Catalog catalog = catalogOf(std::move(packages));
+        ResolveResult result;
+        if (resolve(catalog, "top", result) != 0)
+            return fail("backjump plan not resolved");
+        std::string problem;
+        if (!planHolds(result, problem))
+            return fail("backjump plan: " + problem);
+        if (versionIn(result, "mid") != "1.0.0" || versionIn(result, "u1") != "2.0.0" || versionIn(result, "u4") != "2.0.0")
+            return fail("backjump changed packages that played no part in the conflict");
+        return 0;
+    }
+
+    int testSelfExclusion()
+    {
+        Catalog catalog = catalogOf({package("selfish", "1.0.0", {"selfish ^1"}), package("selfish", "2.0.0", {"selfish ^1"})});
+        ResolveResult result;
+        if (resolve(catalog, "selfish", result) != 0)
+            return fail("self-dependency not resolved");
+        if (versionIn(result, "selfish") != "1.0.0" || result.plan.size() != 1)
+            return fail("selected a version that excludes itself");
+
+        Catalog impossible = catalogOf({package("loop", "1.0.0", {"loop >=2"})});
+        ResolveResult rejected;
+        if (resolve(impossible, "loop", rejected) == 0)
+            return fail("a package excluding itself was selected");
+        if (!explains(rejected, "loop 1.0.0 requires loop >=2, which excludes itself"))
+            return fail("self-exclusion not explained");
+        return 0;
+    }
+
+    int testCycles()
+    {
+        Catalog catalog = catalogOf({package("a", "1.0.0", {"b"}), package("b", "1.0.0", {"a"})});
+        ResolveResult result;
+        if (resolve(catalog, "a", result) != 0)
+            return fail("dependency cycle not resolved");
+        if (result.plan.size() != 2 || result.plan.back().name != "a")
+            return fail("dependency cycle plan is wrong");
+        return 0;
+    }
+
+    int testUnsatisfiable()
+    {
+        Catalog catalog = catalogOf({package("app", "1.0.0", {"libfoo ^2", "libbar"}), package("libbar", "1.0.0", {"libfoo ^1"}),
+                                     package("libfoo", "1.4.0"), package("libfoo", "2.0.0")});
+        ResolveResult result;
+        if (resolve(catalog, "app", result) == 0)
+            return fail("conflicting ranges resolved");
+        if (!result.plan.empty())
+            return fail("failed resolution returned a plan");
+        if (!explains(result, "libbar 1.0.0 requires libfoo ^1, but libfoo 2.0.0 is selected (required by app 1.0.0)"))
+        {
+            for (const auto &line : result.explanation)
+                std::cout << "  " << line << std::endl;
+            return fail("conflict not explained");
+        }
+
+        ResolveResult missing;
+        if (resolve(catalog, "nothing", missing) == 0 || !explains(missing, "Package not found: nothing"))
+            return fail("missing package not reported");
+
+        Catalog foreign = catalogOf({package("app", "1.0.0", {"libwin"}), package("libwin", "1.0.0", {}, "bin;windows-x86_64")});
+        ResolveResult incompatible;
+        if (resolve(foreign, "app", incompatible) == 0 || !explains(incompatible, "compatible with the system tags"))
+            return fail("tag-incompatible dependency not explained");
+        return 0;
+    }
+
+    int testDecisionLimit()
+    {
+        Catalog catalog = catalogOf({package("app", "1.0.0", {"libfoo ^2", "libbar"}), package("libbar", "1.0.0", {"libfoo ^1"}),
+                                     package("libbar", "2.0.0", {"libfoo ^1"}), package("libfoo", "1.0.0"),
+                                     package("libfoo", "2.0.0")});
+        ResolveResult result;
+        if (resolveDependencies(catalog, {Dependency{"app", VersionRange()}}, Tags, result, 2) == 0)
+            return fail("decision limit ignored");
+        if (result.decisions > 2 || !explains(result, "Gave up after trying"))
+            return fail("decision limit not reported");
+        return 0;
+    }
+} // namespace
+
+int main()
+{
+    int failures = 0;
+    failures += testNewestFirst();
+    failures += testBacktracking();
+    failures += testBackjumpOverUnrelated();
+    failures += testSelfExclusion();
+    failures += testCycles();
+    failures += testUnsatisfiable();
+    failures += testDecisionLimit();
+    return failures == 0 ? 0 : 1;
+}
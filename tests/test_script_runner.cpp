@@ -0,0 +1,153 @@
+#include <script_runner.hpp>
+#include <config.hpp>
+#include <logger.hpp>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "test_support.hpp"
+using namespace openspm;
+using namespace openspm::test;
+
+#ifndef _WIN32
+namespace
+{
+    /// A job running a shell script written to @p dir, with SCRATCH pointing at it
+    ScriptJob script(const TempDir &dir, const std::string &name, const std::string &body,
+                     std::vector<std::string> after = {})
+    {
+        std::filesystem::path path = dir / (name + ".sh");
+        std::ofstream(path) << body << "\n";
+        ScriptJob job;
+        job.name = name;
+        job.scriptPath = path.string();
+        job.env = {"SCRATCH=" + dir.path().string()};
+        job.after = std::move(after);
+        return job;
+    }
+
+    const ScriptResult *resultOf(const std::vector<ScriptResult> &results, const std::string &name)
+    {
+        for (const auto &result : results)
+        {
+            if (result.name == name)
+                return &result;
+        }
+        return nullptr;
+    }
+
+    int testOutputAndEnvironment(const TempDir &dir)
+    {
+        getConfig()->logsFile = (dir / "openspm.log").string();
+        logger::initFileLogging();
+        ScriptJob job = script(dir, "greeter", "echo \"hello from $GREETING\"\necho 'to stderr' >&2\nprintf 'no newline'");
+        job.env.push_back("GREETING=the test");
+        std::vector<ScriptResult> results;
+        if (runScripts({job}, 1, 0, results) != 0 || results.size() != 1 || results[0].exitCode != 0)
+            return fail("successful script reported as failed");
+        logger::flush();
+        std::stringstream log;
+        log << std::ifstream(dir / "openspm.log").rdbuf();
+        for (const char *line : {"[greeter] hello from the test", "[greeter] to stderr", "[greeter] no newline"})
+        {
+            if (log.str().find(line) == std::string::npos)
+                return fail(std::string("script output missing from the log: ") + line);
+        }
+        return 0;
+    }
+
+    int testOrderingAndSkips(const TempDir &dir)
+    {
+        std::vector<ScriptJob> jobs = {
+            script(dir, "late", "test -f \"$SCRATCH/early.done\"", {"early"}),
+            script(dir, "early", "sleep 0.2\ntouch \"$SCRATCH/early.done\""),
+            script(dir, "broken", "exit 3"),
+            script(dir, "child", "touch \"$SCRATCH/child.ran\"", {"broken"}),
+            script(dir, "grandchild", "touch \"$SCRATCH/grandchild.ran\"", {"child", "not-a-job"}),
+        };
+        std::vector<ScriptResult> results;
+        if (runScripts(jobs, 4, 0, results) == 0)
+            return fail("failed script not reported");
+        if (results.size() != jobs.size())
+            return fail("expected one result per job");
+        const ScriptResult *late = resultOf(results, "late");
+        if (late == nullptr || late->exitCode != 0)
+            return fail("job started before the job it runs after");
+        const ScriptResult *broken = resultOf(results, "broken");
+        if (broken == nullptr || broken->exitCode != 3 || broken->skipped)
+            return fail("exit code of the failed script not reported");
+        for (const char *name : {"child", "grandchild"})
+        {
+            const ScriptResult *skipped = resultOf(results, name);
+            if (skipped == nullptr || !skipped->skipped || std::filesystem::exists(dir / (std::string(name) + ".ran")))
+                return fail(std::string("dependent of a failed script was not skipped: ") + name);
+        }
+        return 0;
+    }
+
+    int testTimeout(const TempDir &dir)
+    {
+        // The background child shares the process group, so it is terminated with the script
+        auto start = std::chrono::steady_clock::now();
+        std::vector<ScriptResult> results;
+        int status = runScripts({script(dir, "slow", "sleep 30 &\nsleep 30")}, 1, 1, results);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        if (status == 0 || results.size() != 1 || !results[0].timedOut)
+            return fail("script not reported as timed out");
+        if (elapsed > std::chrono::seconds(10))
+            return fail("timed out script was not killed");
+        return 0;
+    }
+
+    int testParallelLimit(const TempDir &dir)
+    {
+        // Each script records how many scripts were running alongside it
+        const std::string body = "touch \"$SCRATCH/active.$NAME\"\n"
+                                 "sleep 0.3\n"
+                                 "ls \"$SCRATCH\" | grep -c '^active\\.' > \"$SCRATCH/seen.$NAME\"\n"
+                                 "rm \"$SCRATCH/active.$NAME\"";
+        for (unsigned limit : {1u, 2u, 4u})
+        {
+            std::vector<ScriptJob> jobs;
+            for (int i = 0; i < 6; ++i)
+            {
+                std::string name = "p" + std::to_string(limit) + "-" + std::to_string(i);
+                jobs.push_back(script(dir, name, body));
+                jobs.back().env.push_back("NAME=" + name);
+            }
+            std::vector<ScriptResult> results;
+            if (runScripts(jobs, limit, 0, results) != 0)
+                return fail("parallel scripts failed");
+            unsigned most = 0;
+            for (const auto &job : jobs)
+            {
+                unsigned seen = 0;
+                std::ifstream(dir / ("seen." + job.name)) >> seen;
+                most = std::max(most, seen);
+            }
+            if (most == 0 || most > limit)
+                return fail("saw " + std::to_string(most) + " scripts running with a limit of " + std::to_string(limit));
+            if (limit > 1 && most == 1)
+                return fail("scripts never ran concurrently with a limit of " + std::to_string(limit));
+        }
+        return 0;
+    }
+} // namespace
+#endif
+
+int main()
+{
+    int failures = 0;
+#ifndef _WIN32
+    TempDir dir("openspm-test-scripts");
+    failures += testOutputAndEnvironment(dir);
+    failures += testOrderingAndSkips(dir);
+    failures += testTimeout(dir);
+    failures += testParallelLimit(dir);
+#endif
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,58 @@
+#include <search_index.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "test_support.hpp"
+using namespace openspm;
+using namespace openspm::test;
+
+namespace
+{
+    PackageInfo described(const std::string &name, const std::string &version, const std::string &description,
+                          const std::string &tags = "bin")
+    {
+        PackageInfo pkg = package(name, version, {}, tags);
+        pkg.description = description;
+        return pkg;
+    }
+} // namespace
+
+int main()
+{
+    // Sorted by name, then version, as the merged view is
+    std::vector<PackageInfo> packages = {described("foo", "1.0.0", "Foo tool"), described("foo", "2.0.0", "Foo tool"),
+                                         described("foo", "3.0.0", "Foo tool", "other"), described("foobar", "1.0.0", "Bar"),
+                                         described("zlib", "1.3.0", "Compression library used by foo")};
+    SearchIndex index;
+    if (index.load(buildSearchIndex(packages)) != 0)
+        return fail("index does not load");
+
+    size_t total = 0;
+    std::vector<SearchResult> results = index.search("foo", "bin", 50, total);
+    if (results.size() != 3 || total != 3)
+        return fail("expected one result per name, got " + std::to_string(results.size()));
+    if (results[0].name != "foo" || results[0].version != "2.0.0")
+        return fail("exact name match is not first with its newest compatible version");
+    if (results[2].name != "zlib")
+        return fail("description match ranks above name matches");
+
+    results = index.search("FOO", "", 50, total);
+    if (results.empty() || results[0].version != "3.0.0")
+        return fail("search without tags does not return the newest version");
+
+    results = index.search("foo", "bin", 1, total);
+    if (results.size() != 1 || total != 3)
+        return fail("limit does not count names");
+
+    results = index.search("compression foo", "bin", 50, total);
+    if (results.size() != 1 || results[0].name != "zlib")
+        return fail("terms are not all required");
+
+    if (!index.search("nothing-like-this", "bin", 50, total).empty() || total != 0)
+        return fail("unmatched query returns results");
+
+    SearchIndex invalid;
+    if (invalid.load("not an index") == 0)
+        return fail("garbage loads as an index");
+    return 0;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file test_support.hpp
+ * @brief Helpers shared by the test executables
+ *
+ * Test functions return the number of failed checks; main sums them and
+ * exits non-zero if any failed.
+ */
+#pragma once
+#include <package_manager.hpp>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+namespace openspm::test
+{
+    /// Tags every package built by package() carries unless told otherwise
+    constexpr const char *Tags = "bin;linux-x86_64";
+
+    /**
+     * @brief Report a failed check
+     * @return 1, to be added to the caller's failure count
+     */
+    inline int fail(const std::string &message)
+    {
+        std::cout << "test failed: " << message << std::endl;
+        return 1;
+    }
+
+    /**
+     * @brief A catalog entry with the fields most tests care about
+     * @param dependencies Dependency specs ("name range")
+     */
+    inline PackageInfo package(const std::string &name, const std::string &version,
+                               std::vector<std::string> dependencies = {}, const std::string &tags = Tags)
+    {
+        PackageInfo pkg;
+        pkg.name = name;
+        pkg.version = version;
+        pkg.tags = tags;
+        pkg.dependencies = std::move(dependencies);
+        return pkg;
+    }
+
+    /**
+     * @brief An empty scratch directory under the system temp directory
+     *
+     * Whatever was left there by an earlier run is removed on creation,
+     * and the directory is removed again when the object goes away.
+     */
+    class TempDir
+    {
+    public:
+        explicit TempDir(const std::string &name) : dir(std::filesystem::temp_directory_path() / name)
+        {
+            std::filesystem::remove_all(dir);
+            std::filesystem::create_directories(dir);
+        }
+        ~TempDir()
+        {
+            std::error_code ec;
+            std::filesystem::remove_all(dir, ec);
+        }
+        TempDir(const TempDir &) = delete;
+        TempDir &operator=(const TempDir &) = delete;
+
+        const std::filesystem::path &path() const { return dir; }
+        std::filesystem::path operator/(const std::string &name) const { return dir / name; }
+
+    private:
+        std::filesystem::path dir;
+    };
+} // namespace openspm::test
@@ -0,0 +1,133 @@
+#include <triggers.hpp>
+#include <utils.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "test_support.hpp"
+using namespace openspm;
+using namespace openspm::test;
+
+namespace
+{
+    int testGlobMatch()
+    {
+        struct Case
+        {
+            const char *pattern;
+            const char *path;
+            bool matches;
+        };
+        const Case cases[] = {
+            {"lib/libz.so", "lib/libz.so", true},
+            {"lib/libz.so", "lib/libz.so.1", false},
+            {"lib/libz.so*", "lib/libz.so.1.3", true},
+            {"lib/*.so", "lib/libz.so", true},
+            {"lib/*.so", "lib/sub/libz.so", false},
+            {"*", "bin", true},
+            {"*", "bin/tool", false},
+            {"**.so", "libz.so", true},
+            {"**.so", "usr/lib/x86_64/libz.so", true},
+            {"**.so", "usr/lib/libz.so.1", false},
+            {"**.so.*", "usr/lib/libz.so.1", true},
+            {"share/**/*.desktop", "share/applications/a.desktop", true},
+            {"share/**/*.desktop", "share/a/b/c.desktop", true},
+            {"share/**/*.desktop", "share/a.desktop", false},
+            {"bin/?", "bin/x", true},
+            {"bin/?", "bin/xy", false},
+            {"a?b", "a/b", false},
+            {"**", "any/depth/at/all", true},
+            {"*a*b*c", "xaybzc", true},
+            {"*a*b*c", "xaybz", false},
+            {"", "", true},
+            {"", "x", false},
+        };
+        for (const auto &c : cases)
+        {
+            if (globMatch(c.pattern, c.path) != c.matches)
+                return fail(std::string("'") + c.pattern + (c.matches ? "' does not match '" : "' matches '") + c.path + "'");
+        }
+        return 0;
+    }
+
+    TriggerInfo trigger(const std::string &name, std::vector<std::string> paths, const std::string &package)
+    {
+        TriggerInfo info;
+        info.name = name;
+        info.paths = std::move(paths);
+        info.command = "touch \"$PKG_INSTALL_DIR/$OPENSPM_TRIGGER.ran\"";
+        info.package = package;
+        return info;
+    }
+
+    int testActivation()
+    {
+#ifndef _WIN32
+        TempDir dir("openspm-test-triggers");
+
+        TriggerSet triggers;
+        triggers.declare(trigger("ldconfig", {"**.so"}, "a"));
+        triggers.declare(trigger("ldconfig", {"**.so.*"}, "b"));
+        triggers.declare(trigger("desktop", {"share/**/*.desktop"}, "a"));
+        // Declared without paths by one package, so it stays always-on after globs are merged in
+        triggers.declare(trigger("always", {}, "a"));
+        triggers.declare(trigger("always", {"never/*"}, "b"));
+        triggers.declare(trigger("always-late", {"never/*"}, "a"));
+        triggers.declare(trigger("always-late", {}, "b"));
+        if (triggers.size() != 4)
+            return fail("triggers with the same name are not merged");
+
+        triggers.fileInstalled("usr/lib/libz.so.1");
+        triggers.fileInstalled("bin/tool");
+        if (triggers.runActivated(dir.path().string(), 2, 30) != 0)
+            return fail("activated triggers failed");
+        for (const char *name : {"ldconfig", "always", "always-late"})
+        {
+            if (!std::filesystem::exists(dir / (std::string(name) + ".ran")))
+                return fail(std::string("trigger did not run: ") + name);
+        }
+        if (std::filesystem::exists(dir / "desktop.ran"))
+            return fail("trigger ran without a matching path");
+#endif
+        return 0;
+    }
+
+    int testLoad()
+    {
+        TempDir dir("openspm-test-trigger-yaml");
+        std::filesystem::path yaml = dir / "pkg.yaml";
+        std::ofstream(yaml) << "name: demo\n"
+                               "triggers:\n"
+                               "  - name: ldconfig\n"
+                               "    paths: [\"**.so\", \"**.so.*\"]\n"
+                               "    command: ldconfig\n"
+                               "  - name: always\n"
+                               "    command: true\n";
+        std::vector<TriggerInfo> loaded;
+        if (loadPackageTriggers(yaml.string(), "demo", loaded) != 0 || loaded.size() != 2)
+            return fail("triggers section not loaded");
+        if (loaded[0].paths.size() != 2 || loaded[0].command != "ldconfig" || loaded[0].package != "demo" || !loaded[1].paths.empty())
+            return fail("trigger fields not loaded");
+
+        std::ofstream(yaml) << "triggers:\n  - paths: [\"x\"]\n    command: true\n";
+        loaded.clear();
+        if (loadPackageTriggers(yaml.string(), "demo", loaded) == 0)
+            return fail("trigger without a name accepted");
+
+        std::ofstream(yaml) << "name: plain\n";
+        loaded.clear();
+        if (loadPackageTriggers(yaml.string(), "plain", loaded) != 0 || !loaded.empty())
+            return fail("package without triggers rejected");
+        return 0;
+    }
+} // namespace
+
+int main()
+{
+    int failures = 0;
+    failures += testGlobMatch();
+    failures += testActivation();
+    failures += testLoad();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+#include <version.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "test_support.hpp"
+using namespace openspm;
+using namespace openspm::test;
+
+namespace
+{
+    bool accepts(const std::string &range, const std::string &version)
+    {
+        VersionRange parsed;
+        std::string parseError;
+        return parseVersionRange(range, parsed, parseError) == 0 && parsed.contains(parseVersion(version));
+    }
+
+    int testOrdering()
+    {
+        // Each version sorts strictly below the next
+        const std::vector<std::string> ascending = {"0.0.1", "0.1", "0.9.9", "1.0.0-1", "1.0.0-alpha", "1.0.0-alpha.2",
+                                                    "1.0.0-alpha.10", "1.0.0-beta", "1.0.0-rc.1", "1.0.0", "1.0.1", "1.2",
+                                                    "1.10.0", "2", "10.0.0"};
+        for (size_t i = 0; i + 1 < ascending.size(); ++i)
+        {
+            if (!(parseVersion(ascending[i]) < parseVersion(ascending[i + 1])))
+                return fail(ascending[i] + " does not sort below " + ascending[i + 1]);
+        }
+        const std::vector<std::pair<std::string, std::string>> equal = {
+            {"1", "1.0.0"}, {"v1.2.3", "1.2.3"}, {"1.2.3+build.5", "1.2.3"}, {"1.2.3.4", "1.2.3"}, {" 1.2", "1.2.0"}};
+        for (const auto &[a, b] : equal)
+        {
+            if (parseVersion(a) != parseVersion(b))
+                return fail(a + " and " + b + " parse differently");
+        }
+        if (parseVersion("99999999999.0.0") != parseVersion("16777215.0.0"))
+            return fail("oversized major not clamped");
+        return 0;
+    }
+
+    int testRanges()
+    {
+        struct Case
+        {
+            const char *range;
+            const char *version;
+            bool accepted;
+        };
+        const Case cases[] = {
+            {"", "0.0.1", true},
+            {"*", "5.0.0", true},
+            {"1.2.3", "1.2.3", true},
+            {"=1.2.3", "1.2.4", false},
+            {"==1.2", "1.2.0", true},
+            {">=1.2, <2", "1.9.9", true},
+            {">=1.2, <2", "2.0.0", false},
+            {">=1.2, <2", "2.0.0-rc.1", false},
+            {">=1.2 <2", "1.1.9", false},
+            {"<2.0.0-beta", "2.0.0-alpha", true},
+            {">1.0", "1.0.0", false},
+            {">1.0", "1.0.1", true},
+            {"<=1.0", "1.0.0", true},
+            {"^1.4", "1.9.0", true},
+            {"^1.4", "1.3.9", false},
+            {"^1.4", "2.0.0", false},
+            {"^0.3.1", "0.3.9", true},
+            {"^0.3.1", "0.4.0", false},
+            {"^0.0.3", "0.0.4", false},
+            {"^0", "0.9.0", true},
+            {"~2.1", "2.1.7", true},
+            {"~2.1", "2.2.0", false},
+            {"~2", "2.9.0", true},
+            {"(~2.1)", "2.1.0", true},
+            {">=1, <1", "1.0.0", false},
+        };
+        for (const auto &c : cases)
+        {
+            if (accepts(c.range, c.version) != c.accepted)
+                return fail(std::string("'") + c.range + "' " + (c.accepted ? "rejects " : "accepts ") + c.version);
+        }
+
+        VersionRange empty;
+        std::string parseError;
+        if (parseVersionRange(">=2, <1", empty, parseError) != 0 || !empty.empty())
+            return fail("disjoint constraints not recognized as empty");
+        VersionRange any;
+        if (parseVersionRange("*", any, parseError) != 0 || !any.any())
+            return fail("'*' does not accept everything");
+        return 0;
+    }
+
+    int testMalformed()
+    {
+        for (const char *range : {">=", "!=1.0", "^x", ">= abc", "<<"})
+        {
+            VersionRange parsed;
+            std::string parseError;
+            if (parseVersionRange(range, parsed, parseError) == 0 || parseError.empty())
+                return fail(std::string("malformed range accepted: ") + range);
+        }
+        return 0;
+    }
+
+    int testDependencies()
+    {
+        Dependency dep;
+        std::string parseError;
+        if (parseDependency("  libfoo >=1.2, <2", dep, parseError) != 0 || dep.name != "libfoo" ||
+            !dep.range.contains(parseVersion("1.5")) || dep.range.contains(parseVersion("2.0")))
+            return fail("dependency with constraints misparsed");
+        if (parseDependency("libbar(^1.4)", dep, parseError) != 0 || dep.name != "libbar" || !dep.range.contains(parseVersion("1.4.0")))
+            return fail("parenthesized constraint misparsed");
+        if (parseDependency("libbaz", dep, parseError) != 0 || !dep.range.any())
+            return fail("bare dependency is not unconstrained");
+        if (dependencyName("  libqux~1") != "libqux")
+            return fail("dependencyName keeps the constraint");
+        if (parseDependency(" >=1.0", dep, parseError) == 0)
+            return fail("dependency without a name accepted");
+        if (parseDependency("libfoo >=", dep, parseError) == 0 || parseError.find("libfoo >=") == std::string::npos)
+            return fail("malformed dependency not reported with its spec");
+        return 0;
+    }
+} // namespace
+
+int main()
+{
+    int failures = 0;
+    failures += testOrdering();
+    failures += testRanges();
+    failures += testMalformed();
+    failures += testDependencies();
+    return failures == 0 ? 0 : 1;
+}